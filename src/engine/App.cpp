@@ -21,6 +21,15 @@
 #include "Language.h"
 #include "config.h"
 #include "Menu.h"
+#include "net/ReplicationManager.h"
+#include "InputRecorder.h"
+#include "graphics/ImageKernels.h"
+#include "LogRing.h"
+#include "JobSystem.h"
+#include "FrameLimiter.h"
+#include "MemoryArena.h"
+#include "MemoryTracker.h"
+#include "Metrics.h"
 
 #define WINDOW_TITLE        "OpenHoW"
 
@@ -37,6 +46,10 @@ static void* u_calloc( size_t num, size_t size ) {
 	return ohw::GetApp()->CAlloc( num, size, true );
 }
 
+static void App_LogOutputCallback( int level, const char *msg ) {
+	ohw::LogRing::GetInstance()->Push( level, msg );
+}
+
 ohw::App::App( int argc, char **argv ) {
 	pl_malloc = u_malloc;
 	pl_calloc = u_calloc;
@@ -44,6 +57,8 @@ ohw::App::App( int argc, char **argv ) {
 	plInitialize( argc, argv );
 	plInitializeSubSystems( PL_SUBSYSTEM_IO );
 
+	Img_InitKernels();
+
 	plRegisterStandardPackageLoaders();
 	plRegisterStandardImageLoaders( PL_IMAGE_FILEFORMAT_TGA | PL_IMAGE_FILEFORMAT_PNG | PL_IMAGE_FILEFORMAT_BMP | PL_IMAGE_FILEFORMAT_TIM );
 
@@ -63,7 +78,11 @@ ohw::App::App( int argc, char **argv ) {
 
 	char logPath[ PL_SYSTEM_MAX_PATH ];
 	snprintf( logPath, sizeof( logPath ), "%s/debug.txt", appDataPath );
-	plSetupLogOutput( logPath );
+	// Everything logged goes into the ring, and the file's written from there on another thread
+	plSetConsoleOutputCallback( App_LogOutputCallback );
+	if ( !LogRing::GetInstance()->StartFileSink( logPath ) ) {
+		DisplayMessageBox( MBErrorLevel::WARNING_MSG, "Unable to open %s for writing!\nNothing will be logged to disk.", logPath );
+	}
 
 	plSetupLogLevel( LOG_LEVEL_DEFAULT, "info", PLColour( 0, 255, 0, 255 ), true );
 	plSetupLogLevel( LOG_LEVEL_WARNING, "warning", PLColour( 255, 255, 0, 255 ), true );
@@ -89,6 +108,10 @@ ohw::App::App( int argc, char **argv ) {
 	 * ourselves                            */
 	SDL_StartTextInput();
 
+	// One thread per core, unless told otherwise
+	const char *numThreads = plGetCommandLineArgumentValue( "-threads" );
+	JobSystem::GetInstance()->Initialize( ( numThreads != nullptr ) ? strtoul( numThreads, nullptr, 10 ) : 0 );
+
 	resourceManager = new ResourceManager();
 	modManager = new ModManager();
 	inputManager = new InputManager();
@@ -97,6 +120,8 @@ ohw::App::App( int argc, char **argv ) {
 void ohw::App::Shutdown() {
 	Config_Save( Config_GetUserConfigPath() );
 
+	JobSystem::GetInstance()->Shutdown();
+
 #if 0
 	ImGui_ImplOpenGL3_DestroyDeviceObjects();
 	ImGui::DestroyContext();
@@ -116,6 +141,8 @@ void ohw::App::Shutdown() {
 
 	plShutdown();
 
+	LogRing::GetInstance()->StopFileSink();
+
 	exit( EXIT_SUCCESS );
 }
 
@@ -137,13 +164,13 @@ void ohw::App::DisplayMessageBox( MBErrorLevel level, const char *message, ... )
 	va_start( args, message );
 
 	int length = pl_vscprintf( message, args ) + 1;
-	char *buf = static_cast<char *>(MAlloc( length, true ));
+	char *buf = static_cast<char *>(u_alloc( length, 1, true ));
 	vsprintf( buf, message, args );
 	va_end( args );
 
 	SDL_ShowSimpleMessageBox( sdlLevel, WINDOW_TITLE, buf, nullptr );
 
-	delete[] buf;
+	u_free( buf );
 }
 
 void ohw::App::InitializeConfig() {
@@ -153,6 +180,9 @@ void ohw::App::InitializeConfig() {
 	 * initialized, otherwise, right now, certain
 	 * vars will not be loaded/saved! */
 	Config_Load( CONFIG_FILENAME );
+
+	// Set up here, before there's any other threads that might get to it first
+	MetricsRegistry::GetInstance();
 }
 
 void ohw::App::InitializeDisplay() {
@@ -401,36 +431,76 @@ bool ohw::App::IsRunning() {
 
 	PollEvents();
 
-	static unsigned int nextTick = 0;
+	static uint64_t nextTick = 0;
 	if ( nextTick == 0 ) {
-		nextTick = SDL_GetTicks();
+		nextTick = FrameLimiter::GetTime();
 	}
 
+	static const uint64_t tickLength = ( uint64_t ) NSEC_PER_SEC / TICKS_PER_SECOND;
 	unsigned int loops = 0;
-	while ( SDL_GetTicks() > nextTick && loops < MAX_FRAMESKIP ) {
-		numSysTicks = SDL_GetTicks();
-		numSimTicks++;
+	while ( FrameLimiter::GetTime() > nextTick && loops < MAX_FRAMESKIP ) {
+		Timer tickTimer;
+		SimulateTick();
+		tickTimer.End();
+		METRIC_HISTOGRAM( "app.tick_ms" )->Record( tickTimer.GetTimeTaken() * 1000.0 );
 
-		gameManager->Tick();
 		audioManager->Tick();
 
+		ReplicationManager::GetInstance()->Tick();
+
 		lastSysTick = SDL_GetTicks();
-		nextTick += SKIP_TICKS;
+		nextTick += tickLength;
 		loops++;
 	}
 
-	deltaTime = ( double ) ( SDL_GetTicks() + SKIP_TICKS - nextTick ) / ( double ) ( SKIP_TICKS );
+	METRIC_GAUGE( "app.sim_ticks" )->Set( numSimTicks );
+	METRIC_GAUGE( "app.sys_tick" )->Set( lastSysTick );
+
+	deltaTime = ( double ) ( FrameLimiter::GetTime() + tickLength - nextTick ) / ( double ) tickLength;
+
+	JobSystem::GetInstance()->RunMainThreadJobs();
+
+	// Nothing to see while minimized, so don't bother drawing anything
+	bool isMinimized = myDisplay->IsMinimized();
+	if ( !isMinimized ) {
+		Timer frameTimer;
+		myDisplay->Render( deltaTime );
+		frameTimer.End();
+		METRIC_HISTOGRAM( "app.draw_ms" )->Record( frameTimer.GetTimeTaken() * 1000.0 );
+	}
+
+	MemoryArena::EndFrame();
+	MemoryTracker::GetInstance()->Tick();
+	MetricsRegistry::GetInstance()->Tick();
 
-	myDisplay->Render( deltaTime );
+	FrameLimiter::GetInstance()->EndFrame( !isMinimized && myDisplay->HasFocus(), isMinimized );
+	METRIC_HISTOGRAM( "app.frame_ms" )->Record( FrameLimiter::GetInstance()->GetFrameTime() * 1000.0 );
 
 	return true;
 }
 
+/**
+ * Moves the game along by one tick, without anything else that
+ * normally happens alongside it, such as audio.
+ */
+void ohw::App::SimulateTick() {
+	numSysTicks = SDL_GetTicks();
+	numSimTicks++;
+
+	InputRecorder::GetInstance()->BeginTick();
+	gameManager->Tick();
+	InputRecorder::GetInstance()->EndTick();
+
+	MemoryArena::EndTick();
+}
+
 void *ohw::App::MAlloc( size_t size, bool abortOnFail ) {
 	return CAlloc( 1, size, abortOnFail );
 }
 
 void *ohw::App::CAlloc( size_t num, size_t size, bool abortOnFail ) {
+	MemoryTracker::CountAllocation( num * size );
+
 	void *mem = calloc( num, size );
 	if ( mem == nullptr && abortOnFail ) {
 		Error( "Failed to allocate %u bytes!\n", size * num );
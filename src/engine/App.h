@@ -73,6 +73,9 @@ namespace ohw {
 		inline unsigned int GetSimulationTicks() const {
 			return numSimTicks;
 		}
+		inline void SetSimulationTicks( unsigned int ticks ) {
+			numSimTicks = ticks;
+		}
 		inline double GetDeltaTime() const {
 			return deltaTime;
 		}
@@ -110,6 +113,7 @@ namespace ohw {
 		static const char *GetVersionString();
 
 		bool IsRunning();
+		void SimulateTick();
 
 		static void *MAlloc( size_t size, bool abortOnFail );
 		static void *CAlloc( size_t num, size_t size, bool abortOnFail );
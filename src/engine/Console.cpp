@@ -152,14 +152,20 @@ PLConsoleVariable *cv_display_fullscreen = nullptr;
 PLConsoleVariable *cv_display_use_window_aspect = nullptr;
 PLConsoleVariable *cv_display_ui_scale = nullptr;
 PLConsoleVariable *cv_display_vsync = nullptr;
+PLConsoleVariable *cv_display_max_fps = nullptr;
+PLConsoleVariable *cv_display_background_fps = nullptr;
 
 PLConsoleVariable *cv_graphics_cull = nullptr;
+PLConsoleVariable *cv_graphics_fog_cull = nullptr;
 PLConsoleVariable *cv_GraphicsDrawTerrain = nullptr;
 PLConsoleVariable *cv_graphics_draw_sprites = nullptr;
 PLConsoleVariable *cv_graphics_draw_audio_sources = nullptr;
 PLConsoleVariable *cv_graphics_texture_filter = nullptr;
 PLConsoleVariable *cv_graphics_alpha_to_coverage = nullptr;
 PLConsoleVariable *cv_graphics_debug_normals = nullptr;
+PLConsoleVariable *cv_graphics_model_cache = nullptr;
+PLConsoleVariable *cv_graphics_atlas_cache = nullptr;
+PLConsoleVariable *cv_graphics_texture_cache = nullptr;
 
 PLConsoleVariable *cv_audio_volume = nullptr;
 PLConsoleVariable *cv_audio_volume_sfx = nullptr;
@@ -167,6 +173,10 @@ PLConsoleVariable *cv_audio_volume_music = nullptr;
 PLConsoleVariable *cv_audio_voices = nullptr;
 PLConsoleVariable *cv_audio_mode = nullptr;
 
+PLConsoleVariable *cv_metrics_export_interval = nullptr;
+PLConsoleVariable *cv_metrics_export_format = nullptr;
+PLConsoleVariable *cv_metrics_export_max_size = nullptr;
+
 void Console_Initialize( void ) {
 #define rvar( var, arc, ... ) \
     { \
@@ -192,14 +202,20 @@ void Console_Initialize( void ) {
 	rvar( cv_display_use_window_aspect, false, "false", pl_bool_var, nullptr, "" );
 	rvar( cv_display_ui_scale, true, "0", pl_int_var, nullptr, "0 = automatic scale" );
 	rvar( cv_display_vsync, true, "false", pl_bool_var, GraphicsVsyncCallback, "Enable / Disable vertical sync" );
+	rvar( cv_display_max_fps, true, "0", pl_int_var, nullptr, "Caps the frame rate, 0 = no cap." );
+	rvar( cv_display_background_fps, true, "20", pl_int_var, nullptr, "Caps the frame rate while the window's in the background, 0 = no cap." );
 
 	rvar( cv_graphics_cull, false, "true", pl_bool_var, nullptr, "Toggles culling of visible objects." );
+	rvar( cv_graphics_fog_cull, false, "true", pl_bool_var, nullptr, "Toggles culling of anything entirely hidden by fog." );
 	rvar( cv_GraphicsDrawTerrain, false, "true", pl_bool_var, nullptr, "Toggles rendering of the terrain." );
 	rvar( cv_graphics_draw_sprites, false, "true", pl_bool_var, nullptr, "Toggles rendering of sprites." );
 	rvar( cv_graphics_draw_audio_sources, false, "false", pl_bool_var, nullptr, "toggles rendering of audio sources" );
 	rvar( cv_graphics_texture_filter, true, "true", pl_bool_var, nullptr, "Filter level/model textures?" );
 	rvar( cv_graphics_alpha_to_coverage, true, "true", pl_bool_var, nullptr, "Enable/disable alpha-to-coverage" );
 	rvar( cv_graphics_debug_normals, false, "false", pl_bool_var, nullptr, "Forces normals to be displayed" );
+	rvar( cv_graphics_model_cache, true, "true", pl_bool_var, nullptr, "Cache compiled models to speed up loading." );
+	rvar( cv_graphics_atlas_cache, true, "true", pl_bool_var, nullptr, "Cache finished texture atlases to speed up loading." );
+	rvar( cv_graphics_texture_cache, true, "true", pl_bool_var, nullptr, "Cache cooked textures to speed up loading." );
 
 	rvar( cv_audio_volume, true, "1", pl_float_var, nullptr, "set global audio volume" );
 	rvar( cv_audio_volume_sfx, true, "1", pl_float_var, nullptr, "set sfx audio volume" );
@@ -207,6 +223,10 @@ void Console_Initialize( void ) {
 	rvar( cv_audio_mode, true, "1", pl_int_var, nullptr, "0 = mono, 1 = stereo" );
 	rvar( cv_audio_voices, true, "true", pl_bool_var, nullptr, "enable/disable pig voices" );
 
+	rvar( cv_metrics_export_interval, true, "0", pl_float_var, nullptr, "Seconds between each row of metrics written out, 0 = off." );
+	rvar( cv_metrics_export_format, true, "csv", pl_string_var, nullptr, "csv or json" );
+	rvar( cv_metrics_export_max_size, true, "4096", pl_int_var, nullptr, "Kilobytes a metrics export can reach before starting another, 0 = no limit." );
+
 	plRegisterConsoleCommand( "open", OpenCommand, "Opens the specified file" );
 	plRegisterConsoleCommand( "exit", QuitCommand, "Closes the game" );
 	plRegisterConsoleCommand( "quit", QuitCommand, "Closes the game" );
@@ -58,14 +58,20 @@ extern PLConsoleVariable *cv_display_fullscreen;
 extern PLConsoleVariable *cv_display_use_window_aspect;
 extern PLConsoleVariable *cv_display_ui_scale;
 extern PLConsoleVariable *cv_display_vsync;
+extern PLConsoleVariable *cv_display_max_fps;
+extern PLConsoleVariable *cv_display_background_fps;
 
 extern PLConsoleVariable *cv_graphics_cull;
+extern PLConsoleVariable *cv_graphics_fog_cull;
 extern PLConsoleVariable* cv_GraphicsDrawTerrain;
 extern PLConsoleVariable* cv_graphics_draw_sprites;
 extern PLConsoleVariable* cv_graphics_draw_audio_sources;
 extern PLConsoleVariable *cv_graphics_texture_filter;
 extern PLConsoleVariable *cv_graphics_alpha_to_coverage;
 extern PLConsoleVariable *cv_graphics_debug_normals;
+extern PLConsoleVariable *cv_graphics_model_cache;
+extern PLConsoleVariable *cv_graphics_atlas_cache;
+extern PLConsoleVariable *cv_graphics_texture_cache;
 
 extern PLConsoleVariable *cv_audio_volume;
 extern PLConsoleVariable *cv_audio_volume_sfx;
@@ -73,6 +79,10 @@ extern PLConsoleVariable *cv_audio_volume_music;
 extern PLConsoleVariable *cv_audio_voices;
 extern PLConsoleVariable *cv_audio_mode;
 
+extern PLConsoleVariable *cv_metrics_export_interval;
+extern PLConsoleVariable *cv_metrics_export_format;
+extern PLConsoleVariable *cv_metrics_export_max_size;
+
 /************************************************************/
 
 void Console_Initialize();
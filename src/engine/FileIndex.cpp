@@ -0,0 +1,291 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "App.h"
+#include "FileIndex.h"
+
+/**
+ * Turns a path into the key it's stored under; lower-cased, forward
+ * slashes only and nothing doubled up or leading.
+ */
+static std::string FileIndex_MakeKey( const char *path, size_t length ) {
+	std::string key;
+	key.reserve( length );
+	for ( size_t i = 0; i < length; ++i ) {
+		char c = ( path[ i ] == '\\' ) ? '/' : static_cast< char >( tolower( path[ i ] ) );
+		if ( c == '/' && ( key.empty() || key.back() == '/' ) ) {
+			continue;
+		}
+		key.push_back( c );
+	}
+
+	if ( key.size() >= 2 && key[ 0 ] == '.' && key[ 1 ] == '/' ) {
+		key.erase( 0, 2 );
+	}
+
+	return key;
+}
+
+/* extensions are stored lower-cased, but the ones passed in may not be */
+static bool FileIndex_CompareExtension( const std::string &extension, const char *other ) {
+	size_t i = 0;
+	for ( ; i < extension.size() && other[ i ] != '\0'; ++i ) {
+		if ( extension[ i ] != tolower( other[ i ] ) ) {
+			return false;
+		}
+	}
+
+	return i == extension.size() && other[ i ] == '\0';
+}
+
+/* returns the length of the path without its extension */
+static size_t FileIndex_GetStemLength( const char *path ) {
+	const char *extension = plGetFileExtension( path );
+	size_t length = strlen( path );
+	return ( extension[ 0 ] == '\0' ) ? length : length - ( strlen( extension ) + 1 );
+}
+
+ohw::FileIndex::FileIndex() {
+	plRegisterConsoleCommand( "PrintFileIndexStats", PrintStatsCommand,
+	                          "Prints the number of files indexed and how many lookups have been made. [reset]" );
+	plRegisterConsoleCommand( "RebuildFileIndex", RebuildCommand,
+	                          "Scans the mounted directories again, for files added since the mod was mounted." );
+	plRegisterConsoleCommand( "BenchmarkFileIndex", BenchmarkCommand,
+	                          "Resolves every indexed texture both through the index and by probing the disk. [iterations]" );
+}
+
+void ohw::FileIndex::Build( const std::vector< std::string > &locations ) {
+	Timer timer;
+
+	Clear();
+
+	locations_ = locations;
+	for ( priority_ = 0; priority_ < locations_.size(); ++priority_ ) {
+		const std::string &location = locations_[ priority_ ];
+		prefixLength_ = location.size();
+		plScanDirectory( location.c_str(), nullptr, AddFile, true, this );
+	}
+
+	isBuilt_ = true;
+
+	timer.End();
+	stats_.numLocations = locations_.size();
+	stats_.buildTime = timer.GetTimeTaken();
+
+	Print( "Indexed %u files across %u locations in %.2fms\n",
+	       stats_.numFiles, stats_.numLocations, stats_.buildTime * 1000.0 );
+}
+
+void ohw::FileIndex::Clear() {
+	entries_.clear();
+	locations_.clear();
+	isBuilt_ = false;
+
+	stats_.numLocations = 0;
+	stats_.numFiles = 0;
+}
+
+void ohw::FileIndex::AddFile( const char *path, void *userData ) {
+	auto *index = static_cast< FileIndex * >( userData );
+
+	// Strip off the location, so we've got the path as it is through the mount
+	const char *relativePath = path + std::min( index->prefixLength_, strlen( path ) );
+	while ( *relativePath == '/' || *relativePath == '\\' ) {
+		relativePath++;
+	}
+
+	Entry entry;
+	entry.priority = index->priority_;
+	for ( const char *c = relativePath; *c != '\0'; ++c ) {
+		char ch = ( *c == '\\' ) ? '/' : *c;
+		if ( ch == '/' && !entry.path.empty() && entry.path.back() == '/' ) {
+			continue;
+		}
+		entry.path.push_back( ch );
+	}
+
+	const char *extension = plGetFileExtension( entry.path.c_str() );
+	entry.extension = u_stringtolower( extension );
+
+	std::string key = FileIndex_MakeKey( entry.path.c_str(), FileIndex_GetStemLength( entry.path.c_str() ) );
+	index->entries_[ key ].push_back( entry );
+	index->stats_.numFiles++;
+}
+
+const char *ohw::FileIndex::Find( const char *stem, const char **preference ) {
+	stats_.numLookups++;
+
+	auto i = entries_.find( FileIndex_MakeKey( stem, strlen( stem ) ) );
+	if ( i == entries_.end() ) {
+		stats_.numMisses++;
+		return nullptr;
+	}
+
+	// Whichever mod comes last wins, then whichever format comes first
+	const Entry *best = nullptr;
+	unsigned int bestPreference = 0;
+	for ( const auto &entry : i->second ) {
+		for ( unsigned int j = 0; preference[ j ] != nullptr; ++j ) {
+			if ( !FileIndex_CompareExtension( entry.extension, preference[ j ] ) ) {
+				continue;
+			}
+
+			if ( best == nullptr || entry.priority > best->priority ||
+			     ( entry.priority == best->priority && j < bestPreference ) ) {
+				best = &entry;
+				bestPreference = j;
+			}
+			break;
+		}
+	}
+
+	if ( best == nullptr ) {
+		stats_.numMisses++;
+		return nullptr;
+	}
+
+	return best->path.c_str();
+}
+
+const char *ohw::FileIndex::FindFile( const char *path ) {
+	stats_.numLookups++;
+
+	auto i = entries_.find( FileIndex_MakeKey( path, FileIndex_GetStemLength( path ) ) );
+	if ( i == entries_.end() ) {
+		stats_.numMisses++;
+		return nullptr;
+	}
+
+	// Case only decides it if the same file turns up more than once in a mod
+	const char *extension = plGetFileExtension( path );
+	const Entry *best = nullptr;
+	for ( const auto &entry : i->second ) {
+		if ( !FileIndex_CompareExtension( entry.extension, extension ) ) {
+			continue;
+		}
+
+		if ( best == nullptr || entry.priority > best->priority ||
+		     ( entry.priority == best->priority && entry.path == path ) ) {
+			best = &entry;
+		}
+	}
+
+	if ( best == nullptr ) {
+		stats_.numMisses++;
+		return nullptr;
+	}
+
+	return best->path.c_str();
+}
+
+void ohw::FileIndex::PrintStatsCommand( unsigned int argc, char **argv ) {
+	FileIndex *index = GetInstance();
+	Stats &stats = index->stats_;
+	if ( argc > 1 && pl_strcasecmp( argv[ 1 ], "reset" ) == 0 ) {
+		stats.numLookups = 0;
+		stats.numMisses = 0;
+		stats.numProbes = 0;
+		Print( "Reset file index stats\n" );
+		return;
+	}
+
+	if ( !index->IsBuilt() ) {
+		Print( "File index hasn't been built, every lookup is probing the disk\n" );
+	} else {
+		Print( "%u files indexed across %u locations in %.2fms\n",
+		       stats.numFiles, stats.numLocations, stats.buildTime * 1000.0 );
+	}
+
+	Print( "%u lookups (%u missed), %u files probed on disk\n", stats.numLookups, stats.numMisses, stats.numProbes );
+}
+
+void ohw::FileIndex::RebuildCommand( unsigned int argc, char **argv ) {
+	FileIndex *index = GetInstance();
+	if ( !index->IsBuilt() ) {
+		Warning( "No mod is mounted, nothing to index!\n" );
+		return;
+	}
+
+	std::vector< std::string > locations = index->locations_;
+	index->Build( locations );
+}
+
+void ohw::FileIndex::BenchmarkCommand( unsigned int argc, char **argv ) {
+	FileIndex *index = GetInstance();
+	if ( !index->IsBuilt() ) {
+		Warning( "No mod is mounted, nothing to benchmark!\n" );
+		return;
+	}
+
+	unsigned int iterations = ( argc > 1 ) ? strtoul( argv[ 1 ], nullptr, 10 ) : 10;
+	if ( iterations == 0 ) {
+		iterations = 1;
+	}
+
+	Stats oldStats = index->stats_;
+
+	// Only the names that would have been looked up, i.e. anything that's a texture
+	std::vector< std::string > stems;
+	for ( const auto &i : index->entries_ ) {
+		const char *path = index->Find( i.first.c_str(), supportedTextureFormats );
+		if ( path != nullptr ) {
+			stems.push_back( std::string( path, FileIndex_GetStemLength( path ) ) );
+		}
+	}
+
+	if ( stems.empty() ) {
+		Warning( "No textures indexed, nothing to benchmark!\n" );
+		return;
+	}
+
+	unsigned int numFound = 0;
+	Timer indexTimer;
+	for ( unsigned int i = 0; i < iterations; ++i ) {
+		for ( const auto &stem : stems ) {
+			numFound += ( index->Find( stem.c_str(), supportedTextureFormats ) != nullptr );
+		}
+	}
+	indexTimer.End();
+
+	unsigned int numProbes = 0;
+	unsigned int numProbeFound = 0;
+	Timer probeTimer;
+	for ( unsigned int i = 0; i < iterations; ++i ) {
+		for ( const auto &stem : stems ) {
+			for ( unsigned int j = 0; supportedTextureFormats[ j ] != nullptr; ++j ) {
+				char path[PL_SYSTEM_MAX_PATH];
+				snprintf( path, sizeof( path ), "%s.%s", stem.c_str(), supportedTextureFormats[ j ] );
+				numProbes++;
+				if ( plFileExists( path ) ) {
+					numProbeFound++;
+					break;
+				}
+			}
+		}
+	}
+	probeTimer.End();
+
+	index->stats_ = oldStats;
+
+	unsigned int numLookups = stems.size() * iterations;
+	Print( "Resolved %u textures %u times\n", ( unsigned int ) stems.size(), iterations );
+	Print( " index:   %.3fms, %.3fus per lookup, %u found, 0 files probed\n",
+	       indexTimer.GetTimeTaken() * 1000.0, indexTimer.GetTimeTaken() * 1000000.0 / numLookups, numFound );
+	Print( " probing: %.3fms, %.3fus per lookup, %u found, %u files probed\n",
+	       probeTimer.GetTimeTaken() * 1000.0, probeTimer.GetTimeTaken() * 1000000.0 / numLookups, numProbeFound, numProbes );
+}
@@ -0,0 +1,93 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <unordered_map>
+
+namespace ohw {
+	/**
+	 * Everything that's in the mounted mod directories, scanned once when
+	 * a mod is mounted, so asset names can be resolved without hitting the
+	 * disk for each format they might be in.
+	 *
+	 * Files are keyed by their path relative to the mount, lower-cased and
+	 * without the extension. Mods are scanned in mount order and each is
+	 * given a higher priority than the last, so a mod's own files win over
+	 * those of anything it depends on, whatever format they're in.
+	 */
+	class FileIndex {
+	public:
+		static FileIndex *GetInstance() {
+			static FileIndex *instance = nullptr;
+			if ( instance == nullptr ) {
+				instance = new FileIndex();
+			}
+			return instance;
+		}
+
+		/* locations are given lowest priority first, e.g. "mods/how/" */
+		void Build( const std::vector< std::string > &locations );
+		void Clear();
+
+		PL_INLINE bool IsBuilt() const { return isBuilt_; }
+
+		/* returns the path of the stem in the first available preferred format, or null */
+		const char *Find( const char *stem, const char **preference );
+		/* returns the path as it is on disk for a path with an extension, or null */
+		const char *FindFile( const char *path );
+
+		/* called for each plFileExists made in place of a lookup */
+		PL_INLINE void AddProbe() { stats_.numProbes++; }
+
+		struct Stats {
+			unsigned int numLocations{ 0 };
+			unsigned int numFiles{ 0 };
+			double buildTime{ 0 };          // in seconds
+			unsigned int numLookups{ 0 };
+			unsigned int numMisses{ 0 };
+			unsigned int numProbes{ 0 };
+		};
+
+	private:
+		FileIndex();
+
+		struct Entry {
+			std::string path;
+			std::string extension;      // lower-cased
+			unsigned int priority;
+		};
+		typedef std::unordered_map< std::string, std::vector< Entry > > EntryMap;
+
+		static void AddFile( const char *path, void *userData );
+
+		static void PrintStatsCommand( unsigned int argc, char **argv );
+		static void RebuildCommand( unsigned int argc, char **argv );
+		static void BenchmarkCommand( unsigned int argc, char **argv );
+
+		EntryMap entries_;
+		std::vector< std::string > locations_;
+		bool isBuilt_{ false };
+
+		/* used while scanning */
+		size_t prefixLength_{ 0 };
+		unsigned int priority_{ 0 };
+
+		Stats stats_;
+	};
+}
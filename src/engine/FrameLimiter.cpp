@@ -0,0 +1,150 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "App.h"
+#include "FrameLimiter.h"
+
+#include <thread>
+
+/* the slowest we'll go, any lower and the simulation can't keep up */
+#define FRAME_LIMITER_MIN_FPS       ( TICKS_PER_SECOND / MAX_FRAMESKIP )
+#define FRAME_LIMITER_SLEEP_STEP    1000000     // 1ms
+#define FRAME_LIMITER_SLEEP_WEIGHT  0.05        // how much each sleep counts towards the average
+
+ohw::FrameLimiter::FrameLimiter() {
+	plRegisterConsoleCommand( "PrintFrameStats", PrintStatsCommand,
+	                          "Prints how evenly frames have been paced. [reset]" );
+}
+
+uint64_t ohw::FrameLimiter::GetTime() {
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ( uint64_t ) ts.tv_sec * NSEC_PER_SEC + ( uint64_t ) ts.tv_nsec;
+}
+
+void ohw::FrameLimiter::EndFrame( bool isForeground, bool isMinimized ) {
+	int maxFps = cv_display_max_fps->i_value;
+	if ( isMinimized ) {
+		// Nothing's being drawn, so there's no reason to go any faster than the
+		// simulation needs, whatever the cvars say - otherwise we'd spin flat out
+		maxFps = FRAME_LIMITER_MIN_FPS;
+		stats_.numThrottled++;
+	} else if ( !isForeground && cv_display_background_fps->i_value > 0 ) {
+		maxFps = ( maxFps > 0 ) ? std::min( maxFps, cv_display_background_fps->i_value ) : cv_display_background_fps->i_value;
+		stats_.numThrottled++;
+	}
+
+	uint64_t now = GetTime();
+	if ( maxFps > 0 ) {
+		uint64_t interval = NSEC_PER_SEC / std::max( maxFps, FRAME_LIMITER_MIN_FPS );
+		nextFrame_ += interval;
+		if ( nextFrame_ < now ) {
+			// Fell behind, whether from a hitch or the cap changing, so start again from here
+			// rather than rushing through frames to catch up
+			if ( lastFrame_ != 0 && now - nextFrame_ > 1000000 ) {
+				stats_.numLate++;
+			}
+			nextFrame_ = now;
+		} else if ( nextFrame_ > now + interval ) {
+			nextFrame_ = now + interval;
+		}
+
+		Wait( nextFrame_ );
+		now = GetTime();
+	} else {
+		nextFrame_ = now;
+	}
+
+	if ( lastFrame_ != 0 ) {
+		lastFrameTime_ = now - lastFrame_;
+
+		stats_.history[ stats_.numFrames % FRAME_LIMITER_HISTORY ] = lastFrameTime_;
+		stats_.numFrames++;
+		stats_.frameTime += lastFrameTime_;
+		stats_.frameTimeSquared += ( double ) lastFrameTime_ * lastFrameTime_;
+		stats_.minFrameTime = std::min( stats_.minFrameTime, lastFrameTime_ );
+		stats_.maxFrameTime = std::max( stats_.maxFrameTime, lastFrameTime_ );
+	}
+	lastFrame_ = now;
+}
+
+/**
+ * Sleeps a millisecond at a time until the deadline's closer than a sleep
+ * is likely to take, then spins out the rest. Every sleep feeds back into
+ * that estimate, so it settles on whatever the scheduler's doing.
+ */
+void ohw::FrameLimiter::Wait( uint64_t deadline ) {
+	uint64_t now = GetTime();
+	uint64_t start = now;
+
+	while ( now < deadline ) {
+		double estimate = sleepMean_ + 2.0 * std::sqrt( sleepVariance_ );
+		if ( ( double ) ( deadline - now ) <= estimate ) {
+			break;
+		}
+
+		std::this_thread::sleep_for( std::chrono::nanoseconds( FRAME_LIMITER_SLEEP_STEP ) );
+
+		uint64_t end = GetTime();
+		double delta = ( double ) ( end - now ) - sleepMean_;
+		sleepMean_ += FRAME_LIMITER_SLEEP_WEIGHT * delta;
+		sleepVariance_ = ( 1.0 - FRAME_LIMITER_SLEEP_WEIGHT ) * ( sleepVariance_ + FRAME_LIMITER_SLEEP_WEIGHT * delta * delta );
+		now = end;
+	}
+
+	stats_.sleepTime += now - start;
+	start = now;
+
+	while ( now < deadline ) {
+		std::this_thread::yield();
+		now = GetTime();
+	}
+
+	stats_.spinTime += now - start;
+}
+
+void ohw::FrameLimiter::PrintStatsCommand( unsigned int argc, char **argv ) {
+	FrameLimiter *limiter = GetInstance();
+	Stats &stats = limiter->stats_;
+	if ( stats.numFrames == 0 ) {
+		Print( "No frames yet\n" );
+		return;
+	}
+
+	double mean = stats.frameTime / stats.numFrames;
+	double deviation = std::sqrt( std::max( 0.0, stats.frameTimeSquared / stats.numFrames - mean * mean ) );
+
+	unsigned int numHistory = std::min( stats.numFrames, ( unsigned int ) FRAME_LIMITER_HISTORY );
+	std::vector< uint64_t > history( stats.history, stats.history + numHistory );
+	std::sort( history.begin(), history.end() );
+
+	Print( "%u frames, %.3fms on average (%.1f fps), jitter of %.3fms\n",
+	       stats.numFrames, mean / 1e6, 1e9 / mean, deviation / 1e6 );
+	Print( "Fastest %.3fms, slowest %.3fms, over the last %u: median %.3fms, 99th percentile %.3fms\n",
+	       stats.minFrameTime / 1e6, stats.maxFrameTime / 1e6, numHistory,
+	       history[ numHistory / 2 ] / 1e6, history[ ( numHistory * 99 ) / 100 ] / 1e6 );
+	Print( "%.3fms asleep and %.3fms spinning per frame, sleeps taking %.3fms (+/- %.3fms)\n",
+	       stats.sleepTime / stats.numFrames / 1e6, stats.spinTime / stats.numFrames / 1e6,
+	       limiter->sleepMean_ / 1e6, std::sqrt( limiter->sleepVariance_ ) / 1e6 );
+	Print( "%u frames missed their deadline, %u were held to the background rate\n",
+	       stats.numLate, stats.numThrottled );
+
+	if ( argc > 1 && pl_strcasecmp( argv[ 1 ], "reset" ) == 0 ) {
+		stats = Stats();
+	}
+}
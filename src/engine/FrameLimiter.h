@@ -0,0 +1,84 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <cstdint>
+
+namespace ohw {
+	/**
+	 * Paces the main loop, so the game isn't spinning through frames
+	 * faster than anyone can see them.
+	 *
+	 * Frames are held to display_max_fps, or to display_background_fps
+	 * while the window's in the background, and to the slowest rate the
+	 * simulation can keep up with while it's minimized. Most of the wait is spent
+	 * asleep; sleeping isn't precise, so it stops short by however long
+	 * sleeps have been overrunning lately and spins the rest of the way.
+	 */
+	class FrameLimiter {
+	public:
+		static FrameLimiter *GetInstance() {
+			static FrameLimiter *instance = nullptr;
+			if ( instance == nullptr ) {
+				instance = new FrameLimiter();
+			}
+			return instance;
+		}
+
+		/* nanoseconds from CLOCK_MONOTONIC */
+		static uint64_t GetTime();
+
+		/* called at the end of each frame, waits until the next one's due */
+		void EndFrame( bool isForeground, bool isMinimized );
+
+		/* time between the last two frames, in seconds */
+		PL_INLINE double GetFrameTime() const { return lastFrameTime_ / 1e9; }
+
+	private:
+		FrameLimiter();
+
+		void Wait( uint64_t deadline );
+
+		static void PrintStatsCommand( unsigned int argc, char **argv );
+
+		uint64_t lastFrame_{ 0 };
+		uint64_t nextFrame_{ 0 };
+		uint64_t lastFrameTime_{ 0 };
+
+		/* how long a 1ms sleep really takes, averaged over the last few */
+		double sleepMean_{ 1.5e6 };
+		double sleepVariance_{ 0.0 };
+
+#define FRAME_LIMITER_HISTORY 512
+		struct Stats {
+			unsigned int numFrames{ 0 };
+			double frameTime{ 0 };              // all in nanoseconds
+			double frameTimeSquared{ 0 };
+			uint64_t minFrameTime{ UINT64_MAX };
+			uint64_t maxFrameTime{ 0 };
+			double sleepTime{ 0 };
+			double spinTime{ 0 };
+			unsigned int numLate{ 0 };          // frames that missed their deadline
+			unsigned int numThrottled{ 0 };     // frames paced at the background rate
+
+			uint64_t history[ FRAME_LIMITER_HISTORY ]{};
+		};
+		Stats stats_;
+	};
+}
@@ -85,6 +85,16 @@ bool ohw::InputManager::GetKeyState( int input ) {
 }
 
 bool ohw::InputManager::GetJoystickState( unsigned int slot, JoystickAxis input, float *x, float *y ) {
+	if ( myFrame != nullptr ) {
+		if ( slot >= INPUT_MAX_SLOTS ) {
+			return false;
+		}
+
+		*x = myFrame->axes[ slot ][ input ][ 0 ] / 32767.0f;
+		*y = myFrame->axes[ slot ][ input ][ 1 ] / 32767.0f;
+		return true;
+	}
+
 	Controller *controller = GetControllerForSlot( slot );
 	if ( controller == nullptr ) {
 		return false;
@@ -105,6 +115,10 @@ bool ohw::InputManager::GetButtonState( unsigned int slot, SDL_GameControllerBut
 }
 
 bool ohw::InputManager::GetActionState( unsigned int slot, Action input ) {
+	if ( myFrame != nullptr ) {
+		return ( slot < INPUT_MAX_SLOTS ) && ( myFrame->actions[ slot ] & ( 1U << input ) );
+	}
+
 	for( auto &i : myBindings[ input ].keys ) {
 		if( GetKeyState( i ) ) {
 			return true;
@@ -122,6 +136,34 @@ bool ohw::InputManager::GetActionState( unsigned int slot, Action input ) {
 	return false;
 }
 
+/**
+ * Samples the current state of every action and stick, as the simulation
+ * would see it this tick.
+ */
+void ohw::InputManager::CaptureFrame( InputFrame *frame ) {
+	const InputFrame *oldFrame = myFrame;
+	myFrame = nullptr;
+
+	memset( frame, 0, sizeof( InputFrame ) );
+	for ( unsigned int slot = 0; slot < INPUT_MAX_SLOTS; ++slot ) {
+		for ( unsigned int action = 0; action < MAX_ACTIONS; ++action ) {
+			if ( GetActionState( slot, ( Action ) action ) ) {
+				frame->actions[ slot ] |= ( 1U << action );
+			}
+		}
+
+		for ( unsigned int axis = 0; axis < MAX_JOYSTICK_AXIS; ++axis ) {
+			float x, y;
+			if ( GetJoystickState( slot, ( JoystickAxis ) axis, &x, &y ) ) {
+				frame->axes[ slot ][ axis ][ 0 ] = ( int16_t ) ( std::max( -1.0f, std::min( x, 1.0f ) ) * 32767.0f );
+				frame->axes[ slot ][ axis ][ 1 ] = ( int16_t ) ( std::max( -1.0f, std::min( y, 1.0f ) ) * 32767.0f );
+			}
+		}
+	}
+
+	myFrame = oldFrame;
+}
+
 void ohw::InputManager::SetAxisState( unsigned int slot, JoystickAxis input, const PLVector2 &status ) {
 	Controller *controller = GetControllerForSlot( slot );
 	if ( controller == nullptr ) {
@@ -17,6 +17,8 @@
 
 #pragma once
 
+#define INPUT_MAX_SLOTS 4
+
 namespace ohw {
 	class InputManager {
 	public:
@@ -111,11 +113,26 @@ namespace ohw {
 
 		void SetupControllers();
 
+		/**
+		 * Everything the simulation can ask for in a single tick, for each slot.
+		 * Sticks are stored as fixed-point, -32767 to 32767.
+		 */
+		struct InputFrame {
+			uint16_t actions[INPUT_MAX_SLOTS];
+			int16_t axes[INPUT_MAX_SLOTS][MAX_JOYSTICK_AXIS][2];
+		};
+
+		void CaptureFrame( InputFrame *frame );
+		/* while set, actions and sticks are read from the frame rather than the devices */
+		void SetFrame( const InputFrame *frame ) { myFrame = frame; }
+
 	protected:
 	private:
 		void (*InputFocusCallback)( int input, bool status ){ nullptr };
 		void (*InputTextCallback)( const char *c ){ nullptr };
 
+		const InputFrame *myFrame{ nullptr };
+
 		PLVector2 myMouseCoords;
 		bool myMouseButtonStates[MAX_MOUSE_BUTTONS];
 		bool myKeyStates[MAX_KEYS];
@@ -0,0 +1,310 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "App.h"
+#include "InputRecorder.h"
+#include "Random.h"
+#include "game/ActorManager.h"
+
+/* Recording (.ohwr)
+ *
+ * header
+ * snapshot    world as it was when recording started
+ * ticks       uint8 has input, input frame if it has, uint64 world hash */
+
+typedef struct __attribute__((packed)) RecordingHeader {
+	char identifier[4];
+	uint32_t version;
+	uint32_t num_ticks;             /* filled in once recording stops */
+	uint32_t snapshot_size;
+	uint64_t random_state;          /* also in the snapshot, but kept here so it's easy to find */
+} RecordingHeader;
+
+ohw::InputRecorder::InputRecorder() {
+	hashState.SetHashing( true );
+
+	plRegisterConsoleCommand( "RecordInput", RecordCommand, "Records input to the given path until stopped." );
+	plRegisterConsoleCommand( "StopRecording", StopCommand, "Stops recording input." );
+	plRegisterConsoleCommand( "ReplayInput", ReplayCommand,
+	                          "Plays back recorded input as fast as possible. [path] [render every nth tick]" );
+}
+
+ohw::InputRecorder::~InputRecorder() {
+	StopRecording();
+}
+
+bool ohw::InputRecorder::StartRecording( const char *path ) {
+	if ( state != State::IDLE ) {
+		Warning( "Already recording or replaying!\n" );
+		return false;
+	}
+
+	if ( GetApp()->gameManager->GetMode() == nullptr ) {
+		Warning( "Can only record while in a game!\n" );
+		return false;
+	}
+
+	// Everything random from here on comes out of Random, so a fresh seed
+	// is captured along with the rest of the world
+	Random::Seed( ( uint64_t ) time( nullptr ) );
+	snapshot.Capture();
+
+	// Restoring leaves a few things to start again on the next tick (such as
+	// the turn), so we start from the restored world too, same as playback
+	if ( !snapshot.Restore() ) {
+		return false;
+	}
+
+	file = fopen( path, "wb" );
+	if ( file == nullptr ) {
+		Warning( "Failed to open \"%s\" for writing!\n", path );
+		return false;
+	}
+
+	RecordingHeader header;
+	memset( &header, 0, sizeof( header ) );
+	memcpy( header.identifier, RECORDING_IDENTIFIER, sizeof( header.identifier ) );
+	header.version = RECORDING_VERSION;
+	header.snapshot_size = snapshot.GetSize();
+	header.random_state = Random::GetState();
+
+	if ( fwrite( &header, sizeof( header ), 1, file ) != 1 ||
+	     fwrite( snapshot.GetData(), snapshot.GetSize(), 1, file ) != 1 ) {
+		Warning( "Failed to write recording header to \"%s\"!\n", path );
+		fclose( file );
+		file = nullptr;
+		return false;
+	}
+
+	numTicks = 0;
+	state = State::RECORDING;
+
+	Print( "Recording input to \"%s\"\n", path );
+
+	return true;
+}
+
+void ohw::InputRecorder::StopRecording() {
+	if ( state != State::RECORDING ) {
+		return;
+	}
+
+	uint32_t storedTicks = numTicks;
+	fseek( file, offsetof( RecordingHeader, num_ticks ), SEEK_SET );
+	fwrite( &storedTicks, sizeof( storedTicks ), 1, file );
+	fclose( file );
+	file = nullptr;
+
+	GetApp()->inputManager->SetFrame( nullptr );
+	state = State::IDLE;
+
+	Print( "Recorded %u ticks\n", numTicks );
+}
+
+bool ohw::InputRecorder::Replay( const char *path, unsigned int renderInterval ) {
+	if ( state != State::IDLE ) {
+		Warning( "Already recording or replaying!\n" );
+		return false;
+	}
+
+	GameManager *gameManager = GetApp()->gameManager;
+	if ( gameManager->GetMode() == nullptr ) {
+		Warning( "Can only replay while in a game!\n" );
+		return false;
+	}
+
+	FILE *fp = fopen( path, "rb" );
+	if ( fp == nullptr ) {
+		Warning( "Failed to open \"%s\"!\n", path );
+		return false;
+	}
+
+	fseek( fp, 0, SEEK_END );
+	long size = ftell( fp );
+	fseek( fp, 0, SEEK_SET );
+
+	replayData.resize( ( size > 0 ) ? size : 0 );
+	bool status = ( size > 0 && fread( replayData.data(), size, 1, fp ) == 1 );
+	fclose( fp );
+
+	Bin_InitReader( &reader, replayData.data(), status ? replayData.size() : 0 );
+
+	RecordingHeader header;
+	const uint8_t *snapshotData;
+	if ( !Bin_ReadArray( &reader, &header, sizeof( header ), 1 ) ||
+	     memcmp( header.identifier, RECORDING_IDENTIFIER, sizeof( header.identifier ) ) != 0 ||
+	     header.version != RECORDING_VERSION ||
+	     ( snapshotData = Bin_ReadView( &reader, header.snapshot_size, 1 ) ) == nullptr ) {
+		Warning( "Invalid recording \"%s\"!\n", path );
+		return false;
+	}
+
+	snapshot.SetData( snapshotData, header.snapshot_size );
+	if ( !snapshot.Restore() ) {
+		return false;
+	}
+
+	Random::SetState( header.random_state );
+
+	bool wasPaused = gameManager->IsSimulationPaused();
+	gameManager->ToggleSimulation( false );
+
+	numTicks = 0;
+	numMismatches = 0;
+	state = State::REPLAYING;
+
+	Timer timer;
+	for ( unsigned int i = 0; i < header.num_ticks && !reader.overflow; ++i ) {
+		GetApp()->SimulateTick();
+
+		if ( renderInterval > 0 && ( i % renderInterval ) == 0 ) {
+			GetApp()->PollEvents();
+			GetApp()->GetDisplay()->Render( 1.0 );
+		}
+	}
+	timer.End();
+
+	state = State::IDLE;
+	GetApp()->inputManager->SetFrame( nullptr );
+	gameManager->ToggleSimulation( wasPaused );
+
+	double seconds = timer.GetTimeTaken();
+	Print( "Replayed %u ticks in %.3fs, %.3fms per tick (%.1fx real-time)\n",
+	       numTicks, seconds, seconds * 1000.0 / std::max( numTicks, 1U ),
+	       ( numTicks / ( double ) TICKS_PER_SECOND ) / std::max( seconds, 0.001 ) );
+
+	if ( numTicks != header.num_ticks ) {
+		Warning( "Recording ended early, only %u of %u ticks were played!\n", numTicks, header.num_ticks );
+		return false;
+	}
+
+	if ( numMismatches > 0 ) {
+		Warning( "World diverged from the recording on %u ticks, starting from tick %u!\n", numMismatches, firstMismatch );
+		return false;
+	}
+
+	Print( "World matched the recording on every tick\n" );
+
+	return true;
+}
+
+void ohw::InputRecorder::BeginTick() {
+	isTickActive = ( state != State::IDLE && !GetApp()->gameManager->IsSimulationPaused() );
+	if ( !isTickActive ) {
+		return;
+	}
+
+	if ( state == State::RECORDING ) {
+		// Nothing left to record once the game's over
+		if ( GetApp()->gameManager->GetMode() == nullptr ) {
+			StopRecording();
+			isTickActive = false;
+			return;
+		}
+
+		GetApp()->inputManager->CaptureFrame( &frame );
+
+		uint8_t hasInput = ( numTicks == 0 || memcmp( &frame, &lastFrame, sizeof( frame ) ) != 0 );
+		fwrite( &hasInput, sizeof( hasInput ), 1, file );
+		if ( hasInput ) {
+			fwrite( &frame, sizeof( frame ), 1, file );
+			lastFrame = frame;
+		}
+	} else {
+		uint8_t hasInput;
+		if ( Bin_ReadUInt8( &reader, &hasInput ) && hasInput ) {
+			Bin_ReadArray( &reader, &frame, sizeof( frame ), 1 );
+		}
+	}
+
+	// Either way, the simulation sees exactly what's in the recording
+	GetApp()->inputManager->SetFrame( &frame );
+}
+
+void ohw::InputRecorder::EndTick() {
+	if ( !isTickActive ) {
+		return;
+	}
+
+	uint64_t hash = HashWorld();
+	if ( state == State::RECORDING ) {
+		fwrite( &hash, sizeof( hash ), 1, file );
+	} else {
+		uint64_t expectedHash;
+		if ( Bin_ReadArray( &reader, &expectedHash, sizeof( expectedHash ), 1 ) && expectedHash != hash ) {
+			if ( numMismatches++ == 0 ) {
+				firstMismatch = numTicks;
+			}
+		}
+	}
+
+	numTicks++;
+}
+
+/**
+ * Hashes everything a snapshot would save, bar the players: the random
+ * state, the game and mode, and every actor. Actors are kept in order of
+ * address, which changes from run to run, so they're summed up rather
+ * than chained together.
+ */
+uint64_t ohw::InputRecorder::HashWorld() {
+	hashState.Clear();
+	hashState.Write( Random::GetState() );
+	GetApp()->gameManager->SaveState( hashState );
+	IGameMode *mode = GetApp()->gameManager->GetMode();
+	if ( mode != nullptr ) {
+		mode->SaveState( hashState );
+	}
+
+	uint64_t hash = u_hash( hashState.GetData(), hashState.GetSize(), U_HASH_SEED );
+	for ( auto actor : ActorManager::GetInstance()->GetActors() ) {
+		hashState.Clear();
+		actor->SaveState( hashState );
+
+		hash += u_hash( hashState.GetData(), hashState.GetSize(), U_HASH_SEED );
+	}
+
+	return hash;
+}
+
+void ohw::InputRecorder::RecordCommand( unsigned int argc, char **argv ) {
+	if ( argc < 2 ) {
+		Warning( "Invalid number of arguments, ignoring!\n" );
+		return;
+	}
+
+	GetInstance()->StartRecording( argv[ 1 ] );
+}
+
+void ohw::InputRecorder::StopCommand( unsigned int argc, char **argv ) {
+	if ( !GetInstance()->IsRecording() ) {
+		Warning( "Not recording!\n" );
+		return;
+	}
+
+	GetInstance()->StopRecording();
+}
+
+void ohw::InputRecorder::ReplayCommand( unsigned int argc, char **argv ) {
+	if ( argc < 2 ) {
+		Warning( "Invalid number of arguments, ignoring!\n" );
+		return;
+	}
+
+	unsigned int renderInterval = ( argc > 2 ) ? strtoul( argv[ 2 ], nullptr, 10 ) : 0;
+	GetInstance()->Replay( argv[ 1 ], renderInterval );
+}
@@ -0,0 +1,90 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "InputManager.h"
+#include "game/WorldSnapshot.h"
+
+#define RECORDING_IDENTIFIER    "OHWR"
+#define RECORDING_VERSION       2
+
+namespace ohw {
+	/**
+	 * Records the input fed into each simulation tick, so a match can be
+	 * played back exactly the same way later on.
+	 *
+	 * A recording starts with a snapshot of the world, including the state of
+	 * Random, followed by the input for each tick (only when it's changed) and
+	 * a hash of the world after it. Playback runs the simulation as quickly as
+	 * it can and checks each hash as it goes, to catch anything diverging.
+	 */
+	class InputRecorder {
+	public:
+		InputRecorder();
+		~InputRecorder();
+
+		static InputRecorder *GetInstance() {
+			static InputRecorder *instance = nullptr;
+			if ( instance == nullptr ) {
+				instance = new InputRecorder();
+			}
+			return instance;
+		}
+
+		bool StartRecording( const char *path );
+		void StopRecording();
+
+		/* renders every nth tick, or not at all if 0 */
+		bool Replay( const char *path, unsigned int renderInterval = 0 );
+
+		PL_INLINE bool IsRecording() const { return state == State::RECORDING; }
+		PL_INLINE bool IsReplaying() const { return state == State::REPLAYING; }
+
+		/* called either side of each simulation tick */
+		void BeginTick();
+		void EndTick();
+
+		uint64_t HashWorld();
+
+	private:
+		enum class State {
+			IDLE,
+			RECORDING,
+			REPLAYING,
+		} state{ State::IDLE };
+
+		InputManager::InputFrame frame;
+		InputManager::InputFrame lastFrame;
+
+		FILE *file{ nullptr };
+		unsigned int numTicks{ 0 };
+		bool isTickActive{ false };         // whether the current tick is being recorded / replayed
+
+		BinReader reader;
+		std::vector< uint8_t > replayData;
+		unsigned int numMismatches{ 0 };
+		unsigned int firstMismatch{ 0 };
+
+		WorldSnapshot snapshot;
+		WorldSnapshot hashState;            // scratch space for HashWorld
+
+		static void RecordCommand( unsigned int argc, char **argv );
+		static void StopCommand( unsigned int argc, char **argv );
+		static void ReplayCommand( unsigned int argc, char **argv );
+	};
+}
@@ -0,0 +1,423 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "App.h"
+#include "JobSystem.h"
+#include "MemoryArena.h"
+#include "Map.h"
+
+/* index of the queue belonging to this thread, the main thread's is 0 */
+static thread_local int jobQueueIndex = -1;
+
+ohw::JobSystem::JobSystem() {
+	plRegisterConsoleCommand( "BenchmarkJobs", BenchmarkCommand,
+	                          "Times the same work on every number of threads, from one up to one per core. [iterations]" );
+	plRegisterConsoleCommand( "TestJobs", TestCommand,
+	                          "Checks parallel-for, dependencies, main thread jobs and nested waits on 1 to 16 threads. [rounds]" );
+}
+
+/* puts things back to however many threads were running before, after trying out others */
+void ohw::JobSystem::Restore( unsigned int numThreads ) {
+	if ( numThreads == 0 ) {
+		Shutdown();
+		return;
+	}
+
+	Initialize( numThreads );
+}
+
+void ohw::JobSystem::Initialize( unsigned int numThreads ) {
+	if ( isRunning_ ) {
+		Shutdown();
+	}
+
+	if ( numThreads == 0 ) {
+		numThreads = std::max( std::thread::hardware_concurrency(), 1U );
+	}
+
+	jobQueueIndex = 0;
+
+	for ( unsigned int i = 0; i < numThreads; ++i ) {
+		queues_.push_back( new Queue() );
+	}
+
+	isRunning_ = true;
+	for ( unsigned int i = 1; i < numThreads; ++i ) {
+		threads_.emplace_back( &JobSystem::WorkerThread, this, i );
+	}
+
+	Print( "Job system started with %u threads\n", numThreads );
+}
+
+void ohw::JobSystem::Shutdown() {
+	if ( !isRunning_ ) {
+		return;
+	}
+
+	{
+		std::lock_guard< std::mutex > lock( sleepMutex_ );
+		isRunning_ = false;
+		wake_.notify_all();
+	}
+
+	for ( auto &thread : threads_ ) {
+		thread.join();
+	}
+	threads_.clear();
+
+	// Nothing should be left by now, but don't leave anyone waiting on it if there is
+	while ( RunOne() ) {}
+	RunMainThreadJobs();
+
+	for ( auto queue : queues_ ) {
+		delete queue;
+	}
+	queues_.clear();
+	numQueued_ = 0;
+}
+
+bool ohw::JobSystem::IsMainThread() const {
+	return jobQueueIndex == 0;
+}
+
+void ohw::JobSystem::Submit( const JobFunction &function, Counter *counter, Counter *dependency ) {
+	Job *job = new Job();
+	job->function = function;
+	job->counter = counter;
+	job->tag = MemoryTracker::GetCurrentTag();
+	Push( job, dependency );
+}
+
+void ohw::JobSystem::SubmitMain( const JobFunction &function, Counter *counter, Counter *dependency ) {
+	Job *job = new Job();
+	job->function = function;
+	job->counter = counter;
+	job->isMainThread = true;
+	job->tag = MemoryTracker::GetCurrentTag();
+	Push( job, dependency );
+}
+
+void ohw::JobSystem::Push( Job *job, Counter *dependency ) {
+	if ( job->counter != nullptr ) {
+		job->counter->numPending.fetch_add( 1, std::memory_order_relaxed );
+	}
+
+	if ( dependency != nullptr ) {
+		std::lock_guard< std::mutex > lock( dependency->mutex );
+		if ( !dependency->IsDone() ) {
+			dependency->dependents.push_back( job );
+			return;
+		}
+	}
+
+	Enqueue( job );
+}
+
+void ohw::JobSystem::Enqueue( Job *job ) {
+	if ( job->isMainThread ) {
+		std::lock_guard< std::mutex > lock( mainQueue_.mutex );
+		mainQueue_.jobs.push_back( job );
+		return;
+	}
+
+	// Not started up, so just get it done now
+	if ( queues_.empty() ) {
+		Run( job );
+		return;
+	}
+
+	// Anything that's not one of ours goes onto the main thread's queue, for the others to steal
+	Queue *queue = queues_[ ( jobQueueIndex >= 0 ) ? jobQueueIndex : 0 ];
+	{
+		std::lock_guard< std::mutex > lock( queue->mutex );
+		queue->jobs.push_back( job );
+	}
+
+	numQueued_.fetch_add( 1 );
+	if ( numSleeping_.load() > 0 ) {
+		std::lock_guard< std::mutex > lock( sleepMutex_ );
+		wake_.notify_one();
+	}
+}
+
+ohw::JobSystem::Job *ohw::JobSystem::Pop() {
+	if ( queues_.empty() ) {
+		return nullptr;
+	}
+
+	// Newest first from our own, so it's still warm in the cache
+	unsigned int index = ( jobQueueIndex >= 0 ) ? jobQueueIndex : 0;
+	if ( jobQueueIndex >= 0 ) {
+		Queue *queue = queues_[ index ];
+		std::lock_guard< std::mutex > lock( queue->mutex );
+		if ( !queue->jobs.empty() ) {
+			Job *job = queue->jobs.back();
+			queue->jobs.pop_back();
+			numQueued_.fetch_sub( 1 );
+			return job;
+		}
+	}
+
+	// Otherwise steal the oldest from someone else
+	for ( unsigned int i = 1; i <= queues_.size(); ++i ) {
+		Queue *queue = queues_[ ( index + i ) % queues_.size() ];
+		std::lock_guard< std::mutex > lock( queue->mutex );
+		if ( !queue->jobs.empty() ) {
+			Job *job = queue->jobs.front();
+			queue->jobs.pop_front();
+			numQueued_.fetch_sub( 1 );
+			return job;
+		}
+	}
+
+	return nullptr;
+}
+
+void ohw::JobSystem::Run( Job *job ) {
+	{
+		// Anything the job left on the scratch arena is done with now
+		MemoryArenaScope scope;
+		MemoryTagScope tagScope( job->tag );
+		job->function();
+	}
+
+	Counter *counter = job->counter;
+	delete job;
+
+	if ( counter == nullptr ) {
+		return;
+	}
+
+	// Once it's dropped to zero, whoever's waiting may destroy it, so everything's taken out beforehand
+	std::vector< Job * > dependents;
+	{
+		std::lock_guard< std::mutex > lock( counter->mutex );
+		if ( counter->numPending.fetch_sub( 1, std::memory_order_acq_rel ) == 1 ) {
+			dependents.swap( counter->dependents );
+		}
+	}
+
+	for ( auto dependent : dependents ) {
+		Enqueue( dependent );
+	}
+}
+
+bool ohw::JobSystem::RunOne() {
+	Job *job = Pop();
+	if ( job == nullptr ) {
+		return false;
+	}
+
+	Run( job );
+	return true;
+}
+
+void ohw::JobSystem::RunMainThreadJobs() {
+	std::deque< Job * > jobs;
+	{
+		std::lock_guard< std::mutex > lock( mainQueue_.mutex );
+		jobs.swap( mainQueue_.jobs );
+	}
+
+	for ( auto job : jobs ) {
+		Run( job );
+	}
+}
+
+void ohw::JobSystem::Wait( Counter *counter ) {
+	while ( !counter->IsDone() ) {
+		if ( IsMainThread() ) {
+			RunMainThreadJobs();
+		}
+
+		if ( !RunOne() ) {
+			std::this_thread::yield();
+		}
+	}
+
+	// Make sure whoever finished it is done with it
+	std::lock_guard< std::mutex > lock( counter->mutex );
+}
+
+void ohw::JobSystem::WorkerThread( unsigned int index ) {
+	jobQueueIndex = index;
+
+	while ( isRunning_ ) {
+		if ( RunOne() ) {
+			continue;
+		}
+
+		std::unique_lock< std::mutex > lock( sleepMutex_ );
+		numSleeping_++;
+		wake_.wait( lock, [ this ]() { return numQueued_.load() > 0 || !isRunning_; } );
+		numSleeping_--;
+	}
+}
+
+void ohw::JobSystem::BenchmarkCommand( unsigned int argc, char **argv ) {
+	unsigned int iterations = ( argc > 1 ) ? strtoul( argv[ 1 ], nullptr, 10 ) : 10;
+	if ( iterations == 0 ) {
+		iterations = 1;
+	}
+
+	JobSystem *jobSystem = GetInstance();
+	if ( !jobSystem->IsMainThread() ) {
+		Warning( "Can only be run from the main thread!\n" );
+		return;
+	}
+
+	Map *map = GetApp()->gameManager->GetCurrentMap();
+	Terrain *terrain = ( map != nullptr ) ? map->GetTerrain() : nullptr;
+
+	// Something to chew on that doesn't touch anything else
+	std::vector< uint8_t > data( 256 * 65536 );
+	for ( size_t i = 0; i < data.size(); ++i ) {
+		data[ i ] = static_cast< uint8_t >( i * 31 );
+	}
+	std::vector< uint64_t > hashes( 256 );
+
+	unsigned int numThreadsInUse = jobSystem->GetNumThreads();
+	unsigned int maxThreads = std::max( std::thread::hardware_concurrency(), 1U );
+	double baseHashTime = 0, baseTerrainTime = 0;
+	for ( unsigned int numThreads = 1; numThreads <= maxThreads; ++numThreads ) {
+		jobSystem->Initialize( numThreads );
+
+		Timer hashTimer;
+		for ( unsigned int i = 0; i < iterations; ++i ) {
+			jobSystem->ParallelFor( hashes.size(), [ & ]( unsigned int j ) {
+				hashes[ j ] = u_hash( &data[ j * 65536 ], 65536, U_HASH_SEED );
+			} );
+		}
+		hashTimer.End();
+
+		double hashTime = hashTimer.GetTimeTaken() * 1000.0 / iterations;
+		if ( numThreads == 1 ) {
+			baseHashTime = hashTime;
+		}
+
+		if ( terrain == nullptr ) {
+			Print( "%2u threads: hashing %.3fms (%.2fx)\n", numThreads, hashTime, baseHashTime / hashTime );
+			continue;
+		}
+
+		Timer terrainTimer;
+		for ( unsigned int i = 0; i < iterations; ++i ) {
+			terrain->GenerateMeshes();
+		}
+		terrainTimer.End();
+
+		double terrainTime = terrainTimer.GetTimeTaken() * 1000.0 / iterations;
+		if ( numThreads == 1 ) {
+			baseTerrainTime = terrainTime;
+		}
+
+		Print( "%2u threads: hashing %.3fms (%.2fx), terrain meshing %.3fms (%.2fx)\n",
+		       numThreads, hashTime, baseHashTime / hashTime, terrainTime, baseTerrainTime / terrainTime );
+	}
+
+	jobSystem->Restore( numThreadsInUse );
+
+	if ( terrain == nullptr ) {
+		Print( "Load a map to include terrain meshing\n" );
+	}
+}
+
+/**
+ * Runs everything the job system offers, over and over, on more threads
+ * than there are likely to be cores, and checks it all happened exactly
+ * once and in the right order. Best run under a thread sanitizer.
+ */
+void ohw::JobSystem::TestCommand( unsigned int argc, char **argv ) {
+	unsigned int rounds = ( argc > 1 ) ? strtoul( argv[ 1 ], nullptr, 10 ) : 100;
+	if ( rounds == 0 ) {
+		rounds = 1;
+	}
+
+	JobSystem *jobSystem = GetInstance();
+	if ( !jobSystem->IsMainThread() ) {
+		Warning( "Can only be run from the main thread!\n" );
+		return;
+	}
+
+	unsigned int numThreadsInUse = jobSystem->GetNumThreads();
+	unsigned int numFailed = 0;
+	for ( unsigned int numThreads = 1; numThreads <= 16; numThreads *= 2 ) {
+		jobSystem->Initialize( numThreads );
+
+		std::atomic< unsigned int > numErrors{ 0 };
+		for ( unsigned int round = 0; round < rounds; ++round ) {
+			// Every index exactly once
+			std::vector< unsigned int > counts( 10000, 0 );
+			jobSystem->ParallelFor( counts.size(), [ &counts ]( unsigned int i ) { counts[ i ]++; } );
+			for ( auto count : counts ) {
+				if ( count != 1 ) {
+					numErrors++;
+					break;
+				}
+			}
+
+			// A chain, ending on the main thread, where each waits on everything before
+			Counter first, second, last;
+			std::atomic< unsigned int > stage{ 0 };
+			bool hasMainRun = false;
+			for ( unsigned int i = 0; i < 16; ++i ) {
+				jobSystem->Submit( [ &stage ]() { stage++; }, &first );
+			}
+			jobSystem->Submit( [ &stage, &numErrors ]() {
+				if ( stage.load() != 16 ) {
+					numErrors++;
+				}
+				stage += 100;
+			}, &second, &first );
+			jobSystem->SubmitMain( [ jobSystem, &stage, &numErrors, &hasMainRun ]() {
+				if ( !jobSystem->IsMainThread() || stage.load() != 116 ) {
+					numErrors++;
+				}
+				hasMainRun = true;
+			}, &last, &second );
+			jobSystem->Wait( &last );
+			if ( !hasMainRun ) {
+				numErrors++;
+			}
+
+			// Jobs that wait on jobs of their own
+			Counter nested;
+			std::atomic< unsigned int > total{ 0 };
+			for ( unsigned int i = 0; i < 8; ++i ) {
+				jobSystem->Submit( [ jobSystem, &total ]() {
+					jobSystem->ParallelFor( 100, [ &total ]( unsigned int ) { total++; } );
+				}, &nested );
+			}
+			jobSystem->Wait( &nested );
+			if ( total.load() != 800 ) {
+				numErrors++;
+			}
+		}
+
+		Print( "%2u threads: %u rounds, %u failed\n", numThreads, rounds, numErrors.load() );
+		numFailed += numErrors.load();
+	}
+
+	jobSystem->Restore( numThreadsInUse );
+
+	if ( numFailed > 0 ) {
+		Warning( "Job system failed %u checks!\n", numFailed );
+	} else {
+		Print( "Job system passed\n" );
+	}
+}
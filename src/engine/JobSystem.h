@@ -0,0 +1,156 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+
+#include "MemoryTracker.h"
+
+namespace ohw {
+	/**
+	 * Runs small pieces of work across every core.
+	 *
+	 * Each thread, the main thread included, has its own queue; it takes
+	 * its newest work from the back, and when it runs dry it steals the
+	 * oldest from the front of someone else's. Anything that needs to call
+	 * into GL can be queued for the main thread instead, which runs those
+	 * each frame or whenever it's waiting on something.
+	 *
+	 * Jobs can add themselves to a counter, which is what gets waited on,
+	 * and can be held back until another counter's finished.
+	 */
+	class JobSystem {
+	private:
+		struct Job;
+
+	public:
+		static JobSystem *GetInstance() {
+			static JobSystem *instance = nullptr;
+			if ( instance == nullptr ) {
+				instance = new JobSystem();
+			}
+			return instance;
+		}
+
+		typedef std::function< void() > JobFunction;
+
+		struct Counter {
+			PL_INLINE bool IsDone() const { return numPending.load( std::memory_order_acquire ) == 0; }
+
+			std::atomic< unsigned int > numPending{ 0 };
+
+		private:
+			std::mutex mutex;                   // held while numPending drops, so Wait can't return early
+			std::vector< Job * > dependents;    // held back until this is done
+
+			friend class JobSystem;
+		};
+
+		/* must be called from the main thread, 0 threads means one per core */
+		void Initialize( unsigned int numThreads = 0 );
+		void Shutdown();
+
+		/* counter is optional; if dependency is given, it won't start until that's done */
+		void Submit( const JobFunction &function, Counter *counter = nullptr, Counter *dependency = nullptr );
+		/* as above, but only ever run on the main thread */
+		void SubmitMain( const JobFunction &function, Counter *counter = nullptr, Counter *dependency = nullptr );
+
+		/* runs whatever it can while waiting */
+		void Wait( Counter *counter );
+
+		/* runs anything queued for the main thread, called once per frame */
+		void RunMainThreadJobs();
+
+		/**
+		 * Calls function( i ) for every index up to count, split into batches
+		 * across every thread, and waits for it all to finish.
+		 */
+		template< typename F >
+		void ParallelFor( unsigned int count, const F &function ) {
+			unsigned int numBatches = std::min( count, GetNumThreads() * 4 );
+			if ( numBatches <= 1 ) {
+				for ( unsigned int i = 0; i < count; ++i ) {
+					function( i );
+				}
+				return;
+			}
+
+			Counter counter;
+			for ( unsigned int batch = 0; batch < numBatches; ++batch ) {
+				unsigned int begin = ( count * batch ) / numBatches;
+				unsigned int end = ( count * ( batch + 1 ) ) / numBatches;
+				Submit( [ &function, begin, end ]() {
+					for ( unsigned int i = begin; i < end; ++i ) {
+						function( i );
+					}
+				}, &counter );
+			}
+			Wait( &counter );
+		}
+
+		/* number of threads jobs run on, including the main thread */
+		PL_INLINE unsigned int GetNumThreads() const { return queues_.size(); }
+
+		bool IsMainThread() const;
+
+	private:
+		JobSystem();
+
+		struct Job {
+			JobFunction function;
+			Counter *counter{ nullptr };
+			bool isMainThread{ false };
+			MemoryTag tag{ MemoryTag::GENERAL };   // whatever the submitter was allocating under
+		};
+
+		struct Queue {
+			std::mutex mutex;
+			std::deque< Job * > jobs;
+		};
+
+		void Enqueue( Job *job );
+		void Push( Job *job, Counter *dependency );
+		Job *Pop();
+		void Run( Job *job );
+		bool RunOne();
+
+		void WorkerThread( unsigned int index );
+
+		void Restore( unsigned int numThreads );
+
+		static void BenchmarkCommand( unsigned int argc, char **argv );
+		static void TestCommand( unsigned int argc, char **argv );
+
+		std::vector< Queue * > queues_;
+		std::vector< std::thread > threads_;
+
+		Queue mainQueue_;
+
+		std::mutex sleepMutex_;
+		std::condition_variable wake_;
+		std::atomic< unsigned int > numQueued_{ 0 };
+		std::atomic< unsigned int > numSleeping_{ 0 };
+		std::atomic< bool > isRunning_{ false };
+	};
+}
@@ -0,0 +1,207 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "App.h"
+#include "LoadTracer.h"
+#include "FrameLimiter.h"
+#include "Menu.h"
+#include "config.h"
+
+#define LOAD_REGRESSION_MS          5.0     // anything slower than last time by this much, and...
+#define LOAD_REGRESSION_FRACTION    0.1     // ...by this much of what it was, gets flagged
+
+void ohw::LoadTracer::Begin( const std::string &name ) {
+	name_ = name;
+	phases_.clear();
+	activePhases_.clear();
+	previousTimes_.clear();
+	completedWeight_ = 0.0f;
+	numRedraws_ = 0;
+	redrawTime_ = 0;
+	lastRedrawTime_ = 0;
+
+	LoadPreviousReport( std::string( Config_GetUserReportPath() ) + "load_" + name_ + ".txt" );
+
+	isActive_ = true;
+	startTime_ = FrameLimiter::GetTime();
+}
+
+void ohw::LoadTracer::End() {
+	if ( !isActive_ ) {
+		return;
+	}
+
+	while ( !activePhases_.empty() ) {
+		EndPhase();
+	}
+
+	duration_ = FrameLimiter::GetTime() - startTime_;
+	isActive_ = false;
+
+	Print( "Loaded \"%s\" in %.2fms\n", name_.c_str(), duration_ / 1e6 );
+
+	if ( !plCreatePath( Config_GetUserReportPath() ) ) {
+		Warning( "Failed to create report directory, \"%s\"!\n", Config_GetUserReportPath() );
+		return;
+	}
+
+	WriteReport( std::string( Config_GetUserReportPath() ) + "load_" + name_ + ".txt" );
+}
+
+void ohw::LoadTracer::Cancel() {
+	isActive_ = false;
+	activePhases_.clear();
+}
+
+void ohw::LoadTracer::BeginPhase( const char *name, const char *description, float weight ) {
+	if ( !isActive_ ) {
+		return;
+	}
+
+	Phase phase;
+	phase.path = activePhases_.empty() ? name : phases_[ activePhases_.back() ].path + "/" + name;
+	phase.depth = activePhases_.size();
+	phase.weight = activePhases_.empty() ? weight : 0.0f;
+	phase.startTime = FrameLimiter::GetTime();
+
+	activePhases_.push_back( phases_.size() );
+	phases_.push_back( phase );
+
+	if ( description != nullptr ) {
+		FE_SetLoadingDescription( description );
+	}
+
+	UpdateProgress();
+}
+
+void ohw::LoadTracer::EndPhase() {
+	if ( !isActive_ || activePhases_.empty() ) {
+		return;
+	}
+
+	Phase &phase = phases_[ activePhases_.back() ];
+	phase.duration = FrameLimiter::GetTime() - phase.startTime;
+	activePhases_.pop_back();
+
+	if ( activePhases_.empty() ) {
+		completedWeight_ += phase.weight;
+	}
+
+	UpdateProgress();
+}
+
+/**
+ * Moves the bar on by however much of the current top-level step is
+ * likely done, going by how long it took last time.
+ */
+void ohw::LoadTracer::UpdateProgress() {
+	float progress = completedWeight_;
+	if ( !activePhases_.empty() ) {
+		const Phase &phase = phases_[ activePhases_.front() ];
+		auto previous = previousTimes_.find( phase.path );
+		if ( previous != previousTimes_.end() && previous->second > 0.0 ) {
+			double elapsed = ( FrameLimiter::GetTime() - phase.startTime ) / 1e6;
+			// Held back a little, in case it's slower this time
+			progress += phase.weight * ( float ) std::min( elapsed / previous->second, 0.95 );
+		}
+	}
+
+	FE_SetLoadingProgress( ( uint8_t ) std::min( progress, 100.0f ) );
+}
+
+/**
+ * Everything's loaded on the main thread, so this is called along the
+ * way to keep the loading screen up to date. Only the loading screen is
+ * drawn, and events are pumped but not handled, so nothing else gets a
+ * look at the game while it's half loaded.
+ */
+void ohw::LoadTracer::Redraw() {
+	if ( !isActive_ ) {
+		return;
+	}
+
+	uint64_t now = FrameLimiter::GetTime();
+	if ( lastRedrawTime_ != 0 && now - lastRedrawTime_ < ( uint64_t ) NSEC_PER_SEC / LOAD_REDRAW_RATE ) {
+		return;
+	}
+
+	// Stop the window being flagged as not responding
+	SDL_PumpEvents();
+
+	GetApp()->GetDisplay()->RenderLoadingScreen();
+
+	lastRedrawTime_ = FrameLimiter::GetTime();
+	redrawTime_ += lastRedrawTime_ - now;
+	numRedraws_++;
+}
+
+void ohw::LoadTracer::LoadPreviousReport( const std::string &path ) {
+	FILE *fp = fopen( path.c_str(), "r" );
+	if ( fp == nullptr ) {
+		return;
+	}
+
+	// Each step is on its own line, as its path followed by how long it took
+	char line[ 512 ];
+	while ( fgets( line, sizeof( line ), fp ) != nullptr ) {
+		char stepPath[ 256 ];
+		double ms;
+		if ( line[ 0 ] != '#' && sscanf( line, "%255s %lf", stepPath, &ms ) == 2 ) {
+			previousTimes_[ stepPath ] = ms;
+		}
+	}
+
+	fclose( fp );
+}
+
+void ohw::LoadTracer::WriteReport( const std::string &path ) {
+	FILE *fp = fopen( path.c_str(), "w" );
+	if ( fp == nullptr ) {
+		Warning( "Failed to write load report to \"%s\"!\n", path.c_str() );
+		return;
+	}
+
+	fprintf( fp, "# Load report for \"%s\", all times in milliseconds\n", name_.c_str() );
+	fprintf( fp, "# %-38s %10s %10s %10s\n", "step", "time", "previous", "change" );
+
+	auto writeStep = [ & ]( const std::string &stepPath, uint64_t duration ) {
+		double ms = duration / 1e6;
+		fprintf( fp, "%-40s %10.2f", stepPath.c_str(), ms );
+
+		auto previous = previousTimes_.find( stepPath );
+		if ( previous == previousTimes_.end() ) {
+			fprintf( fp, " %10s %10s\n", "-", "-" );
+			return;
+		}
+
+		double change = ms - previous->second;
+		bool isRegression = ( change > LOAD_REGRESSION_MS && change > previous->second * LOAD_REGRESSION_FRACTION );
+		fprintf( fp, " %10.2f %+10.2f%s\n", previous->second, change, isRegression ? "  <-- slower" : "" );
+	};
+
+	writeStep( "total", duration_ );
+	for ( const auto &phase : phases_ ) {
+		writeStep( phase.path, phase.duration );
+	}
+
+	fprintf( fp, "# drew the loading screen %u times, which took %.2fms of that\n", numRedraws_, redrawTime_ / 1e6 );
+
+	fclose( fp );
+
+	Print( "Wrote load report to \"%s\"\n", path.c_str() );
+}
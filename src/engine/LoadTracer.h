@@ -0,0 +1,103 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <map>
+
+#define LOAD_REDRAW_RATE    30  // most times a second the loading screen is redrawn
+
+namespace ohw {
+	/**
+	 * Times each step of loading into a game, keeps the loading screen's
+	 * bar and description up to date as it goes, and once it's all done
+	 * writes out a report for the map, alongside how long each step took
+	 * the last time round.
+	 *
+	 * Steps can be nested, giving each a path such as map/terrain/atlas,
+	 * and anything outside of Begin / End is ignored, so they're safe to
+	 * leave in code that runs at other times too.
+	 */
+	class LoadTracer {
+	public:
+		static LoadTracer *GetInstance() {
+			static LoadTracer *instance = nullptr;
+			if ( instance == nullptr ) {
+				instance = new LoadTracer();
+			}
+			return instance;
+		}
+
+		void Begin( const std::string &name );
+		void End();
+		/* stops without writing a report, for when loading failed */
+		void Cancel();
+
+		PL_INLINE bool IsActive() const { return isActive_; }
+
+		/**
+		 * Weight is the share of the loading bar a top-level step takes
+		 * up, out of 100, and description what's shown over it.
+		 */
+		void BeginPhase( const char *name, const char *description = nullptr, float weight = 0.0f );
+		void EndPhase();
+
+		void Redraw();
+
+	private:
+		LoadTracer() = default;
+
+		void UpdateProgress();
+
+		void LoadPreviousReport( const std::string &path );
+		void WriteReport( const std::string &path );
+
+		struct Phase {
+			std::string path;
+			unsigned int depth{ 0 };
+			uint64_t startTime{ 0 };
+			uint64_t duration{ 0 };
+			float weight{ 0 };
+		};
+		std::vector< Phase > phases_;
+		std::vector< size_t > activePhases_;
+
+		/* how long each step took last time, in milliseconds */
+		std::map< std::string, double > previousTimes_;
+
+		std::string name_;
+		bool isActive_{ false };
+		uint64_t startTime_{ 0 };
+		uint64_t duration_{ 0 };
+		float completedWeight_{ 0 };
+
+		uint64_t lastRedrawTime_{ 0 };
+		uint64_t redrawTime_{ 0 };
+		unsigned int numRedraws_{ 0 };
+	};
+
+	class LoadPhaseScope {
+	public:
+		explicit LoadPhaseScope( const char *name, const char *description = nullptr, float weight = 0.0f ) {
+			LoadTracer::GetInstance()->BeginPhase( name, description, weight );
+		}
+		~LoadPhaseScope() {
+			LoadTracer::GetInstance()->EndPhase();
+		}
+	};
+}
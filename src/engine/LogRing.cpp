@@ -0,0 +1,186 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "App.h"
+#include "LogRing.h"
+
+#define LOG_SINK_INTERVAL   10      // ms between each write to the log file
+
+ohw::LogRing::LogRing() {
+	plRegisterConsoleCommand( "PrintLogStats", PrintStatsCommand,
+	                          "Prints how many records have been logged, and how many were lost or cut short." );
+	plRegisterConsoleCommand( "BenchmarkLog", BenchmarkCommand,
+	                          "Pushes records into the log from multiple threads at once. [records per thread] [threads]" );
+}
+
+void ohw::LogRing::Push( int level, const char *msg ) {
+	uint64_t ticket = head_.fetch_add( 1, std::memory_order_relaxed );
+	Record &record = records_[ ticket & ( LOG_RING_RECORDS - 1 ) ];
+
+	if ( isSinkRunning_.load( std::memory_order_relaxed ) ) {
+		// Half full, so give the log file a nudge
+		if ( ( ticket & ( LOG_RING_RECORDS / 2 - 1 ) ) == 0 ) {
+			sinkWake_.notify_one();
+		}
+
+		// Don't overwrite anything that's not made it to the log file yet
+		while ( ticket >= sinkTicket_.load( std::memory_order_acquire ) + LOG_RING_RECORDS &&
+		        isSinkRunning_.load( std::memory_order_relaxed ) ) {
+			sinkWake_.notify_one();
+			std::this_thread::yield();
+		}
+	}
+
+	// Mark it as being written, so anyone reading it knows it's changing
+	record.sequence.store( 0, std::memory_order_relaxed );
+	std::atomic_thread_fence( std::memory_order_release );
+
+	size_t length = strlen( msg );
+	if ( length >= sizeof( record.text ) ) {
+		length = sizeof( record.text ) - 1;
+		numTruncated_.fetch_add( 1, std::memory_order_relaxed );
+	}
+
+	record.level = level;
+	record.length = length;
+	memcpy( record.text, msg, length );
+	record.text[ length ] = '\0';
+
+	record.sequence.store( ticket + 1, std::memory_order_release );
+}
+
+bool ohw::LogRing::Read( uint64_t ticket, int *level, char *out, size_t outSize ) const {
+	const Record &record = records_[ ticket & ( LOG_RING_RECORDS - 1 ) ];
+
+	uint64_t sequence = record.sequence.load( std::memory_order_acquire );
+	if ( sequence != ticket + 1 || outSize == 0 ) {
+		return false;
+	}
+
+	size_t length = std::min( ( size_t ) record.length, outSize - 1 );
+	*level = record.level;
+	memcpy( out, record.text, length );
+	out[ length ] = '\0';
+
+	// If it was overwritten while we were copying, what we've got is garbage
+	std::atomic_thread_fence( std::memory_order_acquire );
+	return record.sequence.load( std::memory_order_relaxed ) == sequence;
+}
+
+bool ohw::LogRing::StartFileSink( const char *path ) {
+	StopFileSink();
+
+	sinkFile_ = fopen( path, "w" );
+	if ( sinkFile_ == nullptr ) {
+		return false;
+	}
+
+	// Only log from here on, anything before it's either in the file already or gone
+	sinkTicket_ = GetHead();
+	numDropped_ = 0;
+
+	isSinkRunning_ = true;
+	sinkThread_ = std::thread( &LogRing::SinkThread, this );
+
+	return true;
+}
+
+void ohw::LogRing::StopFileSink() {
+	if ( !isSinkRunning_ ) {
+		return;
+	}
+
+	isSinkRunning_ = false;
+	sinkWake_.notify_one();
+	sinkThread_.join();
+
+	FlushSink();
+
+	fclose( sinkFile_ );
+	sinkFile_ = nullptr;
+}
+
+void ohw::LogRing::SinkThread() {
+	std::unique_lock< std::mutex > lock( sinkMutex_ );
+	while ( isSinkRunning_ ) {
+		FlushSink();
+		sinkWake_.wait_for( lock, std::chrono::milliseconds( LOG_SINK_INTERVAL ) );
+	}
+}
+
+void ohw::LogRing::FlushSink() {
+	uint64_t ticket = sinkTicket_.load( std::memory_order_relaxed );
+	uint64_t oldTicket = ticket;
+	char text[ LOG_RECORD_LENGTH ];
+	while ( ticket < GetHead() ) {
+		int level;
+		if ( !Read( ticket, &level, text, sizeof( text ) ) ) {
+			// Overwritten before we got to it, which only happens if it was logged before the sink started
+			const Record &record = records_[ ticket & ( LOG_RING_RECORDS - 1 ) ];
+			if ( record.sequence.load( std::memory_order_acquire ) > ticket + 1 ) {
+				numDropped_++;
+				sinkTicket_.store( ++ticket, std::memory_order_release );
+				continue;
+			}
+
+			// Otherwise it's still being written, try again next time
+			break;
+		}
+
+		fputs( text, sinkFile_ );
+		sinkTicket_.store( ++ticket, std::memory_order_release );
+	}
+
+	if ( ticket != oldTicket ) {
+		fflush( sinkFile_ );
+	}
+}
+
+void ohw::LogRing::PrintStatsCommand( unsigned int argc, char **argv ) {
+	LogRing *ring = GetInstance();
+	Print( "%llu records logged, %u cut short, %llu never made it to the log file\n",
+	       ( unsigned long long ) ring->GetHead(), ring->numTruncated_.load(), ( unsigned long long ) ring->numDropped_.load() );
+}
+
+void ohw::LogRing::BenchmarkCommand( unsigned int argc, char **argv ) {
+	unsigned int numRecords = ( argc > 1 ) ? strtoul( argv[ 1 ], nullptr, 10 ) : 100000;
+	unsigned int numThreads = ( argc > 2 ) ? strtoul( argv[ 2 ], nullptr, 10 ) : std::max( std::thread::hardware_concurrency(), 1U );
+	numThreads = std::max( numThreads, 1U );
+
+	LogRing *ring = GetInstance();
+
+	Timer timer;
+	std::vector< std::thread > threads;
+	for ( unsigned int i = 0; i < numThreads; ++i ) {
+		threads.emplace_back( [ ring, numRecords, i ]() {
+			char msg[ 64 ];
+			for ( unsigned int j = 0; j < numRecords; ++j ) {
+				snprintf( msg, sizeof( msg ), "(BenchmarkLog) thread %u, record %u\n", i, j );
+				ring->Push( LOG_LEVEL_DEBUG, msg );
+			}
+		} );
+	}
+	for ( auto &thread : threads ) {
+		thread.join();
+	}
+	timer.End();
+
+	unsigned int total = numRecords * numThreads;
+	Print( "Pushed %u records from %u threads in %.2fms, %.1fns per record\n",
+	       total, numThreads, timer.GetTimeTaken() * 1000.0, timer.GetTimeTaken() * 1000000000.0 / std::max( total, 1U ) );
+}
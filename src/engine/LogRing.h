@@ -0,0 +1,99 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/* must be a power of two */
+#define LOG_RING_RECORDS    2048
+#define LOG_RECORD_LENGTH   512
+
+namespace ohw {
+	/**
+	 * Holds the most recent log output, for the console and the log file.
+	 *
+	 * Any thread can push to it without taking a lock; each record is given
+	 * a ticket when it's pushed, which also decides where it goes in the
+	 * ring. Once the ring's full the oldest records are overwritten, so
+	 * readers check a record's ticket either side of copying it out to be
+	 * sure it didn't change underneath them.
+	 *
+	 * The log file is written on its own thread, so logging doesn't have to
+	 * wait on the disk. It's woken early as the ring fills, and if it still
+	 * can't keep up, whoever's pushing waits for it rather than lose lines.
+	 */
+	class LogRing {
+	public:
+		static LogRing *GetInstance() {
+			static LogRing *instance = nullptr;
+			if ( instance == nullptr ) {
+				instance = new LogRing();
+			}
+			return instance;
+		}
+
+		void Push( int level, const char *msg );
+
+		/* returns false if the record hasn't been written yet, or has since been overwritten */
+		bool Read( uint64_t ticket, int *level, char *out, size_t outSize ) const;
+
+		/* ticket the next record will be given */
+		PL_INLINE uint64_t GetHead() const { return head_.load( std::memory_order_acquire ); }
+		/* ticket of the oldest record still in the ring */
+		PL_INLINE uint64_t GetTail() const {
+			uint64_t head = GetHead();
+			return ( head > LOG_RING_RECORDS ) ? head - LOG_RING_RECORDS : 0;
+		}
+
+		bool StartFileSink( const char *path );
+		/* writes out anything that's left before returning */
+		void StopFileSink();
+
+	private:
+		LogRing();
+
+		struct Record {
+			std::atomic< uint64_t > sequence{ 0 };  // ticket + 1 once written, 0 while being written
+			int level{ 0 };
+			unsigned int length{ 0 };
+			char text[ LOG_RECORD_LENGTH ];
+		};
+
+		void SinkThread();
+		void FlushSink();
+
+		static void PrintStatsCommand( unsigned int argc, char **argv );
+		static void BenchmarkCommand( unsigned int argc, char **argv );
+
+		Record records_[ LOG_RING_RECORDS ];
+		std::atomic< uint64_t > head_{ 0 };
+		std::atomic< unsigned int > numTruncated_{ 0 };
+
+		std::thread sinkThread_;
+		std::mutex sinkMutex_;
+		std::condition_variable sinkWake_;
+		std::atomic< bool > isSinkRunning_{ false };
+		FILE *sinkFile_{ nullptr };
+		std::atomic< uint64_t > sinkTicket_{ 0 };
+		std::atomic< uint64_t > numDropped_{ 0 };     // records overwritten before the sink got to them
+	};
+}
@@ -17,10 +17,16 @@
 
 #include "App.h"
 #include "Map.h"
+#include "Metrics.h"
+#include "LoadTracer.h"
+#include "Random.h"
 
 #include "graphics/ShaderManager.h"
 #include "graphics/TextureAtlas.h"
 
+#include "loaders/MappedFile.h"
+#include "loaders/BinaryReader.h"
+
 ohw::Map::Map( MapManifest *manifest ) : manifest_( manifest ) {
 	std::string base_path = "maps/" + manifest_->filename + "/";
 
@@ -31,16 +37,30 @@ ohw::Map::Map( MapManifest *manifest ) : manifest_( manifest ) {
 	}
 
 	// create the terrain
-	terrain_ = new Terrain( tilePath );
-	// then load the Pmg if it exists otherwise
+	{
+		LoadPhaseScope phase( "terrain" );
+		terrain_ = new Terrain( tilePath );
+	}
+
+	// then load the Oht or Pmg if either exist, otherwise
 	// we'll just assume it's a new map (heightmap data can be imported after)
-	std::string pmgPath = "maps/" + manifest_->filename + "/" + manifest_->filename + ".pmg";
-	terrain_->LoadPmg( pmgPath );
+	{
+		LoadPhaseScope phase( "heightmap" );
+		std::string ohtPath = "maps/" + manifest_->filename + "/" + manifest_->filename + ".oht";
+		if ( !terrain_->LoadOht( ohtPath ) ) {
+			std::string pmgPath = "maps/" + manifest_->filename + "/" + manifest_->filename + ".pmg";
+			terrain_->LoadPmg( pmgPath );
+		}
+	}
 
-	std::string pogPath = "maps/" + manifest_->filename + "/" + manifest_->filename + ".pog";
-	LoadSpawns( pogPath );
+	{
+		LoadPhaseScope phase( "spawns" );
+		std::string pogPath = "maps/" + manifest_->filename + "/" + manifest_->filename + ".pog";
+		LoadSpawns( pogPath );
+	}
 
 	// Load both the bottom and top parts of the sky dome
+	LoadPhaseScope phase( "sky" );
 	if ( skyModelTop == nullptr ) {
 		skyModelTop = LoadSkyModel( "skys/skydome.vtx" );
 	}
@@ -109,6 +129,7 @@ void ohw::Map::UpdateSkyModel( SharedModelResourcePointer model ) {
 	}
 
 	plUploadMesh( mesh );
+	METRIC_COUNTER( "render.mesh_uploads" )->Add();
 }
 
 /**
@@ -116,8 +137,8 @@ void ohw::Map::UpdateSkyModel( SharedModelResourcePointer model ) {
  */
 PLVector2 ohw::Map::GetRandomPointInPlayArea() const {
 	return PLVector2(
-			TERRAIN_PLAYABLE_BORDER + plGenerateRandomf( TERRAIN_PLAYABLE_AREA ),
-			TERRAIN_PLAYABLE_BORDER + plGenerateRandomf( TERRAIN_PLAYABLE_AREA ) );
+			TERRAIN_PLAYABLE_BORDER + Random::GenerateFloat( TERRAIN_PLAYABLE_AREA ),
+			TERRAIN_PLAYABLE_BORDER + Random::GenerateFloat( TERRAIN_PLAYABLE_AREA ) );
 }
 
 /**
@@ -156,24 +177,26 @@ void ohw::Map::LoadSpawns( const std::string &path ) {
 	static_assert( sizeof( PogIndex ) == 94, "Invalid size for PogIndex, should be 94 bytes!" );
 
 	const char *cPath = path.c_str();
-	PLFile *fp = plOpenFile( cPath, false );
+	MappedFile *fp = Map_OpenFile( cPath );
 	if ( fp == NULL ) {
 		Warning( "Failed to open actor data, \"%s\" (%s)!\n", cPath, plGetError() );
 		return;
 	}
 
-	bool status = false;
-	uint16_t num_indices = plReadInt16( fp, false, &status );
-	if ( !status ) {
-		Error( "Failed to read Pog indices count in \"%s\" (%s)!\n", cPath, plGetError() );
+	BinReader reader;
+	Bin_InitReader( &reader, fp->data, fp->size );
+
+	uint16_t num_indices;
+	if ( !Bin_ReadUInt16( &reader, &num_indices ) ) {
+		Error( "Failed to read Pog indices count in \"%s\"!\n", cPath );
 	}
 
 	std::vector< PogIndex > spawns( num_indices );
-	if ( plReadFile( fp, spawns.data(), sizeof( PogIndex ), num_indices ) != num_indices ) {
-		Error( "Failed to read Pog spawns in \"%s\" (%s)!\n", cPath, plGetError() );
+	if ( !Bin_ReadArray( &reader, spawns.data(), sizeof( PogIndex ), num_indices ) ) {
+		Error( "Failed to read Pog spawns in \"%s\"!\n", cPath );
 	}
 
-	plCloseFile( fp );
+	Map_CloseFile( fp );
 
 	actorSpawns.resize( num_indices );
 
@@ -211,6 +234,19 @@ void ohw::Map::LoadSpawns( const std::string &path ) {
 	}
 }
 
+/**
+ * The fog shader works in view depth, and everything is entirely fog
+ * coloured once ( depth / ( far * 100 ) - 1 ) * ( near / 100 ) reaches 1.
+ */
+float ohw::Map::GetCullDistance() const {
+	if ( !cv_graphics_fog_cull->b_value || manifest_->fog_intensity <= 0.0f || manifest_->fog_distance <= 0.0f ) {
+		return 0.0f;
+	}
+
+	float farDistance = manifest_->fog_distance * 100.0f;
+	return farDistance * ( 1.0f + 100.0f / manifest_->fog_intensity );
+}
+
 void ohw::Map::Draw() {
 	Shaders_SetProgramByName( "generic_untextured" );
 
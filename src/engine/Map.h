@@ -40,6 +40,9 @@ namespace ohw {
 
 		void UpdateSky();
 
+		/* distance at which everything's fully fogged, or 0 if it never is */
+		float GetCullDistance() const;
+
 		PLVector2 GetRandomPointInPlayArea() const;
 		void GetPlayArea( PLVector2 *min, PLVector2 *max ) const;
 
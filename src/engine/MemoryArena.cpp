@@ -0,0 +1,223 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "App.h"
+#include "MemoryArena.h"
+#include "MemoryTracker.h"
+
+#include <mutex>
+
+/* every arena that's been created, for the stats */
+static std::mutex arenaListMutex;
+static std::vector< std::pair< std::string, ohw::MemoryArena * > > arenaList;
+
+static void MemoryArena_Register( const std::string &name, ohw::MemoryArena *arena ) {
+	std::lock_guard< std::mutex > lock( arenaListMutex );
+	arenaList.push_back( std::make_pair( name, arena ) );
+}
+
+static struct {
+	uint64_t lastTotal{ 0 };
+	uint64_t lastFrame{ 0 };
+	uint64_t maxFrame{ 0 };
+	uint64_t total{ 0 };
+	unsigned int numFrames{ 0 };
+} heapFrameStats;
+
+ohw::MemoryArena::MemoryArena( size_t blockSize ) : blockSize_( blockSize ) {}
+
+ohw::MemoryArena::~MemoryArena() {
+	for ( auto &block : blocks_ ) {
+		MemoryTracker::Free( block.data );
+	}
+}
+
+void *ohw::MemoryArena::Allocate( size_t size, size_t alignment ) {
+	while ( true ) {
+		if ( currentBlock_ < blocks_.size() ) {
+			Block &block = blocks_[ currentBlock_ ];
+			uintptr_t address = ( uintptr_t ) block.data + offset_;
+			size_t padding = ( alignment - ( address % alignment ) ) % alignment;
+			if ( offset_ + padding + size <= block.size ) {
+				offset_ += padding + size;
+				AddUsed( padding + size );
+				return block.data + offset_ - size;
+			}
+
+			// Doesn't fit, so move on to the next, if there is one
+			if ( currentBlock_ + 1 < blocks_.size() && blocks_[ currentBlock_ + 1 ].size >= size + alignment ) {
+				AddUsed( block.size - offset_ );
+				currentBlock_++;
+				offset_ = 0;
+				continue;
+			}
+		}
+
+		// Out of blocks, so add another, big enough for anything that's oversized
+		Block block;
+		block.size = std::max( blockSize_, size + alignment );
+		block.data = static_cast< char * >( MemoryTracker::Allocate( block.size ) );
+		if ( block.data == nullptr ) {
+			Error( "Failed to allocate %u bytes for memory arena!\n", block.size );
+		}
+
+		if ( currentBlock_ < blocks_.size() ) {
+			AddUsed( blocks_[ currentBlock_ ].size - offset_ );
+			currentBlock_++;
+		}
+		blocks_.insert( blocks_.begin() + currentBlock_, block );
+		capacity_.store( capacity_.load( std::memory_order_relaxed ) + block.size, std::memory_order_relaxed );
+		offset_ = 0;
+	}
+}
+
+/* nobody else writes to these, so there's no need for anything stronger than a relaxed store */
+void ohw::MemoryArena::AddUsed( size_t size ) {
+	size_t used = used_.load( std::memory_order_relaxed ) + size;
+	used_.store( used, std::memory_order_relaxed );
+	if ( used > peak_.load( std::memory_order_relaxed ) ) {
+		peak_.store( used, std::memory_order_relaxed );
+	}
+}
+
+void ohw::MemoryArena::Rewind( const Marker &marker ) {
+	u_assert( marker.block < currentBlock_ || ( marker.block == currentBlock_ && marker.offset <= offset_ ),
+	          "Rewinding memory arena forwards!\n" );
+
+	// Work out how much is being given back, for the stats
+	size_t released = offset_;
+	for ( size_t i = marker.block; i < currentBlock_; ++i ) {
+		released += blocks_[ i ].size;
+	}
+	released -= marker.offset;
+
+	size_t used = used_.load( std::memory_order_relaxed );
+	used_.store( used - std::min( released, used ), std::memory_order_relaxed );
+	currentBlock_ = marker.block;
+	offset_ = marker.offset;
+}
+
+void ohw::MemoryArena::Reset() {
+	currentBlock_ = 0;
+	offset_ = 0;
+	used_.store( 0, std::memory_order_relaxed );
+}
+
+ohw::MemoryArena *ohw::MemoryArena::GetTickArena() {
+	static MemoryArena *arena = nullptr;
+	if ( arena == nullptr ) {
+		arena = new MemoryArena();
+		MemoryArena_Register( "tick", arena );
+	}
+	return arena;
+}
+
+ohw::MemoryArena *ohw::MemoryArena::GetFrameArena() {
+	static MemoryArena *arena = nullptr;
+	if ( arena == nullptr ) {
+		arena = new MemoryArena();
+		MemoryArena_Register( "frame", arena );
+
+		plRegisterConsoleCommand( "PrintMemoryArenaStats", PrintStatsCommand,
+		                          "Prints how much of each memory arena is in use, and heap allocations per frame. [reset]" );
+	}
+	return arena;
+}
+
+/**
+ * Each thread's is created the first time it's asked for, and goes
+ * away along with the thread.
+ */
+ohw::MemoryArena *ohw::MemoryArena::GetThreadArena() {
+	struct ThreadArena {
+		~ThreadArena() {
+			if ( arena == nullptr ) {
+				return;
+			}
+
+			std::lock_guard< std::mutex > lock( arenaListMutex );
+			for ( auto i = arenaList.begin(); i != arenaList.end(); ++i ) {
+				if ( i->second == arena ) {
+					arenaList.erase( i );
+					break;
+				}
+			}
+			delete arena;
+		}
+
+		MemoryArena *arena{ nullptr };
+	};
+	static thread_local ThreadArena threadArena;
+
+	if ( threadArena.arena == nullptr ) {
+		static std::atomic< unsigned int > numThreadArenas{ 0 };
+		threadArena.arena = new MemoryArena( MEMORY_ARENA_BLOCK_SIZE / 4 );
+		MemoryArena_Register( "thread " + std::to_string( numThreadArenas++ ), threadArena.arena );
+	}
+	return threadArena.arena;
+}
+
+void ohw::MemoryArena::EndTick() {
+	GetTickArena()->Reset();
+}
+
+void ohw::MemoryArena::EndFrame() {
+	GetFrameArena()->Reset();
+
+	// Anything left on the main thread's scratch arena is outside of a scope, so it's done with too
+	GetThreadArena()->Reset();
+
+	// Everything before the first frame is just startup
+	uint64_t total = GetNumHeapAllocations();
+	if ( heapFrameStats.lastTotal == 0 ) {
+		heapFrameStats.lastTotal = total;
+		return;
+	}
+
+	heapFrameStats.lastFrame = total - heapFrameStats.lastTotal;
+	heapFrameStats.lastTotal = total;
+	heapFrameStats.maxFrame = std::max( heapFrameStats.maxFrame, heapFrameStats.lastFrame );
+	heapFrameStats.total += heapFrameStats.lastFrame;
+	heapFrameStats.numFrames++;
+}
+
+uint64_t ohw::MemoryArena::GetNumHeapAllocations() {
+	return MemoryTracker::GetNumAllocations();
+}
+
+void ohw::MemoryArena::PrintStatsCommand( unsigned int argc, char **argv ) {
+	{
+		std::lock_guard< std::mutex > lock( arenaListMutex );
+		for ( const auto &i : arenaList ) {
+			Print( "%-10s %8ukb in use, %8ukb at most, %8ukb reserved\n", i.first.c_str(),
+			       ( unsigned int ) ( i.second->GetUsed() / 1024 ), ( unsigned int ) ( i.second->GetPeak() / 1024 ),
+			       ( unsigned int ) ( i.second->GetCapacity() / 1024 ) );
+		}
+	}
+
+	Print( "Heap allocations: %u last frame, %.1f per frame on average, %u at most, over %u frames\n",
+	       ( unsigned int ) heapFrameStats.lastFrame,
+	       heapFrameStats.total / ( double ) std::max( heapFrameStats.numFrames, 1U ),
+	       ( unsigned int ) heapFrameStats.maxFrame, heapFrameStats.numFrames );
+
+	if ( argc > 1 && pl_strcasecmp( argv[ 1 ], "reset" ) == 0 ) {
+		heapFrameStats.maxFrame = 0;
+		heapFrameStats.total = 0;
+		heapFrameStats.numFrames = 0;
+	}
+}
@@ -0,0 +1,150 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+#include <string>
+
+#define MEMORY_ARENA_BLOCK_SIZE     ( 256 * 1024 )
+
+namespace ohw {
+	/**
+	 * Hands out memory by bumping a pointer along, for anything that only
+	 * needs to stick around briefly. Nothing's freed individually; instead
+	 * the whole lot is emptied in one go, either on a Reset or by rewinding
+	 * back to an earlier marker. The blocks are kept, so once it's grown
+	 * to fit, it stays off the heap entirely.
+	 *
+	 * The main thread has one emptied at the end of every tick and another
+	 * at the end of every frame. Every thread also has its own scratch
+	 * arena, which is only ever used through a MemoryArenaScope.
+	 */
+	class MemoryArena {
+	public:
+		explicit MemoryArena( size_t blockSize = MEMORY_ARENA_BLOCK_SIZE );
+		~MemoryArena();
+
+		MemoryArena( const MemoryArena & ) = delete;
+		MemoryArena &operator=( const MemoryArena & ) = delete;
+
+		void *Allocate( size_t size, size_t alignment = alignof( std::max_align_t ) );
+
+		struct Marker {
+			size_t block;
+			size_t offset;
+		};
+		PL_INLINE Marker GetMarker() const { return { currentBlock_, offset_ }; }
+		void Rewind( const Marker &marker );
+		void Reset();
+
+		/* safe to call from any thread, for the stats */
+		PL_INLINE size_t GetUsed() const { return used_.load( std::memory_order_relaxed ); }
+		PL_INLINE size_t GetPeak() const { return peak_.load( std::memory_order_relaxed ); }
+		PL_INLINE size_t GetCapacity() const { return capacity_.load( std::memory_order_relaxed ); }
+
+		/* main thread only, emptied at the end of every tick */
+		static MemoryArena *GetTickArena();
+		/* main thread only, emptied at the end of every frame */
+		static MemoryArena *GetFrameArena();
+		/* the calling thread's own, use it through a MemoryArenaScope */
+		static MemoryArena *GetThreadArena();
+
+		/* called by the main loop */
+		static void EndTick();
+		static void EndFrame();
+
+		/* every heap allocation made so far, through new or the engine's allocators */
+		static uint64_t GetNumHeapAllocations();
+
+	private:
+		static void PrintStatsCommand( unsigned int argc, char **argv );
+
+		void AddUsed( size_t size );
+
+		struct Block {
+			char *data;
+			size_t size;
+		};
+		std::vector< Block > blocks_;
+		size_t blockSize_;
+		size_t currentBlock_{ 0 };
+		size_t offset_{ 0 };
+
+		/* only ever written by the thread that owns the arena, but read by anyone */
+		std::atomic< size_t > used_{ 0 };
+		std::atomic< size_t > peak_{ 0 };
+		std::atomic< size_t > capacity_{ 0 };
+	};
+
+	/**
+	 * Rewinds the arena back to where it was when this was created, so
+	 * everything allocated from it in between goes along with it.
+	 */
+	class MemoryArenaScope {
+	public:
+		explicit MemoryArenaScope( MemoryArena *arena = MemoryArena::GetThreadArena() ) :
+				arena_( arena ), marker_( arena->GetMarker() ) {}
+		~MemoryArenaScope() { arena_->Rewind( marker_ ); }
+
+		MemoryArenaScope( const MemoryArenaScope & ) = delete;
+		MemoryArenaScope &operator=( const MemoryArenaScope & ) = delete;
+
+		PL_INLINE MemoryArena *GetArena() const { return arena_; }
+
+	private:
+		MemoryArena *arena_;
+		MemoryArena::Marker marker_;
+	};
+
+	/**
+	 * Lets the standard containers allocate from an arena. Freeing does
+	 * nothing, so anything that grows a lot will leave its old storage
+	 * behind until the arena's emptied; reserve up front where possible.
+	 */
+	template< typename T >
+	class ArenaAllocator {
+	public:
+		typedef T value_type;
+
+		explicit ArenaAllocator( MemoryArena *arena = MemoryArena::GetThreadArena() ) : arena_( arena ) {}
+		template< typename U >
+		ArenaAllocator( const ArenaAllocator< U > &other ) : arena_( other.GetArena() ) {}
+
+		T *allocate( size_t n ) {
+			return static_cast< T * >( arena_->Allocate( n * sizeof( T ), alignof( T ) ) );
+		}
+		void deallocate( T *, size_t ) {}
+
+		PL_INLINE MemoryArena *GetArena() const { return arena_; }
+
+		template< typename U >
+		bool operator==( const ArenaAllocator< U > &other ) const { return arena_ == other.GetArena(); }
+		template< typename U >
+		bool operator!=( const ArenaAllocator< U > &other ) const { return arena_ != other.GetArena(); }
+
+	private:
+		MemoryArena *arena_;
+	};
+
+	template< typename T >
+	using ArenaVector = std::vector< T, ArenaAllocator< T > >;
+	typedef std::basic_string< char, std::char_traits< char >, ArenaAllocator< char > > ArenaString;
+}
@@ -0,0 +1,489 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "App.h"
+#include "MemoryTracker.h"
+#include "FrameLimiter.h"
+#include "config.h"
+
+#include <new>
+
+#if defined( __GLIBC__ ) && ( __GLIBC__ > 2 || ( __GLIBC__ == 2 && __GLIBC_MINOR__ >= 33 ) )
+#   include <malloc.h>
+#   define MEMORY_TRACKER_MALLINFO
+#endif
+
+#define MEMORY_TRACKER_MAGIC    0x544d454dU     // 'MEMT'
+
+/* sits in front of everything from new, keeping it aligned */
+struct alignas( 16 ) AllocationHeader {
+	uint32_t magic;
+	uint32_t tag;
+	uint64_t size;
+};
+static_assert( sizeof( AllocationHeader ) == 16, "Unexpected allocation header size!" );
+
+/* Each thread counts into its own shard, so nothing's contended; they're
+ * only summed up when someone asks. Shards are never freed, just handed on
+ * to the next thread once their owner's finished with them, which keeps the
+ * totals right since they only ever hold differences. */
+struct TagCounters {
+	std::atomic< int64_t > liveBytes{ 0 };          // can go below zero, if freed on a different thread
+	std::atomic< int64_t > numLive{ 0 };
+	std::atomic< uint64_t > numAllocations{ 0 };
+	std::atomic< uint64_t > allocatedBytes{ 0 };
+	std::atomic< uint64_t > numCounted{ 0 };
+};
+
+struct alignas( 64 ) CounterShard {
+	TagCounters tags[ ( int ) ohw::MemoryTag::MAX_MEMORY_TAGS ];
+	std::atomic< bool > isInUse{ true };
+	CounterShard *next{ nullptr };
+};
+static std::atomic< CounterShard * > shardList{ nullptr };
+
+/* for threads on their way out, which have already given their shard up */
+static CounterShard sharedShard;
+
+static thread_local CounterShard *threadShard = nullptr;
+static thread_local bool isThreadExiting = false;
+
+struct ShardRelease {
+	~ShardRelease() {
+		isThreadExiting = true;
+		if ( threadShard != nullptr ) {
+			threadShard->isInUse.store( false, std::memory_order_release );
+			threadShard = nullptr;
+		}
+	}
+};
+
+static CounterShard *MemoryTracker_GetShard() {
+	if ( threadShard != nullptr ) {
+		return threadShard;
+	}
+
+	if ( isThreadExiting ) {
+		return nullptr;
+	}
+
+	static thread_local ShardRelease release;
+
+	// Pick up one that's been left behind, if there is one...
+	for ( CounterShard *shard = shardList.load( std::memory_order_acquire ); shard != nullptr; shard = shard->next ) {
+		bool isInUse = false;
+		if ( shard->isInUse.compare_exchange_strong( isInUse, true, std::memory_order_acquire ) ) {
+			return ( threadShard = shard );
+		}
+	}
+
+	// ...otherwise make a new one, straight from malloc since we're likely inside new
+	void *mem = malloc( sizeof( CounterShard ) + alignof( CounterShard ) );
+	if ( mem == nullptr ) {
+		return nullptr;
+	}
+	auto *shard = new( reinterpret_cast< void * >( ( ( uintptr_t ) mem + alignof( CounterShard ) - 1 ) & ~( uintptr_t ) ( alignof( CounterShard ) - 1 ) ) ) CounterShard();
+	shard->next = shardList.load( std::memory_order_relaxed );
+	while ( !shardList.compare_exchange_weak( shard->next, shard, std::memory_order_release, std::memory_order_relaxed ) ) {}
+
+	return ( threadShard = shard );
+}
+
+/* only the owning thread writes to its shard, so there's no need for anything locked */
+template< typename T >
+static PL_INLINE void MemoryTracker_Add( std::atomic< T > &counter, T value, bool isShared ) {
+	if ( isShared ) {
+		counter.fetch_add( value, std::memory_order_relaxed );
+	} else {
+		counter.store( counter.load( std::memory_order_relaxed ) + value, std::memory_order_relaxed );
+	}
+}
+
+/* sampled, rather than kept exactly, to keep it out of every allocation */
+static std::atomic< uint64_t > peakBytes[ ( int ) ohw::MemoryTag::MAX_MEMORY_TAGS ];
+
+static thread_local ohw::MemoryTag currentTag = ohw::MemoryTag::GENERAL;
+
+static const char *tagNames[] = {
+		"general",
+		"terrain",
+		"textures",
+		"models",
+		"audio",
+		"actors",
+		"script",
+		"ui",
+};
+static_assert( sizeof( tagNames ) / sizeof( *tagNames ) == ( int ) ohw::MemoryTag::MAX_MEMORY_TAGS, "Missing memory tag names!" );
+
+/* in kilobytes, or as much as we can say for sure if some of it can't be seen */
+static const char *MemoryTracker_FormatUsage( char *buf, size_t size, uint64_t bytes, uint64_t numCounted ) {
+	if ( numCounted == 0 ) {
+		snprintf( buf, size, "%llu", ( unsigned long long ) bytes / 1024 );
+	} else if ( bytes == 0 ) {
+		snprintf( buf, size, "unknown" );
+	} else {
+		snprintf( buf, size, ">=%llu", ( unsigned long long ) bytes / 1024 );
+	}
+
+	return buf;
+}
+
+void *operator new( size_t size ) {
+	void *mem = ohw::MemoryTracker::Allocate( size );
+	if ( mem == nullptr ) {
+		throw std::bad_alloc();
+	}
+
+	return mem;
+}
+
+void *operator new[]( size_t size ) {
+	return operator new( size );
+}
+
+/* these need replacing too, otherwise some runtimes hand out memory without our header */
+void *operator new( size_t size, const std::nothrow_t & ) noexcept {
+	return ohw::MemoryTracker::Allocate( size );
+}
+
+void *operator new[]( size_t size, const std::nothrow_t & ) noexcept {
+	return ohw::MemoryTracker::Allocate( size );
+}
+
+void operator delete( void *mem ) noexcept {
+	ohw::MemoryTracker::Free( mem );
+}
+
+void operator delete[]( void *mem ) noexcept {
+	ohw::MemoryTracker::Free( mem );
+}
+
+void operator delete( void *mem, const std::nothrow_t & ) noexcept {
+	ohw::MemoryTracker::Free( mem );
+}
+
+void operator delete[]( void *mem, const std::nothrow_t & ) noexcept {
+	ohw::MemoryTracker::Free( mem );
+}
+
+ohw::MemoryTracker::MemoryTracker() {
+	plRegisterConsoleCommand( "ListMemory", ListMemoryCommand,
+	                          "Lists how much memory each part of the engine is using." );
+}
+
+const char *ohw::MemoryTracker::GetTagName( MemoryTag tag ) {
+	return tagNames[ ( int ) tag ];
+}
+
+ohw::MemoryTag ohw::MemoryTracker::GetCurrentTag() {
+	return currentTag;
+}
+
+void ohw::MemoryTracker::SetCurrentTag( MemoryTag tag ) {
+	currentTag = tag;
+}
+
+void *ohw::MemoryTracker::Allocate( size_t size ) {
+	auto *header = static_cast< AllocationHeader * >( malloc( sizeof( AllocationHeader ) + size ) );
+	if ( header == nullptr ) {
+		return nullptr;
+	}
+
+	header->magic = MEMORY_TRACKER_MAGIC;
+	header->tag = ( uint32_t ) currentTag;
+	header->size = size;
+
+	CounterShard *shard = MemoryTracker_GetShard();
+	bool isShared = ( shard == nullptr );
+	TagCounters &counters = ( isShared ? sharedShard : *shard ).tags[ header->tag ];
+	MemoryTracker_Add< int64_t >( counters.liveBytes, size, isShared );
+	MemoryTracker_Add< int64_t >( counters.numLive, 1, isShared );
+	MemoryTracker_Add< uint64_t >( counters.numAllocations, 1, isShared );
+	MemoryTracker_Add< uint64_t >( counters.allocatedBytes, size, isShared );
+
+	return header + 1;
+}
+
+void ohw::MemoryTracker::Free( void *mem ) {
+	if ( mem == nullptr ) {
+		return;
+	}
+
+	// Only ever given what came from Allocate, so the header's always there
+	AllocationHeader *header = static_cast< AllocationHeader * >( mem ) - 1;
+	u_assert( header->magic == MEMORY_TRACKER_MAGIC, "Freed memory that didn't come from the memory tracker!\n" );
+	header->magic = 0;
+
+	CounterShard *shard = MemoryTracker_GetShard();
+	bool isShared = ( shard == nullptr );
+	TagCounters &counters = ( isShared ? sharedShard : *shard ).tags[ header->tag ];
+	MemoryTracker_Add< int64_t >( counters.liveBytes, -( int64_t ) header->size, isShared );
+	MemoryTracker_Add< int64_t >( counters.numLive, -1, isShared );
+
+	free( header );
+}
+
+void *ohw::MemoryTracker::Reallocate( void *mem, size_t size ) {
+	if ( mem == nullptr ) {
+		return Allocate( size );
+	}
+
+	if ( size == 0 ) {
+		Free( mem );
+		return nullptr;
+	}
+
+	AllocationHeader *header = static_cast< AllocationHeader * >( mem ) - 1;
+	u_assert( header->magic == MEMORY_TRACKER_MAGIC, "Reallocated memory that didn't come from the memory tracker!\n" );
+
+	void *newMem = Allocate( size );
+	if ( newMem == nullptr ) {
+		return nullptr;
+	}
+
+	memcpy( newMem, mem, std::min< uint64_t >( size, header->size ) );
+	Free( mem );
+
+	return newMem;
+}
+
+void ohw::MemoryTracker::CountAllocation( size_t size ) {
+	CounterShard *shard = MemoryTracker_GetShard();
+	bool isShared = ( shard == nullptr );
+	TagCounters &counters = ( isShared ? sharedShard : *shard ).tags[ ( int ) currentTag ];
+	MemoryTracker_Add< uint64_t >( counters.numAllocations, 1, isShared );
+	MemoryTracker_Add< uint64_t >( counters.allocatedBytes, size, isShared );
+	MemoryTracker_Add< uint64_t >( counters.numCounted, 1, isShared );
+}
+
+void ohw::MemoryTracker::GetStats( MemoryTag tag, TagStats *out ) const {
+	int64_t liveBytes = 0, numLive = 0;
+	uint64_t numAllocations = 0, allocatedBytes = 0, numCounted = 0;
+	auto sum = [ & ]( const TagCounters &counters ) {
+		liveBytes += counters.liveBytes.load( std::memory_order_relaxed );
+		numLive += counters.numLive.load( std::memory_order_relaxed );
+		numAllocations += counters.numAllocations.load( std::memory_order_relaxed );
+		allocatedBytes += counters.allocatedBytes.load( std::memory_order_relaxed );
+		numCounted += counters.numCounted.load( std::memory_order_relaxed );
+	};
+
+	sum( sharedShard.tags[ ( int ) tag ] );
+	for ( CounterShard *shard = shardList.load( std::memory_order_acquire ); shard != nullptr; shard = shard->next ) {
+		sum( shard->tags[ ( int ) tag ] );
+	}
+
+	out->liveBytes = ( uint64_t ) std::max< int64_t >( liveBytes, 0 );
+	out->numLive = ( uint64_t ) std::max< int64_t >( numLive, 0 );
+	out->numAllocations = numAllocations;
+	out->allocatedBytes = allocatedBytes;
+	out->numCounted = numCounted;
+
+	// Bring the peak up to date while we're here
+	uint64_t peak = peakBytes[ ( int ) tag ].load( std::memory_order_relaxed );
+	while ( out->liveBytes > peak && !peakBytes[ ( int ) tag ].compare_exchange_weak( peak, out->liveBytes, std::memory_order_relaxed ) ) {}
+	out->peakBytes = std::max( peak, out->liveBytes );
+}
+
+/**
+ * Adds up every thread's count, across all the tags; there's no single
+ * counter for this, since every allocation would be fighting over it.
+ */
+uint64_t ohw::MemoryTracker::GetNumAllocations() {
+	uint64_t numAllocations = 0;
+	auto sum = [ & ]( const CounterShard &shard ) {
+		for ( const auto &counters : shard.tags ) {
+			numAllocations += counters.numAllocations.load( std::memory_order_relaxed );
+		}
+	};
+
+	sum( sharedShard );
+	for ( CounterShard *shard = shardList.load( std::memory_order_acquire ); shard != nullptr; shard = shard->next ) {
+		sum( *shard );
+	}
+
+	return numAllocations;
+}
+
+void ohw::MemoryTracker::GetRates( MemoryTag tag, double *allocations, double *bytes ) const {
+	*allocations = rates_[ ( int ) tag ].allocations;
+	*bytes = rates_[ ( int ) tag ].bytes;
+}
+
+uint64_t ohw::MemoryTracker::GetUntrackedBytes() {
+#if defined( MEMORY_TRACKER_MALLINFO )
+	struct mallinfo2 info = mallinfo2();
+	uint64_t total = info.uordblks + info.hblkhd;
+
+	uint64_t tracked = 0;
+	for ( unsigned int i = 0; i < ( unsigned int ) MemoryTag::MAX_MEMORY_TAGS; ++i ) {
+		TagStats stats;
+		GetInstance()->GetStats( ( MemoryTag ) i, &stats );
+		tracked += stats.liveBytes + stats.numLive * sizeof( AllocationHeader );
+	}
+
+	return ( total > tracked ) ? total - tracked : 0;
+#else
+	return 0;
+#endif
+}
+
+void ohw::MemoryTracker::Tick() {
+	TagStats stats[ ( int ) MemoryTag::MAX_MEMORY_TAGS ];
+	for ( unsigned int i = 0; i < ( unsigned int ) MemoryTag::MAX_MEMORY_TAGS; ++i ) {
+		// Also what keeps the peaks up to date
+		GetStats( ( MemoryTag ) i, &stats[ i ] );
+	}
+
+	uint64_t now = FrameLimiter::GetTime();
+	if ( lastRateTime_ != 0 && now - lastRateTime_ < NSEC_PER_SEC ) {
+		return;
+	}
+
+	double seconds = ( now - lastRateTime_ ) / ( double ) NSEC_PER_SEC;
+	for ( unsigned int i = 0; i < ( unsigned int ) MemoryTag::MAX_MEMORY_TAGS; ++i ) {
+		Rates &rates = rates_[ i ];
+		if ( lastRateTime_ != 0 ) {
+			rates.allocations = ( stats[ i ].numAllocations - rates.lastAllocations ) / seconds;
+			rates.bytes = ( stats[ i ].allocatedBytes - rates.lastBytes ) / seconds;
+		}
+		rates.lastAllocations = stats[ i ].numAllocations;
+		rates.lastBytes = stats[ i ].allocatedBytes;
+	}
+
+	lastRateTime_ = now;
+}
+
+/**
+ * Starts off a report for the given map; peaks are reset so they only
+ * cover what happens from here on.
+ */
+void ohw::MemoryTracker::BeginReport( const std::string &name ) {
+	for ( unsigned int i = 0; i < ( unsigned int ) MemoryTag::MAX_MEMORY_TAGS; ++i ) {
+		peakBytes[ i ].store( 0, std::memory_order_relaxed );
+		GetStats( ( MemoryTag ) i, &reportStart_[ i ] );
+	}
+
+	reportName_ = name;
+	isReportActive_ = true;
+	isReportCaptured_ = false;
+}
+
+/**
+ * Takes note of where everything's at before the map's unloaded.
+ */
+void ohw::MemoryTracker::CaptureReport() {
+	if ( !isReportActive_ ) {
+		return;
+	}
+
+	for ( unsigned int i = 0; i < ( unsigned int ) MemoryTag::MAX_MEMORY_TAGS; ++i ) {
+		GetStats( ( MemoryTag ) i, &reportEnd_[ i ] );
+	}
+
+	isReportCaptured_ = true;
+}
+
+/**
+ * Writes the report out, once everything's been unloaded, so it shows
+ * whatever was left behind too.
+ */
+void ohw::MemoryTracker::EndReport() {
+	if ( !isReportActive_ ) {
+		return;
+	}
+
+	isReportActive_ = false;
+
+	if ( !isReportCaptured_ ) {
+		CaptureReport();
+	}
+
+	if ( !plCreatePath( Config_GetUserReportPath() ) ) {
+		Warning( "Failed to create report directory, \"%s\"!\n", Config_GetUserReportPath() );
+		return;
+	}
+
+	std::string path = std::string( Config_GetUserReportPath() ) + "memory_" + reportName_ + ".txt";
+	FILE *fp = fopen( path.c_str(), "w" );
+	if ( fp == nullptr ) {
+		Warning( "Failed to write memory report to \"%s\"!\n", path.c_str() );
+		return;
+	}
+
+	fprintf( fp, "Memory report for \"%s\", all sizes in kilobytes\n\n", reportName_.c_str() );
+	fprintf( fp, "%-10s %10s %10s %10s %12s %12s %10s\n",
+	         "tag", "start", "end", "peak", "allocations", "allocated", "left" );
+
+	for ( unsigned int i = 0; i < ( unsigned int ) MemoryTag::MAX_MEMORY_TAGS; ++i ) {
+		const TagStats &start = reportStart_[ i ];
+		const TagStats &end = reportEnd_[ i ];
+
+		TagStats now;
+		GetStats( ( MemoryTag ) i, &now );
+
+		char startBuf[ 32 ], endBuf[ 32 ], peakBuf[ 32 ], leftBuf[ 32 ];
+		fprintf( fp, "%-10s %10s %10s %10s %12llu %12llu %10s\n",
+		         tagNames[ i ],
+		         MemoryTracker_FormatUsage( startBuf, sizeof( startBuf ), start.liveBytes, start.numCounted ),
+		         MemoryTracker_FormatUsage( endBuf, sizeof( endBuf ), end.liveBytes, end.numCounted ),
+		         MemoryTracker_FormatUsage( peakBuf, sizeof( peakBuf ), end.peakBytes, end.numCounted ),
+		         ( unsigned long long ) ( end.numAllocations - start.numAllocations ),
+		         ( unsigned long long ) ( end.allocatedBytes - start.allocatedBytes ) / 1024,
+		         MemoryTracker_FormatUsage( leftBuf, sizeof( leftBuf ), now.liveBytes, now.numCounted ) );
+	}
+
+	fprintf( fp, "\nstart and end are what was in use when the map was loaded and just before it was unloaded,\n"
+	             "left is what was still in use once everything had been unloaded.\n"
+	             "Some of what's allocated for the platform library is freed by it, out of sight, so where a\n"
+	             "tag has any of that its usage is either unknown or at least (>=) what could be seen.\n" );
+
+	fclose( fp );
+
+	Print( "Wrote memory report to \"%s\"\n", path.c_str() );
+}
+
+void ohw::MemoryTracker::ListMemoryCommand( unsigned int argc, char **argv ) {
+	MemoryTracker *tracker = GetInstance();
+
+	Print( "%-10s %10s %10s %10s %12s %12s\n", "tag", "live kb", "peak kb", "blocks", "allocs/s", "kb/s" );
+
+	uint64_t totalLive = 0;
+	for ( unsigned int i = 0; i < ( unsigned int ) MemoryTag::MAX_MEMORY_TAGS; ++i ) {
+		TagStats stats;
+		tracker->GetStats( ( MemoryTag ) i, &stats );
+
+		double allocations, bytes;
+		tracker->GetRates( ( MemoryTag ) i, &allocations, &bytes );
+
+		char liveBuf[ 32 ], peakBuf[ 32 ];
+		Print( "%-10s %10s %10s %10llu %12.1f %12.1f\n", tagNames[ i ],
+		       MemoryTracker_FormatUsage( liveBuf, sizeof( liveBuf ), stats.liveBytes, stats.numCounted ),
+		       MemoryTracker_FormatUsage( peakBuf, sizeof( peakBuf ), stats.peakBytes, stats.numCounted ),
+		       ( unsigned long long ) stats.numLive, allocations, bytes / 1024.0 );
+
+		totalLive += stats.liveBytes;
+	}
+
+	Print( "%llukb in use through new / delete and u_alloc / u_free", ( unsigned long long ) totalLive / 1024 );
+	uint64_t untracked = GetUntrackedBytes();
+	if ( untracked > 0 ) {
+		Print( ", and another %llukb allocated elsewhere", ( unsigned long long ) untracked / 1024 );
+	}
+	Print( "\n" );
+}
@@ -0,0 +1,142 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace ohw {
+	enum class MemoryTag : uint8_t {
+		GENERAL,
+		TERRAIN,
+		TEXTURES,
+		MODELS,
+		AUDIO,
+		ACTORS,
+		SCRIPT,
+		UI,
+
+		MAX_MEMORY_TAGS
+	};
+
+	/**
+	 * Keeps track of how much memory each part of the engine is using.
+	 *
+	 * Every allocation is put down against whichever tag is current on
+	 * the thread making it, which is set with a MemoryTagScope; jobs carry
+	 * over the tag of whoever submitted them.
+	 *
+	 * Anything from new or u_alloc comes back through delete or u_free,
+	 * so those carry a small header to say how big they were and who they
+	 * belong to; that's what live usage comes from. Each thread counts
+	 * separately, so nothing's contended, and peaks are sampled whenever
+	 * the totals are added up, which is at least once a frame. What goes
+	 * through App::MAlloc and App::CAlloc is handed over to the platform
+	 * library to release, so those can only be counted as they're made,
+	 * and any tag that has some of them doesn't know its usage for sure.
+	 */
+	class MemoryTracker {
+	public:
+		static MemoryTracker *GetInstance() {
+			static MemoryTracker *instance = nullptr;
+			if ( instance == nullptr ) {
+				instance = new MemoryTracker();
+			}
+			return instance;
+		}
+
+		static const char *GetTagName( MemoryTag tag );
+
+		static MemoryTag GetCurrentTag();
+		static void SetCurrentTag( MemoryTag tag );
+
+		/* for new / delete and u_alloc / u_free, only ever give these what came from Allocate */
+		static void *Allocate( size_t size );           // returns null if it fails
+		static void *Reallocate( void *mem, size_t size );
+		static void Free( void *mem );
+
+		/* for anything that's freed elsewhere */
+		static void CountAllocation( size_t size );
+
+		struct TagStats {
+			uint64_t liveBytes;
+			uint64_t peakBytes;
+			uint64_t numLive;
+			uint64_t numAllocations;
+			uint64_t allocatedBytes;
+			uint64_t numCounted;        // allocations we can't see freed, so live and peak are only a lower bound
+		};
+		void GetStats( MemoryTag tag, TagStats *out ) const;
+
+		/* every allocation made so far, tracked or only counted, across all tags */
+		static uint64_t GetNumAllocations();
+
+		/* allocations per second and bytes per second, over the last second or so */
+		void GetRates( MemoryTag tag, double *allocations, double *bytes ) const;
+
+		/* memory allocated that's not been through here, if that's known, otherwise 0 */
+		static uint64_t GetUntrackedBytes();
+
+		/* called every frame */
+		void Tick();
+
+		/* a report covering everything from the start of a map until it's unloaded */
+		void BeginReport( const std::string &name );
+		void CaptureReport();
+		void EndReport();
+
+	private:
+		MemoryTracker();
+
+		static void ListMemoryCommand( unsigned int argc, char **argv );
+
+		struct Rates {
+			uint64_t lastAllocations{ 0 };
+			uint64_t lastBytes{ 0 };
+			double allocations{ 0 };
+			double bytes{ 0 };
+		};
+		Rates rates_[ ( int ) MemoryTag::MAX_MEMORY_TAGS ];
+		uint64_t lastRateTime_{ 0 };
+
+		std::string reportName_;
+		bool isReportActive_{ false };
+		bool isReportCaptured_{ false };
+		TagStats reportStart_[ ( int ) MemoryTag::MAX_MEMORY_TAGS ];
+		TagStats reportEnd_[ ( int ) MemoryTag::MAX_MEMORY_TAGS ];
+	};
+
+	/**
+	 * Puts everything allocated on this thread down against the given tag,
+	 * until it goes out of scope.
+	 */
+	class MemoryTagScope {
+	public:
+		explicit MemoryTagScope( MemoryTag tag ) : previous_( MemoryTracker::GetCurrentTag() ) {
+			MemoryTracker::SetCurrentTag( tag );
+		}
+		~MemoryTagScope() { MemoryTracker::SetCurrentTag( previous_ ); }
+
+		MemoryTagScope( const MemoryTagScope & ) = delete;
+		MemoryTagScope &operator=( const MemoryTagScope & ) = delete;
+
+	private:
+		MemoryTag previous_;
+	};
+}
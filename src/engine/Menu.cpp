@@ -19,6 +19,7 @@
 #include "Menu.h"
 #include "Map.h"
 #include "graphics/Display.h"
+#include "LoadTracer.h"
 #include "graphics/video.h"
 #include "graphics/Camera.h"
 #include "graphics/ShaderManager.h"
@@ -157,11 +158,7 @@ void FrontEnd_Tick( void ) {}
 char loading_description[256];
 uint8_t loading_progress = 0;
 
-#if 0
-#	define Redraw()   Display_DrawInterface();
-#else
-#	define Redraw()
-#endif
+#define Redraw()   ohw::LoadTracer::GetInstance()->Redraw()
 
 void FE_SetLoadingBackground( const char *name ) {
 	char screen_path[PL_SYSTEM_MAX_PATH];
@@ -0,0 +1,398 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "App.h"
+#include "Metrics.h"
+#include "FrameLimiter.h"
+#include "config.h"
+
+#include <cmath>
+
+#define METRICS_EXPORT_FILES        4   // how many old exports are kept around
+#define METRICS_BUCKETS_PER_OCTAVE  4
+#define METRICS_FIRST_OCTAVE        -6
+
+unsigned int ohw::Metrics_GetShardIndex() {
+	static std::atomic< unsigned int > numThreads{ 0 };
+	static thread_local unsigned int index = numThreads.fetch_add( 1, std::memory_order_relaxed ) % METRICS_NUM_SHARDS;
+	return index;
+}
+
+/* there's no fetch_add for doubles until C++20 */
+static void AtomicAdd( std::atomic< double > &value, double amount ) {
+	double current = value.load( std::memory_order_relaxed );
+	while ( !value.compare_exchange_weak( current, current + amount, std::memory_order_relaxed ) ) {}
+}
+
+static void AtomicMax( std::atomic< double > &value, double amount ) {
+	double current = value.load( std::memory_order_relaxed );
+	while ( amount > current && !value.compare_exchange_weak( current, amount, std::memory_order_relaxed ) ) {}
+}
+
+/************************************************************/
+
+uint64_t ohw::CounterMetric::Get() const {
+	uint64_t total = 0;
+	for ( const auto &shard : shards_ ) {
+		total += shard.value.load( std::memory_order_relaxed );
+	}
+	return total;
+}
+
+/************************************************************/
+
+void ohw::HistogramMetric::Record( double value ) {
+	int bucket = 0;
+	if ( value > 0 ) {
+		bucket = ( int ) std::floor( std::log2( value ) * METRICS_BUCKETS_PER_OCTAVE ) -
+		         ( METRICS_FIRST_OCTAVE * METRICS_BUCKETS_PER_OCTAVE );
+		bucket = std::max( 0, std::min( bucket, METRICS_HISTOGRAM_BUCKETS - 1 ) );
+	}
+
+	Shard &shard = shards_[ Metrics_GetShardIndex() ];
+	shard.buckets[ bucket ].fetch_add( 1, std::memory_order_relaxed );
+	AtomicAdd( shard.sum, value );
+	AtomicMax( shard.max, value );
+}
+
+double ohw::HistogramMetric::GetBucketLimit( unsigned int bucket ) {
+	return std::exp2( ( double ) ( bucket + 1 ) / METRICS_BUCKETS_PER_OCTAVE + METRICS_FIRST_OCTAVE );
+}
+
+void ohw::HistogramMetric::GetSnapshot( Snapshot *out ) const {
+	*out = Snapshot();
+	for ( const auto &shard : shards_ ) {
+		for ( unsigned int i = 0; i < METRICS_HISTOGRAM_BUCKETS; ++i ) {
+			uint64_t count = shard.buckets[ i ].load( std::memory_order_relaxed );
+			out->buckets[ i ] += count;
+			out->count += count;
+		}
+		out->sum += shard.sum.load( std::memory_order_relaxed );
+		out->max = std::max( out->max, shard.max.load( std::memory_order_relaxed ) );
+	}
+}
+
+/**
+ * The exact max is only kept for all time, so for a shorter stretch
+ * it's the top of the highest bucket anything landed in.
+ */
+ohw::HistogramMetric::Snapshot ohw::HistogramMetric::Snapshot::operator-( const Snapshot &earlier ) const {
+	Snapshot out;
+	out.count = count - earlier.count;
+	out.sum = sum - earlier.sum;
+	for ( unsigned int i = 0; i < METRICS_HISTOGRAM_BUCKETS; ++i ) {
+		out.buckets[ i ] = buckets[ i ] - earlier.buckets[ i ];
+		if ( out.buckets[ i ] > 0 ) {
+			out.max = std::min( GetBucketLimit( i ), max );
+		}
+	}
+	return out;
+}
+
+double ohw::HistogramMetric::Snapshot::GetPercentile( double fraction ) const {
+	if ( count == 0 ) {
+		return 0.0;
+	}
+
+	uint64_t target = ( uint64_t ) std::ceil( fraction * count );
+	uint64_t total = 0;
+	for ( unsigned int i = 0; i < METRICS_HISTOGRAM_BUCKETS; ++i ) {
+		total += buckets[ i ];
+		if ( total >= target ) {
+			return std::min( GetBucketLimit( i ), max );
+		}
+	}
+
+	return max;
+}
+
+/************************************************************/
+
+ohw::MetricsRegistry::MetricsRegistry() {
+	plRegisterConsoleCommand( "PrintMetrics", PrintMetricsCommand, "Lists every metric and where it's at." );
+	plRegisterConsoleCommand( "ExportMetrics", ExportMetricsCommand,
+	                          "Writes a row out to the metrics export straight away." );
+
+	// Everything the engine measures itself is registered here, so the columns are
+	// all there from the first row rather than turning up as each one's first used
+	GetHistogram( "app.tick_ms" );
+	GetHistogram( "app.draw_ms" );
+	GetHistogram( "app.frame_ms" );
+	GetGauge( "app.sim_ticks" );
+	GetGauge( "app.sys_tick" );
+	GetCounter( "render.mesh_uploads" );
+	GetCounter( "render.draw_calls" );
+	GetCounter( "resources.cache_hits" );
+	GetCounter( "resources.cache_misses" );
+	GetCounter( "actors.ticked" );
+	GetGauge( "actors.active" );
+	GetGauge( "audio.voices" );
+	GetCounter( "io.bytes_loaded" );
+}
+
+ohw::Metric *ohw::MetricsRegistry::FindMetric( const std::string &name, Metric::Type type ) {
+	for ( auto metric : metrics_ ) {
+		if ( metric->GetName() != name ) {
+			continue;
+		}
+
+		if ( metric->GetType() != type ) {
+			Error( "Metric \"%s\" was already registered as a different type!\n", name.c_str() );
+		}
+
+		return metric;
+	}
+
+	return nullptr;
+}
+
+ohw::CounterMetric *ohw::MetricsRegistry::GetCounter( const std::string &name ) {
+	std::lock_guard< std::mutex > lock( mutex_ );
+	Metric *metric = FindMetric( name, Metric::Type::COUNTER );
+	if ( metric == nullptr ) {
+		metric = new CounterMetric( name );
+		metrics_.push_back( metric );
+	}
+	return static_cast< CounterMetric * >( metric );
+}
+
+ohw::GaugeMetric *ohw::MetricsRegistry::GetGauge( const std::string &name ) {
+	std::lock_guard< std::mutex > lock( mutex_ );
+	Metric *metric = FindMetric( name, Metric::Type::GAUGE );
+	if ( metric == nullptr ) {
+		metric = new GaugeMetric( name );
+		metrics_.push_back( metric );
+	}
+	return static_cast< GaugeMetric * >( metric );
+}
+
+ohw::HistogramMetric *ohw::MetricsRegistry::GetHistogram( const std::string &name ) {
+	std::lock_guard< std::mutex > lock( mutex_ );
+	Metric *metric = FindMetric( name, Metric::Type::HISTOGRAM );
+	if ( metric == nullptr ) {
+		metric = new HistogramMetric( name );
+		metrics_.push_back( metric );
+	}
+	return static_cast< HistogramMetric * >( metric );
+}
+
+void ohw::MetricsRegistry::Tick() {
+	if ( cv_metrics_export_interval->f_value <= 0 ) {
+		CloseExportFile();
+		lastExportTime_ = 0;
+		return;
+	}
+
+	uint64_t now = FrameLimiter::GetTime();
+	if ( lastExportTime_ == 0 ) {
+		// Nothing to compare against yet, so just start counting from here
+		Export();
+		return;
+	}
+
+	if ( now - lastExportTime_ >= ( uint64_t ) ( cv_metrics_export_interval->f_value * NSEC_PER_SEC ) ) {
+		Export();
+	}
+}
+
+/**
+ * Picks up where this session left off with the current format, or if
+ * there's nothing yet (or it's got too large) shuffles any earlier
+ * exports along, dropping the oldest, and starts a new one.
+ */
+void ohw::MetricsRegistry::OpenExportFile( bool rotate ) {
+	if ( !plCreatePath( Config_GetUserReportPath() ) ) {
+		Warning( "Failed to create report directory, \"%s\"!\n", Config_GetUserReportPath() );
+		return;
+	}
+
+	std::string base = std::string( Config_GetUserReportPath() ) + "metrics";
+	const char *extension = isExportJson_ ? ".json" : ".csv";
+
+	rotate |= !isExportStarted_[ isExportJson_ ];
+	if ( rotate ) {
+		for ( int i = METRICS_EXPORT_FILES - 1; i >= 0; --i ) {
+			std::string from = ( i == 0 ) ? base + extension : base + "_" + std::to_string( i ) + extension;
+			std::string to = base + "_" + std::to_string( i + 1 ) + extension;
+			if ( i == METRICS_EXPORT_FILES - 1 ) {
+				remove( from.c_str() );
+			} else {
+				rename( from.c_str(), to.c_str() );
+			}
+		}
+	}
+
+	std::string path = base + extension;
+	exportFile_ = fopen( path.c_str(), rotate ? "w" : "a" );
+	if ( exportFile_ == nullptr ) {
+		Warning( "Failed to open \"%s\" for writing!\n", path.c_str() );
+		return;
+	}
+
+	isExportStarted_[ isExportJson_ ] = true;
+
+	// Whether it's new or not, give it a header before the next row
+	numExportedMetrics_ = 0;
+
+	Print( "Exporting metrics to \"%s\"\n", path.c_str() );
+}
+
+void ohw::MetricsRegistry::CloseExportFile() {
+	if ( exportFile_ == nullptr ) {
+		return;
+	}
+
+	fclose( exportFile_ );
+	exportFile_ = nullptr;
+}
+
+/**
+ * Writes out a row with every metric. Counters are written as how much
+ * they've gone up by since the last row and histograms only cover what
+ * was recorded since then, so each row stands on its own.
+ */
+void ohw::MetricsRegistry::Export() {
+	std::vector< Metric * > metrics;
+	{
+		std::lock_guard< std::mutex > lock( mutex_ );
+		metrics = metrics_;
+	}
+
+	bool isJson = ( pl_strcasecmp( cv_metrics_export_format->s_value, "json" ) == 0 );
+	bool rotate = false;
+	if ( exportFile_ != nullptr ) {
+		long maxSize = cv_metrics_export_max_size->i_value * 1024L;
+		if ( maxSize > 0 && ftell( exportFile_ ) >= maxSize ) {
+			rotate = true;
+			CloseExportFile();
+		} else if ( isJson != isExportJson_ ) {
+			CloseExportFile();
+		}
+	}
+
+	if ( exportFile_ == nullptr ) {
+		isExportJson_ = isJson;
+		OpenExportFile( rotate );
+		if ( exportFile_ == nullptr ) {
+			// Try again next time round, rather than every frame
+			lastExportTime_ = FrameLimiter::GetTime();
+			return;
+		}
+	}
+
+	uint64_t now = FrameLimiter::GetTime();
+	double seconds = ( lastExportTime_ != 0 ) ? ( now - lastExportTime_ ) / ( double ) NSEC_PER_SEC : 0.0;
+	lastExportTime_ = now;
+
+	lastCounters_.resize( metrics.size(), 0 );
+	lastHistograms_.resize( metrics.size() );
+
+	// Anything registered since the last header gets a new one, further down the same file
+	if ( !isExportJson_ && numExportedMetrics_ != metrics.size() ) {
+		fprintf( exportFile_, "time,seconds" );
+		for ( auto metric : metrics ) {
+			const char *name = metric->GetName().c_str();
+			if ( metric->GetType() == Metric::Type::HISTOGRAM ) {
+				fprintf( exportFile_, ",%s.count,%s.mean,%s.p50,%s.p99,%s.max", name, name, name, name, name );
+			} else {
+				fprintf( exportFile_, ",%s", name );
+			}
+		}
+		fprintf( exportFile_, "\n" );
+		numExportedMetrics_ = metrics.size();
+	}
+
+	if ( isExportJson_ ) {
+		fprintf( exportFile_, "{\"time\":%llu,\"seconds\":%.3f", ( unsigned long long ) time( nullptr ), seconds );
+	} else {
+		fprintf( exportFile_, "%llu,%.3f", ( unsigned long long ) time( nullptr ), seconds );
+	}
+
+	for ( size_t i = 0; i < metrics.size(); ++i ) {
+		Metric *metric = metrics[ i ];
+		if ( isExportJson_ ) {
+			fprintf( exportFile_, ",\"%s\":", metric->GetName().c_str() );
+		} else {
+			fprintf( exportFile_, "," );
+		}
+
+		switch ( metric->GetType() ) {
+			case Metric::Type::COUNTER: {
+				uint64_t value = static_cast< CounterMetric * >( metric )->Get();
+				fprintf( exportFile_, "%llu", ( unsigned long long ) ( value - lastCounters_[ i ] ) );
+				lastCounters_[ i ] = value;
+				break;
+			}
+			case Metric::Type::GAUGE:
+				fprintf( exportFile_, "%g", static_cast< GaugeMetric * >( metric )->Get() );
+				break;
+			case Metric::Type::HISTOGRAM: {
+				HistogramMetric::Snapshot snapshot;
+				static_cast< HistogramMetric * >( metric )->GetSnapshot( &snapshot );
+				HistogramMetric::Snapshot interval = snapshot - lastHistograms_[ i ];
+				lastHistograms_[ i ] = snapshot;
+
+				fprintf( exportFile_,
+				         isExportJson_ ? "{\"count\":%llu,\"mean\":%.4f,\"p50\":%.4f,\"p99\":%.4f,\"max\":%.4f}"
+				                       : "%llu,%.4f,%.4f,%.4f,%.4f",
+				         ( unsigned long long ) interval.count, interval.GetMean(),
+				         interval.GetPercentile( 0.5 ), interval.GetPercentile( 0.99 ), interval.max );
+				break;
+			}
+		}
+	}
+
+	fprintf( exportFile_, isExportJson_ ? "}\n" : "\n" );
+
+	// Soak tests tend to end with the game being killed, so make sure nothing's left behind
+	fflush( exportFile_ );
+}
+
+void ohw::MetricsRegistry::PrintMetricsCommand( unsigned int argc, char **argv ) {
+	MetricsRegistry *registry = GetInstance();
+
+	std::vector< Metric * > metrics;
+	{
+		std::lock_guard< std::mutex > lock( registry->mutex_ );
+		metrics = registry->metrics_;
+	}
+
+	for ( auto metric : metrics ) {
+		const char *name = metric->GetName().c_str();
+		switch ( metric->GetType() ) {
+			case Metric::Type::COUNTER:
+				Print( "%-32s %llu\n", name, ( unsigned long long ) static_cast< CounterMetric * >( metric )->Get() );
+				break;
+			case Metric::Type::GAUGE:
+				Print( "%-32s %g\n", name, static_cast< GaugeMetric * >( metric )->Get() );
+				break;
+			case Metric::Type::HISTOGRAM: {
+				HistogramMetric::Snapshot snapshot;
+				static_cast< HistogramMetric * >( metric )->GetSnapshot( &snapshot );
+				Print( "%-32s %llu recorded, %.3f mean, %.3f median, %.3f p99, %.3f max\n", name,
+				       ( unsigned long long ) snapshot.count, snapshot.GetMean(),
+				       snapshot.GetPercentile( 0.5 ), snapshot.GetPercentile( 0.99 ), snapshot.max );
+				break;
+			}
+		}
+	}
+}
+
+void ohw::MetricsRegistry::ExportMetricsCommand( unsigned int argc, char **argv ) {
+	GetInstance()->Export();
+}
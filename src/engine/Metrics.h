@@ -0,0 +1,187 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define METRICS_NUM_SHARDS          16
+#define METRICS_HISTOGRAM_BUCKETS   64
+
+namespace ohw {
+	/**
+	 * Each thread adds into one of a handful of slots, each on its own
+	 * cache line, so counting from several threads at once doesn't have
+	 * them all fighting over the same one.
+	 */
+	unsigned int Metrics_GetShardIndex();
+
+	class Metric {
+	public:
+		enum class Type {
+			COUNTER,
+			GAUGE,
+			HISTOGRAM,
+		};
+
+		Metric( const std::string &name, Type type ) : name_( name ), type_( type ) {}
+		virtual ~Metric() = default;
+
+		PL_INLINE const std::string &GetName() const { return name_; }
+		PL_INLINE Type GetType() const { return type_; }
+
+	private:
+		std::string name_;
+		Type type_;
+	};
+
+	/* only ever goes up */
+	class CounterMetric : public Metric {
+	public:
+		explicit CounterMetric( const std::string &name ) : Metric( name, Type::COUNTER ) {}
+
+		PL_INLINE void Add( uint64_t amount = 1 ) {
+			shards_[ Metrics_GetShardIndex() ].value.fetch_add( amount, std::memory_order_relaxed );
+		}
+
+		uint64_t Get() const;
+
+	private:
+		struct alignas( 64 ) Shard {
+			std::atomic< uint64_t > value{ 0 };
+		};
+		Shard shards_[ METRICS_NUM_SHARDS ];
+	};
+
+	/* whatever it was last set to */
+	class GaugeMetric : public Metric {
+	public:
+		explicit GaugeMetric( const std::string &name ) : Metric( name, Type::GAUGE ) {}
+
+		PL_INLINE void Set( double value ) { value_.store( value, std::memory_order_relaxed ); }
+		PL_INLINE double Get() const { return value_.load( std::memory_order_relaxed ); }
+
+	private:
+		std::atomic< double > value_{ 0 };
+	};
+
+	/**
+	 * Sorts values into buckets a quarter of a power of two apart, from
+	 * 1/64 up to 1024, which suits timings in milliseconds; anything
+	 * outside of that ends up in the first or last.
+	 */
+	class HistogramMetric : public Metric {
+	public:
+		explicit HistogramMetric( const std::string &name ) : Metric( name, Type::HISTOGRAM ) {}
+
+		void Record( double value );
+
+		struct Snapshot {
+			uint64_t buckets[ METRICS_HISTOGRAM_BUCKETS ]{};
+			uint64_t count{ 0 };
+			double sum{ 0 };
+			double max{ 0 };
+
+			/* everything recorded since the earlier snapshot was taken, max aside */
+			Snapshot operator-( const Snapshot &earlier ) const;
+
+			PL_INLINE double GetMean() const { return ( count > 0 ) ? sum / count : 0.0; }
+			/* upper bound of the bucket the given fraction of values fall under */
+			double GetPercentile( double fraction ) const;
+		};
+		void GetSnapshot( Snapshot *out ) const;
+
+		static double GetBucketLimit( unsigned int bucket );
+
+	private:
+		struct alignas( 64 ) Shard {
+			std::atomic< uint64_t > buckets[ METRICS_HISTOGRAM_BUCKETS ];
+			std::atomic< double > sum{ 0 };
+			std::atomic< double > max{ 0 };
+
+			Shard() {
+				for ( auto &bucket : buckets ) {
+					bucket.store( 0, std::memory_order_relaxed );
+				}
+			}
+		};
+		Shard shards_[ METRICS_NUM_SHARDS ];
+	};
+
+	/**
+	 * Everything that's being measured, by name. Metrics live as long as
+	 * the game does, so hang on to the pointer rather than looking them up
+	 * each time; METRIC_COUNTER and friends do that for you.
+	 *
+	 * Every metrics_export_interval seconds they're all written out, one
+	 * row at a time, to a CSV or JSON lines file under the report
+	 * directory. Each session starts a new file, which is rotated once it
+	 * gets too large; if a metric turns up part way through, the CSV gets
+	 * another header row with it included.
+	 */
+	class MetricsRegistry {
+	public:
+		static MetricsRegistry *GetInstance() {
+			static MetricsRegistry *instance = nullptr;
+			if ( instance == nullptr ) {
+				instance = new MetricsRegistry();
+			}
+			return instance;
+		}
+
+		CounterMetric *GetCounter( const std::string &name );
+		GaugeMetric *GetGauge( const std::string &name );
+		HistogramMetric *GetHistogram( const std::string &name );
+
+		/* called every frame, exports if it's time to */
+		void Tick();
+
+		void Export();
+
+	private:
+		MetricsRegistry();
+
+		Metric *FindMetric( const std::string &name, Metric::Type type );
+		void OpenExportFile( bool rotate );
+		void CloseExportFile();
+
+		static void PrintMetricsCommand( unsigned int argc, char **argv );
+		static void ExportMetricsCommand( unsigned int argc, char **argv );
+
+		mutable std::mutex mutex_;
+		std::vector< Metric * > metrics_;
+
+		/* where things were at the last export, so each row only covers the time since */
+		std::vector< uint64_t > lastCounters_;
+		std::vector< HistogramMetric::Snapshot > lastHistograms_;
+		uint64_t lastExportTime_{ 0 };
+
+		FILE *exportFile_{ nullptr };
+		bool isExportJson_{ false };
+		bool isExportStarted_[ 2 ]{};       // CSV and JSON, whether they've been opened this session
+		size_t numExportedMetrics_{ 0 };    // what the CSV header covers
+	};
+}
+
+#define METRIC_COUNTER( NAME )      ( []() { static ohw::CounterMetric *metric = ohw::MetricsRegistry::GetInstance()->GetCounter( NAME ); return metric; }() )
+#define METRIC_GAUGE( NAME )        ( []() { static ohw::GaugeMetric *metric = ohw::MetricsRegistry::GetInstance()->GetGauge( NAME ); return metric; }() )
+#define METRIC_HISTOGRAM( NAME )    ( []() { static ohw::HistogramMetric *metric = ohw::MetricsRegistry::GetInstance()->GetHistogram( NAME ); return metric; }() )
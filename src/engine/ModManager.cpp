@@ -16,6 +16,7 @@
  */
 
 #include "App.h"
+#include "FileIndex.h"
 
 #include "script/JsonReader.h"
 
@@ -53,16 +54,19 @@ void ohw::ModManager::Mount( const char *name ) {
 		return;
 	}
 
-	// Generate a list of directories to mount based on the dependencies
-	std::set< std::string > dirSet;
-	FetchDependencies( mod, dirSet );
-	dirSet.emplace( mod->directory );
+	// Generate a list of directories to mount based on the dependencies, the mod itself goes last
+	DirectoryList dirList;
+	FetchDependencies( mod, dirList );
+	if ( std::find( dirList.begin(), dirList.end(), mod->directory ) == dirList.end() ) {
+		dirList.push_back( mod->directory );
+	}
 
 	Unmount();
 
 	// Now attempt to mount everything
 	myCurrentMod = mod;
-	for ( const auto &i : dirSet ) {
+	std::vector< std::string > indexLocations;
+	for ( const auto &i : dirList ) {
 		char mountPath[PL_SYSTEM_MAX_PATH];
 		snprintf( mountPath, sizeof( mountPath ), "mods/%s", i.c_str() );
 		PLFileSystemMount *mount = plMountLocation( mountPath );
@@ -71,9 +75,14 @@ void ohw::ModManager::Mount( const char *name ) {
 			continue;
 		}
 
+		mod->mountList.push_back( mount );
+		indexLocations.push_back( mountPath );
+
 		Print( " Mounted location \"%s\"\n", mountPath );
 	}
 
+	FileIndex::GetInstance()->Build( indexLocations );
+
 	Print( "Mod has been set to \"%s\"\n", mod->name.c_str() );
 
 #if defined( _DEBUG )
@@ -91,6 +100,8 @@ void ohw::ModManager::Unmount() {
 		myCurrentMod->mountList.clear();
 	}
 
+	FileIndex::GetInstance()->Clear();
+
 	// Clear out all the content we've loaded, we'll need to load all our major dependencies after
 	GetApp()->resourceManager->ClearAllResources( true );
 }
@@ -106,9 +117,8 @@ void ohw::ModManager::RegisterMod( const char *path, void *userData ) {
 	modManager->myModsMap.emplace( mod.internalName, mod );
 }
 
-void ohw::ModManager::FetchDependencies( ModDescription *modDescription, DirectorySet &output ) {
-	const auto &dir = output.find( modDescription->directory );
-	if ( dir != output.end() ) {
+void ohw::ModManager::FetchDependencies( ModDescription *modDescription, DirectoryList &output ) {
+	if ( std::find( output.begin(), output.end(), modDescription->directory ) != output.end() ) {
 		Print( "%s is already mounted, skipping\n", modDescription->directory.c_str() );
 		return;
 	}
@@ -125,7 +135,9 @@ void ohw::ModManager::FetchDependencies( ModDescription *modDescription, Directo
 			FetchDependencies( dependency, output );
 		}
 
-		output.emplace( dependency->directory );
+		if ( std::find( output.begin(), output.end(), dependency->directory ) == output.end() ) {
+			output.push_back( dependency->directory );
+		}
 	}
 }
 
@@ -51,8 +51,9 @@ namespace ohw {
 	private:
 		static void RegisterMod( const char *path, void *userData );
 
-		typedef std::set<std::string> DirectorySet;
-		void FetchDependencies( ModDescription *modDescription, DirectorySet &output );
+		/* in mount order, dependencies before the mods that need them */
+		typedef std::vector<std::string> DirectoryList;
+		void FetchDependencies( ModDescription *modDescription, DirectoryList &output );
 
 		ModDescription *GetModDescription( const char *name );
 		static ModDescription LoadDescription( const char *path );
@@ -16,15 +16,21 @@
  */
 
 #include "App.h"
+#include "FileIndex.h"
+#include "MemoryArena.h"
+#include "Metrics.h"
 #include "ModelResource.h"
 #include "TextureAtlas.h"
 #include "mesh.h"
-#include "WaveFrontReader.h"
+#include "ObjReader.h"
 #include "graphics/Camera.h"
+#include "config.h"
 
 #include "loaders/VtxLoader.h"
 #include "loaders/FacLoader.h"
 #include "loaders/No2Loader.h"
+#include "loaders/PkgLoader.h"
+#include "loaders/OhmLoader.h"
 
 ohw::ModelResource::ModelResource( const std::string &path, bool persist, bool abortOnFail ) :
 		Resource( path, persist ) {
@@ -56,7 +62,9 @@ ohw::ModelResource::ModelResource( const std::string &path, bool persist, bool a
 		return;
 	}
 
-	GenerateBounds();
+	if ( !hasBounds ) {
+		GenerateBounds();
+	}
 }
 
 ohw::ModelResource::~ModelResource() {
@@ -91,6 +99,7 @@ void ohw::ModelResource::Draw( bool cull, bool batchDraw ) {
 		model->model_matrix = modelMatrix;
 
 		plDrawModel( model );
+		METRIC_COUNTER( "render.draw_calls" )->Add();
 		return;
 	}
 
@@ -130,31 +139,34 @@ ohw::TextureResource *ohw::ModelResource::GetTextureResource( unsigned int i ) {
 }
 
 void ohw::ModelResource::LoadObjModel( const std::string &path, bool abortOnFail ) {
-	WaveFrontReader obj;
+	ObjReader obj;
 	if ( !obj.Load( path, true ) ) {
 		return;
 	}
 
-	// Single material Objs are really damn easy here...
-	if ( obj.materials.size() <= 2 ) {
-		PLMesh *mesh = plCreateMesh( PL_MESH_TRIANGLES, PL_DRAW_STATIC, obj.indices.size(), obj.vertices.size() );
+	// Each material has its own set of vertices and indices, so they go straight into a mesh
+	meshesVector.reserve( obj.subsets.size() );
+	for ( const auto &subset : obj.subsets ) {
+		PLMesh *mesh = plCreateMesh( PL_MESH_TRIANGLES, PL_DRAW_STATIC, subset.indices.size() / 3, subset.vertices.size() );
 		if ( mesh == nullptr ) {
 			if ( abortOnFail ) {
-				Error( "Failed to create mesh! (%s)\n", plGetError() );
+				Error( "Failed to create mesh!\nPL: %s\n", plGetError() );
 			}
 
-			Warning( "Failed to create mesh! (%s)\n", plGetError() );
+			// Destroy all the attached meshes
+			DestroyMeshes();
+
+			Warning( "Failed to create mesh!\nPL: %s\n", plGetError() );
 			return;
 		}
 
-		static_assert( sizeof( *mesh->indices ) == sizeof( *obj.indices.data() ), "mismatch" );
-		// Copy all of the data across
-		memcpy( mesh->indices, obj.indices.data(), sizeof( unsigned int ) * obj.indices.size() );
-		memcpy( mesh->vertices, obj.vertices.data(), sizeof( PLVertex ) * obj.vertices.size() );
+		static_assert( sizeof( *mesh->indices ) == sizeof( ObjReader::index_t ), "mismatch" );
+		memcpy( mesh->indices, subset.indices.data(), sizeof( ObjReader::index_t ) * subset.indices.size() );
+		memcpy( mesh->vertices, subset.vertices.data(), sizeof( PLVertex ) * subset.vertices.size() );
 
-		std::string textureName = obj.materials[ obj.attributes[ 0 ] ].strTexture;
-		if ( obj.materials.size() > 1 && !textureName.empty() ) {
-			SharedTextureResourcePointer texture = GetApp()->resourceManager->LoadTexture( textureName );
+		const ObjReader::Material &material = obj.materials[ subset.material ];
+		if ( !material.strTexture.empty() ) {
+			SharedTextureResourcePointer texture = GetApp()->resourceManager->LoadTexture( material.strTexture );
 			texturesVector.push_back( texture );
 
 			mesh->texture = texture->GetInternalTexture();
@@ -162,95 +174,381 @@ void ohw::ModelResource::LoadObjModel( const std::string &path, bool abortOnFail
 			mesh->texture = GetApp()->resourceManager->GetFallbackTexture();
 		}
 
-		// Push the mesh into our vector
 		meshesVector.push_back( mesh );
+	}
 
-		// And done!
-		return;
+	// Done!
+}
+
+static std::vector< std::string > ModelResource_GetVtxTexturePaths( const FacHandle *facHandle, const std::string &texturePath, const char *extension ) {
+	std::vector< std::string > paths;
+	if ( facHandle->texture_table_size == 0 ) {
+		Warning( "Empty texture table!\n" );
+		return paths;
 	}
 
-	// However we need to do some extra work for those that use multiple materials...
+	std::string str = texturePath;
+	std::string directory = str.erase( str.find_last_of( '/' ) ) + "/";
+	for ( unsigned int i = 0; i < facHandle->texture_table_size; ++i ) {
+		if ( facHandle->texture_table[ i ].name[ 0 ] == '\0' ) {
+			Warning( "Invalid texture name in table, skipping (%d)!\n", i );
+			continue;
+		}
 
-	struct MeshSet {
-		std::vector< unsigned int > indices;
-		WaveFrontReader::Material material;
-	};
-	std::map< unsigned int, MeshSet > meshSets;
+		paths.push_back( directory + facHandle->texture_table[ i ].name + extension );
+	}
 
-	for ( unsigned int i = 0; i < obj.indices.size(); ++i ) {
-		meshSets[ obj.attributes[ i / 3 ] ].indices.push_back( obj.indices[ i ] );
-		meshSets[ obj.attributes[ i / 3 ] ].material = obj.materials[ obj.attributes[ i / 3 ] ];
+	return paths;
+}
+
+static ohw::TextureAtlas *ModelResource_GenerateTextureAtlas( const std::vector< std::string > &paths ) {
+	if ( paths.empty() ) {
+		return nullptr;
 	}
 
-	meshesVector.resize( meshSets.size() );
+	ohw::TextureAtlas *atlas = new ohw::TextureAtlas( 128, 128 );
+	for ( const auto &path : paths ) {
+		if ( !atlas->AddImage( path, true ) ) {
+			Warning( "Failed to add texture \"%s\" to atlas!\n", path.c_str() );
+		}
+	}
 
-	auto j = meshSets.begin();
-	for ( unsigned int i = 0; j != meshSets.end(); ++j ) {
-		meshesVector[ i ] = plCreateMesh( PL_MESH_TRIANGLES, PL_DRAW_STATIC, j->second.indices.size(),
-		                                  obj.vertices.size() );
-		if ( meshesVector[ i ] == nullptr ) {
-			if ( abortOnFail ) {
-				Error( "Failed to create mesh!\nPL: %s\n", plGetError() );
+	atlas->Finalize();
+
+	return atlas;
+}
+
+/**
+ * The Vtx, Fac and No2 can either be loose files or members of one of the
+ * original MAD packages, in which case they're decoded straight from the package.
+ */
+static VtxHandle *ModelResource_LoadVtx( const char *path ) {
+	const PkgMember *member = ohw::GetApp()->resourceManager->GetPackageMember( path );
+	if ( member != nullptr ) {
+		return Vtx_LoadMemory( member->data, member->size, path );
+	}
+
+	return Vtx_LoadFile( path );
+}
+
+static FacHandle *ModelResource_LoadFac( const char *path ) {
+	const PkgMember *member = ohw::GetApp()->resourceManager->GetPackageMember( path );
+	if ( member != nullptr ) {
+		return Fac_LoadMemory( member->data, member->size, path );
+	}
+
+	return Fac_LoadFile( path );
+}
+
+static No2Handle *ModelResource_LoadNo2( const char *path ) {
+	const PkgMember *member = ohw::GetApp()->resourceManager->GetPackageMember( path );
+	if ( member != nullptr ) {
+		return No2_LoadMemory( member->data, member->size, path );
+	}
+
+	return No2_LoadFile( path );
+}
+
+/**
+ * Fac files in the original MAD packages index directly into the accompanying MTD,
+ * rather than carrying a table of names (that gets added on extraction), so the
+ * table is built from the MTD here instead. Returns the path of the MTD on success.
+ */
+static std::string ModelResource_ResolvePackageTextures( FacHandle *facHandle, const char *facesPath ) {
+	char packagePath[PL_SYSTEM_MAX_PATH];
+	const char *memberName;
+	if ( !Pkg_SplitPath( facesPath, packagePath, sizeof( packagePath ), &memberName ) ) {
+		return "";
+	}
+
+	// Case isn't consistent between the MAD and MTD, e.g. BAY.MAD and bay.mtd
+	size_t length = strlen( packagePath );
+	char candidates[3][PL_SYSTEM_MAX_PATH];
+	snprintf( candidates[ 0 ], sizeof( candidates[ 0 ] ), "%s", packagePath );
+	candidates[ 0 ][ length - 2 ] = ( candidates[ 0 ][ length - 2 ] == 'A' ) ? 'T' : 't';
+	snprintf( candidates[ 1 ], sizeof( candidates[ 1 ] ), "%s", candidates[ 0 ] );
+	snprintf( candidates[ 2 ], sizeof( candidates[ 2 ] ), "%s", candidates[ 0 ] );
+	for ( size_t i = length - strlen( plGetFileName( packagePath ) ); i < length; ++i ) {
+		candidates[ 1 ][ i ] = static_cast< char >( tolower( candidates[ 1 ][ i ] ) );
+		candidates[ 2 ][ i ] = static_cast< char >( toupper( candidates[ 2 ][ i ] ) );
+	}
+
+	const PkgHandle *mtd = nullptr;
+	const char *mtdPath = nullptr;
+
+	// The index doesn't care about case, so it can usually tell us straight away
+	ohw::FileIndex *index = ohw::FileIndex::GetInstance();
+	if ( index->IsBuilt() ) {
+		mtdPath = index->FindFile( candidates[ 0 ] );
+		if ( mtdPath != nullptr ) {
+			mtd = ohw::GetApp()->resourceManager->GetPackage( mtdPath );
+		}
+	}
+
+	for ( unsigned int i = 0; i < plArrayElements( candidates ) && mtd == nullptr; ++i ) {
+		index->AddProbe();
+		if ( !plFileExists( candidates[ i ] ) ) {
+			continue;
+		}
+
+		mtdPath = candidates[ i ];
+		mtd = ohw::GetApp()->resourceManager->GetPackage( mtdPath );
+	}
+
+	if ( mtd == nullptr ) {
+		Warning( "Failed to find MTD for \"%s\"!\n", facesPath );
+		return "";
+	}
+
+	// Only pull in the textures that are actually used
+	std::vector< int > remap( mtd->num_members, -1 );
+	std::vector< FacTextureIndex > table;
+	for ( unsigned int i = 0; i < facHandle->num_triangles; ++i ) {
+		unsigned int textureIndex = facHandle->triangles[ i ].texture_index;
+		if ( textureIndex >= mtd->num_members ) {
+			Warning( "Out of bounds texture index in \"%s\" (%u/%u)!\n", facesPath, textureIndex, mtd->num_members );
+			textureIndex = 0;
+		}
+
+		if ( remap[ textureIndex ] == -1 ) {
+			remap[ textureIndex ] = static_cast< int >( table.size() );
+
+			FacTextureIndex index;
+			plStripExtension( index.name, sizeof( index.name ), mtd->members[ textureIndex ].name );
+			pl_strtolower( index.name );
+			table.push_back( index );
+		}
+
+		facHandle->triangles[ i ].texture_index = static_cast< uint32_t >( remap[ textureIndex ] );
+	}
+
+	u_free( facHandle->texture_table );
+	facHandle->texture_table_size = table.size();
+	facHandle->texture_table = static_cast< FacTextureIndex * >( u_alloc( table.size(), sizeof( FacTextureIndex ), true ) );
+	memcpy( facHandle->texture_table, table.data(), sizeof( FacTextureIndex ) * table.size() );
+
+	return mtdPath;
+}
+
+/**
+ * Hashes everything a Vtx model is built from, so we know when a compiled copy is out of date.
+ */
+static bool ModelResource_HashVtxSources( const std::string &path, uint64_t *hash ) {
+	static const char *extensions[] = { "vtx", "fac", "no2" };
+
+	uint64_t sourceHash = u_hash( path.c_str(), path.size(), U_HASH_SEED );
+	for ( const char *extension : extensions ) {
+		char sourcePath[PL_SYSTEM_MAX_PATH];
+		u_new_filename( sourcePath, path.c_str(), extension );
+
+		const PkgMember *member = ohw::GetApp()->resourceManager->GetPackageMember( sourcePath );
+		if ( member != nullptr ) {
+			sourceHash = u_hash( member->data, member->size, sourceHash );
+			continue;
+		}
+
+		MappedFile *file = Map_OpenFile( sourcePath );
+		if ( file == nullptr ) {
+			// No2 is optional
+			if ( strcmp( extension, "no2" ) == 0 ) {
+				continue;
 			}
 
-			// Destroy all the attached meshes
-			DestroyMeshes();
+			return false;
+		}
 
-			Warning( "Failed to create mesh!\nPL: %s\n", plGetError() );
-			return;
+		sourceHash = u_hash( file->data, file->size, sourceHash );
+		Map_CloseFile( file );
+	}
+
+	*hash = sourceHash;
+	return true;
+}
+
+static std::string ModelResource_GetCachePath( const std::string &path ) {
+	char name[32];
+	snprintf( name, sizeof( name ), "%016llx.ohm", ( unsigned long long ) u_hash( path.c_str(), path.size(), U_HASH_SEED ) );
+	return std::string( Config_GetUserCachePath() ) + "models/" + name;
+}
+
+/**
+ * Attempts to load the compiled copy of the model, returns false if
+ * there isn't one or it's out of date. The atlas is loaded by the key it
+ * was cached under rather than from its images, so changes to those alone
+ * aren't picked up until the model cache is cleared.
+ */
+bool ohw::ModelResource::LoadCachedModel( const std::string &cachePath, uint64_t sourceHash ) {
+	OhmHandle *ohm = Ohm_LoadFile( cachePath.c_str() );
+	if ( ohm == nullptr ) {
+		return false;
+	}
+
+	const OhmHeader &header = ohm->header;
+	if ( header.source_hash != sourceHash ) {
+		Ohm_DestroyHandle( ohm );
+		return false;
+	}
+
+	// The UVs are baked against the atlas, so it needs to come out exactly the same
+	TextureAtlas *textureAtlas = nullptr;
+	if ( header.num_atlas_images > 0 ) {
+		if ( ( header.atlas_filtered != 0 ) != cv_graphics_texture_filter->b_value ) {
+			Ohm_DestroyHandle( ohm );
+			return false;
 		}
 
-		memcpy( meshesVector[ i ]->vertices, obj.vertices.data(), sizeof( PLVertex ) * obj.vertices.size() );
-		memcpy( meshesVector[ i ]->indices, j->second.indices.data(),
-		        sizeof( unsigned int ) * j->second.indices.size() );
+		std::vector< std::string > atlasImages;
+		for ( unsigned int i = 0; i < header.num_atlas_images; ++i ) {
+			atlasImages.push_back( ohm->atlas_images[ i ].path );
+		}
 
-		if ( !j->second.material.strTexture.empty() ) {
-			SharedTextureResourcePointer texture = GetApp()->resourceManager->LoadTexture( j->second.material.strTexture );
-			texturesVector.push_back( texture );
+		// Load the atlas it was baked against straight out of the cache, falling back to building it again
+		// only if it wasn't cached in the first place
+		if ( header.atlas_key != 0 ) {
+			textureAtlas = new TextureAtlas( 128, 128 );
+			if ( !textureAtlas->LoadCached( header.atlas_key, atlasImages ) ) {
+				DebugMsg( "Cached atlas for \"%s\" is missing, recompiling\n", cachePath.c_str() );
+				delete textureAtlas;
+				Ohm_DestroyHandle( ohm );
+				return false;
+			}
+		} else {
+			textureAtlas = ModelResource_GenerateTextureAtlas( atlasImages );
+		}
+
+		if ( textureAtlas->GetTexture()->w != header.atlas_width || textureAtlas->GetTexture()->h != header.atlas_height ) {
+			DebugMsg( "Atlas for \"%s\" has changed, recompiling\n", cachePath.c_str() );
+			delete textureAtlas;
+			Ohm_DestroyHandle( ohm );
+			return false;
+		}
+	}
+
+	static_assert( sizeof( *( ( PLMesh * ) nullptr )->indices ) == sizeof( uint32_t ), "mismatch" );
+	for ( unsigned int i = 0; i < header.num_submeshes; ++i ) {
+		const OhmSubMesh &submesh = ohm->submeshes[ i ];
+		PLMesh *mesh = plCreateMesh( PL_MESH_TRIANGLES, PL_DRAW_STATIC, submesh.num_indices / 3, submesh.num_vertices );
+		if ( mesh == nullptr ) {
+			Warning( "Failed to create mesh!\nPL: %s\n", plGetError() );
+			DestroyMeshes();
+			delete textureAtlas;
+			Ohm_DestroyHandle( ohm );
+			return false;
+		}
 
-			meshesVector[ i ]->texture = texture->GetInternalTexture();
+		memcpy( mesh->vertices, ohm->vertices + submesh.first_vertex * header.vertex_size, submesh.num_vertices * header.vertex_size );
+		memcpy( mesh->indices, ohm->indices + submesh.first_index * sizeof( uint32_t ), submesh.num_indices * sizeof( uint32_t ) );
+
+		if ( ( submesh.flags & OHM_SUBMESH_ATLAS ) && textureAtlas != nullptr ) {
+			mesh->texture = textureAtlas->GetTexture();
 		} else {
-			meshesVector[ i ]->texture = GetApp()->resourceManager->GetFallbackTexture();
+			mesh->texture = GetApp()->resourceManager->GetFallbackTexture();
 		}
 
-		++i;
+		meshesVector.push_back( mesh );
 	}
 
-	// Done!
+	delete textureAtlas;
+
+	bounds.origin = PLVector3( header.origin[ 0 ], header.origin[ 1 ], header.origin[ 2 ] );
+	bounds.mins = PLVector3( header.mins[ 0 ], header.mins[ 1 ], header.mins[ 2 ] );
+	bounds.maxs = PLVector3( header.maxs[ 0 ], header.maxs[ 1 ], header.maxs[ 2 ] );
+	hasBounds = true;
+
+	Ohm_DestroyHandle( ohm );
+
+	return true;
 }
 
-static ohw::TextureAtlas *ModelResource_GenerateVtxTextureAtlas( const FacHandle *facHandle, const std::string &texturePath ) {
-	if ( facHandle->texture_table_size == 0 ) {
-		Warning( "Empty texture table!\n" );
-		return nullptr;
+/**
+ * Writes out the meshes we've just converted, so we can skip all that next time.
+ */
+void ohw::ModelResource::WriteCachedModel( const std::string &cachePath, uint64_t sourceHash,
+                                           const std::vector< std::string > &atlasImages, const PLTexture *atlasTexture, uint64_t atlasKey ) {
+	std::string directory = cachePath.substr( 0, cachePath.find_last_of( '/' ) );
+	if ( !plCreatePath( directory.c_str() ) ) {
+		Warning( "Failed to create model cache directory, \"%s\" (%s)!\n", directory.c_str(), plGetError() );
+		return;
 	}
 
-	ohw::TextureAtlas *atlas = new ohw::TextureAtlas( 128, 128 );
+	OhmHeader header;
+	memset( &header, 0, sizeof( OhmHeader ) );
+	memcpy( header.identifier, OHM_IDENTIFIER, sizeof( header.identifier ) );
+	header.version = OHM_VERSION;
+	header.vertex_size = sizeof( PLVertex );
+	header.source_hash = sourceHash;
+
+	header.origin[ 0 ] = bounds.origin.x;
+	header.origin[ 1 ] = bounds.origin.y;
+	header.origin[ 2 ] = bounds.origin.z;
+	header.mins[ 0 ] = bounds.mins.x;
+	header.mins[ 1 ] = bounds.mins.y;
+	header.mins[ 2 ] = bounds.mins.z;
+	header.maxs[ 0 ] = bounds.maxs.x;
+	header.maxs[ 1 ] = bounds.maxs.y;
+	header.maxs[ 2 ] = bounds.maxs.z;
+
+	std::vector< OhmAtlasImage > images;
+	if ( atlasTexture != nullptr ) {
+		for ( const auto &path : atlasImages ) {
+			if ( path.size() >= OHM_MAX_PATH ) {
+				Warning( "Texture path is too long to be cached, \"%s\"!\n", path.c_str() );
+				return;
+			}
 
-	for ( unsigned int i = 0; i < facHandle->texture_table_size; ++i ) {
-		if ( facHandle->texture_table[ i ].name[ 0 ] == '\0' ) {
-			Warning( "Invalid texture name in table, skipping (%d)!\n", i );
-			continue;
+			OhmAtlasImage image;
+			memset( &image, 0, sizeof( OhmAtlasImage ) );
+			strcpy( image.path, path.c_str() );
+			images.push_back( image );
 		}
 
-		std::string str = texturePath;
-		std::string texture_path = str.erase( str.find_last_of( '/' ) ) + "/";
-		if ( !atlas->AddImage( texture_path + facHandle->texture_table[ i ].name + ".png", true ) ) {
-			Warning( "Failed to add texture \"%s\" to atlas!\n", facHandle->texture_table[ i ].name );
-		}
+		header.num_atlas_images = images.size();
+		header.atlas_width = atlasTexture->w;
+		header.atlas_height = atlasTexture->h;
+		header.atlas_filtered = cv_graphics_texture_filter->b_value;
+		header.atlas_key = atlasKey;
 	}
 
-	atlas->Finalize();
+	std::vector< OhmSubMesh > submeshes( meshesVector.size() );
+	std::vector< const void * > vertices( meshesVector.size() );
+	std::vector< const uint32_t * > indices( meshesVector.size() );
+	for ( unsigned int i = 0; i < meshesVector.size(); ++i ) {
+		const PLMesh *mesh = meshesVector[ i ];
+		submeshes[ i ].num_vertices = mesh->num_verts;
+		submeshes[ i ].num_indices = mesh->num_indices;
+		submeshes[ i ].flags = ( atlasTexture != nullptr && mesh->texture == atlasTexture ) ? OHM_SUBMESH_ATLAS : 0;
+		vertices[ i ] = mesh->vertices;
+		indices[ i ] = mesh->indices;
 
-	return atlas;
+		header.num_vertices += mesh->num_verts;
+		header.num_indices += mesh->num_indices;
+	}
+	header.num_submeshes = submeshes.size();
+
+	if ( Ohm_WriteFile( cachePath.c_str(), &header, submeshes.data(), vertices.data(), indices.data(), images.data() ) ) {
+		DebugMsg( "Compiled model \"%s\" to \"%s\"\n", GetPath().c_str(), cachePath.c_str() );
+	}
 }
 
 /**
  * Loader for Hogs of War's PC model format
  */
 void ohw::ModelResource::LoadVtxModel( const std::string &path, bool abortOnFail ) {
+	// If we've already compiled this model, and nothing's changed since, just use that
+	const char *fileName = plGetFileName( path.c_str() );
+	bool isSkydome = ( pl_strcasecmp( fileName, "skydome.vtx" ) == 0 || pl_strcasecmp( fileName, "skydomeu.vtx" ) == 0 );
+	uint64_t sourceHash = 0;
+	bool canCache = cv_graphics_model_cache->b_value && !isSkydome && ModelResource_HashVtxSources( path, &sourceHash );
+	std::string cachePath;
+	if ( canCache ) {
+		cachePath = ModelResource_GetCachePath( path );
+		if ( LoadCachedModel( cachePath, sourceHash ) ) {
+			return;
+		}
+	}
+
 	// Load in the vertices
-	VtxHandle *vtxHandle = Vtx_LoadFile( path.c_str() );
+	VtxHandle *vtxHandle = ModelResource_LoadVtx( path.c_str() );
 	if ( vtxHandle == nullptr ) {
 		if ( abortOnFail ) {
 			Error( "Failed to load Vtx, \"%s\"!\n", path.c_str() );
@@ -263,7 +561,7 @@ void ohw::ModelResource::LoadVtxModel( const std::string &path, bool abortOnFail
 	// Load in the faces
 	char facesPath[PL_SYSTEM_MAX_PATH];
 	u_new_filename( facesPath, path.c_str(), "fac" );
-	FacHandle *facHandle = Fac_LoadFile( facesPath );
+	FacHandle *facHandle = ModelResource_LoadFac( facesPath );
 	if ( facHandle == nullptr ) {
 		if ( abortOnFail ) {
 			Error( "Failed to load Fac, \"%s\"!\n", facesPath );
@@ -276,8 +574,7 @@ void ohw::ModelResource::LoadVtxModel( const std::string &path, bool abortOnFail
 	}
 
 	// There are some special cases, so let's go ahead and deal with those...
-	const char *fileName = plGetFileName( path.c_str() );
-	if ( pl_strcasecmp( fileName, "skydome.vtx" ) == 0 || pl_strcasecmp( fileName, "skydomeu.vtx" ) == 0 ) {
+	if ( isSkydome ) {
 		PLMesh *mesh = plCreateMesh( PL_MESH_TRIANGLES, PL_DRAW_STATIC, facHandle->num_triangles,
 		                             vtxHandle->num_vertices );
 		if ( mesh == nullptr ) {
@@ -334,7 +631,7 @@ void ohw::ModelResource::LoadVtxModel( const std::string &path, bool abortOnFail
 	// Attempt to load in the normals, it's fine if these don't successfully load as we'll just generate them instead later
 	char normalsPath[PL_SYSTEM_MAX_PATH];
 	u_new_filename( normalsPath, path.c_str(), "no2" );
-	No2Handle *no2Handle = No2_LoadFile( normalsPath );
+	No2Handle *no2Handle = ModelResource_LoadNo2( normalsPath );
 
 	// Need to scale the model up, as the models are actually a little bit smaller than our terrain :(
 	for ( unsigned int j = 0; j < vtxHandle->num_vertices; ++j ) {
@@ -343,13 +640,22 @@ void ohw::ModelResource::LoadVtxModel( const std::string &path, bool abortOnFail
 
 	// automatically returns default if failed
 	std::string texturePath = facesPath;
-	// Temporary hack just to get the pig textures loaded
-	if ( strstr( facesPath, "pigs" ) != nullptr ) {
+	const char *textureExtension = ".png";
+	if ( facHandle->texture_table == nullptr ) {
+		// Loaded from a package, so textures come from the accompanying MTD
+		std::string mtdPath = ModelResource_ResolvePackageTextures( facHandle, facesPath );
+		if ( !mtdPath.empty() ) {
+			texturePath = mtdPath + "/";
+			textureExtension = ".tim";
+		}
+	} else if ( strstr( facesPath, "pigs" ) != nullptr ) {
+		// Temporary hack just to get the pig textures loaded
 		texturePath = "chars/pigs/british/";
 	}
 
 	// Now create the atlas itself
-	TextureAtlas *textureAtlas = ModelResource_GenerateVtxTextureAtlas( facHandle, texturePath );
+	std::vector< std::string > atlasImages = ModelResource_GetVtxTexturePaths( facHandle, texturePath, textureExtension );
+	TextureAtlas *textureAtlas = ModelResource_GenerateTextureAtlas( atlasImages );
 
 	unsigned int curIndex = 0;
 	for ( unsigned int i = 0, nextVtxIndex = 0; i < facHandle->num_triangles; ++i ) {
@@ -388,9 +694,12 @@ void ohw::ModelResource::LoadVtxModel( const std::string &path, bool abortOnFail
 		}
 	}
 
+	PLTexture *atlasTexture = nullptr;
+	uint64_t atlasKey = 0;
 	if ( textureAtlas != nullptr ) {
 		// TODO: we have no way of cleaning this up right now...
-		mesh->texture = textureAtlas->GetTexture();
+		atlasTexture = mesh->texture = textureAtlas->GetTexture();
+		atlasKey = textureAtlas->GetCacheKey();
 	} else {
 		mesh->texture = GetApp()->resourceManager->GetFallbackTexture();
 	}
@@ -400,19 +709,22 @@ void ohw::ModelResource::LoadVtxModel( const std::string &path, bool abortOnFail
 	// Normals weren't loaded in, so attempt to generate them
 #if 0
 	if ( no2Handle == nullptr ) {
-		std::list< PLMesh * > meshes( &mesh, &mesh + 1 );
-		Mesh_GenerateFragmentedMeshNormals( meshes );
+		Mesh_GenerateFragmentedMeshNormals( &mesh, 1 );
 	} else {
 		No2_DestroyHandle( no2Handle );
 	}
 #else
 	// Always generate normals until we handle No2 correctly
-	std::list< PLMesh * > meshes( &mesh, &mesh + 1 );
-	Mesh_GenerateFragmentedMeshNormals( meshes );
+	Mesh_GenerateFragmentedMeshNormals( &mesh, 1 );
 #endif
 
 	meshesVector.push_back( mesh );
 
+	if ( canCache ) {
+		GenerateBounds();
+		WriteCachedModel( cachePath, sourceHash, atlasImages, atlasTexture, atlasKey );
+	}
+
 	// Done!
 }
 
@@ -445,7 +757,9 @@ void ohw::ModelResource::DrawMesh( unsigned int i ) {
 	plSetShaderUniformValue( program, "pl_model", &modelMatrix, true );
 
 	plUploadMesh( meshesVector[ i ] );
+	METRIC_COUNTER( "render.mesh_uploads" )->Add();
 	plDrawMesh( meshesVector[ i ] );
+	METRIC_COUNTER( "render.draw_calls" )->Add();
 }
 
 /**
@@ -489,8 +803,23 @@ void ohw::ModelResource::GenerateBounds() {
 		return;
 	}
 
+	hasBounds = true;
+
+	// Most models are a single mesh, so no need to gather anything
+	if ( meshesVector.size() == 1 ) {
+		bounds = plGenerateAABB( meshesVector[ 0 ]->vertices, meshesVector[ 0 ]->num_verts, false );
+		return;
+	}
+
 	// Gather all the vertices from every mesh
-	std::vector< PLVertex > vertices;
+	size_t numVertices = 0;
+	for ( const auto &mesh : meshesVector ) {
+		numVertices += mesh->num_verts;
+	}
+
+	MemoryArenaScope scope;
+	ArenaVector< PLVertex > vertices( ( ArenaAllocator< PLVertex >( scope.GetArena() ) ) );
+	vertices.reserve( numVertices );
 	for ( const auto &mesh : meshesVector ) {
 		vertices.insert( vertices.end(), mesh->vertices, mesh->vertices + mesh->num_verts );
 	}
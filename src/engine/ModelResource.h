@@ -79,6 +79,10 @@ namespace ohw {
 		void LoadVtxModel( const std::string &path, bool abortOnFail );
 		void LoadMinModel( const std::string &path, bool abortOnFail );
 
+		bool LoadCachedModel( const std::string &cachePath, uint64_t sourceHash );
+		void WriteCachedModel( const std::string &cachePath, uint64_t sourceHash,
+		                       const std::vector< std::string > &atlasImages, const PLTexture *atlasTexture, uint64_t atlasKey );
+
 		void DrawMesh( unsigned int i );
 
 		void DestroyMeshes();
@@ -93,6 +97,7 @@ namespace ohw {
 		std::vector< PLMatrix4 > batchedDrawCalls;  // Draw queue. Anything queued up will be pushed to the GPU in one batch
 
 		PLCollisionAABB bounds;
+		bool hasBounds{ false };
 	};
 
 	using SharedModelResourcePointer = SharedResourcePointer< ModelResource >;
@@ -18,36 +18,76 @@
 #include "App.h"
 #include "Property.h"
 
-Property::Property( PropertyOwner &po, const std::string &name, unsigned flags ) :
+uint64_t Property::lastRevision_ = 0;
+
+/**
+ * Only does anything while the first instance of the class is being
+ * constructed. Once a property shows up again at the same offset as the
+ * first one we registered, it's another instance and the table is done.
+ */
+void PropertyTable::Register( const PropertyOwner &po, const char *name, unsigned flags, PropertyType type, ptrdiff_t offset ) {
+	if ( is_complete_ ) {
+		return;
+	}
+
+	if ( descriptors_.empty() ) {
+		// Start off with whatever our base classes have registered
+		if ( po.property_table_ != nullptr && po.property_table_ != this ) {
+			descriptors_ = po.property_table_->descriptors_;
+		}
+		num_inherited_ = descriptors_.size();
+	} else if ( descriptors_.size() > num_inherited_ && descriptors_[ num_inherited_ ].offset == offset ) {
+		is_complete_ = true;
+		return;
+	}
+
+	u_assert( FindProperty( name ) == -1, "Property \"%s\" has already been registered!\n", name );
+	descriptors_.push_back( { name, flags, type, offset } );
+}
+
+int PropertyTable::FindProperty( const char *name ) const {
+	for ( unsigned int i = 0; i < descriptors_.size(); ++i ) {
+		if ( strcmp( descriptors_[ i ].name, name ) == 0 ) {
+			return ( int ) i;
+		}
+	}
+
+	return -1;
+}
+
+Property::Property( PropertyOwner &po, PropertyTable &table, const char *name, unsigned flags, PropertyType type ) :
 		name( name ),
 		flags( flags ),
 		po_( po ),
 		is_dirty_( false ) {
-	auto x = po_.properties_.insert( std::make_pair( name, this ) );
-	u_assert( x.second ); /* Check for name collision */
+	table.Register( po_, name, flags, type, reinterpret_cast< const char * >( this ) - reinterpret_cast< const char * >( &po_ ) );
+	po_.property_table_ = &table;
 }
 
-Property::Property( PropertyOwner &po, const Property &src ) :
+Property::Property( PropertyOwner &po, PropertyTable &table, const Property &src, PropertyType type ) :
 		name( src.name ),
 		flags( src.flags ),
 		po_( po ),
 		is_dirty_( src.is_dirty_ ),
 		dirty_since_( src.dirty_since_ ),
+		quantization_( src.quantization_ ),
 		clean_serialised_( src.clean_serialised_ ) {
-	auto x = po_.properties_.insert( std::make_pair( name, this ) );
-	u_assert( x.second ); /* Check for name collision */
-}
-
-Property::~Property() {
-	po_.properties_.erase( name );
+	table.Register( po_, name, flags, type, reinterpret_cast< const char * >( this ) - reinterpret_cast< const char * >( &po_ ) );
+	po_.property_table_ = &table;
 }
 
 void Property::MarkClean() {
-	clean_serialised_ = Serialise();
+	// Reuses whatever the last clean value left us with
+	clean_serialised_.resize( Serialise( nullptr, 0 ) );
+	if ( !clean_serialised_.empty() ) {
+		Serialise( &clean_serialised_[ 0 ], clean_serialised_.size() );
+	}
 	is_dirty_ = false;
 }
 
 void Property::MarkDirty() {
+	revision_ = po_.revision_ = ++lastRevision_;
+
 	if ( !is_dirty_ ) {
 		is_dirty_ = true;
 		dirty_since_ = ohw::GetApp()->GetTicks();
@@ -55,7 +95,7 @@ void Property::MarkDirty() {
 }
 
 void Property::ResetToClean() {
-	Deserialise( clean_serialised_ );
+	Deserialise( clean_serialised_.data(), clean_serialised_.size() );
 	MarkClean();
 }
 
@@ -67,9 +107,153 @@ unsigned int Property::DirtyTicks() const {
 	}
 }
 
+void Property::SetQuantization( float min, float max, unsigned int bits ) {
+	u_assert( max > min && bits > 0 && bits <= 32 );
+	quantization_.min = min;
+	quantization_.max = max;
+	quantization_.bits = bits;
+}
+
+void Property::PackFloat( ohw::BitWriter &writer, float value ) const {
+	if ( quantization_.bits == 0 ) {
+		writer.WriteFloat( value );
+		return;
+	}
+
+	writer.WriteQuantizedFloat( value, quantization_.min, quantization_.max, quantization_.bits );
+}
+
+float Property::UnpackFloat( ohw::BitReader &reader ) const {
+	if ( quantization_.bits == 0 ) {
+		return reader.ReadFloat();
+	}
+
+	return reader.ReadQuantizedFloat( quantization_.min, quantization_.max, quantization_.bits );
+}
+
+void Property::Pack( ohw::BitWriter &writer ) const {
+	uint8_t buffer[ 256 ];
+	size_t length = Serialise( buffer, sizeof( buffer ) );
+	if ( length > UINT16_MAX ) {
+		Warning( "Property \"%s\" is too large to replicate!\n", name );
+		writer.WriteBits( 0, 16 );
+		return;
+	}
+
+	writer.WriteBits( length, 16 );
+	if ( length <= sizeof( buffer ) ) {
+		writer.WriteBytes( buffer, length );
+		return;
+	}
+
+	std::vector< uint8_t > largeBuffer( length );
+	Serialise( largeBuffer.data(), length );
+	writer.WriteBytes( largeBuffer.data(), length );
+}
+
+void Property::Unpack( ohw::BitReader &reader ) {
+	uint8_t buffer[ 256 ];
+	size_t length = reader.ReadBits( 16 );
+	if ( length <= sizeof( buffer ) ) {
+		if ( reader.ReadBytes( buffer, length ) ) {
+			Deserialise( buffer, length );
+		}
+		return;
+	}
+
+	std::vector< uint8_t > largeBuffer( length );
+	if ( reader.ReadBytes( largeBuffer.data(), length ) ) {
+		Deserialise( largeBuffer.data(), length );
+	}
+}
+
 PropertyOwner::PropertyOwner() {}
 PropertyOwner::~PropertyOwner() {}
 
 std::string PropertyOwner::SerializePropertiesAsJson() {
 	return "";
 }
+
+Property *PropertyOwner::FindProperty( const char *name ) {
+	int index = ( property_table_ != nullptr ) ? property_table_->FindProperty( name ) : -1;
+	return ( index != -1 ) ? GetProperty( index ) : nullptr;
+}
+
+/* each property is written out as a 16-bit length followed by its serialised value */
+
+size_t PropertyOwner::SerialiseProperties( void *buffer, size_t size ) const {
+	uint8_t *out = static_cast< uint8_t * >( buffer );
+	size_t length = 0;
+	for ( unsigned int i = 0; i < GetNumProperties(); ++i ) {
+		bool hasRoom = ( size >= length + sizeof( uint16_t ) );
+		size_t remaining = hasRoom ? size - length - sizeof( uint16_t ) : 0;
+		size_t propertyLength = GetProperty( i )->Serialise( hasRoom ? out + length + sizeof( uint16_t ) : nullptr, remaining );
+		u_assert( propertyLength <= UINT16_MAX, "Property \"%s\" is too large to serialise!\n", GetProperty( i )->name );
+		if ( hasRoom && propertyLength <= remaining ) {
+			uint16_t storedLength = ( uint16_t ) propertyLength;
+			memcpy( out + length, &storedLength, sizeof( storedLength ) );
+		}
+
+		length += sizeof( uint16_t ) + propertyLength;
+	}
+
+	return length;
+}
+
+bool PropertyOwner::DeserialiseProperties( const void *data, size_t size ) {
+	const uint8_t *in = static_cast< const uint8_t * >( data );
+	size_t position = 0;
+	for ( unsigned int i = 0; i < GetNumProperties(); ++i ) {
+		uint16_t propertyLength;
+		if ( size - position < sizeof( propertyLength ) ) {
+			return false;
+		}
+		memcpy( &propertyLength, in + position, sizeof( propertyLength ) );
+		position += sizeof( propertyLength );
+
+		if ( size - position < propertyLength || !GetProperty( i )->Deserialise( in + position, propertyLength ) ) {
+			return false;
+		}
+		position += propertyLength;
+	}
+
+	return ( position == size );
+}
+
+unsigned int PropertyOwner::SendUpdate( ohw::BitWriter &writer, uint64_t sinceRevision,
+                                        unsigned int requiredFlags, unsigned int excludedFlags ) {
+	unsigned int numProperties = std::min( GetNumProperties(), PROPERTY_MAX_REPLICATED );
+	unsigned int numWritten = 0;
+	for ( unsigned int i = 0; i < numProperties; ++i ) {
+		const Property *property = GetProperty( i );
+		if ( property->GetRevision() > sinceRevision &&
+		     ( property->flags & requiredFlags ) == requiredFlags && ( property->flags & excludedFlags ) == 0 ) {
+			writer.WriteBool( true );
+			writer.WriteBits( i, PROPERTY_INDEX_BITS );
+			property->Pack( writer );
+			numWritten++;
+		}
+	}
+
+	writer.WriteBool( false );
+
+	return numWritten;
+}
+
+bool PropertyOwner::ReceiveUpdate( ohw::BitReader &reader, unsigned int requiredFlags, unsigned int excludedFlags ) {
+	while ( reader.ReadBool() ) {
+		unsigned int index = reader.ReadBits( PROPERTY_INDEX_BITS );
+		if ( reader.HasOverflowed() || index >= GetNumProperties() ) {
+			return false;
+		}
+
+		Property *property = GetProperty( index );
+		if ( ( property->flags & requiredFlags ) != requiredFlags || ( property->flags & excludedFlags ) != 0 ) {
+			return false;
+		}
+
+		property->Unpack( reader );
+	}
+
+	return !reader.HasOverflowed();
+}
@@ -17,10 +17,13 @@
 
 #pragma once
 
-#include <map>
 #include <sstream>
 #include <string>
 #include <string.h>
+#include <type_traits>
+#include <vector>
+
+#include "net/BitStream.h"
 
 /**
  * @defgroup PropertyFlags Property flags
@@ -41,6 +44,9 @@
 
 /*@}*/
 
+#define PROPERTY_INDEX_BITS         5
+#define PROPERTY_MAX_REPLICATED     ( 1U << PROPERTY_INDEX_BITS )  /**< Properties past this aren't replicated */
+
 /**
  * @brief Helper macro for initialising properties.
  *
@@ -48,7 +54,8 @@
  * @param flags  PROP_XXX flags
  * @param ...    Extra parameters to property constructor
 */
-#define INIT_PROPERTY(name, flags, ...) name(*(PropertyOwner*)this, #name, flags, ##__VA_ARGS__)
+#define INIT_PROPERTY(name, flags, ...) \
+	name(*(PropertyOwner*)this, PROPERTY_TABLE(), #name, flags, ##__VA_ARGS__)
 
 /**
  * @brief Helper macro for copying-constructing properties.
@@ -56,18 +63,74 @@
  * @param name  Name of member (bareword)
  * @param src   Name of source structure (bareword)
 */
-#define COPY_PROPERTY(name, src) name(*(PropertyOwner*)this, src.name)
+#define COPY_PROPERTY(name, src) name(*(PropertyOwner*)this, PROPERTY_TABLE(), src.name)
+
+/* table for the class whose constructor we're in */
+#define PROPERTY_TABLE() PropertyTable::Get<std::remove_reference<decltype(*this)>::type>()
 
 class JsonReader;
+class Property;
 class PropertyOwner;
 
+enum class PropertyType {
+	NUMERIC,
+	BOOLEAN,
+	STRING,
+	STRING_VECTOR,
+	VECTOR3,
+};
+
+/**
+ * @brief Describes a property member, the same for every instance of a class.
+*/
+struct PropertyDescriptor {
+	const char *name;
+	unsigned flags;
+	PropertyType type;
+	ptrdiff_t offset;   /**< From the start of the PropertyOwner */
+};
+
+/**
+ * @brief Per-class table of properties, shared by every instance.
+ *
+ * There's one for each class that declares properties, holding those of
+ * its base classes first. It's filled in as the first instance of the
+ * class is constructed, so later instances only need to point at it.
+*/
+class PropertyTable {
+	friend Property;
+
+	public:
+		template<typename T> static PropertyTable &Get()
+		{
+			static PropertyTable table;
+			return table;
+		}
+
+		unsigned int GetNumProperties() const { return descriptors_.size(); }
+		const PropertyDescriptor &GetDescriptor(unsigned int i) const { return descriptors_[i]; }
+
+		/**
+		 * @brief Returns the index of the named property, or -1 if there isn't one.
+		*/
+		int FindProperty(const char *name) const;
+
+	private:
+		PropertyTable() = default;
+
+		void Register(const PropertyOwner &po, const char *name, unsigned flags, PropertyType type, ptrdiff_t offset);
+
+		std::vector<PropertyDescriptor> descriptors_;
+		unsigned int num_inherited_{ 0 };
+		bool is_complete_{ false };
+};
+
 /**
  * @brief Base class for all properties. Pure virtual.
 */
 class Property {
 public:
-	const std::string name;
-	const std::string description;
+	const char *const name;
 	const unsigned flags;
 
 	/* No copy/assignment c'tors. */
@@ -75,12 +138,13 @@ public:
 	Property& operator=( const Property& ) = delete;
 
 	/**
-	 * @brief Returns the serialised form of the property's value.
+	 * @brief Writes the serialised form of the property's value into the given buffer.
 	 *
-	 * Serialises the property's value using std::string as a container. The value may
-	 * or may not be a printable string; treat it as a byte array.
+	 * The value may or may not be a printable string; treat it as a byte array.
+	 * Returns the number of bytes needed, and only writes anything if that fits
+	 * within the buffer, so passing a null buffer gets the size.
 	*/
-		virtual std::string Serialise() const = 0;
+		virtual size_t Serialise(void *buffer, size_t size) const = 0;
 
         /**
          * Returns the property formatted as Json.
@@ -90,13 +154,13 @@ public:
 		/**
 		 * @brief Set the property to the given serialised form.
 		 *
-		 * Sets the value to the given serialised one, which must have been returned from
+		 * Sets the value to the given serialised one, which must have been written by
 		 * a call to Serialise(). Marks the property as dirty.
 		 *
-		 * Throws XXX and makes no change to the property if the serialised form isn't
+		 * Returns false and makes no change to the property if the serialised form isn't
 		 * valid.
 		*/
-		virtual void Deserialise(const std::string &serialised) = 0;
+		virtual bool Deserialise(const void *data, size_t size) = 0;
 		
 		/**
 		 * @brief Mark the property as clean and save the current value.
@@ -123,29 +187,62 @@ public:
 		 * @brief Returns the number of ticks the property has been dirty for.
 		*/
 		unsigned int DirtyTicks() const;
+
+		/**
+		 * @brief Returns the revision of the last change made to the property.
+		 *
+		 * Revisions are shared between all properties and only ever go up, so
+		 * anything changed since a given point can be found by comparing against it.
+		*/
+		uint64_t GetRevision() const { return revision_; }
+
+		/**
+		 * @brief Packs the value for replication, as compactly as the type allows.
+		 *
+		 * The default falls back on Serialise(), so types that change often should
+		 * provide their own.
+		*/
+		virtual void Pack( ohw::BitWriter &writer ) const;
+		virtual void Unpack( ohw::BitReader &reader );
+
+		/**
+		 * @brief Replicate floating-point values as fixed-point within the given range.
+		*/
+		void SetQuantization( float min, float max, unsigned int bits );
 		
 	protected:
 		PropertyOwner &po_;
 		
-		Property(PropertyOwner &po, const std::string &name, unsigned flags);
-		Property(PropertyOwner &po, const Property &src);
-		virtual ~Property();
+		Property(PropertyOwner &po, PropertyTable &table, const char *name, unsigned flags, PropertyType type);
+		Property(PropertyOwner &po, PropertyTable &table, const Property &src, PropertyType type);
+		virtual ~Property() = default;
+
+		void PackFloat( ohw::BitWriter &writer, float value ) const;
+		float UnpackFloat( ohw::BitReader &reader ) const;
 		
 	private:
 		bool is_dirty_;
 		unsigned int dirty_since_{ 0 };
+		uint64_t revision_{ 0 };
+
+		static uint64_t lastRevision_;
+
+		struct {
+			float min{ 0.0f };
+			float max{ 0.0f };
+			unsigned int bits{ 0 };
+		} quantization_;
 		
 		std::string clean_serialised_;
 };
 
-typedef std::map<std::string, Property*> PropertyMap;
-
 /**
  * @brief Base class for actors, game modes, etc to allow them to have properties.
 */
 class PropertyOwner
 {
 	friend Property;
+	friend PropertyTable;
 	
 	public:
 		/* These are no-ops because copying or assigning a PropertyOwner class should just
@@ -155,17 +252,72 @@ class PropertyOwner
 		PropertyOwner(const PropertyOwner&) {}
 		PropertyOwner& operator=(const PropertyOwner&) { return *this; }
 
-		const PropertyMap& GetProperties() { return properties_; }
+		const PropertyTable *GetPropertyTable() const { return property_table_; }
+		unsigned int GetNumProperties() const { return ( property_table_ != nullptr ) ? property_table_->GetNumProperties() : 0; }
+
+		Property *GetProperty(unsigned int i)
+		{
+			return reinterpret_cast<Property*>(reinterpret_cast<char*>(this) + property_table_->GetDescriptor(i).offset);
+		}
+		const Property *GetProperty(unsigned int i) const
+		{
+			return reinterpret_cast<const Property*>(reinterpret_cast<const char*>(this) + property_table_->GetDescriptor(i).offset);
+		}
+
+		/**
+		 * @brief Returns the named property, or null if there isn't one.
+		*/
+		Property *FindProperty(const char *name);
+
+		/**
+		 * @brief Writes every property into the given buffer, in table order.
+		 *
+		 * Returns the number of bytes needed. If that's more than the given
+		 * size, the buffer is left partially written and should be discarded.
+		*/
+		size_t SerialiseProperties(void *buffer, size_t size) const;
+
+		/**
+		 * @brief Restores properties written by SerialiseProperties().
+		 *
+		 * Returns false if the data doesn't match up with our properties.
+		*/
+		bool DeserialiseProperties(const void *data, size_t size);
 
 		virtual std::string SerializePropertiesAsJson();
+
+		/**
+		 * @brief Returns the revision of the most recent change to any of our properties.
+		*/
+		uint64_t GetRevision() const { return revision_; }
+
+		/**
+		 * @brief Writes out every property changed since the given revision.
+		 *
+		 * Only properties with all of the required flags and none of the excluded
+		 * ones are written. Returns the number of properties written.
+		*/
+		virtual unsigned int SendUpdate( ohw::BitWriter &writer, uint64_t sinceRevision,
+		                                 unsigned int requiredFlags, unsigned int excludedFlags );
+
+		/**
+		 * @brief Applies an update written by SendUpdate().
+		 *
+		 * Returns false if the update is malformed or includes a property that
+		 * doesn't match the given flags, in which case the rest of the update
+		 * can't be trusted.
+		*/
+		virtual bool ReceiveUpdate( ohw::BitReader &reader, unsigned int requiredFlags, unsigned int excludedFlags );
 	
 	protected:
 		PropertyOwner();
 		virtual ~PropertyOwner();
 		
 	private:
-		/** Properties registered under this object */
-        PropertyMap properties_;
+		/** Properties of the most derived class constructed so far */
+		const PropertyTable *property_table_{ nullptr };
+
+		uint64_t revision_{ 0 };
 };
 
 /**
@@ -177,11 +329,11 @@ template<typename T> class NumericProperty: public Property
 		T value_;
 		
 	public:
-		NumericProperty(PropertyOwner &po, const std::string &name, unsigned flags, T value = 0):
-			Property(po, name, flags), value_(value) {}
+		NumericProperty(PropertyOwner &po, PropertyTable &table, const char *name, unsigned flags, T value = 0):
+			Property(po, table, name, flags, PropertyType::NUMERIC), value_(value) {}
 		
-		NumericProperty(PropertyOwner &po, const NumericProperty<T> &src):
-			Property(po, src), value_(src.value_) {}
+		NumericProperty(PropertyOwner &po, PropertyTable &table, const NumericProperty<T> &src):
+			Property(po, table, src, PropertyType::NUMERIC), value_(src.value_) {}
 		
 		/* Implicit conversion for using as a (const) T */
 		operator const T&() const
@@ -203,26 +355,66 @@ template<typename T> class NumericProperty: public Property
 		*/
 		const T& operator=(const T& value)
 		{
+			if(this->value_ == value)
+			{
+				return value;
+			}
+
 			this->value_ = value;
 			MarkDirty();
 			
 			return value;
 		}
 		
-		std::string Serialise() const override
+		size_t Serialise(void *buffer, size_t size) const override
+		{
+			if(size >= sizeof(value_))
+			{
+				memcpy(buffer, &value_, sizeof(value_));
+			}
+
+			return sizeof(value_);
+		}
+
+		void Pack(ohw::BitWriter &writer) const override
+		{
+			if(std::is_same<T, float>::value)
+			{
+				PackFloat(writer, value_);
+				return;
+			}
+
+			writer.WriteBytes(&value_, sizeof(value_));
+		}
+
+		void Unpack(ohw::BitReader &reader) override
 		{
-			return std::string((const char*)(&value_), sizeof(value_));
+			if(std::is_same<T, float>::value)
+			{
+				value_ = UnpackFloat(reader);
+			}
+			else
+			{
+				reader.ReadBytes(&value_, sizeof(value_));
+			}
+
+			MarkDirty();
 		}
 
         std::string SerialiseAsJson() const override {
             return std::to_string(value_);
         }
 		
-		void Deserialise(const std::string &serialised) override
+		bool Deserialise(const void *data, size_t size) override
 		{
-			u_assert(serialised.length() == sizeof(value_));
-			memcpy(&value_, serialised.data(), sizeof(value_));
+			if(size != sizeof(value_))
+			{
+				return false;
+			}
+
+			memcpy(&value_, data, sizeof(value_));
 			MarkDirty();
+			return true;
 		}
 };
 
@@ -231,9 +423,9 @@ class VectorStringProperty : public Property {
   std::vector<std::string> value_;
 
  public:
-  VectorStringProperty(PropertyOwner& po, const std::string& name, unsigned int flags,
+  VectorStringProperty(PropertyOwner& po, PropertyTable& table, const char* name, unsigned int flags,
                        const std::vector<std::string>& value = {}) :
-      Property(po, name, flags), value_(value) {}
+      Property(po, table, name, flags, PropertyType::STRING_VECTOR), value_(value) {}
 
   operator const std::vector<std::string>&() const {
     return value_;
@@ -245,13 +437,24 @@ class VectorStringProperty : public Property {
     return value;
   }
 
-  std::string Serialise() const override {
-    std::string value;
+  size_t Serialise(void* buffer, size_t size) const override {
+    size_t length = 0;
+    for(const auto& i : value_) {
+      length += sizeof(uint32_t) + i.length();
+    }
+
+    if(length > size) {
+      return length;
+    }
+
+    uint8_t* out = static_cast<uint8_t*>(buffer);
     for(const auto& i : value_) {
       uint32_t l = i.length();
-      value += std::string((const char*)(&l), sizeof(l)) + i;
+      memcpy(out, &l, sizeof(l));
+      memcpy(out + sizeof(l), i.data(), l);
+      out += sizeof(l) + l;
     }
-    return value;
+    return length;
   }
 
   std::string SerialiseAsJson() const override {
@@ -266,21 +469,35 @@ class VectorStringProperty : public Property {
     return str;
   }
 
-  void Deserialise(const std::string& serialised) override {
-    value_.clear();
+  bool Deserialise(const void* data, size_t size) override {
+    /* check it all adds up before we touch anything */
+    const char* serialised = static_cast<const char*>(data);
+    for (size_t i = 0; i < size;) {
+      uint32_t l;
+      if((size - i) < sizeof(l)) {
+        return false;
+      }
+      memcpy(&l, serialised + i, sizeof(l));
+      i += sizeof(l);
 
-    /* TODO: Assertions should be a bad-serialised-value exception */
-    for (size_t i = 0; i < serialised.length();) {
-      assert((i + sizeof(uint32_t)) < serialised.length());
-      uint32_t l = *(uint32_t*) (serialised.data() + i);
-      i += sizeof(uint32_t);
+      if((size - i) < l) {
+        return false;
+      }
+      i += l;
+    }
+
+    value_.clear();
+    for (size_t i = 0; i < size;) {
+      uint32_t l;
+      memcpy(&l, serialised + i, sizeof(l));
+      i += sizeof(l);
 
-      assert((i + l) < serialised.length());
-      value_.emplace_back((serialised.data() + i), l);
+      value_.emplace_back((serialised + i), l);
       i += l;
     }
 
     MarkDirty();
+    return true;
   }
 };
 
@@ -289,11 +506,11 @@ class StringProperty : public Property {
   std::string value_;
 
  public:
-  StringProperty(PropertyOwner& po, const std::string& name, unsigned int flags, const std::string& value = "") :
-      Property(po, name, flags), value_(value) {}
+  StringProperty(PropertyOwner& po, PropertyTable& table, const char* name, unsigned int flags, const std::string& value = "") :
+      Property(po, table, name, flags, PropertyType::STRING), value_(value) {}
 
-  StringProperty(PropertyOwner& po, const StringProperty &src):
-      Property(po, src), value_(src.value_) {}
+  StringProperty(PropertyOwner& po, PropertyTable& table, const StringProperty &src):
+      Property(po, table, src, PropertyType::STRING), value_(src.value_) {}
 
   operator const std::string&() const {
     return value_;
@@ -319,17 +536,21 @@ class StringProperty : public Property {
     return value;
   }
 
-  std::string Serialise() const override {
-    return value_;
+  size_t Serialise(void* buffer, size_t size) const override {
+    if(value_.length() <= size) {
+      memcpy(buffer, value_.data(), value_.length());
+    }
+    return value_.length();
   }
 
 	std::string SerialiseAsJson() const override {
 		return "\"" + value_ + "\"";
 	}
 
-	void Deserialise( const std::string& serialised ) override {
-		value_ = serialised;
+	bool Deserialise( const void* data, size_t size ) override {
+		value_.assign( static_cast< const char* >( data ), size );
 		MarkDirty();
+		return true;
 	}
 };
 
@@ -341,9 +562,9 @@ private:
 	PLVector3 value_;
 
 public:
-	Vector3Property( PropertyOwner& po, const std::string& name, unsigned flags,
+	Vector3Property( PropertyOwner& po, PropertyTable& table, const char* name, unsigned flags,
 					 PLVector3 value = PLVector3( 0, 0, 0 ) ) :
-		Property( po, name, flags ), value_( value ) {}
+		Property( po, table, name, flags, PropertyType::VECTOR3 ), value_( value ) {}
 
 	operator const PLVector3&() const {
 		return value_;
@@ -354,6 +575,10 @@ public:
 	}
 
 	const PLVector3& operator=( const PLVector3& value ) {
+		if ( value_.x == value.x && value_.y == value.y && value_.z == value.z ) {
+			return value;
+		}
+
 		value_ = value;
 		MarkDirty();
 		return value;
@@ -366,8 +591,38 @@ public:
 				std::to_string( value_.z ) );
 	}
 
-	std::string Serialise() const override { return ""; } // todo
-	void Deserialise( const std::string& serialised ) override {} // todo
+	size_t Serialise( void* buffer, size_t size ) const override {
+		float components[ 3 ] = { value_.x, value_.y, value_.z };
+		if ( size >= sizeof( components ) ) {
+			memcpy( buffer, components, sizeof( components ) );
+		}
+		return sizeof( components );
+	}
+
+	bool Deserialise( const void* data, size_t size ) override {
+		float components[ 3 ];
+		if ( size != sizeof( components ) ) {
+			return false;
+		}
+
+		memcpy( components, data, sizeof( components ) );
+		value_ = PLVector3( components[ 0 ], components[ 1 ], components[ 2 ] );
+		MarkDirty();
+		return true;
+	}
+
+	void Pack( ohw::BitWriter& writer ) const override {
+		PackFloat( writer, value_.x );
+		PackFloat( writer, value_.y );
+		PackFloat( writer, value_.z );
+	}
+
+	void Unpack( ohw::BitReader& reader ) override {
+		value_.x = UnpackFloat( reader );
+		value_.y = UnpackFloat( reader );
+		value_.z = UnpackFloat( reader );
+		MarkDirty();
+	}
 };
 
 /**
@@ -378,8 +633,8 @@ private:
 	bool value_;
 
 public:
-		BooleanProperty(PropertyOwner &po, const std::string &name, unsigned flags, bool value = false):
-			Property(po, name, flags), value_(value) {}
+		BooleanProperty(PropertyOwner &po, PropertyTable &table, const char *name, unsigned flags, bool value = false):
+			Property(po, table, name, flags, PropertyType::BOOLEAN), value_(value) {}
 		
 		/* Implicit conversion for using as a (const) bool */
 		operator const bool&() const
@@ -394,38 +649,53 @@ public:
 		*/
 		const bool& operator=(const bool& value)
 		{
+			if(value_ == value)
+			{
+				return value;
+			}
+
 			value_ = value;
 			MarkDirty();
 			
 			return value;
 		}
-		
-		std::string Serialise() const override
+
+		void Pack(ohw::BitWriter &writer) const override
 		{
-			return value_
-				? "true"
-				: "false";
+			writer.WriteBool(value_);
 		}
 
-		std::string SerialiseAsJson() const override {
-		  return Serialise();
+		void Unpack(ohw::BitReader &reader) override
+		{
+			value_ = reader.ReadBool();
+			MarkDirty();
 		}
 		
-		void Deserialise(const std::string &serialised) override
+		size_t Serialise(void *buffer, size_t size) const override
 		{
-			if(serialised == "false")
+			if(size >= 1)
 			{
-				value_ = false;
-				MarkDirty();
+				*static_cast<uint8_t*>(buffer) = value_ ? 1 : 0;
 			}
-			else if(serialised == "true")
+
+			return 1;
+		}
+
+		std::string SerialiseAsJson() const override {
+		  return value_
+			  ? "true"
+			  : "false";
+		}
+		
+		bool Deserialise(const void *data, size_t size) override
+		{
+			if(size != 1 || *static_cast<const uint8_t*>(data) > 1)
 			{
-				value_ = true;
-				MarkDirty();
-			}
-			else{
-				/* TODO: Have a this-isn't-valid exception */
-				abort();
+				return false;
 			}
+
+			value_ = *static_cast<const uint8_t*>(data) != 0;
+			MarkDirty();
+			return true;
 		}
 };
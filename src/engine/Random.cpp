@@ -0,0 +1,43 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "App.h"
+#include "Random.h"
+
+uint64_t ohw::Random::state = 0;
+
+/**
+ * SplitMix64, which only needs the one 64-bit value carried between calls.
+ */
+uint32_t ohw::Random::Generate() {
+	uint64_t z = ( state += 0x9E3779B97F4A7C15ULL );
+	z = ( z ^ ( z >> 30 ) ) * 0xBF58476D1CE4E5B9ULL;
+	z = ( z ^ ( z >> 27 ) ) * 0x94D049BB133111EBULL;
+	return ( uint32_t ) ( ( z ^ ( z >> 31 ) ) >> 32 );
+}
+
+unsigned int ohw::Random::GenerateInt( unsigned int max ) {
+	if ( max == 0 ) {
+		return 0;
+	}
+
+	return ( unsigned int ) ( ( ( uint64_t ) Generate() * max ) >> 32 );
+}
+
+float ohw::Random::GenerateFloat( float max ) {
+	return ( float ) ( ( Generate() >> 8 ) * ( 1.0 / 16777216.0 ) ) * max;
+}
@@ -0,0 +1,41 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+namespace ohw {
+	/**
+	 * Everything random the simulation does comes out of here rather than
+	 * rand(), so the state can be saved off with a snapshot or recording and
+	 * the same numbers come out again when it's played back.
+	 */
+	class Random {
+	public:
+		PL_INLINE static void Seed( uint64_t seed ) { state = seed; }
+
+		PL_INLINE static uint64_t GetState() { return state; }
+		PL_INLINE static void SetState( uint64_t newState ) { state = newState; }
+
+		static uint32_t Generate();
+		/* from 0 up to, but not including, max */
+		static unsigned int GenerateInt( unsigned int max );
+		static float GenerateFloat( float max );
+
+	private:
+		static uint64_t state;
+	};
+}
@@ -15,9 +15,19 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <functional>
+
 #include "App.h"
 #include "ResourceManager.h"
 #include "ShaderManager.h"
+#include "MemoryTracker.h"
+#include "Metrics.h"
+
+#include "loaders/Loaders.h"
+#include "loaders/TimLoader.h"
+#include "loaders/ObjReader.h"
+#include "loaders/WaveFrontReader.h"
+#include "graphics/ImageKernels.h"
 
 ohw::ResourceManager::ResourceManager() {
 	// Allow users to enable support for all package formats if desired (disabled by default for security reasons)
@@ -28,18 +38,31 @@ ohw::ResourceManager::ResourceManager() {
 	plRegisterConsoleCommand( "ListCachedResources", &ResourceManager::ListCachedResources, "List all cached resources." );
 	plRegisterConsoleCommand( "ClearAllResources", &ResourceManager::ClearAllResourcesCommand, "Clears all cached resources." );
 	plRegisterConsoleCommand( "ClearResource", &ResourceManager::ClearResourceCommand, "Clears the specified resource." );
+	plRegisterConsoleCommand( "BenchmarkModelLoading", &ResourceManager::BenchmarkModelLoadingCommand,
+	                          "Times decoding every classic model file under a directory. [directory] [iterations]" );
+	plRegisterConsoleCommand( "BenchmarkObjParsing", &ResourceManager::BenchmarkObjParsingCommand,
+	                          "Compares the old and new Obj parsers, generating a 1M triangle Obj if none is given. [path]" );
+	plRegisterConsoleCommand( "TextureStats", &ResourceManager::TextureStatsCommand,
+	                          "Prints how long textures took to load and how much memory they're using. [reset]" );
+	plRegisterConsoleCommand( "CookTextures", &ResourceManager::CookTexturesCommand,
+	                          "Cooks every texture under a directory into the texture cache. [directory]" );
+	plRegisterConsoleCommand( "BenchmarkImageKernels", &ResourceManager::BenchmarkImageKernelsCommand,
+	                          "Times each image kernel on a 1024x1024 image for every supported instruction set. [iterations]" );
 }
 
 ohw::ResourceManager::~ResourceManager() {
 	ClearAllResources( true );
+	ClearPackages();
 }
 
 ohw::Resource *ohw::ResourceManager::GetCachedResource( const std::string& path ) {
 	auto idx = resourcesMap.find( path );
 	if ( idx != resourcesMap.end() ) {
+		METRIC_COUNTER( "resources.cache_hits" )->Add();
 		return idx->second;
 	}
 
+	METRIC_COUNTER( "resources.cache_misses" )->Add();
 	return nullptr;
 }
 
@@ -49,6 +72,8 @@ ohw::SharedTextureResourcePointer ohw::ResourceManager::LoadTexture( const std::
 		return texturePtr;
 	}
 
+	MemoryTagScope tagScope( MemoryTag::TEXTURES );
+
 	texturePtr = new TextureResource( path, flags, persist, abortOnFail );
 	CacheResource( path, texturePtr );
 
@@ -61,12 +86,72 @@ ohw::SharedModelResourcePointer ohw::ResourceManager::LoadModel( const std::stri
 		return modelPtr;
 	}
 
+	MemoryTagScope tagScope( MemoryTag::MODELS );
+
 	modelPtr = new ModelResource( path, persist, abortOnFail );
 	CacheResource( path, modelPtr );
 
 	return modelPtr;
 }
 
+/**
+ * Returns the given package, mapping it in if it hasn't been already.
+ */
+const PkgHandle *ohw::ResourceManager::GetPackage( const std::string &path ) {
+	auto idx = packagesMap.find( path );
+	if ( idx != packagesMap.end() ) {
+		return idx->second;
+	}
+
+	PkgHandle *package = Pkg_LoadFile( path.c_str() );
+	if ( package == nullptr ) {
+		return nullptr;
+	}
+
+	packagesMap.emplace( path, package );
+	return package;
+}
+
+/**
+ * Fetches a member from one of the original packages, e.g. "Chars/WEAPONS.MAD/bazooka.vtx",
+ * the returned data points straight into the mapped package. Returns null if the path
+ * doesn't point into a package.
+ */
+const PkgMember *ohw::ResourceManager::GetPackageMember( const std::string &path ) {
+	char packagePath[PL_SYSTEM_MAX_PATH];
+	const char *memberName;
+	if ( !Pkg_SplitPath( path.c_str(), packagePath, sizeof( packagePath ), &memberName ) ) {
+		return nullptr;
+	}
+
+	const PkgHandle *package = GetPackage( packagePath );
+	if ( package == nullptr ) {
+		return nullptr;
+	}
+
+	return Pkg_GetMember( package, memberName );
+}
+
+/**
+ * Decodes a Tim held in one of the original packages.
+ */
+PLImage *ohw::ResourceManager::LoadPackageImage( const std::string &path ) {
+	const PkgMember *member = GetPackageMember( path );
+	if ( member == nullptr ) {
+		return nullptr;
+	}
+
+	return Tim_LoadMemory( member->data, member->size, path.c_str() );
+}
+
+void ohw::ResourceManager::ClearPackages() {
+	for ( auto &i : packagesMap ) {
+		Pkg_DestroyHandle( i.second );
+	}
+
+	packagesMap.clear();
+}
+
 PLTexture *ohw::ResourceManager::GetFallbackTexture() {
 	if ( fallbackTexture != nullptr ) {
 		return fallbackTexture;
@@ -113,6 +198,7 @@ PLModel *ohw::ResourceManager::GetFallbackModel() {
 	// todo: kill this api, if we rebuild shader cache we'll die
 	plSetMeshShaderProgram( mesh, shaderProgram->GetInternalProgram() );
 	plUploadMesh( mesh );
+	METRIC_COUNTER( "render.mesh_uploads" )->Add();
 
 	return ( fallbackModel = plCreateBasicStaticModel( mesh ) );
 }
@@ -153,6 +239,11 @@ void ohw::ResourceManager::ClearAllResources( bool force ) {
 		delete i->second;
 		i = resourcesMap.erase( i );
 	}
+
+	// Nothing holds onto package data once it's been loaded
+	if ( force ) {
+		ClearPackages();
+	}
 }
 
 void ohw::ResourceManager::ListCachedResources( unsigned int argc, char** argv ) {
@@ -219,3 +310,346 @@ void ohw::ResourceManager::ClearResourceCommand( unsigned int argc, char **argv
 
 	GetApp()->resourceManager->ClearResource( resourceName, force );
 }
+
+/************************************************************/
+/* Model Loading Benchmark */
+
+enum BenchmarkFormat {
+	BENCHMARK_VTX,
+	BENCHMARK_FAC,
+	BENCHMARK_NO2,
+	BENCHMARK_HIR,
+
+	MAX_BENCHMARK_FORMATS
+};
+
+static const char *benchmarkExtensions[ MAX_BENCHMARK_FORMATS ] = { "vtx", "fac", "no2", "hir" };
+
+struct BenchmarkStats {
+	unsigned int numFiles{ 0 };
+	unsigned int numFailed{ 0 };
+	size_t numBytes{ 0 };
+};
+
+static int Benchmark_GetFormat( const char *path ) {
+	const char *extension = plGetFileExtension( path );
+	for ( int i = 0; i < MAX_BENCHMARK_FORMATS; ++i ) {
+		if ( pl_strcasecmp( extension, benchmarkExtensions[ i ] ) == 0 ) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+static bool Benchmark_Decode( int format, const uint8_t *data, size_t size, const char *name ) {
+	switch ( format ) {
+		case BENCHMARK_VTX: {
+			VtxHandle *handle = Vtx_LoadMemory( data, size, name );
+			Vtx_DestroyHandle( handle );
+			return ( handle != nullptr );
+		}
+		case BENCHMARK_FAC: {
+			FacHandle *handle = Fac_LoadMemory( data, size, name );
+			Fac_DestroyHandle( handle );
+			return ( handle != nullptr );
+		}
+		case BENCHMARK_NO2: {
+			No2Handle *handle = No2_LoadMemory( data, size, name );
+			if ( handle == nullptr ) {
+				return false;
+			}
+			No2_DestroyHandle( handle );
+			return true;
+		}
+		case BENCHMARK_HIR: {
+			HirHandle *handle = Hir_LoadMemory( data, size, name );
+			Hir_DestroyHandle( handle );
+			return ( handle != nullptr );
+		}
+		default:
+			return false;
+	}
+}
+
+static void Benchmark_AppendPath( const char *path, void *userData ) {
+	static_cast< std::vector< std::string > * >( userData )->push_back( path );
+}
+
+/**
+ * Loads every Vtx/Fac/No2/Hir under the given directory, both loose and
+ * inside MAD packages, and prints how long decoding took for each format.
+ */
+void ohw::ResourceManager::BenchmarkModelLoadingCommand( unsigned int argc, char **argv ) {
+	const char *directory = ( argc > 1 ) ? argv[ 1 ] : "chars";
+	unsigned int numIterations = ( argc > 2 ) ? strtoul( argv[ 2 ], nullptr, 10 ) : 10;
+	if ( numIterations == 0 ) {
+		numIterations = 1;
+	}
+
+	std::vector< std::string > paths;
+	for ( const char *extension : benchmarkExtensions ) {
+		plScanDirectory( directory, extension, Benchmark_AppendPath, true, &paths );
+	}
+	plScanDirectory( directory, "mad", Benchmark_AppendPath, true, &paths );
+
+	if ( paths.empty() ) {
+		Warning( "No models found under \"%s\"!\n", directory );
+		return;
+	}
+
+	BenchmarkStats stats[ MAX_BENCHMARK_FORMATS ];
+	double times[ MAX_BENCHMARK_FORMATS ] = { 0 };
+
+	Timer totalTimer;
+	for ( unsigned int i = 0; i < numIterations; ++i ) {
+		bool firstPass = ( i == 0 );
+		for ( const auto &path : paths ) {
+			int format = Benchmark_GetFormat( path.c_str() );
+			if ( format != -1 ) {
+				Timer timer;
+				MappedFile *file = Map_OpenFile( path.c_str() );
+				bool status = ( file != nullptr ) && Benchmark_Decode( format, file->data, file->size, path.c_str() );
+				timer.End();
+				times[ format ] += timer.GetTimeTaken();
+
+				if ( firstPass ) {
+					stats[ format ].numFiles++;
+					stats[ format ].numFailed += status ? 0 : 1;
+					stats[ format ].numBytes += ( file != nullptr ) ? file->size : 0;
+				}
+
+				Map_CloseFile( file );
+				continue;
+			}
+
+			// otherwise it's a package, so go through each of the members
+			PkgHandle *package = Pkg_LoadFile( path.c_str() );
+			if ( package == nullptr ) {
+				continue;
+			}
+
+			for ( unsigned int j = 0; j < package->num_members; ++j ) {
+				const PkgMember *member = &package->members[ j ];
+				format = Benchmark_GetFormat( member->name );
+				if ( format == -1 ) {
+					continue;
+				}
+
+				Timer timer;
+				bool status = Benchmark_Decode( format, member->data, member->size, member->name );
+				timer.End();
+				times[ format ] += timer.GetTimeTaken();
+
+				if ( firstPass ) {
+					stats[ format ].numFiles++;
+					stats[ format ].numFailed += status ? 0 : 1;
+					stats[ format ].numBytes += member->size;
+				}
+			}
+
+			Pkg_DestroyHandle( package );
+		}
+	}
+	totalTimer.End();
+
+	Print( "Model loading benchmark for \"%s\" (%u iterations)\n", directory, numIterations );
+	for ( int i = 0; i < MAX_BENCHMARK_FORMATS; ++i ) {
+		if ( stats[ i ].numFiles == 0 ) {
+			continue;
+		}
+
+		double averageMs = ( times[ i ] * 1000.0 ) / numIterations;
+		double megabytes = ( double ) stats[ i ].numBytes / ( 1024.0 * 1024.0 );
+		Print( " %s: %u files (%u failed), %.2fMB, %.3fms per pass, %.2fMB/s\n",
+		       benchmarkExtensions[ i ], stats[ i ].numFiles, stats[ i ].numFailed, megabytes,
+		       averageMs, ( times[ i ] > 0.0 ) ? ( megabytes * numIterations ) / times[ i ] : 0.0 );
+	}
+	Print( " total: %.3fms per pass\n", ( totalTimer.GetTimeTaken() * 1000.0 ) / numIterations );
+}
+
+/************************************************************/
+/* Obj Parsing Benchmark */
+
+/**
+ * Writes out a flat grid of quads, each split into two triangles once loaded.
+ */
+static bool Benchmark_GenerateObj( const char *path, unsigned int numQuadsPerRow ) {
+	FILE *fp = fopen( path, "w" );
+	if ( fp == nullptr ) {
+		Warning( "Failed to open \"%s\" for writing!\n", path );
+		return false;
+	}
+
+	unsigned int numPerRow = numQuadsPerRow + 1;
+	for ( unsigned int y = 0; y < numPerRow; ++y ) {
+		for ( unsigned int x = 0; x < numPerRow; ++x ) {
+			fprintf( fp, "v %f %f %f\n", x * 16.0f, ( float ) ( ( x * y ) % 17 ), y * -16.0f );
+		}
+	}
+	for ( unsigned int y = 0; y < numPerRow; ++y ) {
+		for ( unsigned int x = 0; x < numPerRow; ++x ) {
+			fprintf( fp, "vt %f %f\n", ( float ) x / numQuadsPerRow, ( float ) y / numQuadsPerRow );
+		}
+	}
+	fprintf( fp, "vn 0.000000 1.000000 0.000000\n" );
+	for ( unsigned int y = 0; y < numQuadsPerRow; ++y ) {
+		for ( unsigned int x = 0; x < numQuadsPerRow; ++x ) {
+			unsigned int a = y * numPerRow + x + 1;
+			unsigned int b = a + 1;
+			unsigned int c = b + numPerRow;
+			unsigned int d = a + numPerRow;
+			fprintf( fp, "f %u/%u/1 %u/%u/1 %u/%u/1 %u/%u/1\n", a, a, b, b, c, c, d, d );
+		}
+	}
+
+	fclose( fp );
+	return true;
+}
+
+void ohw::ResourceManager::BenchmarkObjParsingCommand( unsigned int argc, char **argv ) {
+	// 708 * 708 quads gives us just over 1M triangles
+	const char *path = ( argc > 1 ) ? argv[ 1 ] : "benchmark.obj";
+	if ( argc <= 1 && !plFileExists( path ) ) {
+		Print( "Generating \"%s\"...\n", path );
+		if ( !Benchmark_GenerateObj( path, 708 ) ) {
+			return;
+		}
+	}
+
+	Timer oldTimer;
+	WaveFrontReader oldReader;
+	bool oldStatus = oldReader.Load( path, true );
+	oldTimer.End();
+
+	Timer newTimer;
+	ObjReader newReader;
+	bool newStatus = newReader.Load( path, true );
+	newTimer.End();
+
+	Print( "Obj parsing benchmark for \"%s\"\n", path );
+	Print( " WaveFrontReader: %s, %u triangles, %u vertices, %.2fms\n", oldStatus ? "ok" : "failed",
+	       ( unsigned int ) oldReader.indices.size() / 3, ( unsigned int ) oldReader.vertices.size(),
+	       oldTimer.GetTimeTaken() * 1000.0 );
+	Print( " ObjReader:       %s, %u triangles, %u vertices, %.2fms\n", newStatus ? "ok" : "failed",
+	       ( unsigned int ) newReader.GetNumTriangles(), ( unsigned int ) newReader.GetNumVertices(),
+	       newTimer.GetTimeTaken() * 1000.0 );
+}
+
+/**
+ * Run with reset before loading a map and again once it's loaded to see
+ * what the map cost.
+ */
+void ohw::ResourceManager::TextureStatsCommand( unsigned int argc, char **argv ) {
+	TextureResource::LoadStats &loadStats = TextureResource::loadStats;
+	if ( argc > 1 && pl_strcasecmp( argv[ 1 ], "reset" ) == 0 ) {
+		loadStats = TextureResource::LoadStats();
+		Print( "Reset texture stats\n" );
+		return;
+	}
+
+	unsigned int numTextures = 0;
+	size_t totalSize = 0;
+	for ( const auto &i : GetApp()->resourceManager->resourcesMap ) {
+		auto *texture = dynamic_cast< TextureResource * >( i.second );
+		if ( texture == nullptr ) {
+			continue;
+		}
+
+		numTextures++;
+		totalSize += texture->GetTextureSize();
+	}
+
+	unsigned int numLoaded = loadStats.numCooked + loadStats.numCacheHits;
+	Print( "%u textures resident, %.2fMB\n", numTextures, totalSize / ( 1024.0 * 1024.0 ) );
+	Print( "%u loaded (%u cooked, %u from cache) in %.2fms, %.3fms per texture\n",
+	       numLoaded, loadStats.numCooked, loadStats.numCacheHits, loadStats.loadTime * 1000.0,
+	       loadStats.loadTime * 1000.0 / std::max( numLoaded, 1U ) );
+}
+
+/**
+ * Cooks textures ahead of time, so the first run doesn't have to. These are
+ * cooked with the default flags, anything loaded with others will still
+ * get cooked on first use.
+ */
+void ohw::ResourceManager::CookTexturesCommand( unsigned int argc, char **argv ) {
+	const char *directory = ( argc > 1 ) ? argv[ 1 ] : ".";
+
+	std::vector< std::string > paths;
+	for ( unsigned int i = 0; supportedTextureFormats[ i ] != nullptr; ++i ) {
+		plScanDirectory( directory, supportedTextureFormats[ i ], Benchmark_AppendPath, true, &paths );
+	}
+
+	if ( paths.empty() ) {
+		Warning( "No textures found under \"%s\"!\n", directory );
+		return;
+	}
+
+	unsigned int numCooked = 0;
+	Timer timer;
+	for ( const auto &path : paths ) {
+		if ( TextureResource::CookFile( path ) ) {
+			numCooked++;
+		}
+	}
+	timer.End();
+
+	Print( "Cooked %u of %u textures in %.2fs\n", numCooked, ( unsigned int ) paths.size(), timer.GetTimeTaken() );
+}
+
+/**
+ * Runs every kernel over the same image with each instruction set the CPU
+ * supports, so they can be compared against the scalar versions.
+ */
+void ohw::ResourceManager::BenchmarkImageKernelsCommand( unsigned int argc, char **argv ) {
+	unsigned int numIterations = ( argc > 1 ) ? strtoul( argv[ 1 ], nullptr, 10 ) : 50;
+	if ( numIterations == 0 ) {
+		numIterations = 1;
+	}
+
+	static const size_t numPixels = 1024 * 1024;
+	std::vector< uint8_t > src( numPixels * 4 ), dst( numPixels * 4 );
+	std::vector< float > floatDst( numPixels );
+	for ( auto &i : src ) {
+		i = static_cast< uint8_t >( rand() );
+	}
+
+	static const uint8_t key[ 4 ] = { 255, 0, 255, 255 }, transparent[ 4 ] = { 0, 0, 0, 0 };
+
+	struct Kernel {
+		const char *name;
+		std::function< void() > run;
+	};
+	Kernel kernels[] = {
+		{ "RGB5A1 to RGBA8", [ & ]() { Img_ConvertRGB5A1ToRGBA8( src.data(), dst.data(), numPixels ); } },
+		{ "RGB8 to RGBA8", [ & ]() { Img_ConvertRGB8ToRGBA8( src.data(), dst.data(), numPixels ); } },
+		{ "Colour key", [ & ]() { Img_ReplaceColour( dst.data(), numPixels, key, transparent ); } },
+		{ "Extract channel", [ & ]() { Img_ExtractChannel( src.data(), numPixels, 1, dst.data() ); } },
+		{ "Extract channel (float)", [ & ]() { Img_ExtractChannelF( src.data(), numPixels, 0, 2.0f, floatDst.data() ); } },
+		{ "Fill", [ & ]() { Img_FillPixel( dst.data(), key, numPixels ); } },
+		{ "Blit", [ & ]() { Img_Blit( dst.data(), 1024 * 4, src.data(), 1024 * 4, 1000 * 4, 1024 ); } },
+	};
+
+	ImgKernelLevel bestLevel = Img_GetKernelLevel();
+	Print( "Image kernel benchmark, %u iterations, using %s by default\n", numIterations, Img_GetKernelLevelName( bestLevel ) );
+	for ( const auto &kernel : kernels ) {
+		Print( " %s\n", kernel.name );
+		for ( unsigned int level = 0; level < IMG_MAX_KERNEL_LEVELS; ++level ) {
+			if ( !Img_SetKernelLevel( ( ImgKernelLevel ) level ) ) {
+				continue;
+			}
+
+			Timer timer;
+			for ( unsigned int i = 0; i < numIterations; ++i ) {
+				kernel.run();
+			}
+			timer.End();
+
+			double seconds = std::max( timer.GetTimeTaken(), 0.000001 );
+			Print( "  %-6s %8.1f Mpx/s\n", Img_GetKernelLevelName( ( ImgKernelLevel ) level ),
+			       ( numPixels * numIterations ) / seconds / 1000000.0 );
+		}
+	}
+
+	Img_SetKernelLevel( bestLevel );
+}
@@ -20,6 +20,8 @@
 #include "ModelResource.h"
 #include "TextureResource.h"
 
+#include "loaders/PkgLoader.h"
+
 namespace ohw {
 	class ResourceManager {
 	private:
@@ -36,10 +38,21 @@ namespace ohw {
 		PLTexture *GetFallbackTexture();
 		PLModel *GetFallbackModel();
 
+		// Original packages, mapped on first use
+		const PkgHandle *GetPackage( const std::string &path );
+		const PkgMember *GetPackageMember( const std::string &path );
+		PLImage *LoadPackageImage( const std::string &path );
+		void ClearPackages();
+
 	private:
 		static void ListCachedResources( unsigned int argc, char **argv );
 		static void ClearAllResourcesCommand( unsigned int argc, char **argv );
 		static void ClearResourceCommand( unsigned int argc, char **argv );
+		static void BenchmarkModelLoadingCommand( unsigned int argc, char **argv );
+		static void BenchmarkObjParsingCommand( unsigned int argc, char **argv );
+		static void TextureStatsCommand( unsigned int argc, char **argv );
+		static void CookTexturesCommand( unsigned int argc, char **argv );
+		static void BenchmarkImageKernelsCommand( unsigned int argc, char **argv );
 
 		PLTexture *fallbackTexture{ nullptr };
 		PLModel *fallbackModel{ nullptr };
@@ -52,6 +65,7 @@ namespace ohw {
 		}
 
 		std::map< std::string, Resource* > resourcesMap;
+		std::map< std::string, PkgHandle* > packagesMap;
 
 		friend class App;
 	};
@@ -17,11 +17,21 @@
 
 #include "App.h"
 #include "Terrain.h"
+#include "JobSystem.h"
+#include "MemoryArena.h"
+#include "MemoryTracker.h"
+#include "Metrics.h"
+#include "LoadTracer.h"
 
 #include "graphics/mesh.h"
 #include "graphics/ShaderManager.h"
 #include "graphics/TextureAtlas.h"
 #include "graphics/Camera.h"
+#include "graphics/ImageKernels.h"
+#include "graphics/Visibility.h"
+
+#include "loaders/MappedFile.h"
+#include "loaders/BinaryReader.h"
 
 //Precalculated vertices for chunk rendering
 //TODO: Share one index buffer instance between all chunks
@@ -44,19 +54,135 @@ const static unsigned int chunk_indices[96] = {
 		60, 62, 61, 61, 62, 63,
 };
 
+/* Legacy Terrain (.pmg)
+ *
+ * 256 chunks, each with its own 5x5 grid of vertices, so the edges are
+ * stored twice over. */
+
+typedef struct __attribute__((packed)) PmgTile {
+	int8_t unused0[6];
+	uint8_t type;
+	uint8_t slip;
+	int16_t unused1;
+	uint8_t rotation;
+	uint32_t texture;
+	uint8_t unused2;
+} PmgTile;
+static_assert( sizeof( PmgTile ) == 16, "invalid struct size" );
+
+typedef struct __attribute__((packed)) PmgChunk {
+	int16_t x, y, z;
+	int16_t unknown0;
+	struct __attribute__((packed)) {
+		int16_t height;
+		uint16_t lighting;
+	} vertices[25];
+	int8_t unknown1[4];
+	PmgTile tiles[TERRAIN_CHUNK_TILES];
+} PmgChunk;
+static_assert( sizeof( PmgChunk ) == 368, "invalid struct size" );
+
+/* Terrain (.oht)
+ *
+ * Laid out the way it's used, so loading it is just a case of mapping it
+ * and copying it out. The grids are TERRAIN_GRID_WIDTH squared, and the
+ * tiles are stored per chunk in the same order as in memory.
+ *
+ * header
+ * heights      int16 grid, shared between neighbouring tiles
+ * chunks       chunk descriptors, including the precomputed bounds
+ * shading      uint8 grid
+ * types        uint8 per tile, surface and behaviour as in the pmg
+ * rotations    uint8 per tile
+ * slips        uint8 per tile
+ * textures     uint8 per tile */
+
+#define OHT_IDENTIFIER  "OHWT"
+#define OHT_VERSION     1
+
+typedef struct __attribute__((packed)) OhtHeader {
+	char identifier[4];
+	uint32_t version;
+	uint32_t grid_width;
+	uint32_t num_chunks;
+	uint32_t num_tiles;
+	float min_height;
+	float max_height;
+	uint32_t reserved;
+} OhtHeader;
+
+typedef struct __attribute__((packed)) OhtChunk {
+	int16_t x, y, z;                /* carried over from the pmg */
+	int16_t min_height;
+	int16_t max_height;
+} OhtChunk;
+
+static int16_t ClampHeight( float height ) {
+	return static_cast< int16_t >( std::max( std::min( std::round( height ), ( float ) INT16_MAX ), ( float ) INT16_MIN ) );
+}
+
+/**
+ * Writes out to a temporary file first and then moves it into place,
+ * so we never leave half a map behind.
+ */
+static bool WriteTerrainFile( const std::string &path, const std::vector< uint8_t > &buffer ) {
+	std::string tmpPath = path + ".tmp";
+	FILE *fp = fopen( tmpPath.c_str(), "wb" );
+	if ( fp == nullptr ) {
+		Warning( "Failed to open \"%s\" for writing!\n", tmpPath.c_str() );
+		return false;
+	}
+
+	bool status = ( fwrite( buffer.data(), 1, buffer.size(), fp ) == buffer.size() );
+	status &= ( fclose( fp ) == 0 );
+	if ( !status ) {
+		Warning( "Failed to write terrain to \"%s\"!\n", tmpPath.c_str() );
+		remove( tmpPath.c_str() );
+		return false;
+	}
+
+	remove( path.c_str() );
+	if ( rename( tmpPath.c_str(), path.c_str() ) != 0 ) {
+		Warning( "Failed to move terrain into place at \"%s\"!\n", path.c_str() );
+		remove( tmpPath.c_str() );
+		return false;
+	}
+
+	return true;
+}
+
+ohw::Terrain::Terrain() {
+	chunks_.resize( TERRAIN_CHUNKS );
+}
+
 ohw::Terrain::Terrain( const std::string &tileset ) {
+	MemoryTagScope tagScope( MemoryTag::TERRAIN );
+
 	// attempt to load in the atlas sheet
 	// TODO: allow us to change this on the fly
 	textureAtlas = new ohw::TextureAtlas( 512, 8 );
-	for ( unsigned int i = 0; i < 256; ++i ) {
-		if ( !textureAtlas->AddImage( tileset + std::to_string( i ) ) ) {
-			break;
+	{
+		LoadPhaseScope phase( "tiles" );
+		for ( unsigned int i = 0; i < 256; ++i ) {
+			if ( !textureAtlas->AddImage( tileset + std::to_string( i ) ) ) {
+				break;
+			}
+			LoadTracer::GetInstance()->Redraw();
 		}
 	}
-	textureAtlas->Finalize();
+	{
+		LoadPhaseScope phase( "atlas" );
+		textureAtlas->Finalize();
+	}
+
+	// Tiles refer to textures by number, so sort out which slot each one is in now
+	for ( unsigned int i = 0; i < 256; ++i ) {
+		textureSlots_[ i ] = textureAtlas->GetSlot( std::to_string( i ) );
+	}
 
 	chunks_.resize( TERRAIN_CHUNKS );
 
+	LoadPhaseScope phase( "mesh" );
 	Update();
 }
 
@@ -64,7 +190,12 @@ ohw::Terrain::~Terrain() {
 	delete textureAtlas;
 
 	for ( auto &chunk : chunks_ ) {
-		plDestroyMesh( chunk.solidMesh );
+		if ( chunk.solidMesh != nullptr ) {
+			plDestroyMesh( chunk.solidMesh );
+		}
+		if ( chunk.waterMesh != nullptr ) {
+			plDestroyMesh( chunk.waterMesh );
+		}
 	}
 }
 
@@ -120,7 +251,7 @@ float ohw::Terrain::GetHeight( float x, float y ) {
 	return nz;
 }
 
-void ohw::Terrain::GenerateChunkMesh( Chunk *chunk, const PLVector2 &offset ) {
+void ohw::Terrain::CreateChunkMeshes( Chunk *chunk ) {
 	// We will need to generate the mesh for the cunk again if the terrain is modified
 	if ( chunk->solidMesh != nullptr ) {
 		plDestroyMesh( chunk->solidMesh );
@@ -139,48 +270,23 @@ void ohw::Terrain::GenerateChunkMesh( Chunk *chunk, const PLVector2 &offset ) {
 	if ( chunk->waterMesh == nullptr ) {
 		Error( "Unable to create water chunk mesh, aborting!\nPL: %s\n", plGetError() );
 	}
+}
 
+/**
+ * Fills in the meshes already created for the chunk. Doesn't touch anything
+ * outside of it, so it's safe to run on any thread. Returns the number of
+ * water vertices written.
+ */
+unsigned int ohw::Terrain::GenerateChunkMesh( Chunk *chunk, const PLVector2 &offset ) {
 	int cm_idx = 0;
 	unsigned int numWaterTiles = 0;
 	for ( unsigned int tile_y = 0; tile_y < TERRAIN_CHUNK_ROW_TILES; ++tile_y ) {
 		for ( unsigned int tile_x = 0; tile_x < TERRAIN_CHUNK_ROW_TILES; ++tile_x ) {
 			const Tile *current_tile = &chunk->tiles[ tile_x + tile_y * TERRAIN_CHUNK_ROW_TILES ];
 
-			float tx_x, tx_y, tx_w, tx_h;
-			textureAtlas->GetTextureCoords( std::to_string( current_tile->texture ), &tx_x, &tx_y, &tx_w, &tx_h );
-
-			// TERRAIN_FLIP_FLAG_X flips around texture sheet coords, not TERRAIN coords.
-			if ( current_tile->rotation & Tile::ROTATION_FLAG_X ) {
-				tx_x = tx_x + tx_w;
-				tx_w = -tx_w;
-			}
-
-			// ST coords for each corner of the tile.
-			float tx_Ax[] = { tx_x, tx_x + tx_w, tx_x, tx_x + tx_w };
-			float tx_Ay[] = { tx_y, tx_y, tx_y + tx_h, tx_y + tx_h };
-
-			// Rotate a quad of ST coords 90 degrees clockwise.
-			auto rot90 = []( float *x ) {
-				float c = x[ 0 ];
-				x[ 0 ] = x[ 2 ];
-				x[ 2 ] = x[ 3 ];
-				x[ 3 ] = x[ 1 ];
-				x[ 1 ] = c;
-			};
-
-			if ( current_tile->rotation & Tile::ROTATION_FLAG_ROTATE_90 ) {
-				rot90( tx_Ax );
-				rot90( tx_Ay );
-			}
-
-			if ( current_tile->rotation & Tile::ROTATION_FLAG_ROTATE_180 ) {
-				rot90( tx_Ax );
-				rot90( tx_Ay );
-				rot90( tx_Ax );
-				rot90( tx_Ay );
-			}
-
-			// MAP_FLIP_FLAG_ROTATE_270 is implemented by ORing 90 and 180 together.
+			// Rotation flags line up with the atlas variants, 270 being 90 and 180 ORed together
+			const TextureAtlas::SlotCoords &coords =
+					textureAtlas->GetSlotCoords( textureSlots_[ current_tile->texture ], current_tile->rotation );
 
 			for ( int i = 0; i < 4; ++i, ++cm_idx ) {
 				float x = ( offset.x * TERRAIN_CHUNK_PIXEL_WIDTH ) + ( tile_x + ( i % 2 ) ) * TERRAIN_TILE_PIXEL_WIDTH;
@@ -191,23 +297,20 @@ void ohw::Terrain::GenerateChunkMesh( Chunk *chunk, const PLVector2 &offset ) {
 
 				plSetMeshVertexPosition( chunk->solidMesh, cm_idx, position );
 				plSetMeshVertexColour( chunk->solidMesh, cm_idx, shadedColour );
-				plSetMeshVertexST( chunk->solidMesh, cm_idx, tx_Ax[ i ], tx_Ay[ i ] );
+				plSetMeshVertexST( chunk->solidMesh, cm_idx, coords.s[ i ], coords.t[ i ] );
 
 				if ( current_tile->behaviour == Tile::BEHAVIOUR_WATERY ) {
 					shadedColour.a = 145;
 					plSetMeshVertexPosition( chunk->waterMesh, cm_idx, position );
 					plSetMeshVertexColour( chunk->waterMesh, cm_idx, shadedColour );
-					plSetMeshVertexST( chunk->waterMesh, cm_idx, tx_Ax[ i ], tx_Ay[ i ] );
+					plSetMeshVertexST( chunk->waterMesh, cm_idx, coords.s[ i ], coords.t[ i ] );
 					numWaterTiles++;
 				}
 			}
 		}
 	}
 
-	if ( numWaterTiles == 0 ) {
-		plDestroyMesh( chunk->waterMesh );
-		chunk->waterMesh = nullptr;
-	}
+	return numWaterTiles;
 }
 
 void ohw::Terrain::GenerateOverview() {
@@ -276,17 +379,41 @@ void ohw::Terrain::GenerateOverview() {
 	plDestroyImage( image );
 }
 
-void ohw::Terrain::Update() {
-	GenerateOverview();
+void ohw::Terrain::GenerateMeshes() {
+	// Creating and destroying meshes may call into GL, so that stays here
+	for ( auto &chunk : chunks_ ) {
+		CreateChunkMeshes( &chunk );
+	}
 
-	for ( unsigned int chunk_y = 0; chunk_y < TERRAIN_CHUNK_ROW; ++chunk_y ) {
-		for ( unsigned int chunk_x = 0; chunk_x < TERRAIN_CHUNK_ROW; ++chunk_x ) {
-			GenerateChunkMesh( &chunks_[ chunk_x + chunk_y * TERRAIN_CHUNK_ROW ],
-			                   { static_cast<float>(chunk_x), static_cast<float>(chunk_y) } );
+	// Filling them in is where the time goes, and every chunk can be done at once
+	unsigned int numWaterTiles[ TERRAIN_CHUNKS ];
+	JobSystem::GetInstance()->ParallelFor( TERRAIN_CHUNKS, [ this, &numWaterTiles ]( unsigned int i ) {
+		numWaterTiles[ i ] = GenerateChunkMesh( &chunks_[ i ], {
+				static_cast<float>(i % TERRAIN_CHUNK_ROW), static_cast<float>(i / TERRAIN_CHUNK_ROW) } );
+	} );
+
+	for ( unsigned int i = 0; i < TERRAIN_CHUNKS; ++i ) {
+		if ( numWaterTiles[ i ] == 0 ) {
+			plDestroyMesh( chunks_[ i ].waterMesh );
+			chunks_[ i ].waterMesh = nullptr;
 		}
 	}
+}
+
+void ohw::Terrain::Update() {
+	MemoryTagScope tagScope( MemoryTag::TERRAIN );
+
+	// Nothing to draw it with
+	if ( textureAtlas == nullptr ) {
+		return;
+	}
+
+	GenerateOverview();
+	GenerateMeshes();
 
-	std::list< PLMesh * > meshes;
+	MemoryArenaScope scope;
+	ArenaVector< PLMesh * > meshes( ( ArenaAllocator< PLMesh * >( scope.GetArena() ) ) );
+	meshes.reserve( chunks_.size() * 2 );
 	for ( auto &chunk : chunks_ ) {
 		if ( chunk.solidMesh != nullptr ) {
 			meshes.push_back( chunk.solidMesh );
@@ -297,13 +424,15 @@ void ohw::Terrain::Update() {
 	}
 
 	if ( !meshes.empty() ) {
-		Mesh_GenerateFragmentedMeshNormals( meshes );
+		Mesh_GenerateFragmentedMeshNormals( meshes.data(), meshes.size() );
 	}
 }
 
 void ohw::Terrain::Draw() {
-	ohw::Camera *cameraPtr = GetApp()->gameManager->GetActiveCamera();
-	if ( cameraPtr == nullptr ) {
+	// Culling has already been done by this point
+	Visibility *visibility = Visibility::GetInstance();
+	const std::vector< unsigned int > &visibleChunks = visibility->GetVisibleChunks();
+	if ( visibleChunks.empty() ) {
 		return;
 	}
 
@@ -326,13 +455,17 @@ void ohw::Terrain::Draw() {
 
 		plSetBlendMode( PL_BLEND_DISABLE );
 
-		for ( const auto &chunk : chunks_ ) {
-			if ( ( cv_graphics_cull->b_value && !cameraPtr->IsBoxVisible( &chunk.bounds ) ) || chunk.solidMesh == nullptr ) {
+		for ( unsigned int i : visibleChunks ) {
+			const Chunk &chunk = chunks_[ i ];
+			if ( chunk.solidMesh == nullptr ) {
 				continue;
 			}
 
 			plUploadMesh( chunk.solidMesh );
+			METRIC_COUNTER( "render.mesh_uploads" )->Add();
 			plDrawMesh( chunk.solidMesh );
+			METRIC_COUNTER( "render.draw_calls" )->Add();
+			visibility->AddDrawn( 1 );
 		}
 	}
 
@@ -345,25 +478,25 @@ void ohw::Terrain::Draw() {
 
 			plSetBlendMode( PL_BLEND_DEFAULT );
 
-			for ( const auto &chunk : chunks_ ) {
-				if ( ( cv_graphics_cull->b_value && !cameraPtr->IsBoxVisible( &chunk.bounds ) ) || chunk.waterMesh == nullptr ) {
+			for ( unsigned int i : visibleChunks ) {
+				const Chunk &chunk = chunks_[ i ];
+				if ( chunk.waterMesh == nullptr ) {
 					continue;
 				}
 
 				plUploadMesh( chunk.waterMesh );
+				METRIC_COUNTER( "render.mesh_uploads" )->Add();
 				plDrawMesh( chunk.waterMesh );
+				METRIC_COUNTER( "render.draw_calls" )->Add();
+				visibility->AddDrawn( 1 );
 			}
 		}
 
 		if ( cv_debug_bounds->b_value ) {
 			Shaders_SetProgramByName( "generic_untextured" );
 
-			for ( const auto &chunk : chunks_ ) {
-				if ( ( cv_graphics_cull->b_value && !cameraPtr->IsBoxVisible( &chunk.bounds ) ) ) {
-					continue;
-				}
-
-				plDrawBoundingVolume( &chunk.bounds, PL_COLOUR_ORANGE );
+			for ( unsigned int i : visibleChunks ) {
+				plDrawBoundingVolume( &chunks_[ i ].bounds, PL_COLOUR_ORANGE );
 			}
 		}
 	}
@@ -375,54 +508,57 @@ void ohw::Terrain::Draw() {
 	plPopMatrix();
 }
 
-void ohw::Terrain::LoadPmg( const std::string &path ) {
-	PLFile *fh = plOpenFile( path.c_str(), false );
+void ohw::Terrain::SetupChunkBounds( Chunk *chunk, unsigned int chunk_x, unsigned int chunk_y, float minHeight, float maxHeight ) {
+	chunk->bounds.origin = PLVector3( chunk_x * TERRAIN_CHUNK_PIXEL_WIDTH, 0.0f, chunk_y * TERRAIN_CHUNK_PIXEL_WIDTH );
+	chunk->bounds.maxs.z = chunk->bounds.maxs.x = TERRAIN_CHUNK_PIXEL_WIDTH;
+	chunk->bounds.mins.z = chunk->bounds.mins.x = -TERRAIN_CHUNK_PIXEL_WIDTH;
+	chunk->bounds.maxs.y = maxHeight;
+	chunk->bounds.mins.y = minHeight;
+}
+
+bool ohw::Terrain::LoadPmg( const std::string &path ) {
+	MemoryTagScope tagScope( MemoryTag::TERRAIN );
+
+	MappedFile *fh = Map_OpenFile( path.c_str() );
 	if ( fh == nullptr ) {
 		Warning( "Failed to open tile data, \"%s\", aborting\n", path.c_str() );
-		return;
+		return false;
+	}
+
+	BinReader reader;
+	Bin_InitReader( &reader, fh->data, fh->size );
+
+	// every chunk is a fixed size, so just grab all of them at once
+	const uint8_t *chunks = Bin_ReadView( &reader, sizeof( PmgChunk ), TERRAIN_CHUNKS );
+	if ( chunks == nullptr ) {
+		Error( "Failed to read in chunk descriptors in \"%s\" (%u bytes, expected %u)!\n",
+		       path.c_str(), ( unsigned int ) fh->size, ( unsigned int ) ( sizeof( PmgChunk ) * TERRAIN_CHUNKS ) );
 	}
 
 	for ( unsigned int chunk_y = 0; chunk_y < TERRAIN_CHUNK_ROW; ++chunk_y ) {
 		for ( unsigned int chunk_x = 0; chunk_x < TERRAIN_CHUNK_ROW; ++chunk_x ) {
-			Chunk &chunk = chunks_[ chunk_x + chunk_y * TERRAIN_CHUNK_ROW ];
+			unsigned int chunkIndex = chunk_x + chunk_y * TERRAIN_CHUNK_ROW;
+			Chunk &chunk = chunks_[ chunkIndex ];
 
-			bool status;
-			chunk.x = plReadInt16( fh, false, &status );
-			chunk.y = plReadInt16( fh, false, &status );
-			chunk.z = plReadInt16( fh, false, &status );
-			/* int16_t unknown0 = */
-			plReadInt16( fh, false, &status );
+			PmgChunk pmgChunk;
+			memcpy( &pmgChunk, chunks + ( chunkIndex * sizeof( PmgChunk ) ), sizeof( PmgChunk ) );
 
-			if ( !status ) {
-				Error( "Failed to read in chunk descriptor in \"%s\"!\n", plGetFilePath( fh ) );
-			}
+			chunk.x = pmgChunk.x;
+			chunk.y = pmgChunk.y;
+			chunk.z = pmgChunk.z;
 
-			chunk.bounds.origin = PLVector3( chunk_x * TERRAIN_CHUNK_PIXEL_WIDTH, 0.0f, chunk_y * TERRAIN_CHUNK_PIXEL_WIDTH );
-			chunk.bounds.maxs.z = chunk.bounds.maxs.x = TERRAIN_CHUNK_PIXEL_WIDTH;
-			chunk.bounds.mins.z = chunk.bounds.mins.x = -TERRAIN_CHUNK_PIXEL_WIDTH;
-
-			struct {
-				int16_t height{ 0 };
-				uint16_t lighting{ 0 };
-			} vertices[25];
+			const auto &vertices = pmgChunk.vertices;
 
 			// Find the maximum and minimum points
-			chunk.bounds.maxs.y = INT16_MIN;
-			chunk.bounds.mins.y = INT16_MAX;
-			for ( auto &vertex : vertices ) {
-				vertex.height = plReadInt16( fh, false, &status );
-				vertex.lighting = plReadInt16( fh, false, &status );
-
-				if ( !status ) {
-					Error( "Failed to read in vertex descriptor in \"%s\"!\n", plGetFilePath( fh ) );
-				}
-
+			float chunkMaxHeight = INT16_MIN;
+			float chunkMinHeight = INT16_MAX;
+			for ( const auto &vertex : vertices ) {
 				// Determine the maximum height and minimum height for this chunk
-				if ( vertex.height > chunk.bounds.maxs.y ) {
-					chunk.bounds.maxs.y = vertex.height;
+				if ( vertex.height > chunkMaxHeight ) {
+					chunkMaxHeight = vertex.height;
 				}
-				if ( vertex.height < chunk.bounds.mins.y ) {
-					chunk.bounds.mins.y = vertex.height;
+				if ( vertex.height < chunkMinHeight ) {
+					chunkMinHeight = vertex.height;
 				}
 				// And now for the entire terrain
 				if ( static_cast<float>(vertex.height) > max_height_ ) {
@@ -433,41 +569,17 @@ void ohw::Terrain::LoadPmg( const std::string &path ) {
 				}
 			}
 
-			plFileSeek( fh, 4, PL_SEEK_CUR );
+			SetupChunkBounds( &chunk, chunk_x, chunk_y, chunkMinHeight, chunkMaxHeight );
 
 			for ( unsigned int tile_y = 0; tile_y < TERRAIN_CHUNK_ROW_TILES; ++tile_y ) {
 				for ( unsigned int tile_x = 0; tile_x < TERRAIN_CHUNK_ROW_TILES; ++tile_x ) {
-					struct {
-						int8_t unused0[6]{ 0, 0, 0, 0, 0, 0 };
-						uint8_t type{ 0 };
-						uint8_t slip{ 0 };
-						int16_t unused1{ 0 };
-						uint8_t rotation{ 0 };
-						uint32_t texture{ 0 };
-						uint8_t unused2{ 0 };
-					} tile;
-
-					// Skip unused data
-					if ( plReadFile( fh, tile.unused0, 6, 1 ) != 1 ) {
-						Error( "Failed to skip unused bytes in \"%s\"!\n", plGetFilePath( fh ) );
-					}
-
-					tile.type = plReadInt8( fh, &status );
-					tile.slip = plReadInt8( fh, &status );
-					tile.unused1 = plReadInt16( fh, false, &status );
-					tile.rotation = plReadInt8( fh, &status );
-					tile.texture = plReadInt32( fh, false, &status );
-					tile.unused2 = plReadInt8( fh, &status );
-
-					if ( !status ) {
-						Error( "Failed to read in tile descriptor in \"%s\"!\n", plGetFilePath( fh ) );
-					}
+					const PmgTile &tile = pmgChunk.tiles[ tile_x + tile_y * TERRAIN_CHUNK_ROW_TILES ];
 
 					Tile *current_tile = &chunk.tiles[ tile_x + tile_y * TERRAIN_CHUNK_ROW_TILES ];
 					current_tile->surface = static_cast<Tile::Surface>(tile.type & 31U);
 					current_tile->behaviour = static_cast<Tile::Behaviour>(tile.type & ~31U);
 					current_tile->rotation = static_cast<Tile::Rotation>(tile.rotation);
-					current_tile->slip = 0;
+					current_tile->slip = tile.slip;
 					current_tile->texture = tile.texture;
 
 					current_tile->height[ 0 ] = vertices[ ( tile_y * 5 ) + tile_x ].height;
@@ -484,9 +596,237 @@ void ohw::Terrain::LoadPmg( const std::string &path ) {
 		}
 	}
 
-	plCloseFile( fh );
+	Map_CloseFile( fh );
 
 	Update();
+
+	return true;
+}
+
+/**
+ * Loads terrain in our own format. Unlike the pmg, it's fine for this
+ * not to exist, so nothing is printed in that case.
+ */
+bool ohw::Terrain::LoadOht( const std::string &path ) {
+	MemoryTagScope tagScope( MemoryTag::TERRAIN );
+
+	MappedFile *fh = Map_OpenFile( path.c_str() );
+	if ( fh == nullptr ) {
+		return false;
+	}
+
+	BinReader reader;
+	Bin_InitReader( &reader, fh->data, fh->size );
+
+	OhtHeader header;
+	if ( !Bin_ReadArray( &reader, &header, sizeof( OhtHeader ), 1 ) ||
+	     memcmp( header.identifier, OHT_IDENTIFIER, sizeof( header.identifier ) ) != 0 ||
+	     header.version != OHT_VERSION ||
+	     header.grid_width != TERRAIN_GRID_WIDTH || header.num_chunks != TERRAIN_CHUNKS || header.num_tiles != TERRAIN_TILES ) {
+		Warning( "Invalid terrain, \"%s\"!\n", path.c_str() );
+		Map_CloseFile( fh );
+		return false;
+	}
+
+	const uint8_t *heights = Bin_ReadView( &reader, sizeof( int16_t ), TERRAIN_GRID_WIDTH * TERRAIN_GRID_WIDTH );
+	const uint8_t *chunks = Bin_ReadView( &reader, sizeof( OhtChunk ), TERRAIN_CHUNKS );
+	const uint8_t *shading = Bin_ReadView( &reader, sizeof( uint8_t ), TERRAIN_GRID_WIDTH * TERRAIN_GRID_WIDTH );
+	const uint8_t *types = Bin_ReadView( &reader, sizeof( uint8_t ), TERRAIN_TILES );
+	const uint8_t *rotations = Bin_ReadView( &reader, sizeof( uint8_t ), TERRAIN_TILES );
+	const uint8_t *slips = Bin_ReadView( &reader, sizeof( uint8_t ), TERRAIN_TILES );
+	const uint8_t *textures = Bin_ReadView( &reader, sizeof( uint8_t ), TERRAIN_TILES );
+	if ( reader.overflow ) {
+		Warning( "Truncated terrain, \"%s\"!\n", path.c_str() );
+		Map_CloseFile( fh );
+		return false;
+	}
+
+	// The view isn't aligned, so take a copy before we start reading from it
+	int16_t heightGrid[ TERRAIN_GRID_WIDTH * TERRAIN_GRID_WIDTH ];
+	memcpy( heightGrid, heights, sizeof( heightGrid ) );
+
+	for ( unsigned int chunk_y = 0; chunk_y < TERRAIN_CHUNK_ROW; ++chunk_y ) {
+		for ( unsigned int chunk_x = 0; chunk_x < TERRAIN_CHUNK_ROW; ++chunk_x ) {
+			unsigned int chunkIndex = chunk_x + chunk_y * TERRAIN_CHUNK_ROW;
+			Chunk &chunk = chunks_[ chunkIndex ];
+
+			OhtChunk ohtChunk;
+			memcpy( &ohtChunk, chunks + ( chunkIndex * sizeof( OhtChunk ) ), sizeof( OhtChunk ) );
+
+			chunk.x = ohtChunk.x;
+			chunk.y = ohtChunk.y;
+			chunk.z = ohtChunk.z;
+
+			SetupChunkBounds( &chunk, chunk_x, chunk_y, ohtChunk.min_height, ohtChunk.max_height );
+
+			for ( unsigned int tile_y = 0; tile_y < TERRAIN_CHUNK_ROW_TILES; ++tile_y ) {
+				for ( unsigned int tile_x = 0; tile_x < TERRAIN_CHUNK_ROW_TILES; ++tile_x ) {
+					unsigned int tileIndex = tile_x + tile_y * TERRAIN_CHUNK_ROW_TILES;
+					unsigned int fileIndex = chunkIndex * TERRAIN_CHUNK_TILES + tileIndex;
+
+					Tile *current_tile = &chunk.tiles[ tileIndex ];
+					current_tile->surface = static_cast<Tile::Surface>(types[ fileIndex ] & 31U);
+					current_tile->behaviour = static_cast<Tile::Behaviour>(types[ fileIndex ] & ~31U);
+					current_tile->rotation = static_cast<Tile::Rotation>(rotations[ fileIndex ]);
+					current_tile->slip = slips[ fileIndex ];
+					current_tile->texture = textures[ fileIndex ];
+
+					// top-left corner of the tile in the grid
+					unsigned int corner =
+							( chunk_y * TERRAIN_CHUNK_ROW_TILES + tile_y ) * TERRAIN_GRID_WIDTH +
+							( chunk_x * TERRAIN_CHUNK_ROW_TILES + tile_x );
+					for ( unsigned int i = 0; i < 4; ++i ) {
+						unsigned int gridIndex = corner + ( i % 2 ) + ( i / 2 ) * TERRAIN_GRID_WIDTH;
+						current_tile->height[ i ] = heightGrid[ gridIndex ];
+						current_tile->shading[ i ] = shading[ gridIndex ];
+					}
+				}
+			}
+		}
+	}
+
+	min_height_ = header.min_height;
+	max_height_ = header.max_height;
+
+	Map_CloseFile( fh );
+
+	Update();
+
+	return true;
+}
+
+/**
+ * Writes the terrain out in our own format. Heights are stored as they
+ * are in the pmg, so anything imported from a heightmap outside of that
+ * range will be clamped.
+ */
+bool ohw::Terrain::Serialize( const std::string &path ) {
+	static const unsigned int gridSize = TERRAIN_GRID_WIDTH * TERRAIN_GRID_WIDTH;
+
+	std::vector< int16_t > heights( gridSize, 0 );
+	std::vector< uint8_t > shading( gridSize, 255 );
+	std::vector< uint8_t > written( gridSize, 0 );
+	std::vector< OhtChunk > chunks( TERRAIN_CHUNKS );
+	std::vector< uint8_t > types( TERRAIN_TILES ), rotations( TERRAIN_TILES ), slips( TERRAIN_TILES ), textures( TERRAIN_TILES );
+
+	unsigned int numMismatches = 0;
+	for ( unsigned int chunk_y = 0; chunk_y < TERRAIN_CHUNK_ROW; ++chunk_y ) {
+		for ( unsigned int chunk_x = 0; chunk_x < TERRAIN_CHUNK_ROW; ++chunk_x ) {
+			unsigned int chunkIndex = chunk_x + chunk_y * TERRAIN_CHUNK_ROW;
+			const Chunk &chunk = chunks_[ chunkIndex ];
+
+			OhtChunk &ohtChunk = chunks[ chunkIndex ];
+			ohtChunk.x = chunk.x;
+			ohtChunk.y = chunk.y;
+			ohtChunk.z = chunk.z;
+			ohtChunk.min_height = INT16_MAX;
+			ohtChunk.max_height = INT16_MIN;
+
+			for ( unsigned int tile_y = 0; tile_y < TERRAIN_CHUNK_ROW_TILES; ++tile_y ) {
+				for ( unsigned int tile_x = 0; tile_x < TERRAIN_CHUNK_ROW_TILES; ++tile_x ) {
+					unsigned int tileIndex = tile_x + tile_y * TERRAIN_CHUNK_ROW_TILES;
+					unsigned int fileIndex = chunkIndex * TERRAIN_CHUNK_TILES + tileIndex;
+
+					const Tile &tile = chunk.tiles[ tileIndex ];
+					types[ fileIndex ] = static_cast< uint8_t >( tile.surface | tile.behaviour );
+					rotations[ fileIndex ] = static_cast< uint8_t >( tile.rotation );
+					slips[ fileIndex ] = static_cast< uint8_t >( tile.slip );
+					textures[ fileIndex ] = tile.texture;
+
+					unsigned int corner =
+							( chunk_y * TERRAIN_CHUNK_ROW_TILES + tile_y ) * TERRAIN_GRID_WIDTH +
+							( chunk_x * TERRAIN_CHUNK_ROW_TILES + tile_x );
+					for ( unsigned int i = 0; i < 4; ++i ) {
+						unsigned int gridIndex = corner + ( i % 2 ) + ( i / 2 ) * TERRAIN_GRID_WIDTH;
+						int16_t height = ClampHeight( tile.height[ i ] );
+						if ( written[ gridIndex ] && ( heights[ gridIndex ] != height || shading[ gridIndex ] != tile.shading[ i ] ) ) {
+							numMismatches++;
+						}
+
+						heights[ gridIndex ] = height;
+						shading[ gridIndex ] = tile.shading[ i ];
+						written[ gridIndex ] = 1;
+
+						ohtChunk.min_height = std::min( ohtChunk.min_height, height );
+						ohtChunk.max_height = std::max( ohtChunk.max_height, height );
+					}
+				}
+			}
+		}
+	}
+
+	// Only one height can be kept for each corner, so neighbours that disagree lose out
+	if ( numMismatches > 0 ) {
+		Warning( "%u tile corners didn't match their neighbours, only the last was kept!\n", numMismatches );
+	}
+
+	OhtHeader header;
+	memset( &header, 0, sizeof( OhtHeader ) );
+	memcpy( header.identifier, OHT_IDENTIFIER, sizeof( header.identifier ) );
+	header.version = OHT_VERSION;
+	header.grid_width = TERRAIN_GRID_WIDTH;
+	header.num_chunks = TERRAIN_CHUNKS;
+	header.num_tiles = TERRAIN_TILES;
+	header.min_height = min_height_;
+	header.max_height = max_height_;
+
+	std::vector< uint8_t > buffer;
+	auto append = [ &buffer ]( const void *data, size_t size ) {
+		buffer.insert( buffer.end(), static_cast< const uint8_t * >( data ), static_cast< const uint8_t * >( data ) + size );
+	};
+
+	append( &header, sizeof( OhtHeader ) );
+	append( heights.data(), heights.size() * sizeof( int16_t ) );
+	append( chunks.data(), chunks.size() * sizeof( OhtChunk ) );
+	append( shading.data(), shading.size() );
+	append( types.data(), types.size() );
+	append( rotations.data(), rotations.size() );
+	append( slips.data(), slips.size() );
+	append( textures.data(), textures.size() );
+
+	return WriteTerrainFile( path, buffer );
+}
+
+/**
+ * Writes the terrain back out as a pmg. Anything we don't know the
+ * purpose of in the original is left zeroed.
+ */
+bool ohw::Terrain::SerializePmg( const std::string &path ) {
+	std::vector< uint8_t > buffer( sizeof( PmgChunk ) * TERRAIN_CHUNKS );
+	for ( unsigned int chunkIndex = 0; chunkIndex < TERRAIN_CHUNKS; ++chunkIndex ) {
+		const Chunk &chunk = chunks_[ chunkIndex ];
+
+		PmgChunk pmgChunk;
+		memset( &pmgChunk, 0, sizeof( PmgChunk ) );
+		pmgChunk.x = chunk.x;
+		pmgChunk.y = chunk.y;
+		pmgChunk.z = chunk.z;
+
+		// Each vertex comes from whichever tile it's the corner of, right and bottom edges included
+		for ( unsigned int vertex_y = 0; vertex_y < 5; ++vertex_y ) {
+			for ( unsigned int vertex_x = 0; vertex_x < 5; ++vertex_x ) {
+				unsigned int tile_x = std::min( vertex_x, TERRAIN_CHUNK_ROW_TILES - 1U );
+				unsigned int tile_y = std::min( vertex_y, TERRAIN_CHUNK_ROW_TILES - 1U );
+				unsigned int i = ( vertex_x - tile_x ) + ( vertex_y - tile_y ) * 2;
+
+				const Tile &tile = chunk.tiles[ tile_x + tile_y * TERRAIN_CHUNK_ROW_TILES ];
+				pmgChunk.vertices[ vertex_x + vertex_y * 5 ].height = ClampHeight( tile.height[ i ] );
+				pmgChunk.vertices[ vertex_x + vertex_y * 5 ].lighting = tile.shading[ i ];
+			}
+		}
+
+		for ( unsigned int i = 0; i < TERRAIN_CHUNK_TILES; ++i ) {
+			const Tile &tile = chunk.tiles[ i ];
+			pmgChunk.tiles[ i ].type = static_cast< uint8_t >( tile.surface | tile.behaviour );
+			pmgChunk.tiles[ i ].slip = static_cast< uint8_t >( tile.slip );
+			pmgChunk.tiles[ i ].rotation = static_cast< uint8_t >( tile.rotation );
+			pmgChunk.tiles[ i ].texture = tile.texture;
+		}
+
+		memcpy( &buffer[ chunkIndex * sizeof( PmgChunk ) ], &pmgChunk, sizeof( PmgChunk ) );
+	}
+
+	return WriteTerrainFile( path, buffer );
 }
 
 void ohw::Terrain::LoadHeightmap( const std::string &path, int multiplier ) {
@@ -508,19 +848,17 @@ void ohw::Terrain::LoadHeightmap( const std::string &path, int multiplier ) {
 
 	unsigned int chan_length = image->width * image->height;
 
-	auto *rchan = static_cast<float *>(u_alloc( chan_length, sizeof( float ), true ));
-	uint8_t *pixel = image->data[ 0 ];
-	for ( unsigned int i = 0; i < chan_length; ++i ) {
-		rchan[ i ] = static_cast<int>(*pixel) * multiplier; //(static_cast<int>(*pixel) - 127) * 256;
-		pixel += 4;
+	if ( !Img_ConvertImageToRGBA8( image ) ) {
+		Warning( "Failed to convert heightmap to RGBA8, \"%s\" (%s)!\n", path.c_str(), plGetError() );
+		plDestroyImage( image );
+		return;
 	}
 
+	auto *rchan = static_cast<float *>(u_alloc( chan_length, sizeof( float ), true ));
+	Img_ExtractChannelF( image->data[ 0 ], chan_length, 0, static_cast<float>(multiplier), rchan );
+
 	auto *gchan = static_cast<uint8_t *>(u_alloc( chan_length, sizeof( uint8_t ), true ));
-	pixel = image->data[ 0 ] + 1;
-	for ( unsigned int i = 0; i < chan_length; ++i ) {
-		gchan[ i ] = *pixel;
-		pixel += 4;
-	}
+	Img_ExtractChannel( image->data[ 0 ], chan_length, 1, gchan );
 
 	plDestroyImage( image );
 
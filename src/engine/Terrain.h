@@ -26,6 +26,10 @@
 #define TERRAIN_CHUNK_PIXEL_WIDTH   2048
 
 #define TERRAIN_ROW_TILES           (TERRAIN_CHUNK_ROW * TERRAIN_CHUNK_ROW_TILES)
+#define TERRAIN_TILES               (TERRAIN_CHUNKS * TERRAIN_CHUNK_TILES)
+
+/* tiles share their corners with their neighbours, so there's one more row */
+#define TERRAIN_GRID_WIDTH          (TERRAIN_ROW_TILES + 1)
 
 #define TERRAIN_PIXEL_WIDTH         (TERRAIN_TILE_PIXEL_WIDTH * TERRAIN_ROW_TILES)
 
@@ -36,6 +40,8 @@ namespace ohw {
 	class TextureAtlas;
 	class Terrain {
 	public:
+		/* without a tileset, nothing is drawn; it's only for working with the data */
+		Terrain();
 		explicit Terrain( const std::string &tileset );
 		~Terrain();
 
@@ -97,25 +103,34 @@ namespace ohw {
 		};
 
 		Chunk *GetChunk( const PLVector2 &pos );
+		PL_INLINE const Chunk &GetChunkByIndex( unsigned int i ) const { return chunks_[ i ]; }
 		Tile *GetTile( float x, float y );
 
 		float GetHeight( float x, float y );
 		float GetMaxHeight() { return max_height_; }
 		float GetMinHeight() { return min_height_; }
 
-		void LoadPmg( const std::string &path );
+		bool LoadPmg( const std::string &path );
+		bool LoadOht( const std::string &path );
 		void LoadHeightmap( const std::string &path, int multiplier );
 
 		PLTexture *GetOverview() { return overview_; }
 
-		void Serialize( const std::string &path );
+		bool Serialize( const std::string &path );
+		bool SerializePmg( const std::string &path );
 
 		void Draw();
 		void Update();
 
+		/* regenerates the mesh for every chunk, but not the normals */
+		void GenerateMeshes();
+
 	protected:
 	private:
-		void GenerateChunkMesh( Chunk *chunk, const PLVector2 &offset );
+		void SetupChunkBounds( Chunk *chunk, unsigned int chunk_x, unsigned int chunk_y, float minHeight, float maxHeight );
+
+		void CreateChunkMeshes( Chunk *chunk );
+		unsigned int GenerateChunkMesh( Chunk *chunk, const PLVector2 &offset );
 		void GenerateOverview();
 
 		float max_height_{ 0 };
@@ -124,6 +139,7 @@ namespace ohw {
 		std::vector< Chunk > chunks_;
 
 		ohw::TextureAtlas *textureAtlas{ nullptr };
+		unsigned int textureSlots_[ 256 ]{};    // atlas slot for each tile texture
 		PLTexture *overview_{ nullptr };
 	};
 }
@@ -16,70 +16,91 @@
  */
 
 #include "App.h"
+#include "config.h"
+#include "graphics/ImageKernels.h"
+#include "graphics/TextureCooker.h"
+#include "loaders/OhxLoader.h"
+#include "loaders/TimLoader.h"
 
 // TODO: we should be able to query the platform library for this!!
 const char *supportedTextureFormats[] = { "png", "tga", "bmp", "tim", nullptr };
 
-ohw::TextureResource::TextureResource( const std::string &path, unsigned int flags, bool persist, bool abortOnFail ) : Resource( path, persist ) {
-	PLTextureFilter filterMode;
-	if ( flags & FLAG_NOMIPS ) {
-		if ( flags & FLAG_NEAREST ) {
-			filterMode = PL_TEXTURE_FILTER_NEAREST;
-		} else {
-			filterMode = PL_TEXTURE_FILTER_LINEAR;
-		}
-	} else {
-		if ( flags & FLAG_NEAREST ) {
-			filterMode = PL_TEXTURE_FILTER_MIPMAP_NEAREST;
-		} else {
-			filterMode = PL_TEXTURE_FILTER_MIPMAP_LINEAR;
-		}
+/* bump this if the cooker starts producing anything different */
+#define TEXTURE_COOK_VERSION    1
+
+ohw::TextureResource::LoadStats ohw::TextureResource::loadStats;
+
+static std::string TextureResource_GetCachePath( const std::string &path, unsigned int flags ) {
+	uint64_t hash = u_hash( path.c_str(), path.size(), U_HASH_SEED );
+	hash = u_hash( &flags, sizeof( flags ), hash );
+
+	char name[32];
+	snprintf( name, sizeof( name ), "%016llx.ohx", ( unsigned long long ) hash );
+	return std::string( Config_GetUserCachePath() ) + "textures/" + name;
+}
+
+/**
+ * Hashes the original image along with anything that changes how it's
+ * cooked, so the cooked copy is thrown out if either changes.
+ */
+static uint64_t TextureResource_HashSource( const std::string &path, unsigned int flags ) {
+	unsigned int settings[] = { TEXTURE_COOK_VERSION, flags };
+	uint64_t hash = u_hash( settings, sizeof( settings ), U_HASH_SEED );
+
+	const PkgMember *member = GetApp()->resourceManager->GetPackageMember( path );
+	if ( member != nullptr ) {
+		return u_hash( member->data, member->size, hash );
 	}
 
-	const char *fileExtension = plGetFileExtension( path.c_str() );
-	if ( fileExtension[ 0 ] == '\0' ) {
-		const char *newPath = u_find2( path.c_str(), supportedTextureFormats, abortOnFail );
-		if ( newPath != nullptr ) {
-			texturePtr = plLoadTextureFromImage( newPath, filterMode );
-		}
+	MappedFile *file = Map_OpenFile( path.c_str() );
+	if ( file != nullptr ) {
+		hash = u_hash( file->data, file->size, hash );
+		Map_CloseFile( file );
+	}
 
-		if ( texturePtr == nullptr ) {
-			if ( abortOnFail ) {
-				Error( "Failed to load texture, \"%s\"!\nPL: %s\n", path.c_str(), plGetError() );
-			}
+	return hash;
+}
 
-			Warning( "Failed to load texture, \"%s\"!\nPL: %s\n", path.c_str(), plGetError() );
-			texturePtr = GetApp()->resourceManager->GetFallbackTexture();
-		}
+ohw::TextureResource::TextureResource( const std::string &path, unsigned int flags, bool persist, bool abortOnFail ) : Resource( path, persist ) {
+	Timer timer;
 
-		return;
+	std::string sourcePath = path;
+	const char *fileExtension = plGetFileExtension( path.c_str() );
+	if ( fileExtension[ 0 ] == '\0' ) {
+		const char *newPath = u_find2( path.c_str(), supportedTextureFormats, abortOnFail );
+		sourcePath = ( newPath != nullptr ) ? newPath : "";
 	}
 
-	PLImage *image = plLoadImage( path.c_str() );
-	if ( image ) {
-		// pixel format of TIM will be changed before uploading
-		if ( pl_strncasecmp( fileExtension, "tim", 3 ) == 0 ) {
-			plConvertPixelFormat( image, PL_IMAGEFORMAT_RGBA8 );
+	if ( !sourcePath.empty() ) {
+		std::string cachePath;
+		uint64_t sourceHash = 0;
+		if ( cv_graphics_texture_cache->b_value ) {
+			cachePath = TextureResource_GetCachePath( sourcePath, flags );
+			sourceHash = TextureResource_HashSource( sourcePath, flags );
 		}
 
-		// If discard is specified, we need to throw away the first colour
-		if ( flags & FLAG_DISCARD ) {
-			const PLColour *firstColour = ( PLColour * ) image->data[ 0 ];
-			plReplaceImageColour( image, *firstColour, PLColour( 0, 0, 0, 0 ) );
-		}
+		if ( !cachePath.empty() && LoadCachedTexture( cachePath, sourceHash, flags ) ) {
+			loadStats.numCacheHits++;
+		} else {
+			CookedTexture cooked;
+			if ( CookTexture( sourcePath, flags, &cooked ) ) {
+				loadStats.numCooked++;
 
-		texturePtr = plCreateTexture();
-		if ( texturePtr != nullptr ) {
-			texturePtr->filter = filterMode;
-			if ( plUploadTextureImage( texturePtr, image ) ) {
-				return;
+				if ( !cachePath.empty() && plCreatePath( ( std::string( Config_GetUserCachePath() ) + "textures/" ).c_str() ) ) {
+					WriteCookedTexture( cachePath, sourceHash, cooked );
+				}
+
+				Upload( cooked.format, cooked.width, cooked.height, cooked.levels.data(), cooked.levels.size(), cooked.pixels.data(), flags );
 			}
 		}
-
-		plDestroyTexture( texturePtr );
 	}
 
-	plDestroyImage( image );
+	timer.End();
+	loadStats.loadTime += timer.GetTimeTaken();
+
+	if ( texturePtr != nullptr ) {
+		return;
+	}
 
 	if ( abortOnFail ) {
 		Error( "Failed to load texture, \"%s\"!\nPL: %s\n", path.c_str(), plGetError() );
@@ -99,3 +120,207 @@ ohw::TextureResource::~TextureResource() {
 
 	plDestroyTexture( texturePtr );
 }
+
+/**
+ * Decodes the original image and converts it into whatever we're going
+ * to upload it as. Anything that's going to be mipmapped gets block
+ * compressed, whereas UI textures are left as they are so they stay sharp.
+ */
+bool ohw::TextureResource::CookTexture( const std::string &path, unsigned int flags, CookedTexture *out ) {
+	// Textures can also be decoded straight out of the original packages
+	PLImage *image = GetApp()->resourceManager->LoadPackageImage( path );
+	if ( image == nullptr ) {
+		image = plLoadImage( path.c_str() );
+		if ( image == nullptr ) {
+			return false;
+		}
+	}
+
+	// the cooker only deals with RGBA8
+	if ( !Img_ConvertImageToRGBA8( image ) ) {
+		Warning( "Failed to convert \"%s\" to RGBA8!\n", path.c_str() );
+		plDestroyImage( image );
+		return false;
+	}
+
+	// If discard is specified, we need to throw away the first colour
+	if ( flags & FLAG_DISCARD ) {
+		static const uint8_t transparent[ 4 ] = { 0, 0, 0, 0 };
+		uint8_t firstColour[ 4 ];
+		memcpy( firstColour, image->data[ 0 ], sizeof( firstColour ) );
+		Img_ReplaceColour( image->data[ 0 ], image->width * image->height, firstColour, transparent );
+	}
+
+	bool generateMips = !( flags & FLAG_NOMIPS );
+	Cook_Texture( image->data[ 0 ], image->width, image->height, generateMips, generateMips, out );
+
+	plDestroyImage( image );
+
+	return true;
+}
+
+bool ohw::TextureResource::CookFile( const std::string &path, unsigned int flags ) {
+	CookedTexture cooked;
+	if ( !CookTexture( path, flags, &cooked ) ) {
+		Warning( "Failed to cook texture, \"%s\"!\nPL: %s\n", path.c_str(), plGetError() );
+		return false;
+	}
+
+	if ( !plCreatePath( ( std::string( Config_GetUserCachePath() ) + "textures/" ).c_str() ) ) {
+		Warning( "Failed to create texture cache directory!\nPL: %s\n", plGetError() );
+		return false;
+	}
+
+	return WriteCookedTexture( TextureResource_GetCachePath( path, flags ), TextureResource_HashSource( path, flags ), cooked );
+}
+
+bool ohw::TextureResource::WriteCookedTexture( const std::string &cachePath, uint64_t sourceHash, CookedTexture &cooked ) {
+	OhxHeader header;
+	memset( &header, 0, sizeof( OhxHeader ) );
+	memcpy( header.identifier, OHX_IDENTIFIER, sizeof( header.identifier ) );
+	header.version = OHX_VERSION;
+	header.source_hash = sourceHash;
+	header.width = cooked.width;
+	header.height = cooked.height;
+	header.format = cooked.format;
+	header.num_levels = cooked.levels.size();
+
+	const uint8_t *pixels[ OHX_MAX_LEVELS ];
+	for ( unsigned int i = 0; i < header.num_levels; ++i ) {
+		pixels[ i ] = &cooked.pixels[ cooked.levels[ i ].offset ];
+	}
+
+	return Ohx_WriteFile( cachePath.c_str(), &header, cooked.levels.data(), pixels );
+}
+
+/**
+ * Uploads the cooked copy of the texture straight out of the mapped file,
+ * returns false if there isn't one or it's out of date.
+ */
+bool ohw::TextureResource::LoadCachedTexture( const std::string &cachePath, uint64_t sourceHash, unsigned int flags ) {
+	OhxHandle *ohx = Ohx_LoadFile( cachePath.c_str() );
+	if ( ohx == nullptr ) {
+		return false;
+	}
+
+	if ( ohx->header.source_hash != sourceHash ) {
+		DebugMsg( "Cooked texture is out of date, \"%s\"\n", cachePath.c_str() );
+		Ohx_DestroyHandle( ohx );
+		return false;
+	}
+
+	bool status = Upload( ohx->header.format, ohx->header.width, ohx->header.height,
+	                      ohx->levels, ohx->header.num_levels, ohx->pixels, flags );
+	Ohx_DestroyHandle( ohx );
+
+	return status;
+}
+
+/* set once the platform library has turned down a block compressed or
+ * mipmapped upload, so we don't keep trying it for every texture */
+static bool compressedUploadFailed = false;
+static bool levelUploadFailed = false;
+
+/**
+ * Uploads the cooked levels as they are where we can, otherwise falls back
+ * to decompressing them into RGBA8 and then to just the top level.
+ */
+bool ohw::TextureResource::Upload( unsigned int format, unsigned int width, unsigned int height,
+                                   const OhxLevel *levels, unsigned int numLevels, const uint8_t *pixels, unsigned int flags ) {
+	bool isCompressed = ( format == OHX_FORMAT_BC1 || format == OHX_FORMAT_BC3 );
+	if ( !( isCompressed && compressedUploadFailed ) && !( numLevels > 1 && levelUploadFailed ) ) {
+		if ( UploadLevels( format, width, height, levels, numLevels, pixels, flags ) ) {
+			return true;
+		}
+
+		if ( isCompressed ) {
+			Warning( "Failed to upload compressed texture, falling back to RGBA8!\nPL: %s\n", plGetError() );
+			compressedUploadFailed = true;
+		} else if ( numLevels > 1 ) {
+			Warning( "Failed to upload texture levels, falling back to a single level!\nPL: %s\n", plGetError() );
+			levelUploadFailed = true;
+		} else {
+			return false;
+		}
+	}
+
+	std::vector< OhxLevel > rgbaLevels( levels, levels + numLevels );
+	std::vector< uint8_t > rgbaPixels;
+	for ( unsigned int i = 0; i < numLevels; ++i ) {
+		rgbaLevels[ i ].offset = rgbaPixels.size();
+		rgbaLevels[ i ].size = Cook_GetLevelSize( OHX_FORMAT_RGBA8, levels[ i ].width, levels[ i ].height );
+		rgbaPixels.resize( rgbaPixels.size() + rgbaLevels[ i ].size );
+		Cook_DecompressLevel( format, pixels + levels[ i ].offset, levels[ i ].width, levels[ i ].height, &rgbaPixels[ rgbaLevels[ i ].offset ] );
+	}
+
+	if ( numLevels > 1 && !levelUploadFailed ) {
+		if ( UploadLevels( OHX_FORMAT_RGBA8, width, height, rgbaLevels.data(), numLevels, rgbaPixels.data(), flags ) ) {
+			return true;
+		}
+
+		Warning( "Failed to upload texture levels, falling back to a single level!\nPL: %s\n", plGetError() );
+		levelUploadFailed = true;
+	}
+
+	// without the rest of the levels, a mipmapped filter would leave it incomplete
+	return UploadLevels( OHX_FORMAT_RGBA8, width, height, rgbaLevels.data(), 1, rgbaPixels.data(), flags | FLAG_NOMIPS );
+}
+
+/**
+ * Hands the levels over to the platform library as they are, without
+ * copying them anywhere first.
+ */
+bool ohw::TextureResource::UploadLevels( unsigned int format, unsigned int width, unsigned int height,
+                                   const OhxLevel *levels, unsigned int numLevels, const uint8_t *pixels, unsigned int flags ) {
+	PLTextureFilter filterMode;
+	if ( flags & FLAG_NOMIPS ) {
+		if ( flags & FLAG_NEAREST ) {
+			filterMode = PL_TEXTURE_FILTER_NEAREST;
+		} else {
+			filterMode = PL_TEXTURE_FILTER_LINEAR;
+		}
+	} else {
+		if ( flags & FLAG_NEAREST ) {
+			filterMode = PL_TEXTURE_FILTER_MIPMAP_NEAREST;
+		} else {
+			filterMode = PL_TEXTURE_FILTER_MIPMAP_LINEAR;
+		}
+	}
+
+	uint8_t *levelData[ OHX_MAX_LEVELS ];
+	size_t totalSize = 0;
+	for ( unsigned int i = 0; i < numLevels; ++i ) {
+		levelData[ i ] = const_cast< uint8_t * >( pixels + levels[ i ].offset );
+		totalSize += levels[ i ].size;
+	}
+
+	PLImage image;
+	memset( &image, 0, sizeof( PLImage ) );
+	image.width = width;
+	image.height = height;
+	image.levels = numLevels;
+	image.size = totalSize;
+	image.data = levelData;
+	image.colour_format = PL_COLOURFORMAT_RGBA;
+	switch ( format ) {
+		case OHX_FORMAT_BC1: image.format = PL_IMAGEFORMAT_RGB_DXT1; break;
+		case OHX_FORMAT_BC3: image.format = PL_IMAGEFORMAT_RGBA_DXT5; break;
+		default: image.format = PL_IMAGEFORMAT_RGBA8; break;
+	}
+
+	texturePtr = plCreateTexture();
+	if ( texturePtr == nullptr ) {
+		return false;
+	}
+
+	texturePtr->filter = filterMode;
+	if ( !plUploadTextureImage( texturePtr, &image ) ) {
+		plDestroyTexture( texturePtr );
+		texturePtr = nullptr;
+		return false;
+	}
+
+	textureSize = totalSize;
+
+	return true;
+}
@@ -19,6 +19,9 @@
 
 #include "Resource.h"
 
+struct CookedTexture;
+struct OhxLevel;
+
 namespace ohw {
 	class TextureResource : public Resource {
 	public:
@@ -32,7 +35,8 @@ namespace ohw {
 		PL_INLINE unsigned int GetWidth() const { return texturePtr->w; }
 		PL_INLINE unsigned int GetHeight() const { return texturePtr->h; }
 
-		PL_INLINE size_t GetTextureSize() const { return texturePtr->size; }
+		/* size of the uploaded texture, including its mips */
+		PL_INLINE size_t GetTextureSize() const { return textureSize; }
 
 		enum {
 			FLAG_DISCARD        = ( 1 << 0 ),   // Convert the background colour to alpha
@@ -40,8 +44,28 @@ namespace ohw {
 			FLAG_NEAREST        = ( 1 << 2 ),   // Will use nearest filtering
 		};
 
+		struct LoadStats {
+			unsigned int numCooked{ 0 };
+			unsigned int numCacheHits{ 0 };
+			double loadTime{ 0 };           // in seconds
+		};
+		static LoadStats loadStats;
+
+		/* cooks the texture into the cache without loading it */
+		static bool CookFile( const std::string &path, unsigned int flags = 0 );
+
 	private:
+		static bool CookTexture( const std::string &path, unsigned int flags, CookedTexture *out );
+		static bool WriteCookedTexture( const std::string &cachePath, uint64_t sourceHash, CookedTexture &cooked );
+
+		bool LoadCachedTexture( const std::string &cachePath, uint64_t sourceHash, unsigned int flags );
+		bool Upload( unsigned int format, unsigned int width, unsigned int height,
+		             const OhxLevel *levels, unsigned int numLevels, const uint8_t *pixels, unsigned int flags );
+		bool UploadLevels( unsigned int format, unsigned int width, unsigned int height,
+		                   const OhxLevel *levels, unsigned int numLevels, const uint8_t *pixels, unsigned int flags );
+
 		PLTexture *texturePtr{ nullptr };
+		size_t textureSize{ 0 };
 	};
 
 	using SharedTextureResourcePointer = SharedResourcePointer< TextureResource >;
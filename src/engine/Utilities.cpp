@@ -18,6 +18,8 @@
 #include <PL/platform_filesystem.h>
 
 #include "App.h"
+#include "FileIndex.h"
+#include "MemoryTracker.h"
 
 /****************************************************/
 /* Memory */
@@ -29,7 +31,7 @@ unsigned long u_unmangle( void* source, void* destination ) {
 }
 
 void* u_realloc( void* ptr, size_t new_size, bool abort_on_fail ) {
-	void* mem = realloc( ptr, new_size );
+	void* mem = ohw::MemoryTracker::Reallocate( ptr, new_size );
 	if ( mem == NULL && new_size > 0 ) {
 		if ( abort_on_fail ) {
 			Error( "Failed to allocate %u bytes!\n", new_size );
@@ -43,20 +45,45 @@ void* u_realloc( void* ptr, size_t new_size, bool abort_on_fail ) {
 }
 
 void* u_alloc( size_t num, size_t size, bool abort_on_fail ) {
-	void* mem = calloc( num, size );
-	if ( mem == NULL && abort_on_fail ) {
-		Error( "Failed to allocate %u bytes!\n", size * num );
+	void* mem = ohw::MemoryTracker::Allocate( num * size );
+	if ( mem == NULL ) {
+		if ( abort_on_fail ) {
+			Error( "Failed to allocate %u bytes!\n", size * num );
+		}
+		return NULL;
 	}
+
+	memset( mem, 0, num * size );
 	return mem;
 }
 
+/* anything from u_alloc or u_realloc has to come back through here, so it's tracked */
+void u_dealloc( void* ptr ) {
+	ohw::MemoryTracker::Free( ptr );
+}
+
 /****************************************************/
 /* Filesystem */
 
 const char* u_scan( const char* path, const char** preference ) {
 	static char find[PL_SYSTEM_MAX_PATH];
+
+	// Once a mod's mounted everything on disk is in the index, so there's no need to go probing
+	ohw::FileIndex *index = ohw::FileIndex::GetInstance();
+	if ( index->IsBuilt() ) {
+		const char *found = index->Find( path, preference );
+		if ( found == NULL ) {
+			DebugMsg( "Failed to find \"%s\"\n", path );
+			return "";
+		}
+
+		snprintf( find, sizeof( find ), "%s", found );
+		return find;
+	}
+
 	while ( *preference != NULL ) {
 		snprintf( find, sizeof( find ), "%s.%s", path, *preference );
+		index->AddProbe();
 		if ( plFileExists( find ) ) {
 			//LogDebug( "Found \"%s\"\n", find );
 			return find;
@@ -92,3 +119,20 @@ char *u_new_filename( char *dst, const char *src, const char *ext ) {
 	strcat( dst, ext );
 	return dst;
 }
+
+/****************************************************/
+/* Hashing */
+
+/**
+ * FNV-1a, pass the result back in as the seed to hash
+ * multiple blocks of data together.
+ */
+uint64_t u_hash( const void *data, size_t size, uint64_t seed ) {
+	const uint8_t *bytes = static_cast< const uint8_t * >( data );
+	uint64_t hash = seed;
+	for ( size_t i = 0; i < size; ++i ) {
+		hash ^= bytes[ i ];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
@@ -25,7 +25,7 @@
 #define u_unused( ... ) (void)( __VA_ARGS__ )
 
 #define u_fclose( FILE )  if((FILE) != NULL) { fclose((FILE)); (FILE) = NULL; }
-#define u_free( DATA )    free((DATA)); (DATA) = NULL
+#define u_free( DATA )    u_dealloc((DATA)); (DATA) = NULL
 
 static inline std::string u_stringtolower( std::string s ) {
 	std::transform( s.begin(), s.end(), s.begin(), ::tolower );
@@ -36,12 +36,17 @@ PL_EXTERN_C
 
 void *u_realloc( void *ptr, size_t new_size, bool abort_on_fail );
 void *u_alloc( size_t num, size_t size, bool abort_on_fail );
+void u_dealloc( void *ptr );
 
 const char *u_scan( const char *path, const char **preference );
 const char *u_find2( const char *path, const char **preference, bool abort_on_fail );
 
 char *u_new_filename( char *dst, const char *src, const char *ext );
 
+#define U_HASH_SEED 14695981039346656037ULL
+
+uint64_t u_hash( const void *data, size_t size, uint64_t seed );
+
 PL_EXTERN_C_END
 
 #ifdef _DEBUG
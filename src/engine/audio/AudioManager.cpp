@@ -26,6 +26,8 @@
 
 #include "App.h"
 #include "Menu.h"
+#include "MemoryTracker.h"
+#include "Metrics.h"
 
 #include "graphics/Camera.h"
 
@@ -368,6 +370,8 @@ const AudioSample *AudioManager::CacheSample( const std::string &path, bool pres
 		return &( i->second );
 	}
 
+	MemoryTagScope tagScope( MemoryTag::AUDIO );
+
 	const char *ext = plGetFileExtension( path.c_str());
 	if ( ext == nullptr ) {
 		Warning( "Unable to identify audio format, \"%s\"!\n", path.c_str());
@@ -542,6 +546,14 @@ void AudioManager::Tick() {
 		delete ( *source );
 		source = temp_sources_.erase( source );
 	}
+
+	unsigned int numVoices = 0;
+	for ( auto source : sources_ ) {
+		if ( source->IsPlaying() ) {
+			numVoices++;
+		}
+	}
+	METRIC_GAUGE( "audio.voices" )->Set( numVoices );
 }
 
 void AudioManager::PlayGlobalSound( const std::string &path ) {
@@ -639,6 +651,7 @@ void AudioManager::DrawSources() {
 
 		sprite->model_matrix = plTranslateMatrix4( source->GetPosition());
 		plDrawModel( sprite );
+		METRIC_COUNTER( "render.draw_calls" )->Add();
 	}
 	plSetMeshUniformColour( mesh, PLColour( 255, 0, 0, 255 ));
 }
@@ -34,6 +34,40 @@ const char *Config_GetUserConfigPath() {
 	return config_path.c_str();
 }
 
+/**
+ * Directory for anything we generate that can safely be thrown away, e.g. compiled models.
+ */
+const char *Config_GetUserCachePath() {
+	static std::string cache_path;
+	if ( cache_path.empty() ) {
+		char out[PL_SYSTEM_MAX_PATH];
+		if ( plGetApplicationDataDirectory( APP_NAME, out, PL_SYSTEM_MAX_PATH ) == nullptr ) {
+			Warning( "Failed to get app data directory!\n%s\n", plGetError() );
+			cache_path = "./cache/";
+		} else {
+			cache_path = std::string( out ) + "cache/";
+		}
+	}
+	return cache_path.c_str();
+}
+
+/**
+ * Directory for anything written out to be looked over afterwards, e.g. memory usage for each map.
+ */
+const char *Config_GetUserReportPath() {
+	static std::string report_path;
+	if ( report_path.empty() ) {
+		char out[PL_SYSTEM_MAX_PATH];
+		if ( plGetApplicationDataDirectory( APP_NAME, out, PL_SYSTEM_MAX_PATH ) == nullptr ) {
+			Warning( "Failed to get app data directory!\n%s\n", plGetError() );
+			report_path = "./reports/";
+		} else {
+			report_path = std::string( out ) + "reports/";
+		}
+	}
+	return report_path.c_str();
+}
+
 void Config_Save( const char *path ) {
 	FILE *fp = fopen( path, "wb" );
 	if ( fp == nullptr ) {
@@ -20,6 +20,8 @@
 #define CONFIG_FILENAME    "user.config"
 
 const char* Config_GetUserConfigPath();
+const char* Config_GetUserCachePath();
+const char* Config_GetUserReportPath();
 
 void Config_Save( const char* path );
 void Config_Load( const char* path );
@@ -66,26 +66,22 @@ void ActorTreeWindow::Display() {
 }
 
 void ActorTreeWindow::DisplayActorProperties( Actor* actor ) {
-	const PropertyMap& property_map = actor->GetProperties();
-	if ( property_map.empty() ) {
+	if ( actor->GetNumProperties() == 0 ) {
 		// Very unlikely, better safe than sorry...
 		return;
 	}
 
 	ImGui::Checkbox( "Show read only?", &showReadOnly );
 
-	for ( const auto& i : property_map ) {
-		Property* property = i.second;
+	for ( unsigned int i = 0; i < actor->GetNumProperties(); ++i ) {
+		Property* property = actor->GetProperty( i );
 		if ( !( property->flags & PROP_WRITE ) && !showReadOnly ) {
 			continue;
 		}
 
 		ImGui::PushID( property );
 
-		const char* name = property->name.c_str();
-		if ( !property->description.empty() ) {
-			name = property->description.c_str();
-		}
+		const char* name = property->name;
 
 		auto* stringProperty = dynamic_cast< StringProperty* >( property );
 		if ( stringProperty != nullptr ) {
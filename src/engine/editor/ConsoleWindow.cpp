@@ -20,6 +20,7 @@
 #include "App.h"
 #include "Language.h"
 #include "ConsoleWindow.h"
+#include "LogRing.h"
 
 ohw::ConsoleWindow::ConsoleWindow() : BaseWindow() {
 
@@ -64,22 +65,49 @@ void ohw::ConsoleWindow::Display() {
 	const float footerHeightToReserve = ImGui::GetStyle().ItemSpacing.y + ImGui::GetFrameHeightWithSpacing(); // 1 separator, 1 input text
 	ImGui::BeginChild( "ScrollingRegion", ImVec2( 0, -footerHeightToReserve ), false, ImGuiWindowFlags_HorizontalScrollbar );
 
-	for ( const auto &i : logBuffer ) {
-		switch ( i.level ) {
-			default:
-				ImGui::PushStyleColor( ImGuiCol_Text, ImVec4( 0.0f, 0.6f, 0.8f, 1.0f ) );
-				break;
-			case LOG_LEVEL_WARNING:
-				ImGui::PushStyleColor( ImGuiCol_Text, ImVec4( 0.8f, 0.6f, 0.0f, 1.0f ) );
-				break;
-			case LOG_LEVEL_ERROR:
-				ImGui::PushStyleColor( ImGuiCol_Text, ImVec4( 0.8f, 0.2f, 0.0f, 1.0f ) );
-				break;
-		}
-
-		ImGui::TextUnformatted( i.buffer );
+	// Scroll down whenever anything new comes in
+	LogRing *logRing = LogRing::GetInstance();
+	uint64_t head = logRing->GetHead();
+	if ( head != lastHead ) {
+		lastHead = head;
+		scrollToEnd = true;
+	}
 
-		ImGui::PopStyleColor();
+	// Only the lines that are actually on screen get read out
+	uint64_t tail = std::max( firstTicket, logRing->GetTail() );
+	ImGuiListClipper clipper;
+	clipper.Begin( static_cast< int >( head - tail ) );
+	while ( clipper.Step() ) {
+		for ( int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i ) {
+			int level;
+			char buffer[ LOG_RECORD_LENGTH ];
+			if ( !logRing->Read( tail + i, &level, buffer, sizeof( buffer ) ) ) {
+				// Not written yet, or overwritten since
+				ImGui::TextUnformatted( "" );
+				continue;
+			}
+
+			switch ( level ) {
+				default:
+					ImGui::PushStyleColor( ImGuiCol_Text, ImVec4( 0.0f, 0.6f, 0.8f, 1.0f ) );
+					break;
+				case LOG_LEVEL_WARNING:
+					ImGui::PushStyleColor( ImGuiCol_Text, ImVec4( 0.8f, 0.6f, 0.0f, 1.0f ) );
+					break;
+				case LOG_LEVEL_ERROR:
+					ImGui::PushStyleColor( ImGuiCol_Text, ImVec4( 0.8f, 0.2f, 0.0f, 1.0f ) );
+					break;
+			}
+
+			// The clipper expects every line to be the same height, so don't let the newline add another
+			size_t length = strlen( buffer );
+			if ( length > 0 && buffer[ length - 1 ] == '\n' ) {
+				length--;
+			}
+			ImGui::TextUnformatted( buffer, buffer + length );
+
+			ImGui::PopStyleColor();
+		}
 	}
 
 	if ( scrollToEnd ) {
@@ -92,21 +120,8 @@ void ohw::ConsoleWindow::Display() {
 	ImGui::End();
 }
 
-void ohw::ConsoleWindow::PushMessage( int level, const char *msg ) {
-	if ( logBuffer.size() > 1024 ) {
-		logBuffer.erase( logBuffer.begin() );
-	}
-
-	Message message;
-	message.level = level;
-	snprintf( message.buffer, sizeof( message.buffer ), "%s", msg );
-	logBuffer.push_back( message );
-
-	scrollToEnd = true;
-}
-
 void ohw::ConsoleWindow::Clear() {
-	logBuffer.clear();
+	firstTicket = LogRing::GetInstance()->GetHead();
 }
 
 void ohw::ConsoleWindow::PushCommand() {
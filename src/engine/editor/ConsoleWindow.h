@@ -27,17 +27,14 @@ namespace ohw {
 
 		void Display() override;
 
-		void PushMessage( int level, const char *msg );
 		void Clear();
 
 		void PushCommand();
 
 	private:
-		struct Message {
-			int level{ 0 };
-			char buffer[ 512 ]{ '\0' };
-		};
-		std::vector< Message > logBuffer;
+		/* lines are drawn straight out of the LogRing, these are tickets into it */
+		uint64_t firstTicket{ 0 };
+		uint64_t lastHead{ 0 };
 
 		bool scrollToEnd{ false };
 
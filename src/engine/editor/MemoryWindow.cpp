@@ -0,0 +1,85 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <imgui.h>
+
+#include "App.h"
+#include "MemoryWindow.h"
+#include "MemoryTracker.h"
+
+using namespace ohw;
+
+MemoryWindow::MemoryWindow() = default;
+MemoryWindow::~MemoryWindow() = default;
+
+void MemoryWindow::Display() {
+	ImGui::SetNextWindowSize( ImVec2( 480, 256 ), ImGuiCond_Once );
+	Begin( "Memory Usage", ED_DEFAULT_WINDOW_FLAGS );
+
+	MemoryTracker *tracker = MemoryTracker::GetInstance();
+
+	ImGui::Columns( 6 );
+	ImGui::Text( "Tag" ); ImGui::NextColumn();
+	ImGui::Text( "Live" ); ImGui::NextColumn();
+	ImGui::Text( "Peak" ); ImGui::NextColumn();
+	ImGui::Text( "Blocks" ); ImGui::NextColumn();
+	ImGui::Text( "Allocs/s" ); ImGui::NextColumn();
+	ImGui::Text( "KB/s" ); ImGui::NextColumn();
+	ImGui::Separator();
+
+	uint64_t totalLive = 0;
+	for ( unsigned int i = 0; i < ( unsigned int ) MemoryTag::MAX_MEMORY_TAGS; ++i ) {
+		MemoryTracker::TagStats stats;
+		tracker->GetStats( ( MemoryTag ) i, &stats );
+
+		double allocations, bytes;
+		tracker->GetRates( ( MemoryTag ) i, &allocations, &bytes );
+
+		// Some of what the platform library allocates is freed by it, where we can't see it
+		auto usage = [ &stats ]( uint64_t value ) {
+			if ( stats.numCounted == 0 ) {
+				ImGui::Text( "%.1fMB", value / ( 1024.0 * 1024.0 ) );
+			} else if ( value == 0 ) {
+				ImGui::Text( "unknown" );
+			} else {
+				ImGui::Text( ">=%.1fMB", value / ( 1024.0 * 1024.0 ) );
+			}
+			ImGui::NextColumn();
+		};
+
+		ImGui::Text( "%s", MemoryTracker::GetTagName( ( MemoryTag ) i ) ); ImGui::NextColumn();
+		usage( stats.liveBytes );
+		usage( stats.peakBytes );
+		ImGui::Text( "%llu", ( unsigned long long ) stats.numLive ); ImGui::NextColumn();
+		ImGui::Text( "%.0f", allocations ); ImGui::NextColumn();
+		ImGui::Text( "%.1f", bytes / 1024.0 ); ImGui::NextColumn();
+
+		totalLive += stats.liveBytes;
+	}
+
+	ImGui::Columns( 1 );
+	ImGui::Separator();
+
+	ImGui::Text( "%.1fMB in use through new / delete and u_alloc / u_free", totalLive / ( 1024.0 * 1024.0 ) );
+	uint64_t untracked = MemoryTracker::GetUntrackedBytes();
+	if ( untracked > 0 ) {
+		ImGui::Text( "%.1fMB allocated elsewhere", untracked / ( 1024.0 * 1024.0 ) );
+	}
+
+	ImGui::End();
+}
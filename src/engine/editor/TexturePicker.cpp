@@ -27,29 +27,19 @@ ohw::TexturePicker::TexturePicker() : BaseWindow() {
 
 	mapDir.append( "tiles/" );
 
-	unsigned int numFormats;
-	const char **formatExtensions = plGetSupportedImageFormats( &numFormats );
-
 	for ( unsigned int i = 0;; ++i ) {
-		bool indexLoaded = false;
-		for ( unsigned int j = 0; j < numFormats; ++j ) {
-			std::string texturePath = mapDir + std::to_string( i ) + "." + formatExtensions[ j ];
-			if ( plFileExists( texturePath.c_str() ) ) {
-				SharedTextureResourcePointer sharedTexture = GetApp()->resourceManager->LoadTexture(
-						texturePath,
-						TextureResource::FLAG_NOMIPS | TextureResource::FLAG_NEAREST
-				);
-				textures.push_back( sharedTexture );
-				indexLoaded = true;
-				break;
-			}
-		}
-
-		// Failed to load the index? Assume it's the end. (let's do this better in future)
-		if ( !indexLoaded ) {
+		// Failed to find the index? Assume it's the end. (let's do this better in future)
+		const char *texturePath = u_scan( ( mapDir + std::to_string( i ) ).c_str(), supportedTextureFormats );
+		if ( *texturePath == '\0' ) {
 			Print( "Didn't find texture index %d. Assuming end of tiles list!\n", i );
 			break;
 		}
+
+		SharedTextureResourcePointer sharedTexture = GetApp()->resourceManager->LoadTexture(
+				texturePath,
+				TextureResource::FLAG_NOMIPS | TextureResource::FLAG_NEAREST
+		);
+		textures.push_back( sharedTexture );
 	}
 }
 
@@ -18,6 +18,7 @@
 #include "App.h"
 #include "ActorManager.h"
 #include "AAirship.h"
+#include "WorldSnapshot.h"
 #include "Map.h"
 
 REGISTER_ACTOR_BASIC( AAirship )
@@ -110,3 +111,20 @@ void AAirship::Deserialize( const ActorSpawn &spawn ) {
 	PLVector2 point = map->GetRandomPointInPlayArea();
 	myDestination = PLVector3( point.x, GetHeight(), point.y );
 }
+
+void AAirship::SaveState( WorldSnapshot &snapshot ) const {
+	SuperClass::SaveState( snapshot );
+
+	snapshot.Write( myDestination );
+	snapshot.Write( myDestinationTolerance );
+	snapshot.Write( myTurnSpeed );
+	snapshot.Write( myTurnFrames );
+}
+
+bool AAirship::RestoreState( WorldSnapshot &snapshot ) {
+	return SuperClass::RestoreState( snapshot ) &&
+	       snapshot.Read( &myDestination ) &&
+	       snapshot.Read( &myDestinationTolerance ) &&
+	       snapshot.Read( &myTurnSpeed ) &&
+	       snapshot.Read( &myTurnFrames );
+}
@@ -30,6 +30,9 @@ public:
 
 	void Deserialize( const ActorSpawn &spawn ) override;
 
+	void SaveState( ohw::WorldSnapshot &snapshot ) const override;
+	bool RestoreState( ohw::WorldSnapshot &snapshot ) override;
+
 protected:
 private:
 	PLVector3 myDestination;
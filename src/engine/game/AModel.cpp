@@ -18,6 +18,7 @@
 #include "App.h"
 #include "model.h"
 #include "AModel.h"
+#include "WorldSnapshot.h"
 
 using namespace ohw;
 
@@ -43,7 +44,28 @@ void AModel::Draw() {
 	model->modelMatrix.Rotate( angles.x, { 0, 0, 1 } );
 	model->modelMatrix.Translate( position_ );
 
-	model->Draw();
+	// Already culled before we got here
+	model->Draw( false );
+}
+
+/**
+ * Covers the model as well, as the actor's own bounds are usually just
+ * what it collides with.
+ */
+PLCollisionAABB AModel::GetVisibilityBounds() const {
+	PLCollisionAABB bounds = SuperClass::GetVisibilityBounds();
+	if ( !show_model_ || model == nullptr ) {
+		return bounds;
+	}
+
+	const PLCollisionAABB &modelBounds = model->GetBounds();
+	bounds.mins.x = std::min( bounds.mins.x, modelBounds.mins.x );
+	bounds.mins.y = std::min( bounds.mins.y, modelBounds.mins.y );
+	bounds.mins.z = std::min( bounds.mins.z, modelBounds.mins.z );
+	bounds.maxs.x = std::max( bounds.maxs.x, modelBounds.maxs.x );
+	bounds.maxs.y = std::max( bounds.maxs.y, modelBounds.maxs.y );
+	bounds.maxs.z = std::max( bounds.maxs.z, modelBounds.maxs.z );
+	return bounds;
 }
 
 void AModel::SetModel( const std::string &path ) {
@@ -57,3 +79,23 @@ void AModel::SetModel( const std::string &path ) {
 void AModel::ShowModel( bool show ) {
 	show_model_ = show;
 }
+
+void AModel::SaveState( WorldSnapshot &snapshot ) const {
+	SuperClass::SaveState( snapshot );
+
+	snapshot.Write( show_model_ );
+}
+
+bool AModel::RestoreState( WorldSnapshot &snapshot ) {
+	if ( !SuperClass::RestoreState( snapshot ) || !snapshot.Read( &show_model_ ) ) {
+		return false;
+	}
+
+	// Only needs loading again if we've been recreated, or it was changed since
+	const std::string &path = modelPath;
+	if ( !path.empty() && ( model == nullptr || model->GetPath() != path ) ) {
+		model = GetApp()->resourceManager->LoadModel( path, false );
+	}
+
+	return true;
+}
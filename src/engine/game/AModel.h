@@ -27,10 +27,14 @@ public:
 	~AModel() override;
 
 	void Draw() override;
+	PLCollisionAABB GetVisibilityBounds() const override;
 	void ShowModel( bool show = true );
 
 	void SetModel( const std::string &path );
 
+	void SaveState( ohw::WorldSnapshot &snapshot ) const override;
+	bool RestoreState( ohw::WorldSnapshot &snapshot ) override;
+
 protected:
 	ohw::SharedModelResourcePointer model{ nullptr };
 
@@ -21,6 +21,8 @@
 #include "Player.h"
 #include "ActorManager.h"
 #include "APig.h"
+#include "WorldSnapshot.h"
+#include "Random.h"
 
 REGISTER_ACTOR( ac_me, APig )    // Ace
 REGISTER_ACTOR( gr_me, APig )    // Grunt
@@ -216,7 +218,8 @@ void APig::Deserialize( const ActorSpawn &spawn ) {
 
 	// Create and equip our parachute, and then
 	// link it to ensure it gets destroyed when we do
-	parachuteWeapon = dynamic_cast<AParachuteWeapon *>(ActorManager::GetInstance()->CreateActor( "weapon_parachute" ));
+	static const ActorManager::SpawnFactory parachuteFactory = ActorManager::GetInstance()->FindSpawnFactory( "weapon_parachute" );
+	parachuteWeapon = dynamic_cast<AParachuteWeapon *>(ActorManager::GetInstance()->CreateActor( parachuteFactory ));
 	if ( parachuteWeapon == nullptr ) {
 		Error( "Failed to create \"weapon_parachute\" actor, aborting!\n" );
 	}
@@ -226,6 +229,50 @@ void APig::Deserialize( const ActorSpawn &spawn ) {
 	parachuteWeapon->Deploy();
 }
 
+void APig::SaveState( WorldSnapshot &snapshot ) const {
+	SuperClass::SaveState( snapshot );
+
+	snapshot.Write( aimPitch );
+	snapshot.Write( myTeam );
+	snapshot.Write( myPersonality );
+	snapshot.Write( myClass );
+	snapshot.Write( lifeState );
+	snapshot.Write( upper_face_frame_ );
+	snapshot.Write( lower_face_frame_ );
+
+	snapshot.WriteActor( weapon_ );
+	snapshot.WriteActor( parachuteWeapon );
+
+	// Players stick around between snapshots, so we just need to know which
+	const PlayerPtrVector &players = GetApp()->gameManager->GetPlayers();
+	auto player = std::find( players.begin(), players.end(), playerOwnerPtr );
+	snapshot.Write< int32_t >( ( player != players.end() ) ? player - players.begin() : -1 );
+}
+
+bool APig::RestoreState( WorldSnapshot &snapshot ) {
+	Actor *weapon, *parachute;
+	int32_t playerIndex;
+	if ( !SuperClass::RestoreState( snapshot ) ||
+	     !snapshot.Read( &aimPitch ) ||
+	     !snapshot.Read( &myTeam ) ||
+	     !snapshot.Read( &myPersonality ) ||
+	     !snapshot.Read( &myClass ) ||
+	     !snapshot.Read( &lifeState ) ||
+	     !snapshot.Read( &upper_face_frame_ ) ||
+	     !snapshot.Read( &lower_face_frame_ ) ||
+	     !snapshot.ReadActor( &weapon ) ||
+	     !snapshot.ReadActor( &parachute ) ||
+	     !snapshot.Read( &playerIndex ) ) {
+		return false;
+	}
+
+	weapon_ = dynamic_cast< AWeapon * >( weapon );
+	parachuteWeapon = dynamic_cast< AParachuteWeapon * >( parachute );
+	playerOwnerPtr = ( playerIndex >= 0 ) ? GetApp()->gameManager->GetPlayerByIndex( playerIndex ) : nullptr;
+
+	return true;
+}
+
 bool APig::Possessed( const Player *player ) {
 	// TODO
 	PlayVoiceSample( VoiceCategory::READY );
@@ -298,7 +345,7 @@ void APig::PlayVoiceSample( VoiceCategory category ) {
 		static_cast<int>(GetPersonality()),
 		team->voice_set.c_str(),
 		static_cast<int>(category),
-		rand() % 6 + 1
+		Random::GenerateInt( 6 ) + 1
 		);
 
 	const AudioSample* sample = GetApp()->audioManager->CacheSample(path);
@@ -70,6 +70,9 @@ public:
 
 	void Deserialize( const ActorSpawn &spawn ) override;
 
+	void SaveState( ohw::WorldSnapshot &snapshot ) const override;
+	bool RestoreState( ohw::WorldSnapshot &snapshot ) override;
+
 private:
 	void Jump();
 	void Land();
@@ -17,6 +17,7 @@
 
 #include "App.h"
 #include "AVehicle.h"
+#include "WorldSnapshot.h"
 
 AVehicle::AVehicle() : SuperClass() {}
 AVehicle::~AVehicle() = default;
@@ -29,4 +30,17 @@ void AVehicle::Occupy( Actor *occupant ) {
 void AVehicle::Unoccupy() {
 	occupant_ = nullptr;
 	isOccupied_ = false;
-}
\ No newline at end of file
+}
+
+void AVehicle::SaveState( ohw::WorldSnapshot &snapshot ) const {
+	SuperClass::SaveState( snapshot );
+
+	snapshot.Write( isOccupied_ );
+	snapshot.WriteActor( occupant_ );
+}
+
+bool AVehicle::RestoreState( ohw::WorldSnapshot &snapshot ) {
+	return SuperClass::RestoreState( snapshot ) &&
+	       snapshot.Read( &isOccupied_ ) &&
+	       snapshot.ReadActor( &occupant_ );
+}
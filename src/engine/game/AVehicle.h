@@ -31,6 +31,9 @@ public:
 	bool IsOccupied() { return isOccupied_; } //occupant_ == nullptr instead?
 	Actor *GetOccupant() { return occupant_; }
 
+	void SaveState( ohw::WorldSnapshot &snapshot ) const override;
+	bool RestoreState( ohw::WorldSnapshot &snapshot ) override;
+
 protected:
 private:
 	bool isOccupied_;
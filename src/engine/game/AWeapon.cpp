@@ -17,6 +17,7 @@
 
 #include "App.h"
 #include "AWeapon.h"
+#include "WorldSnapshot.h"
 
 AWeapon::AWeapon() : SuperClass() {}
 AWeapon::~AWeapon() = default;
@@ -48,3 +49,13 @@ void AWeapon::Holster() {
 
 	isWeaponDeployed = false;
 }
+
+void AWeapon::SaveState( ohw::WorldSnapshot &snapshot ) const {
+	SuperClass::SaveState( snapshot );
+
+	snapshot.Write( isWeaponDeployed );
+}
+
+bool AWeapon::RestoreState( ohw::WorldSnapshot &snapshot ) {
+	return SuperClass::RestoreState( snapshot ) && snapshot.Read( &isWeaponDeployed );
+}
@@ -34,6 +34,9 @@ public:
 
 	bool IsDeployed() const { return isWeaponDeployed; }
 
+	void SaveState( ohw::WorldSnapshot &snapshot ) const override;
+	bool RestoreState( ohw::WorldSnapshot &snapshot ) override;
+
 protected:
 
 	bool isWeaponDeployed{ false };
@@ -20,6 +20,8 @@
 #include "ActorManager.h"
 #include "Player.h"
 #include "Actor.h"
+#include "WorldSnapshot.h"
+#include "MemoryArena.h"
 
 #include "graphics/Camera.h"
 
@@ -29,9 +31,16 @@ Actor::Actor() :
 	INIT_PROPERTY( forwardVelocity, PROP_PUSH, 0.00 ),
 	INIT_PROPERTY( inputYaw, PROP_PUSH, 0.00 ),
 	INIT_PROPERTY( inputPitch, PROP_PUSH, 0.00 ),
-	INIT_PROPERTY( position_, PROP_LOCAL | PROP_WRITE, PLVector3( 0, 0, 0 ) ),
+	INIT_PROPERTY( position_, PROP_WRITE, PLVector3( 0, 0, 0 ) ),
 	INIT_PROPERTY( fallback_position_, PROP_LOCAL | PROP_WRITE, PLVector3( 0, 0, 0 ) ),
-	INIT_PROPERTY( myAngles, PROP_LOCAL | PROP_WRITE, PLVector3( 0, 0, 0 ) ) {}
+	INIT_PROPERTY( myAngles, PROP_WRITE, PLVector3( 0, 0, 0 ) ) {
+	// Replicated as fixed-point, which is plenty at this scale
+	forwardVelocity.SetQuantization( -1.0f, 1.0f, 10 );
+	inputYaw.SetQuantization( -1.0f, 1.0f, 10 );
+	inputPitch.SetQuantization( -1.0f, 1.0f, 10 );
+	position_.SetQuantization( -16384.0f, 49152.0f, 20 );
+	myAngles.SetQuantization( -360.0f, 360.0f, 12 );
+}
 
 Actor::~Actor() {
 	for ( auto actor : childActors ) {
@@ -43,6 +52,10 @@ Actor::~Actor() {
 	childActors.shrink_to_fit();
 
 	DestroyPhysicsBody();
+
+	if ( networkId != REPLICATION_INVALID_ID ) {
+		ReplicationManager::GetInstance()->UnregisterObject( networkId );
+	}
 }
 
 /**
@@ -63,6 +76,12 @@ bool Actor::IsVisible() {
 	return !( camera == nullptr || !camera->IsBoxVisible( &boundingBox ) );
 }
 
+PLCollisionAABB Actor::GetVisibilityBounds() const {
+	PLCollisionAABB bounds = boundingBox;
+	bounds.origin = position_;
+	return bounds;
+}
+
 void Actor::SetVelocity(PLVector3 newVelocity) {
 	old_velocity_ = velocity;
 	velocity = newVelocity;
@@ -76,6 +95,17 @@ void Actor::SetPosition( PLVector3 position ) {
 	boundingBox.origin = position;
 }
 
+bool Actor::ReceiveUpdate( ohw::BitReader &reader, unsigned int requiredFlags, unsigned int excludedFlags ) {
+	if ( !PropertyOwner::ReceiveUpdate( reader, requiredFlags, excludedFlags ) ) {
+		return false;
+	}
+
+	// Keep the bounds in step with wherever we've been moved to
+	boundingBox.origin = position_;
+
+	return true;
+}
+
 void Actor::Deserialize( const ActorSpawn &spawn ) {
 	// Convert the original spawn bounds to those we want (TODO: do this in spawn handler)
 	boundingBox.maxs.x = ( float ) spawn.bounds[ 0 ];
@@ -89,6 +119,56 @@ void Actor::Deserialize( const ActorSpawn &spawn ) {
 	SetAngles( spawn.angles );
 }
 
+void Actor::SaveState( ohw::WorldSnapshot &snapshot ) const {
+	snapshot.WriteProperties( this );
+
+	snapshot.Write( myHealth );
+	snapshot.Write( velocity );
+	snapshot.Write( old_velocity_ );
+	snapshot.Write( old_position_ );
+	snapshot.Write( myOldAngles );
+	snapshot.Write( myForward );
+	snapshot.Write( boundingBox );
+	snapshot.Write( is_visible_ );
+	snapshot.Write( isActive );
+
+	snapshot.WriteActor( parentActor );
+	snapshot.Write< uint32_t >( childActors.size() );
+	for ( auto child : childActors ) {
+		snapshot.WriteActor( child );
+	}
+}
+
+bool Actor::RestoreState( ohw::WorldSnapshot &snapshot ) {
+	if ( !snapshot.ReadProperties( this ) ||
+	     !snapshot.Read( &myHealth ) ||
+	     !snapshot.Read( &velocity ) ||
+	     !snapshot.Read( &old_velocity_ ) ||
+	     !snapshot.Read( &old_position_ ) ||
+	     !snapshot.Read( &myOldAngles ) ||
+	     !snapshot.Read( &myForward ) ||
+	     !snapshot.Read( &boundingBox ) ||
+	     !snapshot.Read( &is_visible_ ) ||
+	     !snapshot.Read( &isActive ) ||
+	     !snapshot.ReadActor( &parentActor ) ) {
+		return false;
+	}
+
+	uint32_t numChildren;
+	if ( !snapshot.Read( &numChildren ) || numChildren > UINT16_MAX ) {
+		return false;
+	}
+
+	childActors.resize( numChildren );
+	for ( auto &child : childActors ) {
+		if ( !snapshot.ReadActor( &child ) ) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
 const ohw::PhysicsBody *Actor::CreatePhysicsBody() {
 	return nullptr;
 }
@@ -214,34 +294,12 @@ void Actor::LinkChild( Actor *actor ) {
 bool Actor::CheckTouching() {
 	bool touchedSomething = false;
 
-	ActorSet actorSet = ActorManager::GetInstance()->GetActors();
-	for ( Actor *other : actorSet ) {
-		// Can't touch ourself
-		if ( other == this || !other->IsActivated() ) {
-			continue;
-		}
-
-		// Check if it's our parent; we can't touch them
-		if ( other == parentActor ) {
-			continue;
-		}
-
-		// Check if it's one of our children; we can't touch them either
-		bool isChild = false;
-		for ( unsigned int i = 0; i < childActors.size(); ++i ) {
-			if ( childActors[ i ] == other ) {
-				isChild = true;
-				break;
-			}
-		}
-
-		if ( isChild ) {
-			continue;
-		}
-
-		// Now check the AABB against that of the other actor
-		if( !plIsAABBIntersecting( &boundingBox, &other->boundingBox ) ) {
-			// Didn't get a hit, continue onto the next
+	// Touching may well spawn or destroy something, so go off a copy
+	const ActorSet &actors = ActorManager::GetInstance()->GetActors();
+	ohw::MemoryArenaScope scope;
+	ohw::ArenaVector< Actor * > actorList( actors.begin(), actors.end(), ohw::ArenaAllocator< Actor * >( scope.GetArena() ) );
+	for ( Actor *other : actorList ) {
+		if ( !CanTouch( other ) ) {
 			continue;
 		}
 
@@ -254,6 +312,32 @@ bool Actor::CheckTouching() {
 	return touchedSomething;
 }
 
+/**
+ * Whether we're currently overlapping the other actor, and are allowed
+ * to touch it. Doesn't change anything, so it's safe to call from any thread.
+ */
+bool Actor::CanTouch( Actor *other ) {
+	// Can't touch ourself
+	if ( other == this || !other->IsActivated() ) {
+		return false;
+	}
+
+	// Check if it's our parent; we can't touch them
+	if ( other == parentActor ) {
+		return false;
+	}
+
+	// Check if it's one of our children; we can't touch them either
+	for ( unsigned int i = 0; i < childActors.size(); ++i ) {
+		if ( childActors[ i ] == other ) {
+			return false;
+		}
+	}
+
+	// Now check the AABB against that of the other actor
+	return plIsAABBIntersecting( &boundingBox, &other->boundingBox );
+}
+
 /**
  * Called when one actor collides with another.
  * @param other The touchee.
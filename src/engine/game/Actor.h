@@ -18,6 +18,7 @@
 #pragma once
 
 #include "../Property.h"
+#include "../net/ReplicationManager.h"
 
 enum ActorFlag {
 	ACTOR_FLAG_PLAYABLE = 1,
@@ -70,6 +71,7 @@ struct ActorSpawn {
 
 namespace ohw {
 	class PhysicsBody;
+	class WorldSnapshot;
 }
 
 #define IMPLEMENT_SUPER( a ) typedef a SuperClass;
@@ -102,6 +104,9 @@ public:
 
 	virtual bool IsVisible();
 
+	/* what's used to decide if it's on screen, if it has no size it's always drawn */
+	virtual PLCollisionAABB GetVisibilityBounds() const;
+
 	inline PLVector3 GetVelocity() const {
 		return velocity;
 	}
@@ -132,6 +137,14 @@ public:
 	virtual ActorSpawn Serialize() { return ActorSpawn(); }
 	virtual void Deserialize( const ActorSpawn &spawn );
 
+	/* Full state for snapshots, see WorldSnapshot */
+	virtual void SaveState( ohw::WorldSnapshot &snapshot ) const;
+	virtual bool RestoreState( ohw::WorldSnapshot &snapshot );
+
+	/* Class it was registered under with the ActorManager */
+	const char *GetClassIdentifier() const { return classIdentifier; }
+	void SetClassIdentifier( const char *identifier ) { classIdentifier = identifier; }
+
 	virtual void Activate() { isActive = true; }
 	virtual void Deactivate() { isActive = false; }
 	virtual bool IsActivated() { return isActive; }
@@ -142,10 +155,13 @@ public:
 
 	Actor *GetParent() { return parentActor; }
 	void LinkChild( Actor *actor );
+	/* forgets about the children without destroying them along with us */
+	void ReleaseChildren() { childActors.clear(); }
 	unsigned int GetNumOfChildren() { return childActors.size(); }
 	std::vector< Actor * > GetChildren() { return childActors; }
 
 	bool CheckTouching();
+	bool CanTouch( Actor *other );
 	virtual void Touch( Actor *other );
 
 	void DropToFloor();
@@ -159,8 +175,10 @@ public:
 
 	// Networking
 
-	void SendUpdate();
-	void ReceiveUpdate();
+	bool ReceiveUpdate( ohw::BitReader &reader, unsigned int requiredFlags, unsigned int excludedFlags ) override;
+
+	uint16_t GetNetworkId() const { return networkId; }
+	void SetNetworkId( uint16_t id ) { networkId = id; }
 
 protected:
 	PLVector3 CalculateForwardVector();
@@ -199,4 +217,8 @@ private:
 
 	Actor *parentActor{ nullptr };
 	std::vector< Actor * > childActors;
+
+	uint16_t networkId{ REPLICATION_INVALID_ID };
+
+	const char *classIdentifier{ nullptr };
 };
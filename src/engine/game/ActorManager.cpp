@@ -18,6 +18,10 @@
 #include "App.h"
 #include "Menu.h"
 #include "graphics/ShaderManager.h"
+#include "graphics/Visibility.h"
+#include "JobSystem.h"
+#include "MemoryTracker.h"
+#include "Metrics.h"
 #include "ActorManager.h"
 #include "JsonReader.h"
 
@@ -25,15 +29,22 @@
 
 ActorSet ActorManager::actorsList;
 std::vector< Actor * > ActorManager::destructionQueue;
+std::vector< Actor * > ActorManager::touchingActors;
+std::vector< std::vector< Actor * > > ActorManager::touchingLists;
 std::map< std::string, ActorManager::actor_ctor_func > ActorManager::actorClassesRegistry
 		__attribute__((init_priority (1000)));
 
-Actor *ActorManager::CreateActor( const std::string &identifier, const ActorSpawn &spawnData ) {
+ActorManager::ActorManager() {
+	plRegisterConsoleCommand( "BenchmarkActorProperties", BenchmarkActorPropertiesCommand,
+	                          "Spawns and serialises the given number of actors. [actors] [class]" );
+}
+
+ActorManager::SpawnFactory ActorManager::FindSpawnFactory( const std::string &identifier ) const {
 	auto spawn = actorSpawnsRegistry.find( identifier );
 	if ( spawn == actorSpawnsRegistry.end() ) {
 		// TODO: make this throw an error rather than continue...
 		Warning( "Failed to find actor in spawn registry \"%s\"!\n", identifier.c_str() );
-		return nullptr;
+		return SpawnFactory();
 	}
 
 	auto classSpawn = actorClassesRegistry.find( spawn->second.className );
@@ -43,14 +54,55 @@ Actor *ActorManager::CreateActor( const std::string &identifier, const ActorSpaw
 		 spawn->second.identifier.c_str() );
 	}
 
-	Actor *actor = classSpawn->second();
-	actorsList.insert( actor );
+	SpawnFactory factory;
+	factory.construct = classSpawn->second;
+	factory.classIdentifier = classSpawn->first.c_str();
+	return factory;
+}
+
+Actor *ActorManager::CreateActor( const std::string &identifier, const ActorSpawn &spawnData ) {
+	return CreateActor( FindSpawnFactory( identifier ), spawnData );
+}
 
+Actor *ActorManager::CreateActor( const SpawnFactory &factory, const ActorSpawn &spawnData ) {
+	if ( factory.construct == nullptr ) {
+		return nullptr;
+	}
+
+	ohw::MemoryTagScope tagScope( ohw::MemoryTag::ACTORS );
+
+	Actor *actor = ConstructActor( factory.construct, factory.classIdentifier );
 	actor->Deserialize( spawnData );
 
 	return actor;
 }
 
+/**
+ * Creates an actor straight from its class, without going through a spawn
+ * manifest. Returns null if the class doesn't exist.
+ */
+Actor *ActorManager::CreateActorOfClass( const std::string &className ) {
+	ohw::MemoryTagScope tagScope( ohw::MemoryTag::ACTORS );
+
+	auto classSpawn = actorClassesRegistry.find( className );
+	if ( classSpawn == actorClassesRegistry.end() ) {
+		return nullptr;
+	}
+
+	return ConstructActor( classSpawn->second, classSpawn->first.c_str() );
+}
+
+Actor *ActorManager::ConstructActor( actor_ctor_func construct, const char *classIdentifier ) {
+	Actor *actor = construct();
+	actor->SetClassIdentifier( classIdentifier );
+	actorsList.insert( actor );
+
+	// Actors are created in the same order on every peer, so they'll get the same id
+	actor->SetNetworkId( ohw::ReplicationManager::GetInstance()->RegisterObject( actor ) );
+
+	return actor;
+}
+
 void ActorManager::DestroyActor( Actor *actor ) {
 	u_assert( actor != nullptr, "attempted to delete a null actor!\n" );
 
@@ -65,22 +117,78 @@ void ActorManager::DestroyActor( Actor *actor ) {
 }
 
 void ActorManager::TickActors() {
+	unsigned int numTicked = 0;
 	for ( auto const &actor: actorsList ) {
 		if ( !actor->IsActivated() ) {
 			continue;
 		}
 
 		actor->Tick();
-		actor->CheckTouching();
+		numTicked++;
+	}
+
+	METRIC_COUNTER( "actors.ticked" )->Add( numTicked );
+	METRIC_GAUGE( "actors.active" )->Set( numTicked );
+
+	// Working out who's touching who only reads, so that can be split up across threads...
+	touchingActors.clear();
+	for ( auto const &actor: actorsList ) {
+		if ( actor->IsActivated() ) {
+			touchingActors.push_back( actor );
+		}
+	}
+
+	if ( touchingLists.size() < touchingActors.size() ) {
+		touchingLists.resize( touchingActors.size() );
+	}
+
+	ohw::JobSystem::GetInstance()->ParallelFor( touchingActors.size(), []( unsigned int i ) {
+		Actor *actor = touchingActors[ i ];
+		touchingLists[ i ].clear();
+		for ( auto const &other : actorsList ) {
+			if ( actor->CanTouch( other ) ) {
+				touchingLists[ i ].push_back( other );
+			}
+		}
+	} );
+
+	// ...but touching can change anything, so that's done in order, checking again as it goes
+	for ( unsigned int i = 0; i < touchingActors.size(); ++i ) {
+		Actor *actor = touchingActors[ i ];
+		for ( auto const &other : touchingLists[ i ] ) {
+			// An earlier touch may have deactivated it, and then it shouldn't touch anything else
+			if ( !actor->IsActivated() ) {
+				break;
+			}
+
+			if ( actor->CanTouch( other ) ) {
+				actor->Touch( other );
+			}
+		}
 	}
 
 	// Now clean everything up that was marked for destruction
-	for ( auto &i : destructionQueue ) {
-		assert( actorsList.find( i ) != actorsList.end() );
-		actorsList.erase( i );
-		delete i;
+	DestroyQueuedActors();
+}
+
+/**
+ * Deletes everything queued up by DestroyActor. Deleting an actor queues up
+ * its children in turn, so this keeps going until there's nothing left.
+ */
+void ActorManager::DestroyQueuedActors() {
+	std::vector< Actor * > queue;
+	while ( !destructionQueue.empty() ) {
+		queue.swap( destructionQueue );
+		for ( auto actor : queue ) {
+			// A child may have been queued again by its parent after it was already gone
+			if ( actorsList.erase( actor ) == 0 ) {
+				continue;
+			}
+
+			delete actor;
+		}
+		queue.clear();
 	}
-	destructionQueue.clear();
 }
 
 void ActorManager::DrawActors() {
@@ -90,14 +198,18 @@ void ActorManager::DrawActors() {
 
 	Shaders_SetProgramByName( cv_graphics_debug_normals->b_value ? "debug_normals" : "generic_textured_lit" );
 
-	for ( auto const &actor: actorsList ) {
+	// Culling has already been done by this point
+	ohw::Visibility *visibility = ohw::Visibility::GetInstance();
+	const std::vector< Actor * > &visibleActors = visibility->GetVisibleActors();
+	for ( auto const &actor: visibleActors ) {
 		actor->Draw();
 	}
+	visibility->AddDrawn( visibleActors.size() );
 
 	if ( cv_debug_bounds->b_value ) {
 		Shaders_SetProgramByName( "generic_untextured" );
 
-		for ( auto const &actor: actorsList ) {
+		for ( auto const &actor: visibleActors ) {
 			plDrawBoundingVolume( actor->GetBoundingBox(), PL_COLOUR_GREEN );
 		}
 	}
@@ -185,3 +297,54 @@ ActorManager::ActorClassRegistration::ActorClassRegistration( const std::string
 ActorManager::ActorClassRegistration::~ActorClassRegistration() {
 	ActorManager::actorClassesRegistry.erase( name_ );
 }
+
+/**
+ * Times constructing, destroying and serialising the properties of a batch of
+ * actors, without putting them into the world.
+ */
+void ActorManager::BenchmarkActorPropertiesCommand( unsigned int argc, char **argv ) {
+	unsigned int numActors = ( argc > 1 ) ? strtoul( argv[ 1 ], nullptr, 10 ) : 100000;
+	const char *className = ( argc > 2 ) ? argv[ 2 ] : "AStaticModel";
+	if ( numActors == 0 ) {
+		Warning( "Number of actors must be at least 1!\n" );
+		return;
+	}
+
+	auto classSpawn = actorClassesRegistry.find( className );
+	if ( classSpawn == actorClassesRegistry.end() ) {
+		Warning( "Invalid class name \"%s\"!\n", className );
+		return;
+	}
+
+	Timer spawnTimer;
+	for ( unsigned int i = 0; i < numActors; ++i ) {
+		delete classSpawn->second();
+	}
+	spawnTimer.End();
+
+	std::vector< Actor * > actors( numActors );
+	for ( auto &actor : actors ) {
+		actor = classSpawn->second();
+	}
+
+	unsigned int numProperties = actors[ 0 ]->GetNumProperties();
+	size_t bufferSize = actors[ 0 ]->SerialiseProperties( nullptr, 0 ) * numActors;
+	std::vector< uint8_t > buffer( bufferSize );
+
+	Timer serialiseTimer;
+	size_t position = 0;
+	for ( auto actor : actors ) {
+		position += actor->SerialiseProperties( &buffer[ position ], bufferSize - position );
+	}
+	serialiseTimer.End();
+
+	for ( auto actor : actors ) {
+		delete actor;
+	}
+
+	Print( "Benchmarked %u %s actors, %u properties each\n", numActors, className, numProperties );
+	Print( " spawn:     %.3fms (%.0f per second)\n",
+	       spawnTimer.GetTimeTaken() * 1000.0, numActors / spawnTimer.GetTimeTaken() );
+	Print( " serialise: %.3fms (%lu bytes)\n",
+	       serialiseTimer.GetTimeTaken() * 1000.0, ( unsigned long ) position );
+}
@@ -19,6 +19,10 @@
 
 class Actor;
 
+namespace ohw {
+	class WorldSnapshot;
+}
+
 typedef std::set< Actor * > ActorSet;
 
 struct ActorSpawnManifest {
@@ -29,6 +33,8 @@ struct ActorSpawnManifest {
 };
 
 class ActorManager {
+	friend class ohw::WorldSnapshot;
+
 protected:
 	typedef Actor *(*actor_ctor_func)();
 	static std::map< std::string, actor_ctor_func > actorClassesRegistry;
@@ -42,8 +48,18 @@ public:
 		return instance;
 	}
 
+	/* what a spawn identifier resolves to, so more can be created without looking it up again */
+	struct SpawnFactory {
+		actor_ctor_func construct{ nullptr };
+		const char *classIdentifier{ nullptr };
+	};
+	SpawnFactory FindSpawnFactory( const std::string &identifier ) const;
+
 	Actor *CreateActor( const std::string &identifier, const ActorSpawn &spawnData = ActorSpawn() );
+	Actor *CreateActor( const SpawnFactory &factory, const ActorSpawn &spawnData = ActorSpawn() );
+	Actor *CreateActorOfClass( const std::string &className );
 	void DestroyActor( Actor *actor );
+	void DestroyQueuedActors();
 
 	void TickActors();
 	void DrawActors();
@@ -66,10 +82,20 @@ public:
 	};
 
 private:
+	ActorManager();
+
+	static Actor *ConstructActor( actor_ctor_func construct, const char *classIdentifier );
+
+	static void BenchmarkActorPropertiesCommand( unsigned int argc, char **argv );
+
 	std::map< std::string, ActorSpawnManifest > actorSpawnsRegistry;
 
 	static ActorSet actorsList;
 	static std::vector< Actor * > destructionQueue;
+
+	/* actors that were active this tick, and who each of them is touching */
+	static std::vector< Actor * > touchingActors;
+	static std::vector< std::vector< Actor * > > touchingLists;
 };
 
 #define REGISTER_ACTOR( NAME, CLASS ) \
@@ -24,6 +24,10 @@
 #include "Player.h"
 
 #include "graphics/Camera.h"
+#include "config.h"
+#include "MemoryTracker.h"
+#include "LoadTracer.h"
+#include "Random.h"
 
 #include "script/JsonReader.h"
 
@@ -90,6 +94,18 @@ ohw::GameManager::GameManager() {
 	plRegisterConsoleCommand( "Teleport", TeleportCommand, "Teleports current actor to the given destination." );
 	plRegisterConsoleCommand( "FirstPerson", FirstPersonCommand, "Toggles the camera into first-person mode." );
 	plRegisterConsoleCommand( "FreeCam", FreeCamCommand, "Toggles the camera into fly mode." );
+	plRegisterConsoleCommand( "SaveSnapshot", SaveSnapshotCommand, "Saves the state of the world to the given path." );
+	plRegisterConsoleCommand( "LoadSnapshot", LoadSnapshotCommand,
+	                          "Restores the world from the given path, or the last turn if none is given." );
+	plRegisterConsoleCommand( "UndoTurn", UndoTurnCommand, "Puts everything back to the start of the turn." );
+	plRegisterConsoleCommand( "BenchmarkSnapshot", BenchmarkSnapshotCommand,
+	                          "Times capturing and restoring the world. [iterations]" );
+	plRegisterConsoleCommand( "ExportTerrain", ExportTerrainCommand,
+	                          "Writes the terrain of the current map to the given path, as either a .oht or .pmg." );
+	plRegisterConsoleCommand( "BenchmarkTerrain", BenchmarkTerrainCommand,
+	                          "Times loading the terrain of every map, as both .pmg and .oht. [iterations]" );
+	plRegisterConsoleCommand( "BenchmarkTerrainMesh", BenchmarkTerrainMeshCommand,
+	                          "Times regenerating the terrain meshes for the current map. [iterations]" );
 
 	defaultCamera = new Camera( pl_vecOrigin3, pl_vecOrigin3 );
 }
@@ -112,17 +128,17 @@ void ohw::GameManager::Tick() {
 	}
 
 	if ( ambient_emit_delay_ < GetApp()->GetSimulationTicks() ) {
-		const AudioSample *sample = ambient_samples_[ rand() % MAX_AMBIENT_SAMPLES ];
+		const AudioSample *sample = ambient_samples_[ Random::GenerateInt( MAX_AMBIENT_SAMPLES ) ];
 		if ( sample != nullptr ) {
 			PLVector3 position = {
-					plGenerateRandomf( TERRAIN_PIXEL_WIDTH ),
+					Random::GenerateFloat( TERRAIN_PIXEL_WIDTH ),
 					currentMap->GetTerrain()->GetMaxHeight(),
-					plGenerateRandomf( TERRAIN_PIXEL_WIDTH )
+					Random::GenerateFloat( TERRAIN_PIXEL_WIDTH )
 			};
 			GetApp()->audioManager->PlayLocalSound( sample, position, { 0, 0, 0 }, true, 0.5f );
 		}
 
-		ambient_emit_delay_ = GetApp()->GetSimulationTicks() + TICKS_PER_SECOND + rand() % ( 7 * TICKS_PER_SECOND );
+		ambient_emit_delay_ = GetApp()->GetSimulationTicks() + TICKS_PER_SECOND + Random::GenerateInt( 7 * TICKS_PER_SECOND );
 	}
 
 	currentMode->Tick();
@@ -136,6 +152,14 @@ void ohw::GameManager::Tick() {
 	}
 }
 
+void ohw::GameManager::SaveState( WorldSnapshot &snapshot ) const {
+	snapshot.Write( ambient_emit_delay_ );
+}
+
+bool ohw::GameManager::RestoreState( WorldSnapshot &snapshot ) {
+	return snapshot.Read( &ambient_emit_delay_ );
+}
+
 void ohw::GameManager::SetupPlayers( const PlayerPtrVector &players ) {
 	for ( auto i : players ) {
 		GetMode()->PlayerJoined( i );
@@ -174,6 +198,11 @@ void ohw::GameManager::LoadMap( const std::string &name ) {
 
 	currentMap = map;
 
+	// When starting a mode, it'll switch over itself once everything else is loaded
+	if ( LoadTracer::GetInstance()->IsActive() ) {
+		return;
+	}
+
 	/* todo: we should actually pause here and wait for user input
 	 *       otherwise players won't have time to read the loading screen */
 	FrontEnd_SetState( FE_MODE_GAME );
@@ -181,6 +210,7 @@ void ohw::GameManager::LoadMap( const std::string &name ) {
 
 void ohw::GameManager::UnloadMap() {
 	delete currentMap;
+	currentMap = nullptr;
 }
 
 void ohw::GameManager::CachePersistentData() {
@@ -534,18 +564,223 @@ void ohw::GameManager::FreeCamCommand( unsigned int argc, char **argv ) {
 	GetApp()->gameManager->cameraMode = oldCameraMode;
 }
 
+void ohw::GameManager::SaveSnapshotCommand( unsigned int argc, char **argv ) {
+	if ( argc < 2 ) {
+		Warning( "Invalid number of arguments, ignoring!\n" );
+		return;
+	}
+
+	if ( GetApp()->gameManager->GetMode() == nullptr ) {
+		Print( "Command cannot function outside of game!\n" );
+		return;
+	}
+
+	WorldSnapshot snapshot;
+	snapshot.Capture();
+	if ( snapshot.Save( argv[ 1 ] ) ) {
+		Print( "Wrote %lu bytes to \"%s\"\n", ( unsigned long ) snapshot.GetSize(), argv[ 1 ] );
+	}
+}
+
+void ohw::GameManager::LoadSnapshotCommand( unsigned int argc, char **argv ) {
+	if ( GetApp()->gameManager->GetMode() == nullptr ) {
+		Print( "Command cannot function outside of game!\n" );
+		return;
+	}
+
+	std::string path = ( argc > 1 ) ? argv[ 1 ] : std::string( Config_GetUserCachePath() ) + "recovery.ohws";
+
+	WorldSnapshot snapshot;
+	if ( snapshot.Load( path.c_str() ) ) {
+		snapshot.Restore();
+	}
+}
+
+void ohw::GameManager::UndoTurnCommand( unsigned int argc, char **argv ) {
+	GameMode *mode = dynamic_cast<GameMode *>(GetApp()->gameManager->GetMode());
+	if ( mode == nullptr ) {
+		Print( "Command cannot function outside of game!\n" );
+		return;
+	}
+
+	mode->UndoTurn();
+}
+
+void ohw::GameManager::BenchmarkSnapshotCommand( unsigned int argc, char **argv ) {
+	if ( GetApp()->gameManager->GetMode() == nullptr ) {
+		Print( "Command cannot function outside of game!\n" );
+		return;
+	}
+
+	unsigned int iterations = ( argc > 1 ) ? strtoul( argv[ 1 ], nullptr, 10 ) : 100;
+	if ( iterations == 0 ) {
+		iterations = 1;
+	}
+
+	WorldSnapshot snapshot;
+	snapshot.Capture();
+
+	Timer captureTimer;
+	for ( unsigned int i = 0; i < iterations; ++i ) {
+		snapshot.Capture();
+	}
+	captureTimer.End();
+
+	Timer restoreTimer;
+	for ( unsigned int i = 0; i < iterations; ++i ) {
+		snapshot.Restore();
+	}
+	restoreTimer.End();
+
+	Print( "Snapshot of %lu actors, %lu bytes\n",
+	       ( unsigned long ) ActorManager::GetInstance()->GetActors().size(), ( unsigned long ) snapshot.GetSize() );
+	Print( " capture: %.3fms\n", captureTimer.GetTimeTaken() * 1000.0 / iterations );
+	Print( " restore: %.3fms\n", restoreTimer.GetTimeTaken() * 1000.0 / iterations );
+}
+
+void ohw::GameManager::ExportTerrainCommand( unsigned int argc, char **argv ) {
+	if ( argc < 2 ) {
+		Warning( "Invalid number of arguments, ignoring!\n" );
+		return;
+	}
+
+	Map *map = GetApp()->gameManager->GetCurrentMap();
+	if ( map == nullptr ) {
+		Print( "No map loaded!\n" );
+		return;
+	}
+
+	std::string path = argv[ 1 ];
+	const char *extension = plGetFileExtension( path.c_str() );
+	bool status;
+	if ( pl_strcasecmp( extension, "pmg" ) == 0 ) {
+		status = map->GetTerrain()->SerializePmg( path );
+	} else if ( pl_strcasecmp( extension, "oht" ) == 0 ) {
+		status = map->GetTerrain()->Serialize( path );
+	} else {
+		Warning( "Unknown terrain format, \"%s\"!\n", extension );
+		return;
+	}
+
+	if ( status ) {
+		Print( "Wrote terrain to \"%s\"\n", path.c_str() );
+	}
+}
+
+void ohw::GameManager::BenchmarkTerrainCommand( unsigned int argc, char **argv ) {
+	unsigned int iterations = ( argc > 1 ) ? strtoul( argv[ 1 ], nullptr, 10 ) : 100;
+	if ( iterations == 0 ) {
+		iterations = 1;
+	}
+
+	if ( !plCreatePath( Config_GetUserCachePath() ) ) {
+		Warning( "Failed to create cache directory, \"%s\"!\n", Config_GetUserCachePath() );
+		return;
+	}
+
+	std::string ohtPath = std::string( Config_GetUserCachePath() ) + "benchmark.oht";
+
+	double pmgTotal = 0, ohtTotal = 0;
+	unsigned int numMaps = 0;
+	for ( const auto &manifest : GetApp()->gameManager->GetMapManifests() ) {
+		std::string pmgPath = "maps/" + manifest.second.filename + "/" + manifest.second.filename + ".pmg";
+
+		// Without a tileset, nothing is generated for drawing, so this is just the load itself
+		Terrain terrain;
+		if ( !terrain.LoadPmg( pmgPath ) || !terrain.Serialize( ohtPath ) ) {
+			continue;
+		}
+
+		Timer pmgTimer;
+		for ( unsigned int i = 0; i < iterations; ++i ) {
+			terrain.LoadPmg( pmgPath );
+		}
+		pmgTimer.End();
+
+		Timer ohtTimer;
+		for ( unsigned int i = 0; i < iterations; ++i ) {
+			terrain.LoadOht( ohtPath );
+		}
+		ohtTimer.End();
+
+		double pmgTime = pmgTimer.GetTimeTaken() * 1000.0 / iterations;
+		double ohtTime = ohtTimer.GetTimeTaken() * 1000.0 / iterations;
+		Print( "%-16s pmg: %.3fms oht: %.3fms\n", manifest.second.filename.c_str(), pmgTime, ohtTime );
+
+		pmgTotal += pmgTime;
+		ohtTotal += ohtTime;
+		numMaps++;
+	}
+
+	remove( ohtPath.c_str() );
+
+	Print( "%u maps, pmg: %.3fms oht: %.3fms\n", numMaps, pmgTotal, ohtTotal );
+}
+
+void ohw::GameManager::BenchmarkTerrainMeshCommand( unsigned int argc, char **argv ) {
+	Map *map = GetApp()->gameManager->GetCurrentMap();
+	if ( map == nullptr ) {
+		Print( "No map loaded!\n" );
+		return;
+	}
+
+	unsigned int iterations = ( argc > 1 ) ? strtoul( argv[ 1 ], nullptr, 10 ) : 10;
+	if ( iterations == 0 ) {
+		iterations = 1;
+	}
+
+	Terrain *terrain = map->GetTerrain();
+
+	Timer meshTimer;
+	for ( unsigned int i = 0; i < iterations; ++i ) {
+		terrain->GenerateMeshes();
+	}
+	meshTimer.End();
+
+	// And again with everything else that happens when the terrain changes
+	Timer updateTimer;
+	for ( unsigned int i = 0; i < iterations; ++i ) {
+		terrain->Update();
+	}
+	updateTimer.End();
+
+	Print( "Terrain meshes: %.3fms\n", meshTimer.GetTimeTaken() * 1000.0 / iterations );
+	Print( "Terrain update: %.3fms\n", updateTimer.GetTimeTaken() * 1000.0 / iterations );
+}
+
 void ohw::GameManager::StartMode( const std::string &map,
                                   const PlayerPtrVector &players,
                                   const GameModeDescriptor &descriptor ) {
 	FrontEnd_SetState( FE_MODE_LOADING );
 
-	// Free up all our unreferenced resources
-	GetApp()->resourceManager->ClearAllResources();
+	LoadTracer *loadTracer = LoadTracer::GetInstance();
+	loadTracer->Begin( map );
 
-	LoadMap( map );
+	FE_SetLoadingBackground( map.c_str() );
+
+	{
+		LoadPhaseScope phase( "resources", "Freeing resources", 5 );
+
+		// Wrap up whatever was running before, so its memory report gets written
+		// out before we start on the one for this map
+		if ( currentMode != nullptr || currentMap != nullptr ) {
+			EndMode();
+		}
+
+		// Free up all our unreferenced resources
+		GetApp()->resourceManager->ClearAllResources();
+	}
+
+	MemoryTracker::GetInstance()->BeginReport( map );
+
+	{
+		LoadPhaseScope phase( "map", "Loading map", 60 );
+		LoadMap( map );
+	}
 
 	if ( currentMap == nullptr ) {
 		Warning( "Failed to start mode, map wasn't loaded!\n" );
+		loadTracer->Cancel();
 		EndMode();
 		return;
 	}
@@ -555,36 +790,59 @@ void ohw::GameManager::StartMode( const std::string &map,
 		sample_ext = "n";
 	}
 
-	ambient_emit_delay_ = GetApp()->GetSimulationTicks() + plGenerateRandomd( 100 ) + 1;
-	for ( unsigned int i = 1, idx = 0; i < 4; ++i ) {
-		std::string snum = std::to_string( i );
-		std::string path = "audio/amb_";
-		if ( i < 3 ) {
-			path += snum + sample_ext + ".wav";
-			ambient_samples_[ idx++ ] = GetApp()->audioManager->CacheSample( path, false );
+	{
+		LoadPhaseScope phase( "audio", "Loading sounds", 15 );
+
+		auto cacheSample = []( const std::string &path ) {
+			LoadPhaseScope samplePhase( path.substr( path.rfind( '/' ) + 1 ).c_str() );
+			return GetApp()->audioManager->CacheSample( path, false );
+		};
+
+		ambient_emit_delay_ = GetApp()->GetSimulationTicks() + Random::GenerateInt( 100 ) + 1;
+		for ( unsigned int i = 1, idx = 0; i < 4; ++i ) {
+			std::string snum = std::to_string( i );
+			std::string path = "audio/amb_";
+			if ( i < 3 ) {
+				path += snum + sample_ext + ".wav";
+				ambient_samples_[ idx++ ] = cacheSample( path );
+			}
+
+			path = "audio/batt_s" + snum + ".wav";
+			ambient_samples_[ idx++ ] = cacheSample( path );
+			path = "audio/batt_l" + snum + ".wav";
+			ambient_samples_[ idx++ ] = cacheSample( path );
 		}
+	}
 
-		path = "audio/batt_s" + snum + ".wav";
-		ambient_samples_[ idx++ ] = GetApp()->audioManager->CacheSample( path, false );
-		path = "audio/batt_l" + snum + ".wav";
-		ambient_samples_[ idx++ ] = GetApp()->audioManager->CacheSample( path, false );
+	// call StartRound; deals with spawning everything in and other mode specific logic
+	{
+		LoadPhaseScope phase( "mode", "Setting up game", 2 );
+		currentMode = new GameMode( descriptor );
 	}
 
-	FrontEnd_SetState( FE_MODE_GAME );
+	{
+		LoadPhaseScope phase( "players", "Setting up players", 3 );
+		SetupPlayers( players );
+	}
 
-	// call StartRound; deals with spawning everything in and other mode specific logic
-	currentMode = new GameMode( descriptor );
+	{
+		LoadPhaseScope phase( "round", "Deploying", 15 );
+		currentMode->StartRound();
+	}
 
-	SetupPlayers( players );
+	loadTracer->End();
 
-	currentMode->StartRound();
+	FrontEnd_SetState( FE_MODE_GAME );
 }
 
 /**
  * End the currently active mode and flush everything.
  */
 void ohw::GameManager::EndMode() {
+	MemoryTracker::GetInstance()->CaptureReport();
+
 	delete currentMode;
+	currentMode = nullptr;
 
 	// Clear out all the allocated players for this game
 	ClearPlayers();
@@ -598,6 +856,8 @@ void ohw::GameManager::EndMode() {
 
 	GetApp()->audioManager->FreeSources();
 	GetApp()->audioManager->FreeSamples();
+
+	MemoryTracker::GetInstance()->EndReport();
 }
 
 /**
@@ -200,6 +200,7 @@ struct AudioSample;
 namespace ohw {
 	class Map;
 	class Camera;
+	class WorldSnapshot;
 	class GameManager {
 	private:
 		GameManager();
@@ -254,6 +255,13 @@ namespace ohw {
 			pauseSim = paused;
 		}
 
+		PL_INLINE bool IsSimulationPaused() const {
+			return pauseSim && simSteps == 0;
+		}
+
+		void SaveState( WorldSnapshot &snapshot ) const;
+		bool RestoreState( WorldSnapshot &snapshot );
+
 		std::string GetCurrentMapDirectory() const;
 
 	protected:
@@ -269,6 +277,13 @@ namespace ohw {
 		static void TeleportCommand( unsigned int argc, char **argv );
 		static void FirstPersonCommand( unsigned int argc, char **argv );
 		static void FreeCamCommand( unsigned int argc, char **argv );
+		static void SaveSnapshotCommand( unsigned int argc, char **argv );
+		static void LoadSnapshotCommand( unsigned int argc, char **argv );
+		static void UndoTurnCommand( unsigned int argc, char **argv );
+		static void BenchmarkSnapshotCommand( unsigned int argc, char **argv );
+		static void ExportTerrainCommand( unsigned int argc, char **argv );
+		static void BenchmarkTerrainCommand( unsigned int argc, char **argv );
+		static void BenchmarkTerrainMeshCommand( unsigned int argc, char **argv );
 
 		bool pauseSim{ false };
 		unsigned int simSteps{ 0 };
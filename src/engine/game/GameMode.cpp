@@ -23,6 +23,9 @@
 #include "APig.h"
 #include "AAirship.h"
 #include "graphics/Camera.h"
+#include "config.h"
+#include "LoadTracer.h"
+#include "Random.h"
 
 using namespace ohw;
 
@@ -37,10 +40,21 @@ void GameMode::StartRound() {
 		Error( "Attempted to change map in the middle of a round, aborting!\n" );
 	}
 
-	SpawnActors();
+	{
+		LoadPhaseScope phase( "actors" );
+		SpawnActors();
+	}
+
+	{
+		LoadPhaseScope phase( "snapshot" );
+		roundSnapshot.Capture();
+	}
 
 	// Play the deployment music
-	GetApp()->audioManager->PlayMusic( "music/track" + std::to_string( std::rand() % 4 + 27 ) + ".ogg" );
+	{
+		LoadPhaseScope phase( "music" );
+		GetApp()->audioManager->PlayMusic( "music/track" + std::to_string( Random::GenerateInt( 4 ) + 27 ) + ".ogg" );
+	}
 
 	StartTurn( GetCurrentPlayer() );
 
@@ -48,8 +62,14 @@ void GameMode::StartRound() {
 }
 
 void GameMode::RestartRound() {
+	// Much quicker than going back through all the spawns
+	if ( roundSnapshot.Restore() ) {
+		return;
+	}
+
 	DestroyActors();
 
+	hasRoundStarted = false;
 	StartRound();
 }
 
@@ -95,28 +115,16 @@ void GameMode::SpawnActors() {
 		return;
 	}
 
-	const std::vector< ActorSpawn > &spawns = map->GetSpawns();
-	for ( const auto &spawn : spawns ) {
-		Actor *actor = ActorManager::GetInstance()->CreateActor( spawn.className, spawn );
-		if ( actor == nullptr ) {
-			actor = ActorManager::GetInstance()->CreateActor( "model_static", spawn );
-		}
-
-		APig *pig = dynamic_cast<APig *>(actor);
-		if ( pig == nullptr ) {
-			continue;
-		}
-
-		Player *player = GetApp()->gameManager->GetPlayerByIndex( pig->GetTeam() );
-		if ( player == nullptr ) {
-			Warning( "Failed to assign pig to team!\n" );
-			continue;
-		}
-
-		pig->SetPlayerOwner( player );
+	// Later rounds, and restarts, go straight through the plan
+	if ( !spawnPlan.IsCompiled() ) {
+		LoadPhaseScope phase( "plan" );
+		spawnPlan.Compile( map->GetSpawns() );
+		airshipFactory = ActorManager::GetInstance()->FindSpawnFactory( "vehicle_airship" );
 	}
 
-	AAirship *model_actor = dynamic_cast<AAirship *>(ActorManager::GetInstance()->CreateActor( "vehicle_airship" ));
+	spawnPlan.Spawn();
+
+	AAirship *model_actor = dynamic_cast<AAirship *>(ActorManager::GetInstance()->CreateActor( airshipFactory ));
 	if ( model_actor == nullptr ) {
 		Error( "Failed to create model actor!\n" );
 	}
@@ -136,6 +144,14 @@ void GameMode::StartTurn( Player *player ) {
 		return;
 	}
 
+	// Taken before possessing anything, so undoing just starts the turn over
+	turnSnapshot.Capture();
+
+	std::string recoveryPath = std::string( Config_GetUserCachePath() ) + "recovery.ohws";
+	if ( plCreatePath( Config_GetUserCachePath() ) ) {
+		turnSnapshot.Save( recoveryPath.c_str() );
+	}
+
 	player->PossessCurrentChild();
 
 	turn_started_ = true;
@@ -209,3 +225,43 @@ void GameMode::CyclePlayers() {
 void GameMode::AssignActorToPlayer( Actor *target, Player *owner ) {
 	owner->AddChild( target );
 }
+
+void GameMode::SaveState( WorldSnapshot &snapshot ) const {
+	snapshot.Write( currentPlayer );
+	snapshot.Write( num_turn_ticks );
+	snapshot.Write( turn_started_ );
+}
+
+/**
+ * The turn is left to start again on the next tick, so whoever's turn it
+ * was gets to possess their pig again.
+ */
+bool GameMode::RestoreState( WorldSnapshot &snapshot ) {
+	if ( HasTurnStarted() ) {
+		Player *player = GetCurrentPlayer();
+		if ( player != nullptr ) {
+			player->DispossessCurrentChild();
+		}
+	}
+
+	bool turnStarted;
+	if ( !snapshot.Read( &currentPlayer ) || !snapshot.Read( &num_turn_ticks ) || !snapshot.Read( &turnStarted ) ) {
+		return false;
+	}
+
+	turn_started_ = false;
+
+	return true;
+}
+
+/**
+ * Puts everything back to how it was at the start of the current turn.
+ */
+bool GameMode::UndoTurn() {
+	if ( !turnSnapshot.IsValid() ) {
+		Warning( "Nothing to undo!\n" );
+		return false;
+	}
+
+	return turnSnapshot.Restore();
+}
@@ -18,6 +18,8 @@
 #pragma once
 
 #include "GameModeInterface.h"
+#include "WorldSnapshot.h"
+#include "SpawnPlan.h"
 
 namespace ohw {
 	class GameMode : public IGameMode {
@@ -46,6 +48,12 @@ namespace ohw {
 
 		void AssignActorToPlayer( Actor *target, Player *owner ) override;
 
+		void SaveState( WorldSnapshot &snapshot ) const override;
+		bool RestoreState( WorldSnapshot &snapshot ) override;
+
+		bool UndoTurn();
+		const WorldSnapshot &GetTurnSnapshot() const { return turnSnapshot; }
+
 	protected:
 		void StartTurn( Player *player ) override;
 		void EndTurn( Player *player ) override;
@@ -54,5 +62,10 @@ namespace ohw {
 		void DestroyActors() override;
 
 	private:
+		WorldSnapshot roundSnapshot;    // as everything was spawned, for restarting
+		WorldSnapshot turnSnapshot;     // start of the current turn, for undo and recovery
+
+		SpawnPlan spawnPlan;            // the map's spawns, worked out on the first round
+		ActorManager::SpawnFactory airshipFactory;
 	};
 }
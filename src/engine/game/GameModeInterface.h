@@ -22,6 +22,8 @@ struct PlayerTeam;
 class Player;
 
 namespace ohw {
+	class WorldSnapshot;
+
 	class IGameMode {
 	public:
 		virtual ~IGameMode() = default;
@@ -54,6 +56,9 @@ namespace ohw {
 
 		virtual void AssignActorToPlayer( Actor *target, Player *owner ) = 0;
 
+		virtual void SaveState( WorldSnapshot &snapshot ) const = 0;
+		virtual bool RestoreState( WorldSnapshot &snapshot ) = 0;
+
 	protected:
 		virtual void StartTurn( Player *player ) = 0;
 		virtual void EndTurn( Player *player ) = 0;
@@ -32,11 +32,15 @@ public:
 
 	void AddChild( Actor *actor );
 	void RemoveChild( Actor *actor );
+	void ClearChildren() { myChildActors.clear(); }
+	Actor *GetChild( unsigned int i ) { return myChildActors[ i ]; }
 
 	void PossessCurrentChild();
 	void DispossessCurrentChild();
 
 	Actor *GetCurrentChild();
+	unsigned int GetCurrentChildIndex() const { return myCurrentChildActorIndex; }
+	void SetCurrentChildIndex( unsigned int i ) { myCurrentChildActorIndex = i; }
 
 	void CycleChildren( bool forward = true );
 
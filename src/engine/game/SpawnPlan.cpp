@@ -0,0 +1,101 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "App.h"
+#include "SpawnPlan.h"
+#include "Player.h"
+#include "APig.h"
+
+void ohw::SpawnPlan::Compile( const std::vector< ActorSpawn > &spawns ) {
+	Clear();
+
+	ActorManager *actorManager = ActorManager::GetInstance();
+
+	// Anything that can't be found ends up as a static model instead
+	ActorManager::SpawnFactory fallback;
+	unsigned int fallbackIndex = 0;
+
+	const PlayerPtrVector &players = GetApp()->gameManager->GetPlayers();
+
+	std::map< std::string, unsigned int > classIndices;
+	spawns_.reserve( spawns.size() );
+	for ( const auto &spawn : spawns ) {
+		auto i = classIndices.find( spawn.className );
+		if ( i == classIndices.end() ) {
+			ClassEntry entry;
+			entry.factory = actorManager->FindSpawnFactory( spawn.className );
+			if ( entry.factory.construct == nullptr ) {
+				if ( fallback.construct == nullptr ) {
+					fallback = actorManager->FindSpawnFactory( "model_static" );
+					if ( fallback.construct == nullptr ) {
+						continue;
+					}
+
+					fallbackIndex = classes_.size();
+					classes_.push_back( ClassEntry() );
+					classes_.back().factory = fallback;
+				}
+
+				i = classIndices.emplace( spawn.className, fallbackIndex ).first;
+			} else {
+				i = classIndices.emplace( spawn.className, classes_.size() ).first;
+				classes_.push_back( entry );
+			}
+		}
+
+		SpawnEntry entry;
+		entry.classIndex = i->second;
+		entry.spawn = &spawn;
+		entry.owner = ( spawn.team < players.size() ) ? players[ spawn.team ] : nullptr;
+		spawns_.push_back( entry );
+	}
+
+	isCompiled_ = true;
+
+	DebugMsg( "Compiled %u spawns across %u classes\n", ( unsigned int ) spawns_.size(), ( unsigned int ) classes_.size() );
+}
+
+void ohw::SpawnPlan::Clear() {
+	classes_.clear();
+	spawns_.clear();
+	isCompiled_ = false;
+}
+
+void ohw::SpawnPlan::Spawn() {
+	ActorManager *actorManager = ActorManager::GetInstance();
+	for ( const auto &entry : spawns_ ) {
+		ClassEntry &classEntry = classes_[ entry.classIndex ];
+		Actor *actor = actorManager->CreateActor( classEntry.factory, *entry.spawn );
+
+		if ( classEntry.binding == ClassEntry::Binding::UNKNOWN ) {
+			classEntry.binding = ( dynamic_cast< APig * >( actor ) != nullptr ) ?
+			                     ClassEntry::Binding::TEAM : ClassEntry::Binding::NONE;
+		}
+
+		if ( classEntry.binding != ClassEntry::Binding::TEAM ) {
+			continue;
+		}
+
+		if ( entry.owner == nullptr ) {
+			Warning( "Failed to assign pig to team!\n" );
+			continue;
+		}
+
+		static_cast< APig * >( actor )->SetPlayerOwner( entry.owner );
+	}
+}
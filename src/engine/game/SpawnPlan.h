@@ -0,0 +1,66 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "ActorManager.h"
+
+class Player;
+
+namespace ohw {
+	/**
+	 * Everything the spawns for a map need, worked out once, so each round
+	 * can create its actors without looking anything up by name.
+	 *
+	 * Spawns are resolved to the factory for their class, falling back to a
+	 * static model for anything that isn't known, and each is bound to the
+	 * player for its team, which only ends up being used for pigs.
+	 */
+	class SpawnPlan {
+	public:
+		void Compile( const std::vector< ActorSpawn > &spawns );
+		void Clear();
+
+		PL_INLINE bool IsCompiled() const { return isCompiled_; }
+		PL_INLINE size_t GetNumSpawns() const { return spawns_.size(); }
+
+		void Spawn();
+
+	private:
+		struct ClassEntry {
+			ActorManager::SpawnFactory factory;
+
+			/* whether it's a pig, found out the first time one's created */
+			enum class Binding : uint8_t {
+				UNKNOWN,
+				NONE,
+				TEAM,
+			} binding{ Binding::UNKNOWN };
+		};
+		std::vector< ClassEntry > classes_;
+
+		struct SpawnEntry {
+			unsigned int classIndex;
+			const ActorSpawn *spawn;
+			Player *owner;
+		};
+		std::vector< SpawnEntry > spawns_;
+
+		bool isCompiled_{ false };
+	};
+}
@@ -0,0 +1,535 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "App.h"
+#include "Map.h"
+#include "ActorManager.h"
+#include "Player.h"
+#include "Random.h"
+#include "WorldSnapshot.h"
+
+/* Snapshot (.ohws), all little-endian as it's written straight out of memory.
+ *
+ * header
+ * game state  length prefixed, what the GameManager keeps between ticks
+ * mode state  length prefixed, empty if there's no mode
+ * actors      address and class of each, so references can be resolved up front
+ * actor state length prefixed, written by each actor's SaveState
+ * players     children and which is current */
+
+#define SNAPSHOT_MAX_MAP    64
+
+typedef struct __attribute__((packed)) SnapshotHeader {
+	char identifier[4];
+	uint32_t version;
+	uint64_t session;               /* actors are only matched up by address within the same run */
+	char map[SNAPSHOT_MAX_MAP];
+	uint32_t num_actors;
+	uint32_t has_mode;
+	uint32_t sim_ticks;
+	uint64_t random_state;
+} SnapshotHeader;
+
+static uint64_t Snapshot_GetSession() {
+	static uint64_t session = 0;
+	if ( session == 0 ) {
+		session = ( ( uint64_t ) time( nullptr ) << 32 ) ^ ( uint64_t ) ( uintptr_t ) &session;
+	}
+	return session;
+}
+
+static const char *Snapshot_GetMapName() {
+	ohw::Map *map = ohw::GetApp()->gameManager->GetCurrentMap();
+	if ( map == nullptr || map->GetManifest() == nullptr ) {
+		return nullptr;
+	}
+	return map->GetManifest()->filename.c_str();
+}
+
+void ohw::WorldSnapshot::Reserve( size_t size ) {
+	if ( length + size <= data.size() ) {
+		return;
+	}
+
+	data.resize( std::max( data.size() * 2, length + size ) );
+}
+
+void ohw::WorldSnapshot::Write( const void *buffer, size_t size ) {
+	if ( size == 0 ) {
+		return;
+	}
+
+	Reserve( size );
+	memcpy( &data[ length ], buffer, size );
+	length += size;
+}
+
+void ohw::WorldSnapshot::WriteActor( const Actor *actor ) {
+	if ( !isHashing ) {
+		Write< uint64_t >( ( uintptr_t ) actor );
+		return;
+	}
+
+	// Addresses change from run to run, so go by what it is instead
+	uint64_t hash = 0;
+	if ( actor != nullptr ) {
+		const char *className = actor->GetClassIdentifier();
+		hash = u_hash( className, ( className != nullptr ) ? strlen( className ) : 0, actor->GetNetworkId() );
+	}
+	Write( hash );
+}
+
+void ohw::WorldSnapshot::WriteProperties( const PropertyOwner *owner ) {
+	// Try whatever room we have left first, it'll usually fit
+	Reserve( sizeof( uint32_t ) );
+	size_t start = length + sizeof( uint32_t );
+	size_t size = owner->SerialiseProperties( &data[ 0 ] + start, data.size() - start );
+	if ( start + size > data.size() ) {
+		length = start;
+		Reserve( size );
+		owner->SerialiseProperties( &data[ start ], size );
+	}
+
+	uint32_t storedSize = ( uint32_t ) size;
+	memcpy( &data[ start - sizeof( uint32_t ) ], &storedSize, sizeof( storedSize ) );
+	length = start + size;
+}
+
+bool ohw::WorldSnapshot::Read( void *buffer, size_t size ) {
+	return Bin_ReadArray( &reader, buffer, size, 1 );
+}
+
+/**
+ * Returns false if the actor wasn't part of the snapshot.
+ */
+bool ohw::WorldSnapshot::ReadActor( Actor **actor ) {
+	uint64_t address;
+	if ( !Read( &address ) ) {
+		return false;
+	}
+
+	if ( address == 0 ) {
+		*actor = nullptr;
+		return true;
+	}
+
+	// Captured in set order, so they're already sorted
+	auto i = std::lower_bound( capturedActors.begin(), capturedActors.end(), address );
+	if ( i == capturedActors.end() || *i != address ) {
+		return false;
+	}
+
+	*actor = restoredActors[ i - capturedActors.begin() ];
+	return true;
+}
+
+bool ohw::WorldSnapshot::ReadProperties( PropertyOwner *owner ) {
+	uint32_t size;
+	if ( !Read( &size ) ) {
+		return false;
+	}
+
+	const uint8_t *view = Bin_ReadView( &reader, size, 1 );
+	return ( view != nullptr && owner->DeserialiseProperties( view, size ) );
+}
+
+size_t ohw::WorldSnapshot::BeginBlock() {
+	size_t start = length;
+	Write< uint32_t >( 0 );
+	return start;
+}
+
+void ohw::WorldSnapshot::EndBlock( size_t start ) {
+	uint32_t blockLength = length - start - sizeof( uint32_t );
+	memcpy( &data[ start ], &blockLength, sizeof( blockLength ) );
+}
+
+/**
+ * Steps over a length prefixed block, returning where its contents start and end.
+ */
+bool ohw::WorldSnapshot::SkipBlock( size_t *start, size_t *end ) {
+	uint32_t blockLength;
+	if ( !Read( &blockLength ) ) {
+		return false;
+	}
+
+	*start = reader.pos;
+	if ( !Bin_Skip( &reader, blockLength ) ) {
+		return false;
+	}
+	*end = reader.pos;
+	return true;
+}
+
+void ohw::WorldSnapshot::Capture() {
+	length = 0;
+
+	const ActorSet &actors = ActorManager::GetInstance()->GetActors();
+	IGameMode *mode = GetApp()->gameManager->GetMode();
+
+	SnapshotHeader header;
+	memset( &header, 0, sizeof( header ) );
+	memcpy( header.identifier, SNAPSHOT_IDENTIFIER, sizeof( header.identifier ) );
+	header.version = SNAPSHOT_VERSION;
+	header.session = Snapshot_GetSession();
+	const char *mapName = Snapshot_GetMapName();
+	snprintf( header.map, sizeof( header.map ), "%s", ( mapName != nullptr ) ? mapName : "" );
+	header.num_actors = actors.size();
+	header.has_mode = ( mode != nullptr );
+	header.sim_ticks = GetApp()->GetSimulationTicks();
+	header.random_state = Random::GetState();
+	Write( header );
+
+	size_t start = BeginBlock();
+	GetApp()->gameManager->SaveState( *this );
+	EndBlock( start );
+
+	start = BeginBlock();
+	if ( mode != nullptr ) {
+		mode->SaveState( *this );
+	}
+	EndBlock( start );
+
+	for ( auto actor : actors ) {
+		WriteActor( actor );
+
+		const char *className = actor->GetClassIdentifier();
+		uint8_t classNameLength = ( className != nullptr ) ? strlen( className ) : 0;
+		Write( classNameLength );
+		Write( className, classNameLength );
+	}
+
+	for ( auto actor : actors ) {
+		start = BeginBlock();
+		actor->SaveState( *this );
+		EndBlock( start );
+	}
+
+	const PlayerPtrVector &players = GetApp()->gameManager->GetPlayers();
+	Write< uint32_t >( players.size() );
+	for ( auto player : players ) {
+		Write< uint32_t >( player->GetNumChildren() );
+		for ( unsigned int i = 0; i < player->GetNumChildren(); ++i ) {
+			WriteActor( player->GetChild( i ) );
+		}
+		Write< uint32_t >( player->GetCurrentChildIndex() );
+	}
+}
+
+/**
+ * Everything is read through and checked before any of it is applied, so
+ * a bad snapshot leaves the world exactly as it was.
+ */
+bool ohw::WorldSnapshot::Restore() {
+	Bin_InitReader( &reader, data.data(), length );
+
+	SnapshotHeader header;
+	if ( !Read( &header ) ||
+	     memcmp( header.identifier, SNAPSHOT_IDENTIFIER, sizeof( header.identifier ) ) != 0 ||
+	     header.version != SNAPSHOT_VERSION ) {
+		Warning( "Invalid snapshot!\n" );
+		return false;
+	}
+
+	// Terrain isn't part of the snapshot, so it has to be the same map
+	const char *mapName = Snapshot_GetMapName();
+	header.map[ SNAPSHOT_MAX_MAP - 1 ] = '\0';
+	if ( mapName == nullptr || strcmp( header.map, mapName ) != 0 ) {
+		Warning( "Snapshot was taken on a different map (\"%s\")!\n", header.map );
+		return false;
+	}
+
+	IGameMode *mode = GetApp()->gameManager->GetMode();
+	if ( header.has_mode && mode == nullptr ) {
+		Warning( "Snapshot was taken during a game, but there isn't one running!\n" );
+		return false;
+	}
+
+	SnapshotLayout layout;
+	if ( !SkipBlock( &layout.gameStart, &layout.gameEnd ) ||
+	     !SkipBlock( &layout.modeStart, &layout.modeEnd ) ||
+	     !ReadActorTable( header.num_actors, &layout ) ||
+	     !ReadPlayers( false ) ) {
+		Warning( "Snapshot is corrupt, ignoring!\n" );
+		return false;
+	}
+
+	// Now it's safe to start changing things
+	GetApp()->SetSimulationTicks( header.sim_ticks );
+	Random::SetState( header.random_state );
+
+	bool status = true;
+
+	reader.pos = layout.gameStart;
+	if ( !GetApp()->gameManager->RestoreState( *this ) || reader.pos != layout.gameEnd ) {
+		Warning( "Failed to restore game from snapshot!\n" );
+		reader.overflow = false;
+		status = false;
+	}
+
+	reader.pos = layout.modeStart;
+	if ( header.has_mode && ( !mode->RestoreState( *this ) || reader.pos != layout.modeEnd ) ) {
+		Warning( "Failed to restore mode from snapshot!\n" );
+		reader.overflow = false;
+		status = false;
+	}
+
+	status &= RestoreActors( layout, header.session == Snapshot_GetSession() );
+
+	reader.pos = layout.playersStart;
+	status &= ReadPlayers( true );
+
+	reader.overflow = false;
+	if ( !status ) {
+		Warning( "World may not have been fully restored from snapshot!\n" );
+	}
+
+	return status;
+}
+
+/**
+ * Reads in the class of every actor, making sure each one can be created,
+ * and then steps over their state so we know where it all is.
+ */
+bool ohw::WorldSnapshot::ReadActorTable( uint32_t numActors, SnapshotLayout *layout ) {
+	if ( numActors > Bin_GetRemaining( &reader ) ) {
+		return false;
+	}
+
+	capturedActors.resize( numActors );
+	layout->classNames.resize( numActors );
+	for ( unsigned int i = 0; i < numActors; ++i ) {
+		uint8_t classNameLength;
+		char className[ 256 ];
+		if ( !Read( &capturedActors[ i ] ) || !Read( &classNameLength ) || !Read( className, classNameLength ) ) {
+			return false;
+		}
+		className[ classNameLength ] = '\0';
+
+		// ReadActor relies on these being in order
+		if ( capturedActors[ i ] == 0 || ( i > 0 && capturedActors[ i ] <= capturedActors[ i - 1 ] ) ) {
+			return false;
+		}
+
+		if ( ActorManager::actorClassesRegistry.find( className ) == ActorManager::actorClassesRegistry.end() ) {
+			Warning( "Unknown actor class in snapshot, \"%s\"!\n", className );
+			return false;
+		}
+
+		layout->classNames[ i ] = className;
+	}
+
+	layout->actorStarts.resize( numActors );
+	layout->actorEnds.resize( numActors );
+	for ( unsigned int i = 0; i < numActors; ++i ) {
+		if ( !SkipBlock( &layout->actorStarts[ i ], &layout->actorEnds[ i ] ) ) {
+			return false;
+		}
+	}
+
+	layout->playersStart = reader.pos;
+	return true;
+}
+
+bool ohw::WorldSnapshot::RestoreActors( const SnapshotLayout &layout, bool isSameSession ) {
+	ActorManager *actorManager = ActorManager::GetInstance();
+
+	unsigned int numActors = capturedActors.size();
+	restoredActors.resize( numActors );
+
+	// Match everything up with what we already have, and create what we don't
+	std::vector< Actor * > createdActors;
+	for ( unsigned int i = 0; i < numActors; ++i ) {
+		const char *className = layout.classNames[ i ].c_str();
+
+		Actor *actor = nullptr;
+		if ( isSameSession ) {
+			auto existing = actorManager->actorsList.find( ( Actor * ) ( uintptr_t ) capturedActors[ i ] );
+			if ( existing != actorManager->actorsList.end() && ( *existing )->GetClassIdentifier() != nullptr &&
+			     strcmp( ( *existing )->GetClassIdentifier(), className ) == 0 ) {
+				actor = *existing;
+			}
+		}
+
+		if ( actor == nullptr ) {
+			actor = actorManager->CreateActorOfClass( className );
+			createdActors.push_back( actor );
+		}
+
+		restoredActors[ i ] = actor;
+	}
+
+	// Then get rid of anything that's been spawned since, and keep anything
+	// that was on its way out but is in the snapshot
+	std::vector< Actor * > keptActors( restoredActors );
+	std::sort( keptActors.begin(), keptActors.end() );
+
+	auto &queue = actorManager->destructionQueue;
+	queue.erase( std::remove_if( queue.begin(), queue.end(), [ &keptActors ]( Actor *actor ) {
+		return std::binary_search( keptActors.begin(), keptActors.end(), actor );
+	} ), queue.end() );
+
+	std::vector< Actor * > removedActors;
+	for ( auto actor : actorManager->actorsList ) {
+		if ( !std::binary_search( keptActors.begin(), keptActors.end(), actor ) ) {
+			removedActors.push_back( actor );
+		}
+	}
+
+	// Anything they had attached is either going too, or is being kept and
+	// gets its parent from the snapshot
+	for ( auto actor : removedActors ) {
+		actor->ReleaseChildren();
+		actorManager->DestroyActor( actor );
+	}
+	actorManager->DestroyQueuedActors();
+
+	bool status = true;
+	for ( unsigned int i = 0; i < numActors; ++i ) {
+		reader.pos = layout.actorStarts[ i ];
+		if ( !restoredActors[ i ]->RestoreState( *this ) || reader.pos != layout.actorEnds[ i ] ) {
+			Warning( "Failed to restore actor %u from snapshot!\n", i );
+			reader.overflow = false;
+			status = false;
+		}
+	}
+
+	// Now they're back where they were, anything created again needs its body back too
+	for ( auto actor : createdActors ) {
+		actor->CreatePhysicsBody();
+	}
+
+	return status;
+}
+
+/**
+ * Checks the players match up with what we've got, and only changes them if apply is set.
+ */
+bool ohw::WorldSnapshot::ReadPlayers( bool apply ) {
+	const PlayerPtrVector &players = GetApp()->gameManager->GetPlayers();
+
+	uint32_t numPlayers;
+	if ( !Read( &numPlayers ) || numPlayers != players.size() ) {
+		return false;
+	}
+
+	for ( auto player : players ) {
+		uint32_t numChildren;
+		if ( !Read( &numChildren ) || numChildren > Bin_GetRemaining( &reader ) ) {
+			return false;
+		}
+
+		if ( apply ) {
+			player->ClearChildren();
+		}
+
+		for ( unsigned int i = 0; i < numChildren; ++i ) {
+			if ( !apply ) {
+				uint64_t address;
+				if ( !Read( &address ) ||
+				     ( address != 0 && !std::binary_search( capturedActors.begin(), capturedActors.end(), address ) ) ) {
+					return false;
+				}
+				continue;
+			}
+
+			Actor *child;
+			if ( !ReadActor( &child ) ) {
+				return false;
+			}
+
+			if ( child != nullptr ) {
+				player->AddChild( child );
+			}
+		}
+
+		uint32_t currentChild;
+		if ( !Read( &currentChild ) ) {
+			return false;
+		}
+
+		if ( apply ) {
+			player->SetCurrentChildIndex( currentChild );
+		}
+	}
+
+	return true;
+}
+
+void ohw::WorldSnapshot::SetData( const void *buffer, size_t size ) {
+	length = 0;
+	Write( buffer, size );
+}
+
+/**
+ * Writes out to a temporary file first and then moves it into place,
+ * so a crash part way through doesn't take out the last good snapshot.
+ */
+bool ohw::WorldSnapshot::Save( const char *path ) const {
+	char tmpPath[ PL_SYSTEM_MAX_PATH ];
+	snprintf( tmpPath, sizeof( tmpPath ), "%s.tmp", path );
+
+	FILE *fp = fopen( tmpPath, "wb" );
+	if ( fp == nullptr ) {
+		Warning( "Failed to open \"%s\" for writing!\n", tmpPath );
+		return false;
+	}
+
+	bool status = ( fwrite( data.data(), 1, length, fp ) == length );
+	status &= ( fclose( fp ) == 0 );
+	if ( !status ) {
+		Warning( "Failed to write snapshot to \"%s\"!\n", tmpPath );
+		remove( tmpPath );
+		return false;
+	}
+
+	remove( path );
+	if ( rename( tmpPath, path ) != 0 ) {
+		Warning( "Failed to move snapshot into place at \"%s\"!\n", path );
+		remove( tmpPath );
+		return false;
+	}
+
+	return true;
+}
+
+bool ohw::WorldSnapshot::Load( const char *path ) {
+	FILE *fp = fopen( path, "rb" );
+	if ( fp == nullptr ) {
+		Warning( "Failed to open \"%s\"!\n", path );
+		return false;
+	}
+
+	fseek( fp, 0, SEEK_END );
+	long size = ftell( fp );
+	fseek( fp, 0, SEEK_SET );
+
+	length = 0;
+	if ( size > 0 ) {
+		Reserve( size );
+		length = fread( data.data(), 1, size, fp );
+	}
+	fclose( fp );
+
+	if ( length == 0 || length != ( size_t ) size ) {
+		Warning( "Failed to read snapshot from \"%s\"!\n", path );
+		length = 0;
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,98 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "../loaders/BinaryReader.h"
+
+#define SNAPSHOT_IDENTIFIER "OHWS"
+#define SNAPSHOT_VERSION    4
+
+class Actor;
+class PropertyOwner;
+
+namespace ohw {
+	/**
+	 * Binary copy of the simulation state: every actor and its properties,
+	 * which player owns what, whose turn it is, the simulation tick and the
+	 * state of the random number generator.
+	 *
+	 * Restoring is done in place, so any actors that still exist are just
+	 * written over, and only those that have been destroyed since are created
+	 * again. Actors that didn't exist when the snapshot was taken are removed.
+	 */
+	class WorldSnapshot {
+	public:
+		void Capture();
+		bool Restore();
+
+		PL_INLINE bool IsValid() const { return length > 0; }
+		PL_INLINE size_t GetSize() const { return length; }
+		PL_INLINE void Clear() { length = 0; }
+
+		/* actors are written out as something that stays the same from run to
+		 * run rather than their address, for comparing state but not restoring it */
+		PL_INLINE void SetHashing( bool hashing ) { isHashing = hashing; }
+
+		bool Save( const char *path ) const;
+		bool Load( const char *path );
+
+		PL_INLINE const uint8_t *GetData() const { return data.data(); }
+		void SetData( const void *buffer, size_t size );
+
+		/* used by actors and the mode to write out / read back their own state */
+
+		void Write( const void *buffer, size_t size );
+		template< typename T > void Write( const T &value ) { Write( &value, sizeof( T ) ); }
+		void WriteActor( const Actor *actor );
+		void WriteProperties( const PropertyOwner *owner );
+
+		bool Read( void *buffer, size_t size );
+		template< typename T > bool Read( T *value ) { return Read( value, sizeof( T ) ); }
+		bool ReadActor( Actor **actor );
+		bool ReadProperties( PropertyOwner *owner );
+
+	private:
+		/* where everything is, worked out before anything is restored */
+		struct SnapshotLayout {
+			size_t gameStart, gameEnd;
+			size_t modeStart, modeEnd;
+			std::vector< std::string > classNames;
+			std::vector< size_t > actorStarts, actorEnds;
+			size_t playersStart;
+		};
+
+		bool ReadActorTable( uint32_t numActors, SnapshotLayout *layout );
+		bool RestoreActors( const SnapshotLayout &layout, bool isSameSession );
+		bool ReadPlayers( bool apply );
+
+		size_t BeginBlock();
+		void EndBlock( size_t start );
+		bool SkipBlock( size_t *start, size_t *end );
+
+		void Reserve( size_t size );
+
+		std::vector< uint8_t > data;            // grown as needed, but never shrunk
+		size_t length{ 0 };
+		BinReader reader;
+		bool isHashing{ false };
+
+		/* lookup from an actor's address at capture, to where it is now */
+		std::vector< uint64_t > capturedActors;
+		std::vector< Actor * > restoredActors;
+	};
+}
@@ -18,6 +18,7 @@
 #include "App.h"
 #include "BitmapFont.h"
 #include "Display.h"
+#include "Metrics.h"
 
 ohw::BitmapFont::BitmapFont() {
 	renderMesh = plCreateMesh( PL_MESH_TRIANGLES, PL_DRAW_DYNAMIC, 512, 256 );
@@ -94,7 +95,9 @@ void ohw::BitmapFont::DrawCharacter( float x, float y, float scale, PLColour col
 	plSetShaderUniformValue( program, "pl_model", &matrix, false );
 
 	plUploadMesh( renderMesh );
+	METRIC_COUNTER( "render.mesh_uploads" )->Add();
 	plDrawMesh( renderMesh );
+	METRIC_COUNTER( "render.draw_calls" )->Add();
 }
 
 /**
@@ -142,7 +145,9 @@ void ohw::BitmapFont::DrawString( float x, float y, float spacing, float scale,
 	plSetShaderUniformValue( program, "pl_model", plGetMatrix( PL_MODELVIEW_MATRIX ), false );
 
 	plUploadMesh( renderMesh );
+	METRIC_COUNTER( "render.mesh_uploads" )->Add();
 	plDrawMesh( renderMesh );
+	METRIC_COUNTER( "render.draw_calls" )->Add();
 
 	plPopMatrix();
 }
@@ -21,6 +21,8 @@
 #include "Map.h"
 #include "ShaderManager.h"
 #include "Camera.h"
+#include "Visibility.h"
+#include "FrameLimiter.h"
 
 #include "game/ActorManager.h"
 #include "Display.h"
@@ -31,14 +33,14 @@
 void Display_GetFramesCount( unsigned int *fps, unsigned int *ms ) {
 	static unsigned int fps_ = 0;
 	static unsigned int ms_ = 0;
-	//static unsigned int update_delay = 60;
-#if 0 // todo: revisit
-	if ( update_delay < g_state.draw_ticks && g_state.last_draw_ms > 0 ) {
-		ms_ = g_state.last_draw_ms;
-		fps_ = 1000 / ms_;
-		update_delay = g_state.draw_ticks + 60;
+	static unsigned int update_delay = 0;
+	// Only updated every so often, otherwise it's unreadable
+	if ( update_delay < ohw::GetApp()->GetTicks() ) {
+		double frameTime = ohw::FrameLimiter::GetInstance()->GetFrameTime();
+		ms_ = ( unsigned int ) ( frameTime * 1000.0 + 0.5 );
+		fps_ = ( frameTime > 0.0 ) ? ( unsigned int ) ( 1.0 / frameTime + 0.5 ) : 0;
+		update_delay = ohw::GetApp()->GetTicks() + 500;
 	}
-#endif
 
 	*fps = fps_;
 	*ms = ms_;
@@ -188,6 +190,21 @@ void ohw::Display::Render( double delta ) {
 	Swap();
 }
 
+/**
+ * Just the loading screen, for while a map is being loaded and nothing
+ * else is safe to draw.
+ */
+void ohw::Display::RenderLoadingScreen() {
+	plBindFrameBuffer( nullptr, PL_FRAMEBUFFER_DRAW );
+
+	plSetClearColour( PLColour( 0, 0, 0, 255 ) );
+	plClearBuffers( PL_BUFFER_DEPTH | PL_BUFFER_COLOUR );
+
+	RenderOverlays();
+
+	Swap();
+}
+
 void ohw::Display::RenderScene() {
 	ohw::Camera *camera = ohw::GetApp()->gameManager->GetActiveCamera();
 	if ( camera == nullptr ) {
@@ -207,6 +224,14 @@ void ohw::Display::RenderScene() {
 
 	camera->MakeActive();
 
+	// Work out what's visible once, for everything else to use
+	ohw::Map *map = ohw::GetApp()->gameManager->GetCurrentMap();
+	if ( map != nullptr ) {
+		ohw::Visibility::GetInstance()->Update( camera, map->GetTerrain(), map->GetCullDistance() );
+	} else {
+		ohw::Visibility::GetInstance()->Update( camera, nullptr, 0.0f );
+	}
+
 	if ( cv_graphics_alpha_to_coverage->b_value ) {
 		plEnableGraphicsState( PL_GFX_STATE_ALPHATOCOVERAGE );
 	}
@@ -322,6 +347,14 @@ bool ohw::Display::HandleEvent( const SDL_Event &event ) {
 	return false;
 }
 
+bool ohw::Display::IsMinimized() const {
+	return ( SDL_GetWindowFlags( myWindow ) & ( SDL_WINDOW_MINIMIZED | SDL_WINDOW_HIDDEN ) ) != 0;
+}
+
+bool ohw::Display::HasFocus() const {
+	return ( SDL_GetWindowFlags( myWindow ) & SDL_WINDOW_INPUT_FOCUS ) != 0;
+}
+
 void ohw::Display::SetMousePosition( int x, int y ) {
 	SDL_WarpMouseInWindow( myWindow, x, y );
 }
@@ -31,6 +31,7 @@ namespace ohw {
 		void SetIcon( const char *path );
 
 		void Render( double delta );
+		void RenderLoadingScreen();
 
 		void SetDisplaySize( int w, int h, bool fullscreen );
 		void GetDisplaySize( int *w, int *h );
@@ -40,6 +41,9 @@ namespace ohw {
 
 		bool HandleEvent( const SDL_Event &event );
 
+		bool IsMinimized() const;
+		bool HasFocus() const;
+
 		void SetMousePosition( int x, int y );
 
 		void DebugDrawLine( const PLVector3 &startPos, const PLVector3 &endPos, const PLColour &colour );
@@ -0,0 +1,438 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include "ImageKernels.h"
+
+#if defined( __GNUC__ ) && ( defined( __x86_64__ ) || defined( __i386__ ) )
+#   define IMG_HAS_X86
+#   include <immintrin.h>
+#   define IMG_TARGET( A ) __attribute__((target(A)))
+#endif
+
+/************************************************************/
+/* Scalar */
+
+static inline void Img_DecodeRGB5A1( uint16_t c, uint8_t *out ) {
+	uint8_t r = c & 31, g = ( c >> 5 ) & 31, b = ( c >> 10 ) & 31;
+	out[ 0 ] = ( r << 3 ) | ( r >> 2 );
+	out[ 1 ] = ( g << 3 ) | ( g >> 2 );
+	out[ 2 ] = ( b << 3 ) | ( b >> 2 );
+	out[ 3 ] = 255;
+}
+
+static void Img_ConvertRGB5A1ToRGBA8_Scalar( const uint8_t *src, uint8_t *dst, size_t numPixels ) {
+	for ( size_t i = 0; i < numPixels; ++i ) {
+		uint16_t c;
+		memcpy( &c, src + i * 2, sizeof( uint16_t ) );
+		Img_DecodeRGB5A1( c, dst + i * 4 );
+	}
+}
+
+static void Img_ConvertRGB8ToRGBA8_Scalar( const uint8_t *src, uint8_t *dst, size_t numPixels ) {
+	for ( size_t i = 0; i < numPixels; ++i, src += 3, dst += 4 ) {
+		dst[ 0 ] = src[ 0 ];
+		dst[ 1 ] = src[ 1 ];
+		dst[ 2 ] = src[ 2 ];
+		dst[ 3 ] = 255;
+	}
+}
+
+static void Img_ReplaceColour_Scalar( uint8_t *rgba, size_t numPixels, uint32_t key, uint32_t replacement ) {
+	for ( size_t i = 0; i < numPixels; ++i ) {
+		uint32_t c;
+		memcpy( &c, rgba + i * 4, sizeof( uint32_t ) );
+		if ( c == key ) {
+			memcpy( rgba + i * 4, &replacement, sizeof( uint32_t ) );
+		}
+	}
+}
+
+static void Img_ExtractChannel_Scalar( const uint8_t *rgba, size_t numPixels, unsigned int channel, uint8_t *dst ) {
+	for ( size_t i = 0; i < numPixels; ++i ) {
+		dst[ i ] = rgba[ i * 4 + channel ];
+	}
+}
+
+static void Img_ExtractChannelF_Scalar( const uint8_t *rgba, size_t numPixels, unsigned int channel, float scale, float *dst ) {
+	for ( size_t i = 0; i < numPixels; ++i ) {
+		dst[ i ] = ( float ) rgba[ i * 4 + channel ] * scale;
+	}
+}
+
+static void Img_FillPixel_Scalar( uint8_t *dst, uint32_t colour, size_t numPixels ) {
+	for ( size_t i = 0; i < numPixels; ++i ) {
+		memcpy( dst + i * 4, &colour, sizeof( uint32_t ) );
+	}
+}
+
+/************************************************************/
+/* SSE2 */
+
+#if defined( IMG_HAS_X86 )
+
+/* expands 5-bit channels sitting in each 16-bit lane out to 8-bit */
+#define IMG_EXPAND5( V ) _mm_or_si128( _mm_slli_epi16( ( V ), 3 ), _mm_srli_epi16( ( V ), 2 ) )
+
+IMG_TARGET( "sse2" )
+static void Img_ConvertRGB5A1ToRGBA8_SSE2( const uint8_t *src, uint8_t *dst, size_t numPixels ) {
+	const __m128i mask = _mm_set1_epi16( 31 );
+	const __m128i alpha = _mm_set1_epi16( ( short ) 0xFF00 );
+
+	size_t i = 0;
+	for ( ; i + 8 <= numPixels; i += 8 ) {
+		__m128i v = _mm_loadu_si128( ( const __m128i * ) ( src + i * 2 ) );
+		__m128i r = _mm_and_si128( v, mask );
+		__m128i g = _mm_and_si128( _mm_srli_epi16( v, 5 ), mask );
+		__m128i b = _mm_and_si128( _mm_srli_epi16( v, 10 ), mask );
+		r = IMG_EXPAND5( r );
+		g = IMG_EXPAND5( g );
+		b = IMG_EXPAND5( b );
+
+		// pair up r/g and b/a into 16-bit lanes, then interleave those into pixels
+		__m128i rg = _mm_or_si128( r, _mm_slli_epi16( g, 8 ) );
+		__m128i ba = _mm_or_si128( b, alpha );
+		_mm_storeu_si128( ( __m128i * ) ( dst + i * 4 ), _mm_unpacklo_epi16( rg, ba ) );
+		_mm_storeu_si128( ( __m128i * ) ( dst + i * 4 + 16 ), _mm_unpackhi_epi16( rg, ba ) );
+	}
+
+	Img_ConvertRGB5A1ToRGBA8_Scalar( src + i * 2, dst + i * 4, numPixels - i );
+}
+
+IMG_TARGET( "sse2" )
+static void Img_ReplaceColour_SSE2( uint8_t *rgba, size_t numPixels, uint32_t key, uint32_t replacement ) {
+	const __m128i vkey = _mm_set1_epi32( ( int ) key );
+	const __m128i vreplacement = _mm_set1_epi32( ( int ) replacement );
+
+	size_t i = 0;
+	for ( ; i + 4 <= numPixels; i += 4 ) {
+		__m128i v = _mm_loadu_si128( ( const __m128i * ) ( rgba + i * 4 ) );
+		__m128i match = _mm_cmpeq_epi32( v, vkey );
+		v = _mm_or_si128( _mm_and_si128( match, vreplacement ), _mm_andnot_si128( match, v ) );
+		_mm_storeu_si128( ( __m128i * ) ( rgba + i * 4 ), v );
+	}
+
+	Img_ReplaceColour_Scalar( rgba + i * 4, numPixels - i, key, replacement );
+}
+
+IMG_TARGET( "sse2" )
+static void Img_ExtractChannel_SSE2( const uint8_t *rgba, size_t numPixels, unsigned int channel, uint8_t *dst ) {
+	const __m128i mask = _mm_set1_epi32( 0xFF );
+	const __m128i shift = _mm_cvtsi32_si128( ( int ) channel * 8 );
+
+	size_t i = 0;
+	for ( ; i + 16 <= numPixels; i += 16 ) {
+		const __m128i *p = ( const __m128i * ) ( rgba + i * 4 );
+		__m128i a = _mm_and_si128( _mm_srl_epi32( _mm_loadu_si128( p ), shift ), mask );
+		__m128i b = _mm_and_si128( _mm_srl_epi32( _mm_loadu_si128( p + 1 ), shift ), mask );
+		__m128i c = _mm_and_si128( _mm_srl_epi32( _mm_loadu_si128( p + 2 ), shift ), mask );
+		__m128i d = _mm_and_si128( _mm_srl_epi32( _mm_loadu_si128( p + 3 ), shift ), mask );
+		__m128i v = _mm_packus_epi16( _mm_packs_epi32( a, b ), _mm_packs_epi32( c, d ) );
+		_mm_storeu_si128( ( __m128i * ) ( dst + i ), v );
+	}
+
+	Img_ExtractChannel_Scalar( rgba + i * 4, numPixels - i, channel, dst + i );
+}
+
+IMG_TARGET( "sse2" )
+static void Img_ExtractChannelF_SSE2( const uint8_t *rgba, size_t numPixels, unsigned int channel, float scale, float *dst ) {
+	const __m128i mask = _mm_set1_epi32( 0xFF );
+	const __m128i shift = _mm_cvtsi32_si128( ( int ) channel * 8 );
+	const __m128 vscale = _mm_set1_ps( scale );
+
+	size_t i = 0;
+	for ( ; i + 4 <= numPixels; i += 4 ) {
+		__m128i v = _mm_loadu_si128( ( const __m128i * ) ( rgba + i * 4 ) );
+		v = _mm_and_si128( _mm_srl_epi32( v, shift ), mask );
+		_mm_storeu_ps( dst + i, _mm_mul_ps( _mm_cvtepi32_ps( v ), vscale ) );
+	}
+
+	Img_ExtractChannelF_Scalar( rgba + i * 4, numPixels - i, channel, scale, dst + i );
+}
+
+IMG_TARGET( "sse2" )
+static void Img_FillPixel_SSE2( uint8_t *dst, uint32_t colour, size_t numPixels ) {
+	const __m128i v = _mm_set1_epi32( ( int ) colour );
+
+	size_t i = 0;
+	for ( ; i + 4 <= numPixels; i += 4 ) {
+		_mm_storeu_si128( ( __m128i * ) ( dst + i * 4 ), v );
+	}
+
+	Img_FillPixel_Scalar( dst + i * 4, colour, numPixels - i );
+}
+
+/************************************************************/
+/* AVX2 */
+
+#define IMG_EXPAND5_256( V ) _mm256_or_si256( _mm256_slli_epi16( ( V ), 3 ), _mm256_srli_epi16( ( V ), 2 ) )
+
+IMG_TARGET( "avx2" )
+static void Img_ConvertRGB5A1ToRGBA8_AVX2( const uint8_t *src, uint8_t *dst, size_t numPixels ) {
+	const __m256i mask = _mm256_set1_epi16( 31 );
+	const __m256i alpha = _mm256_set1_epi16( ( short ) 0xFF00 );
+
+	size_t i = 0;
+	for ( ; i + 16 <= numPixels; i += 16 ) {
+		__m256i v = _mm256_loadu_si256( ( const __m256i * ) ( src + i * 2 ) );
+		__m256i r = _mm256_and_si256( v, mask );
+		__m256i g = _mm256_and_si256( _mm256_srli_epi16( v, 5 ), mask );
+		__m256i b = _mm256_and_si256( _mm256_srli_epi16( v, 10 ), mask );
+		r = IMG_EXPAND5_256( r );
+		g = IMG_EXPAND5_256( g );
+		b = IMG_EXPAND5_256( b );
+
+		__m256i rg = _mm256_or_si256( r, _mm256_slli_epi16( g, 8 ) );
+		__m256i ba = _mm256_or_si256( b, alpha );
+		__m256i lo = _mm256_unpacklo_epi16( rg, ba );   // pixels 0-3, 8-11
+		__m256i hi = _mm256_unpackhi_epi16( rg, ba );   // pixels 4-7, 12-15
+		_mm256_storeu_si256( ( __m256i * ) ( dst + i * 4 ), _mm256_permute2x128_si256( lo, hi, 0x20 ) );
+		_mm256_storeu_si256( ( __m256i * ) ( dst + i * 4 + 32 ), _mm256_permute2x128_si256( lo, hi, 0x31 ) );
+	}
+
+	Img_ConvertRGB5A1ToRGBA8_SSE2( src + i * 2, dst + i * 4, numPixels - i );
+}
+
+IMG_TARGET( "avx2" )
+static void Img_ConvertRGB8ToRGBA8_AVX2( const uint8_t *src, uint8_t *dst, size_t numPixels ) {
+	const __m256i shuffle = _mm256_setr_epi8(
+			0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+			0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1 );
+	const __m256i alpha = _mm256_set1_epi32( ( int ) 0xFF000000 );
+
+	// each half reads 16 bytes but only uses 12, so stop early enough to not read past the end
+	size_t i = 0;
+	for ( ; i + 11 <= numPixels; i += 8 ) {
+		__m128i a = _mm_loadu_si128( ( const __m128i * ) ( src + i * 3 ) );
+		__m128i b = _mm_loadu_si128( ( const __m128i * ) ( src + i * 3 + 12 ) );
+		__m256i v = _mm256_inserti128_si256( _mm256_castsi128_si256( a ), b, 1 );
+		v = _mm256_or_si256( _mm256_shuffle_epi8( v, shuffle ), alpha );
+		_mm256_storeu_si256( ( __m256i * ) ( dst + i * 4 ), v );
+	}
+
+	Img_ConvertRGB8ToRGBA8_Scalar( src + i * 3, dst + i * 4, numPixels - i );
+}
+
+IMG_TARGET( "avx2" )
+static void Img_ReplaceColour_AVX2( uint8_t *rgba, size_t numPixels, uint32_t key, uint32_t replacement ) {
+	const __m256i vkey = _mm256_set1_epi32( ( int ) key );
+	const __m256i vreplacement = _mm256_set1_epi32( ( int ) replacement );
+
+	size_t i = 0;
+	for ( ; i + 8 <= numPixels; i += 8 ) {
+		__m256i v = _mm256_loadu_si256( ( const __m256i * ) ( rgba + i * 4 ) );
+		__m256i match = _mm256_cmpeq_epi32( v, vkey );
+		_mm256_storeu_si256( ( __m256i * ) ( rgba + i * 4 ), _mm256_blendv_epi8( v, vreplacement, match ) );
+	}
+
+	Img_ReplaceColour_SSE2( rgba + i * 4, numPixels - i, key, replacement );
+}
+
+IMG_TARGET( "avx2" )
+static void Img_ExtractChannel_AVX2( const uint8_t *rgba, size_t numPixels, unsigned int channel, uint8_t *dst ) {
+	const __m256i mask = _mm256_set1_epi32( 0xFF );
+	const __m128i shift = _mm_cvtsi32_si128( ( int ) channel * 8 );
+	// packing works within each 128-bit lane, this puts the groups of four back in order
+	const __m256i order = _mm256_setr_epi32( 0, 4, 1, 5, 2, 6, 3, 7 );
+
+	size_t i = 0;
+	for ( ; i + 32 <= numPixels; i += 32 ) {
+		const __m256i *p = ( const __m256i * ) ( rgba + i * 4 );
+		__m256i a = _mm256_and_si256( _mm256_srl_epi32( _mm256_loadu_si256( p ), shift ), mask );
+		__m256i b = _mm256_and_si256( _mm256_srl_epi32( _mm256_loadu_si256( p + 1 ), shift ), mask );
+		__m256i c = _mm256_and_si256( _mm256_srl_epi32( _mm256_loadu_si256( p + 2 ), shift ), mask );
+		__m256i d = _mm256_and_si256( _mm256_srl_epi32( _mm256_loadu_si256( p + 3 ), shift ), mask );
+		__m256i v = _mm256_packus_epi16( _mm256_packs_epi32( a, b ), _mm256_packs_epi32( c, d ) );
+		_mm256_storeu_si256( ( __m256i * ) ( dst + i ), _mm256_permutevar8x32_epi32( v, order ) );
+	}
+
+	Img_ExtractChannel_SSE2( rgba + i * 4, numPixels - i, channel, dst + i );
+}
+
+IMG_TARGET( "avx2" )
+static void Img_ExtractChannelF_AVX2( const uint8_t *rgba, size_t numPixels, unsigned int channel, float scale, float *dst ) {
+	const __m256i mask = _mm256_set1_epi32( 0xFF );
+	const __m128i shift = _mm_cvtsi32_si128( ( int ) channel * 8 );
+	const __m256 vscale = _mm256_set1_ps( scale );
+
+	size_t i = 0;
+	for ( ; i + 8 <= numPixels; i += 8 ) {
+		__m256i v = _mm256_loadu_si256( ( const __m256i * ) ( rgba + i * 4 ) );
+		v = _mm256_and_si256( _mm256_srl_epi32( v, shift ), mask );
+		_mm256_storeu_ps( dst + i, _mm256_mul_ps( _mm256_cvtepi32_ps( v ), vscale ) );
+	}
+
+	Img_ExtractChannelF_SSE2( rgba + i * 4, numPixels - i, channel, scale, dst + i );
+}
+
+IMG_TARGET( "avx2" )
+static void Img_FillPixel_AVX2( uint8_t *dst, uint32_t colour, size_t numPixels ) {
+	const __m256i v = _mm256_set1_epi32( ( int ) colour );
+
+	size_t i = 0;
+	for ( ; i + 8 <= numPixels; i += 8 ) {
+		_mm256_storeu_si256( ( __m256i * ) ( dst + i * 4 ), v );
+	}
+
+	Img_FillPixel_Scalar( dst + i * 4, colour, numPixels - i );
+}
+
+#endif
+
+/************************************************************/
+/* Dispatch */
+
+typedef struct ImgKernels {
+	void ( *ConvertRGB5A1ToRGBA8 )( const uint8_t *src, uint8_t *dst, size_t numPixels );
+	void ( *ConvertRGB8ToRGBA8 )( const uint8_t *src, uint8_t *dst, size_t numPixels );
+	void ( *ReplaceColour )( uint8_t *rgba, size_t numPixels, uint32_t key, uint32_t replacement );
+	void ( *ExtractChannel )( const uint8_t *rgba, size_t numPixels, unsigned int channel, uint8_t *dst );
+	void ( *ExtractChannelF )( const uint8_t *rgba, size_t numPixels, unsigned int channel, float scale, float *dst );
+	void ( *FillPixel )( uint8_t *dst, uint32_t colour, size_t numPixels );
+} ImgKernels;
+
+static const ImgKernels kernelTable[ IMG_MAX_KERNEL_LEVELS ] = {
+	{
+		Img_ConvertRGB5A1ToRGBA8_Scalar, Img_ConvertRGB8ToRGBA8_Scalar, Img_ReplaceColour_Scalar,
+		Img_ExtractChannel_Scalar, Img_ExtractChannelF_Scalar, Img_FillPixel_Scalar,
+	},
+#if defined( IMG_HAS_X86 )
+	/* RGB8 needs a byte shuffle, which SSE2 doesn't have */
+	{
+		Img_ConvertRGB5A1ToRGBA8_SSE2, Img_ConvertRGB8ToRGBA8_Scalar, Img_ReplaceColour_SSE2,
+		Img_ExtractChannel_SSE2, Img_ExtractChannelF_SSE2, Img_FillPixel_SSE2,
+	},
+	{
+		Img_ConvertRGB5A1ToRGBA8_AVX2, Img_ConvertRGB8ToRGBA8_AVX2, Img_ReplaceColour_AVX2,
+		Img_ExtractChannel_AVX2, Img_ExtractChannelF_AVX2, Img_FillPixel_AVX2,
+	},
+#endif
+};
+
+static const ImgKernels *kernels = &kernelTable[ IMG_KERNEL_SCALAR ];
+static ImgKernelLevel kernelLevel = IMG_KERNEL_SCALAR;
+
+static bool Img_IsKernelLevelSupported( ImgKernelLevel level ) {
+	switch ( level ) {
+		case IMG_KERNEL_SCALAR: return true;
+#if defined( IMG_HAS_X86 )
+		case IMG_KERNEL_SSE2: return __builtin_cpu_supports( "sse2" );
+		case IMG_KERNEL_AVX2: return __builtin_cpu_supports( "avx2" );
+#endif
+		default: return false;
+	}
+}
+
+void Img_InitKernels( void ) {
+#if defined( IMG_HAS_X86 )
+	__builtin_cpu_init();
+#endif
+
+	for ( int level = IMG_MAX_KERNEL_LEVELS - 1; level >= 0; --level ) {
+		if ( Img_SetKernelLevel( ( ImgKernelLevel ) level ) ) {
+			break;
+		}
+	}
+}
+
+bool Img_SetKernelLevel( ImgKernelLevel level ) {
+	if ( level >= IMG_MAX_KERNEL_LEVELS || !Img_IsKernelLevelSupported( level ) ) {
+		return false;
+	}
+
+	kernels = &kernelTable[ level ];
+	kernelLevel = level;
+	return true;
+}
+
+ImgKernelLevel Img_GetKernelLevel( void ) {
+	return kernelLevel;
+}
+
+const char *Img_GetKernelLevelName( ImgKernelLevel level ) {
+	static const char *names[ IMG_MAX_KERNEL_LEVELS ] = { "Scalar", "SSE2", "AVX2" };
+	return ( level < IMG_MAX_KERNEL_LEVELS ) ? names[ level ] : "Unknown";
+}
+
+void Img_ConvertRGB5A1ToRGBA8( const uint8_t *src, uint8_t *dst, size_t numPixels ) {
+	kernels->ConvertRGB5A1ToRGBA8( src, dst, numPixels );
+}
+
+void Img_ConvertRGB8ToRGBA8( const uint8_t *src, uint8_t *dst, size_t numPixels ) {
+	kernels->ConvertRGB8ToRGBA8( src, dst, numPixels );
+}
+
+void Img_ReplaceColour( uint8_t *rgba, size_t numPixels, const uint8_t key[4], const uint8_t replacement[4] ) {
+	uint32_t packedKey, packedReplacement;
+	memcpy( &packedKey, key, sizeof( uint32_t ) );
+	memcpy( &packedReplacement, replacement, sizeof( uint32_t ) );
+	kernels->ReplaceColour( rgba, numPixels, packedKey, packedReplacement );
+}
+
+void Img_ExtractChannel( const uint8_t *rgba, size_t numPixels, unsigned int channel, uint8_t *dst ) {
+	kernels->ExtractChannel( rgba, numPixels, channel & 3, dst );
+}
+
+void Img_ExtractChannelF( const uint8_t *rgba, size_t numPixels, unsigned int channel, float scale, float *dst ) {
+	kernels->ExtractChannelF( rgba, numPixels, channel & 3, scale, dst );
+}
+
+void Img_FillPixel( uint8_t *dst, const uint8_t colour[4], size_t numPixels ) {
+	uint32_t packedColour;
+	memcpy( &packedColour, colour, sizeof( uint32_t ) );
+	kernels->FillPixel( dst, packedColour, numPixels );
+}
+
+/* memcpy already gets the most out of whatever CPU it's running on,
+ * so there's nothing to gain from our own versions here */
+void Img_Blit( uint8_t *dst, size_t dstStride, const uint8_t *src, size_t srcStride, size_t rowSize, unsigned int numRows ) {
+	if ( dstStride == rowSize && srcStride == rowSize ) {
+		memcpy( dst, src, rowSize * numRows );
+		return;
+	}
+
+	for ( unsigned int y = 0; y < numRows; ++y, dst += dstStride, src += srcStride ) {
+		memcpy( dst, src, rowSize );
+	}
+}
+
+bool Img_ConvertImageToRGBA8( PLImage *image ) {
+	if ( image->format == PL_IMAGEFORMAT_RGBA8 ) {
+		return true;
+	}
+
+	if ( image->format != PL_IMAGEFORMAT_RGB8 ) {
+		return plConvertPixelFormat( image, PL_IMAGEFORMAT_RGBA8 );
+	}
+
+	PLImage *converted = plCreateImage( NULL, image->width, image->height, PL_COLOURFORMAT_RGBA, PL_IMAGEFORMAT_RGBA8 );
+	if ( converted == NULL ) {
+		return false;
+	}
+
+	Img_ConvertRGB8ToRGBA8( image->data[ 0 ], converted->data[ 0 ], ( size_t ) image->width * image->height );
+
+	// Swap them over so the caller's image is the converted one, and the original gets destroyed
+	memcpy( converted->path, image->path, sizeof( image->path ) );
+	PLImage original = *image;
+	*image = *converted;
+	*converted = original;
+	plDestroyImage( converted );
+
+	return true;
+}
@@ -0,0 +1,66 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <PL/platform.h>
+#include <PL/platform_image.h>
+
+PL_EXTERN_C
+
+/* Image Kernels
+ *
+ * The tight per-pixel loops used when importing images, with SSE2 and AVX2
+ * versions picked at runtime depending on what the CPU supports. Nothing
+ * here requires any alignment. These are shared with the tools, so keep
+ * anything engine specific out of here. */
+
+typedef enum ImgKernelLevel {
+	IMG_KERNEL_SCALAR,
+	IMG_KERNEL_SSE2,
+	IMG_KERNEL_AVX2,
+
+	IMG_MAX_KERNEL_LEVELS
+} ImgKernelLevel;
+
+/* picks the best kernels for this CPU, until then the scalar ones are used */
+void Img_InitKernels( void );
+
+/* returns false if the CPU doesn't support the given level */
+bool Img_SetKernelLevel( ImgKernelLevel level );
+ImgKernelLevel Img_GetKernelLevel( void );
+const char *Img_GetKernelLevelName( ImgKernelLevel level );
+
+/* PSX 15-bit colour (5:5:5, red in the low bits) to RGBA8, alpha is always 255 */
+void Img_ConvertRGB5A1ToRGBA8( const uint8_t *src, uint8_t *dst, size_t numPixels );
+void Img_ConvertRGB8ToRGBA8( const uint8_t *src, uint8_t *dst, size_t numPixels );
+
+/* replaces any pixel exactly matching key, colours are RGBA in memory order */
+void Img_ReplaceColour( uint8_t *rgba, size_t numPixels, const uint8_t key[4], const uint8_t replacement[4] );
+
+/* pulls a single channel out of RGBA8, either as is or scaled into a float */
+void Img_ExtractChannel( const uint8_t *rgba, size_t numPixels, unsigned int channel, uint8_t *dst );
+void Img_ExtractChannelF( const uint8_t *rgba, size_t numPixels, unsigned int channel, float scale, float *dst );
+
+void Img_FillPixel( uint8_t *dst, const uint8_t colour[4], size_t numPixels );
+void Img_Blit( uint8_t *dst, size_t dstStride, const uint8_t *src, size_t srcStride, size_t rowSize, unsigned int numRows );
+
+/* converts the image to RGBA8 in place, uses the kernels above for RGB8 and
+ * leaves anything else to the platform library */
+bool Img_ConvertImageToRGBA8( PLImage *image );
+
+PL_EXTERN_C_END
@@ -18,6 +18,7 @@
 #include "App.h"
 #include "Sprite.h"
 #include "ShaderManager.h"
+#include "Metrics.h"
 
 ohw::Sprite::Sprite( SpriteType type, const std::string &texturePath, PLColour colour, float scale ) :
 		type_( type ), colour_( colour ), scale_( scale ) {
@@ -57,10 +58,12 @@ void ohw::Sprite::Draw() {
 	plSetShaderUniformValue( defaultProgram->GetInternalProgram(), "pl_model", &modelMatrix, true );
 
 	plUploadMesh( mesh_ );
+	METRIC_COUNTER( "render.mesh_uploads" )->Add();
 
 	plSetCullMode( PL_CULL_NONE );
 
 	plDrawMesh( mesh_ );
+	METRIC_COUNTER( "render.draw_calls" )->Add();
 
 	plSetCullMode( PL_CULL_POSTIVE );
 
@@ -18,16 +18,145 @@
 #include "App.h"
 #include "Display.h"
 #include "TextureAtlas.h"
+#include "ImageKernels.h"
+#include "JobSystem.h"
+#include "MemoryTracker.h"
+
+#include "config.h"
+#include "loaders/MappedFile.h"
+#include "loaders/BinaryReader.h"
+#include "loaders/TimLoader.h"
+
+/* Each image is padded out with copies of its edges so filtering and
+ * mipmapping don't pull in its neighbours, and everything is aligned to
+ * the same size so that holds for the first few mip levels too. */
+#define ATLAS_GUTTER    4
+
+/* Cached atlas (.oha)
+ *
+ * header
+ * indices     where each image ended up
+ * pixels      RGBA8, width * height */
+
+#define ATLAS_CACHE_IDENTIFIER  "OHWA"
+#define ATLAS_CACHE_VERSION     1
+#define ATLAS_CACHE_MAX_NAME    64
+
+typedef struct __attribute__((packed)) AtlasCacheHeader {
+	char identifier[4];
+	uint32_t version;
+	uint32_t width;
+	uint32_t height;
+	uint32_t num_indices;
+} AtlasCacheHeader;
+
+typedef struct __attribute__((packed)) AtlasCacheIndex {
+	char name[ATLAS_CACHE_MAX_NAME];
+	uint32_t x, y, w, h;
+} AtlasCacheIndex;
+
+static unsigned int Atlas_Align( unsigned int size ) {
+	return ( size + ATLAS_GUTTER - 1 ) & ~( ATLAS_GUTTER - 1U );
+}
+
+static unsigned int Atlas_NextPowerOfTwo( unsigned int size ) {
+	unsigned int out = 1;
+	while ( out < size ) {
+		out <<= 1;
+	}
+	return out;
+}
+
+/**
+ * Skyline bottom-left packer. Each rectangle goes wherever it leaves the
+ * lowest top edge, and the skyline tracks the top of everything placed
+ * so far. Returns false if anything is wider than the atlas.
+ */
+static bool Atlas_PackSkyline( unsigned int width, const std::vector< std::pair< unsigned int, unsigned int > > &sizes,
+                               const std::vector< unsigned int > &order, std::vector< std::pair< unsigned int, unsigned int > > *positions,
+                               unsigned int *height ) {
+	struct Node {
+		unsigned int x, y, w;
+	};
+	std::vector< Node > skyline;
+	skyline.push_back( { 0, 0, width } );
+
+	positions->resize( sizes.size() );
+	*height = 0;
+
+	for ( unsigned int index : order ) {
+		unsigned int w = sizes[ index ].first;
+		unsigned int h = sizes[ index ].second;
+
+		size_t bestNode = SIZE_MAX;
+		unsigned int bestY = UINT_MAX, bestWidth = UINT_MAX;
+		for ( size_t i = 0; i < skyline.size(); ++i ) {
+			if ( skyline[ i ].x + w > width ) {
+				break;
+			}
+
+			// It has to sit above everything it spans
+			unsigned int y = 0;
+			for ( size_t j = i, spanned = 0; spanned < w; spanned += skyline[ j ].w, ++j ) {
+				y = std::max( y, skyline[ j ].y );
+			}
+
+			if ( y < bestY || ( y == bestY && skyline[ i ].w < bestWidth ) ) {
+				bestNode = i;
+				bestY = y;
+				bestWidth = skyline[ i ].w;
+			}
+		}
+
+		if ( bestNode == SIZE_MAX ) {
+			return false;
+		}
+
+		unsigned int x = skyline[ bestNode ].x;
+		( *positions )[ index ] = std::make_pair( x, bestY );
+		*height = std::max( *height, bestY + h );
+
+		// Raise the skyline, and trim back whatever is now underneath
+		skyline.insert( skyline.begin() + bestNode, { x, bestY + h, w } );
+		for ( size_t i = bestNode + 1; i < skyline.size(); ) {
+			unsigned int covered = x + w;
+			if ( skyline[ i ].x >= covered ) {
+				break;
+			}
+
+			unsigned int shrink = covered - skyline[ i ].x;
+			if ( shrink < skyline[ i ].w ) {
+				skyline[ i ].x += shrink;
+				skyline[ i ].w -= shrink;
+				break;
+			}
+
+			skyline.erase( skyline.begin() + i );
+		}
+
+		for ( size_t i = 0; i + 1 < skyline.size(); ) {
+			if ( skyline[ i ].y == skyline[ i + 1 ].y ) {
+				skyline[ i ].w += skyline[ i + 1 ].w;
+				skyline.erase( skyline.begin() + i + 1 );
+			} else {
+				++i;
+			}
+		}
+	}
+
+	return true;
+}
 
 ohw::TextureAtlas::TextureAtlas( int w, int h ) : width_( w ), height_( h ) {
 	texture_ = ohw::GetApp()->resourceManager->GetFallbackTexture();
+
+	AddSlot( 0, 0, 1.0f, 1.0f );
 }
 
 ohw::TextureAtlas::~TextureAtlas() {
-	for ( auto &id : images_by_name_ ) {
-		PLImage *image = id.second;
-		plDestroyImage( image );
-		id.second = nullptr;
+	for ( auto &source : sources_ ) {
+		plDestroyImage( source.image );
+		source.image = nullptr;
 	}
 
 	if ( texture_ != ohw::GetApp()->resourceManager->GetFallbackTexture() ) {
@@ -36,27 +165,41 @@ ohw::TextureAtlas::~TextureAtlas() {
 	}
 }
 
+/**
+ * Queues up the given image to be part of the atlas; nothing is decoded
+ * until Finalize is called. Returns false if the image doesn't exist.
+ */
 bool ohw::TextureAtlas::AddImage( const std::string &path, bool absolute ) {
-	const auto image = images_by_name_.find( path );
-	if ( image != images_by_name_.end() ) {
-		return true;
+	MemoryTagScope tagScope( MemoryTag::TEXTURES );
+
+	for ( const auto &source : sources_ ) {
+		if ( source.path == path ) {
+			return true;
+		}
 	}
 
 	char full_path[PL_SYSTEM_MAX_PATH];
 	if ( absolute ) {
-		strncpy( full_path, path.c_str(), sizeof( full_path ) - 1 );
+		snprintf( full_path, sizeof( full_path ), "%s", path.c_str() );
 	} else {
-		snprintf( full_path, sizeof( full_path ) - 1, "%s", u_find2( path.c_str(), supportedTextureFormats, false ) );
+		const char *found = u_find2( path.c_str(), supportedTextureFormats, false );
+		if ( found == nullptr ) {
+			return false;
+		}
+		snprintf( full_path, sizeof( full_path ), "%s", found );
 	}
 
-	PLImage *img = plLoadImage( full_path );
-	if ( img == nullptr ) {
+	Source source;
+	source.path = full_path;
+	source.member = ohw::GetApp()->resourceManager->GetPackageMember( full_path );
+	// Anything u_find2 turned up is already known to exist
+	if ( source.member == nullptr && absolute && !plFileExists( full_path ) ) {
 		return false;
 	}
 
-	plConvertPixelFormat( img, PL_IMAGEFORMAT_RGBA8 );
-	images_by_name_.emplace( path, img );
-	images_by_height_.emplace( img->height, img );
+	source.name = GetImageName( full_path );
+
+	sources_.push_back( source );
 	return true;
 }
 
@@ -66,85 +209,292 @@ void ohw::TextureAtlas::AddImages( const std::vector< std::string > &textures )
 	}
 }
 
-void ohw::TextureAtlas::Finalize() {
-	if ( images_by_height_.empty() ) {
-		Warning( "Failed to finalize texture atlas, no textures loaded!\n" );
-		return;
+/* images are looked up by their file name, without the extension */
+std::string ohw::TextureAtlas::GetImageName( const char *path ) {
+	const char *filename = plGetFileName( path );
+	const char *extension = plGetFileExtension( path );
+	return std::string( filename ).substr( 0, strlen( filename ) - ( strlen( extension ) + 1 ) );
+}
+
+std::string ohw::TextureAtlas::GetCachePath( uint64_t key ) {
+	char name[32];
+	snprintf( name, sizeof( name ), "%016llx.oha", ( unsigned long long ) key );
+	return std::string( Config_GetUserCachePath() ) + "atlases/" + name;
+}
+
+/**
+ * Hashes the contents of every image in the atlas, along with anything
+ * else that changes how it comes out.
+ */
+uint64_t ohw::TextureAtlas::HashSources() const {
+	unsigned int settings[] = { ATLAS_CACHE_VERSION, ATLAS_GUTTER, ( unsigned int ) width_, ( unsigned int ) height_ };
+	uint64_t hash = u_hash( settings, sizeof( settings ), U_HASH_SEED );
+	for ( const auto &source : sources_ ) {
+		hash = u_hash( source.name.c_str(), source.name.size() + 1, hash );
+		if ( source.member != nullptr ) {
+			hash = u_hash( source.member->data, source.member->size, hash );
+			continue;
+		}
+
+		MappedFile *file = Map_OpenFile( source.path.c_str() );
+		if ( file != nullptr ) {
+			hash = u_hash( file->data, file->size, hash );
+			Map_CloseFile( file );
+		}
 	}
 
-	// Figure out how we'll organise the atlas
-	unsigned int w = width_, h = height_;
-	unsigned int max_h = 0;
-	unsigned int cur_y = 0, cur_x = 0;
-	for ( auto i = images_by_height_.rbegin(); i != images_by_height_.rend(); ++i ) {
-		PLImage *image = i->second;
-		if ( image->height > max_h ) {
-			max_h = image->height;
+	return hash;
+}
+
+/**
+ * Decodes all of the queued images at once, across multiple threads.
+ */
+void ohw::TextureAtlas::DecodeSources() {
+	JobSystem::GetInstance()->ParallelFor( sources_.size(), [ this ]( unsigned int i ) {
+		Source &source = sources_[ i ];
+		if ( source.member != nullptr ) {
+			source.image = Tim_LoadMemory( source.member->data, source.member->size, source.path.c_str() );
+		} else {
+			source.image = plLoadImage( source.path.c_str() );
 		}
 
-		if ( cur_x == 0 && image->width > w ) {
-			w = image->width;
-		} else if ( cur_x + image->width > w ) {
-			cur_y += max_h;
-			cur_x = max_h = 0;
+		if ( source.image != nullptr && !Img_ConvertImageToRGBA8( source.image ) ) {
+			plDestroyImage( source.image );
+			source.image = nullptr;
 		}
+	} );
 
-		if ( cur_y + image->height > h ) {
-			h = cur_y + image->height;
+	for ( auto i = sources_.begin(); i != sources_.end(); ) {
+		if ( i->image == nullptr ) {
+			Warning( "Failed to load \"%s\" for texture atlas!\n", i->path.c_str() );
+			i = sources_.erase( i );
+		} else {
+			++i;
 		}
+	}
+}
 
-		u_assert( image->path[ 0 ] != '\0', "Invalid image name!" );
-		const char *filename = plGetFileName( image->path );
-		const char *extension = plGetFileExtension( image->path );
-		std::string index_name = std::string( filename ).substr( 0, strlen( filename ) - ( strlen( extension ) + 1 ) );
-		textures_.emplace( index_name, Index{
-				.x = cur_x,
-				.y = cur_y,
-				.w = image->width,
-				.h = image->height,
-				.image = image
-		} );
+/**
+ * Works out where everything goes and copies it all into a single image.
+ * Every power of two width is tried, and whichever wastes the least space
+ * wins. The height is left as it is, as padding that out to a power of two
+ * would usually cost more than the gutters themselves.
+ */
+PLImage *ohw::TextureAtlas::Pack() {
+	std::vector< std::pair< unsigned int, unsigned int > > sizes;
+	unsigned int minWidth = std::max( width_, 1 );
+	for ( const auto &source : sources_ ) {
+		unsigned int w = Atlas_Align( source.image->width + ATLAS_GUTTER * 2 );
+		unsigned int h = Atlas_Align( source.image->height + ATLAS_GUTTER * 2 );
+		sizes.push_back( std::make_pair( w, h ) );
+		minWidth = std::max( minWidth, w );
+	}
 
-		cur_x += image->width;
+	// Tallest first packs tightest
+	std::vector< unsigned int > order( sizes.size() );
+	for ( unsigned int i = 0; i < order.size(); ++i ) {
+		order[ i ] = i;
 	}
+	std::sort( order.begin(), order.end(), [ &sizes ]( unsigned int a, unsigned int b ) {
+		if ( sizes[ a ].second != sizes[ b ].second ) {
+			return sizes[ a ].second > sizes[ b ].second;
+		}
+		return sizes[ a ].first > sizes[ b ].first;
+	} );
 
-	// Ensure power of two for final atlas
-	h = static_cast<unsigned int>(pow( 2, ceil( log( h ) / log( 2 ) ) ));
-	w = static_cast<unsigned int>(pow( 2, ceil( log( w ) / log( 2 ) ) ));
+	std::vector< std::pair< unsigned int, unsigned int > > positions, bestPositions;
+	unsigned int w = 0, h = 0;
+	for ( unsigned int tryWidth = Atlas_NextPowerOfTwo( minWidth ); tryWidth <= 8192; tryWidth <<= 1 ) {
+		unsigned int tryHeight;
+		if ( !Atlas_PackSkyline( tryWidth, sizes, order, &positions, &tryHeight ) ) {
+			continue;
+		}
 
-	// Image pointers will be freed when we're done with textures list
-	images_by_name_.clear();
-	images_by_height_.clear();
+		tryHeight = std::max( tryHeight, Atlas_Align( std::max( height_, 1 ) ) );
+		uint64_t area = ( uint64_t ) tryWidth * tryHeight;
+		uint64_t bestArea = ( uint64_t ) w * h;
+		if ( bestPositions.empty() || area < bestArea || ( area == bestArea && std::max( tryWidth, tryHeight ) < std::max( w, h ) ) ) {
+			bestPositions.swap( positions );
+			w = tryWidth;
+			h = tryHeight;
+		}
+	}
+
+	if ( bestPositions.empty() ) {
+		Error( "Failed to fit images into texture atlas!\n" );
+	}
 
-	// Now create the atlas itself
 	PLImage *cache = plCreateImage( nullptr, w, h, PL_COLOURFORMAT_RGBA, PL_IMAGEFORMAT_RGBA8 );
 	if ( cache == nullptr ) {
 		Error( "Failed to generate image cache for texture atlas (%s)!\n", plGetError() );
 	}
 
-	//plReplaceImageColour(cache, {0, 0, 0, 0}, {0, 0, 0, 255});
+	for ( unsigned int i = 0; i < sources_.size(); ++i ) {
+		textures_[ sources_[ i ].name ] = Index{
+				.x = bestPositions[ i ].first + ATLAS_GUTTER,
+				.y = bestPositions[ i ].second + ATLAS_GUTTER,
+				.w = sources_[ i ].image->width,
+				.h = sources_[ i ].image->height,
+		};
+	}
+
+	// Every image has its own space, so they can all be copied in at once
+	JobSystem::GetInstance()->ParallelFor( sources_.size(), [ & ]( unsigned int i ) {
+		const PLImage *image = sources_[ i ].image;
+		unsigned int cellX = bestPositions[ i ].first, cellY = bestPositions[ i ].second;
+		unsigned int cellW = sizes[ i ].first, cellH = sizes[ i ].second;
+		unsigned int right = cellW - image->width - ATLAS_GUTTER;
+		size_t stride = cache->width * 4;
+
+		// Copy the image in, then extend the first and last pixel of each row out into the gutter
+		uint8_t *cell = cache->data[ 0 ] + cellY * stride + cellX * 4;
+		uint8_t *top = cell + ATLAS_GUTTER * stride;
+		Img_Blit( top + ATLAS_GUTTER * 4, stride, image->data[ 0 ], image->width * 4, image->width * 4, image->height );
+		for ( unsigned int y = 0; y < image->height; ++y ) {
+			const uint8_t *src = image->data[ 0 ] + y * image->width * 4;
+			uint8_t *dst = top + y * stride;
+			Img_FillPixel( dst, src, ATLAS_GUTTER );
+			Img_FillPixel( dst + ( ATLAS_GUTTER + image->width ) * 4, src + ( image->width - 1 ) * 4, right );
+		}
 
-	for ( auto &tarr : textures_ ) {
-		Index *texture = &tarr.second;
-		uint8_t *pos = cache->data[ 0 ] + ( ( texture->y * cache->width ) + texture->x ) * 4;
-		uint8_t *src = texture->image->data[ 0 ];
-		for ( unsigned int y = 0; y < texture->h; ++y ) {
-			memcpy( pos, src, ( texture->w * 4 ) );
-			src += texture->w * 4;
-			pos += cache->width * 4;
+		// And then the first and last row up and down
+		const uint8_t *bottom = top + ( image->height - 1 ) * stride;
+		for ( unsigned int y = 0; y < ATLAS_GUTTER; ++y ) {
+			memcpy( cell + y * stride, top, cellW * 4 );
 		}
+		for ( unsigned int y = ATLAS_GUTTER + image->height; y < cellH; ++y ) {
+			memcpy( cell + y * stride, bottom, cellW * 4 );
+		}
+	} );
+
+	for ( auto &source : sources_ ) {
+		plDestroyImage( source.image );
+		source.image = nullptr;
+	}
+
+	return cache;
+}
 
-		plDestroyImage( texture->image );
-		texture->image = nullptr;
+bool ohw::TextureAtlas::LoadCache( const std::string &path ) {
+	MappedFile *file = Map_OpenFile( path.c_str() );
+	if ( file == nullptr ) {
+		return false;
+	}
+
+	BinReader reader;
+	Bin_InitReader( &reader, file->data, file->size );
+
+	AtlasCacheHeader header;
+	if ( !Bin_ReadArray( &reader, &header, sizeof( AtlasCacheHeader ), 1 ) ||
+	     memcmp( header.identifier, ATLAS_CACHE_IDENTIFIER, sizeof( header.identifier ) ) != 0 ||
+	     header.version != ATLAS_CACHE_VERSION ) {
+		DebugMsg( "Outdated or invalid atlas cache, \"%s\"\n", path.c_str() );
+		Map_CloseFile( file );
+		return false;
 	}
 
+	std::vector< AtlasCacheIndex > indices( header.num_indices );
+	bool status = Bin_ReadArray( &reader, indices.data(), sizeof( AtlasCacheIndex ), header.num_indices );
+	const uint8_t *pixels = Bin_ReadView( &reader, ( size_t ) header.width * 4, header.height );
+	if ( !status || pixels == nullptr ) {
+		Warning( "Truncated atlas cache, \"%s\"!\n", path.c_str() );
+		Map_CloseFile( file );
+		return false;
+	}
+
+	for ( auto &index : indices ) {
+		index.name[ ATLAS_CACHE_MAX_NAME - 1 ] = '\0';
+		if ( index.x + index.w > header.width || index.y + index.h > header.height ) {
+			Warning( "Invalid index in atlas cache, \"%s\"!\n", path.c_str() );
+			textures_.clear();
+			Map_CloseFile( file );
+			return false;
+		}
+
+		textures_[ index.name ] = Index{ .x = index.x, .y = index.y, .w = index.w, .h = index.h };
+	}
+
+	PLImage *image = plCreateImage( const_cast< uint8_t * >( pixels ), header.width, header.height,
+	                                PL_COLOURFORMAT_RGBA, PL_IMAGEFORMAT_RGBA8 );
+	Map_CloseFile( file );
+	if ( image == nullptr ) {
+		textures_.clear();
+		return false;
+	}
+
+	Upload( image );
+	plDestroyImage( image );
+
+	return true;
+}
+
+/**
+ * Writes out to a temporary file first and then moves it into place,
+ * so we never leave a half written atlas behind.
+ */
+bool ohw::TextureAtlas::SaveCache( const std::string &path, const PLImage *image ) const {
+	std::vector< AtlasCacheIndex > indices;
+	for ( const auto &texture : textures_ ) {
+		if ( texture.first.size() >= ATLAS_CACHE_MAX_NAME ) {
+			DebugMsg( "Name is too long to cache atlas, \"%s\"\n", texture.first.c_str() );
+			return false;
+		}
+
+		AtlasCacheIndex index;
+		memset( &index, 0, sizeof( AtlasCacheIndex ) );
+		strncpy( index.name, texture.first.c_str(), sizeof( index.name ) - 1 );
+		index.x = texture.second.x;
+		index.y = texture.second.y;
+		index.w = texture.second.w;
+		index.h = texture.second.h;
+		indices.push_back( index );
+	}
+
+	AtlasCacheHeader header;
+	memset( &header, 0, sizeof( AtlasCacheHeader ) );
+	memcpy( header.identifier, ATLAS_CACHE_IDENTIFIER, sizeof( header.identifier ) );
+	header.version = ATLAS_CACHE_VERSION;
+	header.width = image->width;
+	header.height = image->height;
+	header.num_indices = indices.size();
+
+	std::string tmpPath = path + ".tmp";
+	FILE *fp = fopen( tmpPath.c_str(), "wb" );
+	if ( fp == nullptr ) {
+		Warning( "Failed to open \"%s\" for writing!\n", tmpPath.c_str() );
+		return false;
+	}
+
+	size_t pixelsSize = ( size_t ) image->width * image->height * 4;
+	bool status = ( fwrite( &header, sizeof( AtlasCacheHeader ), 1, fp ) == 1 );
+	status &= ( fwrite( indices.data(), sizeof( AtlasCacheIndex ), indices.size(), fp ) == indices.size() );
+	status &= ( fwrite( image->data[ 0 ], 1, pixelsSize, fp ) == pixelsSize );
+	status &= ( fclose( fp ) == 0 );
+	if ( !status ) {
+		Warning( "Failed to write atlas cache, \"%s\"!\n", tmpPath.c_str() );
+		remove( tmpPath.c_str() );
+		return false;
+	}
+
+	// rename won't replace an existing file on Windows
+	remove( path.c_str() );
+	if ( rename( tmpPath.c_str(), path.c_str() ) != 0 ) {
+		Warning( "Failed to move atlas cache into place, \"%s\"!\n", path.c_str() );
+		remove( tmpPath.c_str() );
+		return false;
+	}
+
+	return true;
+}
+
+void ohw::TextureAtlas::Upload( PLImage *image ) {
 #ifdef _DEBUG
 	static unsigned int gen_id = 0;
 	if ( plCreatePath( "./debug/generated/" ) ) {
 		char buf[PL_SYSTEM_MAX_PATH];
 		snprintf( buf, sizeof( buf ) - 1, "./debug/generated/%dx%d_%d.png",
-		          cache->width, cache->height, gen_id++ );
-		plWriteImage( cache, buf );
+		          image->width, image->height, gen_id++ );
+		plWriteImage( image, buf );
 	}
 #endif
 
@@ -160,11 +510,144 @@ void ohw::TextureAtlas::Finalize() {
 		texture_->filter = PL_TEXTURE_FILTER_MIPMAP_NEAREST;
 	}
 
-	if ( !plUploadTextureImage( texture_, cache ) ) {
+	if ( !plUploadTextureImage( texture_, image ) ) {
 		Error( "Failed to upload texture atlas (%s)!\n", plGetError() );
 	}
+}
+
+void ohw::TextureAtlas::Finalize() {
+	MemoryTagScope tagScope( MemoryTag::TEXTURES );
+
+	if ( sources_.empty() ) {
+		Warning( "Failed to finalize texture atlas, no textures loaded!\n" );
+		return;
+	}
+
+	std::vector< std::string > names;
+	for ( const auto &source : sources_ ) {
+		names.push_back( source.name );
+	}
 
+	uint64_t key = 0;
+	std::string cachePath;
+	if ( cv_graphics_atlas_cache->b_value ) {
+		key = HashSources();
+		cachePath = GetCachePath( key );
+		if ( LoadCache( cachePath ) ) {
+			cacheKey_ = key;
+			sources_.clear();
+			GenerateSlots( names );
+			return;
+		}
+	}
+
+	DecodeSources();
+	if ( sources_.empty() ) {
+		Warning( "Failed to finalize texture atlas, no textures loaded!\n" );
+		return;
+	}
+
+	PLImage *cache = Pack();
+	sources_.clear();
+
+	if ( !cachePath.empty() && plCreatePath( ( std::string( Config_GetUserCachePath() ) + "atlases/" ).c_str() ) &&
+	     SaveCache( cachePath, cache ) ) {
+		cacheKey_ = key;
+	}
+
+	Upload( cache );
 	plDestroyImage( cache );
+
+	GenerateSlots( names );
+}
+
+/**
+ * For anything that's already baked against this atlas, so it has to come
+ * out exactly as it did before. Returns false if the cached copy has gone.
+ */
+bool ohw::TextureAtlas::LoadCached( uint64_t key, const std::vector< std::string > &paths ) {
+	MemoryTagScope tagScope( MemoryTag::TEXTURES );
+
+	if ( !LoadCache( GetCachePath( key ) ) ) {
+		return false;
+	}
+
+	// same as AddImage, anything added twice only gets the one slot
+	std::vector< std::string > names;
+	for ( auto i = paths.begin(); i != paths.end(); ++i ) {
+		if ( std::find( paths.begin(), i, *i ) == i ) {
+			names.push_back( GetImageName( i->c_str() ) );
+		}
+	}
+
+	cacheKey_ = key;
+	GenerateSlots( names );
+	return true;
+}
+
+/**
+ * Works out the coordinates for every slot up front, along with each way
+ * it can be flipped and rotated.
+ */
+void ohw::TextureAtlas::GenerateSlots( const std::vector< std::string > &names ) {
+	slotNames_ = names;
+	slotCoords_.clear();
+	slotCoords_.reserve( ( names.size() + 1 ) * ATLAS_SLOT_VARIANTS );
+
+	for ( const auto &name : names ) {
+		float x, y, w, h;
+		GetTextureCoords( name, &x, &y, &w, &h );
+		AddSlot( x, y, w, h );
+	}
+
+	AddSlot( 0, 0, 1.0f, 1.0f );
+}
+
+void ohw::TextureAtlas::AddSlot( float x, float y, float w, float h ) {
+	// Rotate the corners 90 degrees clockwise
+	auto rot90 = []( float *c ) {
+		float first = c[ 0 ];
+		c[ 0 ] = c[ 2 ];
+		c[ 2 ] = c[ 3 ];
+		c[ 3 ] = c[ 1 ];
+		c[ 1 ] = first;
+	};
+
+	for ( unsigned int variant = 0; variant < ATLAS_SLOT_VARIANTS; ++variant ) {
+		float sx = x, sw = w;
+		if ( variant & 1U ) {
+			sx = sx + sw;
+			sw = -sw;
+		}
+
+		SlotCoords coords = {
+				{ sx, sx + sw, sx, sx + sw },
+				{ y, y, y + h, y + h },
+		};
+
+		if ( variant & 2U ) {
+			rot90( coords.s );
+			rot90( coords.t );
+		}
+		if ( variant & 4U ) {
+			rot90( coords.s );
+			rot90( coords.t );
+			rot90( coords.s );
+			rot90( coords.t );
+		}
+
+		slotCoords_.push_back( coords );
+	}
+}
+
+unsigned int ohw::TextureAtlas::GetSlot( const std::string &name ) const {
+	for ( unsigned int i = 0; i < slotNames_.size(); ++i ) {
+		if ( slotNames_[ i ] == name ) {
+			return i;
+		}
+	}
+
+	return slotNames_.size();
 }
 
 bool ohw::TextureAtlas::GetTextureCoords( const std::string &name, float *x, float *y, float *w, float *h ) {
@@ -175,16 +658,10 @@ bool ohw::TextureAtlas::GetTextureCoords( const std::string &name, float *x, flo
 		return false;
 	}
 
-	// HACK: work around texture leaking until we have a better solution!
-	int shift = 0;
-	if ( texture_->filter == PL_TEXTURE_FILTER_MIPMAP_LINEAR ) {
-		shift = 1;
-	}
-
-	*x = static_cast<float>(index->second.x + shift) / static_cast<float>(texture_->w);
-	*y = static_cast<float>(index->second.y + shift) / static_cast<float>(texture_->h);
-	*w = static_cast<float>(index->second.w - shift * 2) / static_cast<float>(texture_->w);
-	*h = static_cast<float>(index->second.h - shift * 2) / static_cast<float>(texture_->h);
+	*x = static_cast<float>(index->second.x) / static_cast<float>(texture_->w);
+	*y = static_cast<float>(index->second.y) / static_cast<float>(texture_->h);
+	*w = static_cast<float>(index->second.w) / static_cast<float>(texture_->w);
+	*h = static_cast<float>(index->second.h) / static_cast<float>(texture_->h);
 	return true;
 }
 
@@ -17,7 +17,18 @@
 
 #pragma once
 
+struct PkgMember;
+
+/* flip on x, then rotated by 90, 180 or both, same as the terrain tile flags */
+#define ATLAS_SLOT_VARIANTS     8
+
 namespace ohw {
+	/**
+	 * Packs a set of images into a single texture. Images are only queued
+	 * up as they're added and then decoded all at once when the atlas is
+	 * finalized, and the result is cached so the next time the same set of
+	 * images comes through it can be loaded straight back in.
+	 */
 	class TextureAtlas {
 	public:
 		TextureAtlas( int w, int h );
@@ -26,27 +37,67 @@ namespace ohw {
 		bool GetTextureCoords( const std::string &name, float *x, float *y, float *w, float *h );
 		std::pair< unsigned int, unsigned int > GetTextureSize( const std::string &name );
 
+		/* Images are also given a slot in the order they were added, so they
+		 * can be looked up without going through their names every time. */
+		struct SlotCoords {
+			float s[ 4 ], t[ 4 ];   // top-left, top-right, bottom-left, bottom-right
+		};
+		unsigned int GetSlot( const std::string &name ) const;
+		PL_INLINE const SlotCoords &GetSlotCoords( unsigned int slot, unsigned int variant = 0 ) const {
+			// anything out of range gets the last slot, which covers the whole texture
+			slot = std::min( slot, static_cast< unsigned int >( slotCoords_.size() / ATLAS_SLOT_VARIANTS ) - 1 );
+			return slotCoords_[ slot * ATLAS_SLOT_VARIANTS + ( variant % ATLAS_SLOT_VARIANTS ) ];
+		}
+
 		bool AddImage( const std::string &path, bool absolute = false );
 		void AddImages( const std::vector< std::string > &textures );
 
 		void Finalize();
 
+		/* identifies the cached copy Finalize loaded or wrote out, 0 if there isn't one */
+		uint64_t GetCacheKey() const { return cacheKey_; }
+		/* loads a cached copy straight back in by its key, without touching
+		 * any of the images it was built from */
+		bool LoadCached( uint64_t key, const std::vector< std::string > &paths );
+
 		PLTexture *GetTexture() { return texture_; }
 
 	protected:
 	private:
+		struct Source {
+			std::string name;
+			std::string path;
+			const PkgMember *member{ nullptr };     // if it's in one of the packages
+			PLImage *image{ nullptr };
+		};
+
 		struct Index {
 			unsigned int x, y, w, h;
-			PLImage *image;
 		};
 
+		uint64_t HashSources() const;
+		void DecodeSources();
+		PLImage *Pack();
+
+		static std::string GetCachePath( uint64_t key );
+		static std::string GetImageName( const char *path );
+		bool LoadCache( const std::string &path );
+		bool SaveCache( const std::string &path, const PLImage *image ) const;
+
+		void Upload( PLImage *image );
+		void GenerateSlots( const std::vector< std::string > &names );
+		void AddSlot( float x, float y, float w, float h );
+
 		int width_{ 512 };
 		int height_{ 8 };
 
+		std::vector< Source > sources_;
 		std::map< std::string, Index > textures_;
-		std::map< std::string, PLImage * > images_by_name_;
-		std::multimap< unsigned int, PLImage * > images_by_height_;
+
+		std::vector< std::string > slotNames_;
+		std::vector< SlotCoords > slotCoords_;
 
 		PLTexture *texture_{ nullptr };
+		uint64_t cacheKey_{ 0 };
 	};
 }
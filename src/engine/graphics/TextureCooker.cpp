@@ -0,0 +1,332 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "App.h"
+#include "TextureCooker.h"
+
+/************************************************************/
+/* Texture Cooking */
+
+size_t Cook_GetLevelSize( unsigned int format, unsigned int width, unsigned int height ) {
+	size_t numBlocks = ( size_t ) ( ( width + 3 ) / 4 ) * ( ( height + 3 ) / 4 );
+	switch ( format ) {
+		case OHX_FORMAT_BC1: return numBlocks * 8;
+		case OHX_FORMAT_BC3: return numBlocks * 16;
+		default: return ( size_t ) width * height * 4;
+	}
+}
+
+/**
+ * Halves the image with a box filter, repeating the last row or column
+ * if either side is odd.
+ */
+static void Cook_Downsample( const uint8_t *src, unsigned int width, unsigned int height, uint8_t *dst ) {
+	unsigned int dstWidth = std::max( width / 2, 1U );
+	unsigned int dstHeight = std::max( height / 2, 1U );
+	for ( unsigned int y = 0; y < dstHeight; ++y ) {
+		unsigned int y0 = std::min( y * 2, height - 1 ), y1 = std::min( y * 2 + 1, height - 1 );
+		for ( unsigned int x = 0; x < dstWidth; ++x ) {
+			unsigned int x0 = std::min( x * 2, width - 1 ), x1 = std::min( x * 2 + 1, width - 1 );
+			const uint8_t *a = src + ( y0 * width + x0 ) * 4;
+			const uint8_t *b = src + ( y0 * width + x1 ) * 4;
+			const uint8_t *c = src + ( y1 * width + x0 ) * 4;
+			const uint8_t *d = src + ( y1 * width + x1 ) * 4;
+			for ( unsigned int i = 0; i < 4; ++i ) {
+				*( dst++ ) = static_cast< uint8_t >( ( a[ i ] + b[ i ] + c[ i ] + d[ i ] + 2 ) / 4 );
+			}
+		}
+	}
+}
+
+/* grabs a 4x4 block, clamping to the edge of the image */
+static void Cook_FetchBlock( const uint8_t *rgba, unsigned int width, unsigned int height, unsigned int bx, unsigned int by, uint8_t *block ) {
+	for ( unsigned int y = 0; y < 4; ++y ) {
+		unsigned int sy = std::min( by * 4 + y, height - 1 );
+		for ( unsigned int x = 0; x < 4; ++x ) {
+			unsigned int sx = std::min( bx * 4 + x, width - 1 );
+			memcpy( block + ( y * 4 + x ) * 4, rgba + ( sy * width + sx ) * 4, 4 );
+		}
+	}
+}
+
+static uint16_t Cook_PackRGB565( const uint8_t *c ) {
+	return static_cast< uint16_t >( ( ( c[ 0 ] >> 3 ) << 11 ) | ( ( c[ 1 ] >> 2 ) << 5 ) | ( c[ 2 ] >> 3 ) );
+}
+
+static void Cook_UnpackRGB565( uint16_t v, uint8_t *c ) {
+	uint8_t r = ( v >> 11 ) & 31, g = ( v >> 5 ) & 63, b = v & 31;
+	c[ 0 ] = static_cast< uint8_t >( ( r << 3 ) | ( r >> 2 ) );
+	c[ 1 ] = static_cast< uint8_t >( ( g << 2 ) | ( g >> 4 ) );
+	c[ 2 ] = static_cast< uint8_t >( ( b << 3 ) | ( b >> 2 ) );
+}
+
+/**
+ * Encodes the colour half of a block. The endpoints are the corners of the
+ * colours' bounding box, pulled in slightly, and each pixel takes whichever
+ * of the four palette entries is closest.
+ */
+static void Cook_EncodeColourBlock( const uint8_t *block, uint8_t *out ) {
+	uint8_t minColour[ 3 ] = { 255, 255, 255 }, maxColour[ 3 ] = { 0, 0, 0 };
+	for ( unsigned int i = 0; i < 16; ++i ) {
+		for ( unsigned int j = 0; j < 3; ++j ) {
+			minColour[ j ] = std::min( minColour[ j ], block[ i * 4 + j ] );
+			maxColour[ j ] = std::max( maxColour[ j ], block[ i * 4 + j ] );
+		}
+	}
+
+	for ( unsigned int j = 0; j < 3; ++j ) {
+		int inset = ( maxColour[ j ] - minColour[ j ] ) / 16;
+		minColour[ j ] = static_cast< uint8_t >( std::min( minColour[ j ] + inset, 255 ) );
+		maxColour[ j ] = static_cast< uint8_t >( std::max( maxColour[ j ] - inset, 0 ) );
+	}
+
+	uint16_t colour0 = Cook_PackRGB565( maxColour );
+	uint16_t colour1 = Cook_PackRGB565( minColour );
+
+	uint32_t indices = 0;
+	if ( colour0 != colour1 ) {
+		// colour0 has to be the larger or it's read as having alpha
+		if ( colour0 < colour1 ) {
+			std::swap( colour0, colour1 );
+		}
+
+		uint8_t palette[ 4 ][ 3 ];
+		Cook_UnpackRGB565( colour0, palette[ 0 ] );
+		Cook_UnpackRGB565( colour1, palette[ 1 ] );
+		for ( unsigned int j = 0; j < 3; ++j ) {
+			palette[ 2 ][ j ] = static_cast< uint8_t >( ( 2 * palette[ 0 ][ j ] + palette[ 1 ][ j ] ) / 3 );
+			palette[ 3 ][ j ] = static_cast< uint8_t >( ( palette[ 0 ][ j ] + 2 * palette[ 1 ][ j ] ) / 3 );
+		}
+
+		for ( unsigned int i = 0; i < 16; ++i ) {
+			unsigned int best = 0;
+			int bestDistance = INT_MAX;
+			for ( unsigned int p = 0; p < 4; ++p ) {
+				int distance = 0;
+				for ( unsigned int j = 0; j < 3; ++j ) {
+					int d = block[ i * 4 + j ] - palette[ p ][ j ];
+					distance += d * d;
+				}
+				if ( distance < bestDistance ) {
+					bestDistance = distance;
+					best = p;
+				}
+			}
+			indices |= best << ( i * 2 );
+		}
+	}
+
+	out[ 0 ] = static_cast< uint8_t >( colour0 & 0xFF );
+	out[ 1 ] = static_cast< uint8_t >( colour0 >> 8 );
+	out[ 2 ] = static_cast< uint8_t >( colour1 & 0xFF );
+	out[ 3 ] = static_cast< uint8_t >( colour1 >> 8 );
+	for ( unsigned int i = 0; i < 4; ++i ) {
+		out[ 4 + i ] = static_cast< uint8_t >( indices >> ( i * 8 ) );
+	}
+}
+
+/**
+ * Encodes the alpha half of a BC3 block, using the eight step mode
+ * between the lowest and highest alpha.
+ */
+static void Cook_EncodeAlphaBlock( const uint8_t *block, uint8_t *out ) {
+	uint8_t minAlpha = 255, maxAlpha = 0;
+	for ( unsigned int i = 0; i < 16; ++i ) {
+		minAlpha = std::min( minAlpha, block[ i * 4 + 3 ] );
+		maxAlpha = std::max( maxAlpha, block[ i * 4 + 3 ] );
+	}
+
+	out[ 0 ] = maxAlpha;
+	out[ 1 ] = minAlpha;
+
+	uint64_t indices = 0;
+	if ( maxAlpha != minAlpha ) {
+		uint8_t palette[ 8 ];
+		palette[ 0 ] = maxAlpha;
+		palette[ 1 ] = minAlpha;
+		for ( unsigned int p = 1; p < 7; ++p ) {
+			palette[ p + 1 ] = static_cast< uint8_t >( ( ( 7 - p ) * maxAlpha + p * minAlpha ) / 7 );
+		}
+
+		for ( unsigned int i = 0; i < 16; ++i ) {
+			uint64_t best = 0;
+			int bestDistance = INT_MAX;
+			for ( unsigned int p = 0; p < 8; ++p ) {
+				int distance = std::abs( block[ i * 4 + 3 ] - palette[ p ] );
+				if ( distance < bestDistance ) {
+					bestDistance = distance;
+					best = p;
+				}
+			}
+			indices |= best << ( i * 3 );
+		}
+	}
+
+	for ( unsigned int i = 0; i < 6; ++i ) {
+		out[ 2 + i ] = static_cast< uint8_t >( indices >> ( i * 8 ) );
+	}
+}
+
+void Cook_CompressBC1( const uint8_t *rgba, unsigned int width, unsigned int height, uint8_t *out ) {
+	uint8_t block[ 16 * 4 ];
+	for ( unsigned int by = 0; by < ( height + 3 ) / 4; ++by ) {
+		for ( unsigned int bx = 0; bx < ( width + 3 ) / 4; ++bx, out += 8 ) {
+			Cook_FetchBlock( rgba, width, height, bx, by, block );
+			Cook_EncodeColourBlock( block, out );
+		}
+	}
+}
+
+void Cook_CompressBC3( const uint8_t *rgba, unsigned int width, unsigned int height, uint8_t *out ) {
+	uint8_t block[ 16 * 4 ];
+	for ( unsigned int by = 0; by < ( height + 3 ) / 4; ++by ) {
+		for ( unsigned int bx = 0; bx < ( width + 3 ) / 4; ++bx, out += 16 ) {
+			Cook_FetchBlock( rgba, width, height, bx, by, block );
+			Cook_EncodeAlphaBlock( block, out );
+			Cook_EncodeColourBlock( block, out + 8 );
+		}
+	}
+}
+
+/* decodes the colour half of a block, BC3 always uses the four colour mode */
+static void Cook_DecodeColourBlock( const uint8_t *in, bool allowAlpha, uint8_t *block ) {
+	uint16_t colour0 = static_cast< uint16_t >( in[ 0 ] | ( in[ 1 ] << 8 ) );
+	uint16_t colour1 = static_cast< uint16_t >( in[ 2 ] | ( in[ 3 ] << 8 ) );
+
+	uint8_t palette[ 4 ][ 4 ];
+	Cook_UnpackRGB565( colour0, palette[ 0 ] );
+	Cook_UnpackRGB565( colour1, palette[ 1 ] );
+	palette[ 0 ][ 3 ] = palette[ 1 ][ 3 ] = palette[ 2 ][ 3 ] = palette[ 3 ][ 3 ] = 255;
+	if ( colour0 > colour1 || !allowAlpha ) {
+		for ( unsigned int j = 0; j < 3; ++j ) {
+			palette[ 2 ][ j ] = static_cast< uint8_t >( ( 2 * palette[ 0 ][ j ] + palette[ 1 ][ j ] ) / 3 );
+			palette[ 3 ][ j ] = static_cast< uint8_t >( ( palette[ 0 ][ j ] + 2 * palette[ 1 ][ j ] ) / 3 );
+		}
+	} else {
+		for ( unsigned int j = 0; j < 3; ++j ) {
+			palette[ 2 ][ j ] = static_cast< uint8_t >( ( palette[ 0 ][ j ] + palette[ 1 ][ j ] ) / 2 );
+			palette[ 3 ][ j ] = 0;
+		}
+		palette[ 3 ][ 3 ] = 0;
+	}
+
+	uint32_t indices = in[ 4 ] | ( in[ 5 ] << 8 ) | ( in[ 6 ] << 16 ) | ( ( uint32_t ) in[ 7 ] << 24 );
+	for ( unsigned int i = 0; i < 16; ++i ) {
+		memcpy( block + i * 4, palette[ ( indices >> ( i * 2 ) ) & 3 ], 4 );
+	}
+}
+
+static void Cook_DecodeAlphaBlock( const uint8_t *in, uint8_t *block ) {
+	uint8_t palette[ 8 ];
+	palette[ 0 ] = in[ 0 ];
+	palette[ 1 ] = in[ 1 ];
+	if ( palette[ 0 ] > palette[ 1 ] ) {
+		for ( unsigned int p = 1; p < 7; ++p ) {
+			palette[ p + 1 ] = static_cast< uint8_t >( ( ( 7 - p ) * palette[ 0 ] + p * palette[ 1 ] ) / 7 );
+		}
+	} else {
+		for ( unsigned int p = 1; p < 5; ++p ) {
+			palette[ p + 1 ] = static_cast< uint8_t >( ( ( 5 - p ) * palette[ 0 ] + p * palette[ 1 ] ) / 5 );
+		}
+		palette[ 6 ] = 0;
+		palette[ 7 ] = 255;
+	}
+
+	uint64_t indices = 0;
+	for ( unsigned int i = 0; i < 6; ++i ) {
+		indices |= ( uint64_t ) in[ 2 + i ] << ( i * 8 );
+	}
+
+	for ( unsigned int i = 0; i < 16; ++i ) {
+		block[ i * 4 + 3 ] = palette[ ( indices >> ( i * 3 ) ) & 7 ];
+	}
+}
+
+void Cook_DecompressLevel( unsigned int format, const uint8_t *src, unsigned int width, unsigned int height, uint8_t *rgba ) {
+	if ( format != OHX_FORMAT_BC1 && format != OHX_FORMAT_BC3 ) {
+		memcpy( rgba, src, ( size_t ) width * height * 4 );
+		return;
+	}
+
+	uint8_t block[ 16 * 4 ];
+	for ( unsigned int by = 0; by < ( height + 3 ) / 4; ++by ) {
+		for ( unsigned int bx = 0; bx < ( width + 3 ) / 4; ++bx ) {
+			if ( format == OHX_FORMAT_BC1 ) {
+				Cook_DecodeColourBlock( src, true, block );
+				src += 8;
+			} else {
+				Cook_DecodeColourBlock( src + 8, false, block );
+				Cook_DecodeAlphaBlock( src, block );
+				src += 16;
+			}
+
+			// and write back whatever of the block is actually inside the image
+			for ( unsigned int y = 0; y < 4 && by * 4 + y < height; ++y ) {
+				for ( unsigned int x = 0; x < 4 && bx * 4 + x < width; ++x ) {
+					memcpy( rgba + ( ( size_t ) ( by * 4 + y ) * width + bx * 4 + x ) * 4, block + ( y * 4 + x ) * 4, 4 );
+				}
+			}
+		}
+	}
+}
+
+void Cook_Texture( const uint8_t *rgba, unsigned int width, unsigned int height, bool generateMips, bool compress, CookedTexture *out ) {
+	out->width = width;
+	out->height = height;
+	out->format = OHX_FORMAT_RGBA8;
+	if ( compress ) {
+		out->format = OHX_FORMAT_BC1;
+		for ( size_t i = 0; i < ( size_t ) width * height; ++i ) {
+			if ( rgba[ i * 4 + 3 ] != 255 ) {
+				out->format = OHX_FORMAT_BC3;
+				break;
+			}
+		}
+	}
+
+	out->levels.clear();
+	out->pixels.clear();
+
+	std::vector< uint8_t > level( rgba, rgba + ( size_t ) width * height * 4 ), nextLevel;
+	unsigned int levelWidth = width, levelHeight = height;
+	while ( out->levels.size() < OHX_MAX_LEVELS ) {
+		OhxLevel ohxLevel;
+		ohxLevel.width = levelWidth;
+		ohxLevel.height = levelHeight;
+		ohxLevel.offset = out->pixels.size();
+		ohxLevel.size = Cook_GetLevelSize( out->format, levelWidth, levelHeight );
+		out->levels.push_back( ohxLevel );
+
+		out->pixels.resize( out->pixels.size() + ohxLevel.size );
+		uint8_t *dst = &out->pixels[ ohxLevel.offset ];
+		switch ( out->format ) {
+			case OHX_FORMAT_BC1: Cook_CompressBC1( level.data(), levelWidth, levelHeight, dst ); break;
+			case OHX_FORMAT_BC3: Cook_CompressBC3( level.data(), levelWidth, levelHeight, dst ); break;
+			default: memcpy( dst, level.data(), ohxLevel.size ); break;
+		}
+
+		if ( !generateMips || ( levelWidth == 1 && levelHeight == 1 ) ) {
+			break;
+		}
+
+		nextLevel.resize( ( size_t ) std::max( levelWidth / 2, 1U ) * std::max( levelHeight / 2, 1U ) * 4 );
+		Cook_Downsample( level.data(), levelWidth, levelHeight, nextLevel.data() );
+		level.swap( nextLevel );
+		levelWidth = std::max( levelWidth / 2, 1U );
+		levelHeight = std::max( levelHeight / 2, 1U );
+	}
+}
@@ -0,0 +1,42 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "loaders/OhxLoader.h"
+
+/* A texture converted into the form it's uploaded in, with every mip level
+ * it's going to have stored back to back. */
+struct CookedTexture {
+	unsigned int format{ OHX_FORMAT_RGBA8 };
+	unsigned int width{ 0 };
+	unsigned int height{ 0 };
+
+	std::vector< OhxLevel > levels;
+	std::vector< uint8_t > pixels;
+};
+
+/* takes RGBA8 pixels; compressing picks BC1 if everything is opaque, otherwise BC3 */
+void Cook_Texture( const uint8_t *rgba, unsigned int width, unsigned int height, bool generateMips, bool compress, CookedTexture *out );
+
+/* both write out blocks row by row, and the size doesn't need to be a multiple of 4 */
+void Cook_CompressBC1( const uint8_t *rgba, unsigned int width, unsigned int height, uint8_t *out );
+void Cook_CompressBC3( const uint8_t *rgba, unsigned int width, unsigned int height, uint8_t *out );
+size_t Cook_GetLevelSize( unsigned int format, unsigned int width, unsigned int height );
+
+/* turns a cooked level of any format back into RGBA8, for when it can't be uploaded as it is */
+void Cook_DecompressLevel( unsigned int format, const uint8_t *src, unsigned int width, unsigned int height, uint8_t *rgba );
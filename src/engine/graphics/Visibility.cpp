@@ -0,0 +1,272 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cfloat>
+
+#include "App.h"
+#include "Visibility.h"
+#include "Camera.h"
+#include "game/ActorManager.h"
+
+static const unsigned int levelOffsets[ VISIBILITY_LEVELS ] = { 0, 1, 5, 21, 85 };
+
+static PL_INLINE unsigned int Visibility_GetNode( unsigned int level, unsigned int x, unsigned int y ) {
+	return levelOffsets[ level ] + y * ( 1U << level ) + x;
+}
+
+static PL_INLINE void Visibility_AddBounds( PLVector3 *mins, PLVector3 *maxs, const PLVector3 &otherMins, const PLVector3 &otherMaxs ) {
+	mins->x = std::min( mins->x, otherMins.x );
+	mins->y = std::min( mins->y, otherMins.y );
+	mins->z = std::min( mins->z, otherMins.z );
+	maxs->x = std::max( maxs->x, otherMaxs.x );
+	maxs->y = std::max( maxs->y, otherMaxs.y );
+	maxs->z = std::max( maxs->z, otherMaxs.z );
+}
+
+ohw::Visibility::Visibility() {
+	plRegisterConsoleCommand( "PrintVisibilityStats", PrintStatsCommand,
+	                          "Prints average culling time and number of objects drawn since it was last run." );
+}
+
+void ohw::Visibility::Update( const Camera *camera, const Terrain *terrain, float cullDistance ) {
+	Timer timer;
+
+	camera_ = camera;
+	terrain_ = terrain;
+	cameraPosition_ = camera->GetPosition();
+	cameraForward_ = camera->GetForward();
+	cullDistance_ = cullDistance;
+
+	totalStats_.numFrames++;
+	totalStats_.cullTime += frameStats_.cullTime;
+	totalStats_.numNodesTested += frameStats_.numNodesTested;
+	totalStats_.numChunks += frameStats_.numChunks;
+	totalStats_.numActors += frameStats_.numActors;
+	totalStats_.numDrawn += frameStats_.numDrawn;
+	frameStats_ = Stats();
+
+	visibleChunks_.clear();
+	visibleActors_.clear();
+
+	BinActors();
+
+	if ( !cv_graphics_cull->b_value ) {
+		if ( terrain != nullptr ) {
+			for ( unsigned int i = 0; i < TERRAIN_CHUNKS; ++i ) {
+				visibleChunks_.push_back( i );
+			}
+		}
+		for ( const auto &i : actorBounds_ ) {
+			visibleActors_.push_back( i.actor );
+		}
+		for ( const auto &i : unsortedActors_ ) {
+			visibleActors_.push_back( i.actor );
+		}
+	} else {
+		BuildNodes();
+		CullNode( 0, 0, 0 );
+
+		for ( const auto &i : unsortedActors_ ) {
+			if ( IsBoxVisible( i.mins, i.maxs ) ) {
+				visibleActors_.push_back( i.actor );
+			}
+		}
+	}
+
+	timer.End();
+	frameStats_.cullTime = timer.GetTimeTaken();
+	frameStats_.numChunks = visibleChunks_.size();
+	frameStats_.numActors = visibleActors_.size();
+}
+
+/**
+ * Sorts every actor by the chunk it's over, using the same bounds it'll
+ * be culled with. Anything we can't tell the size of is always drawn.
+ */
+void ohw::Visibility::BinActors() {
+	const ActorSet &actors = ActorManager::GetInstance()->GetActors();
+
+	unsortedActors_.clear();
+	actorBounds_.clear();
+	actorBounds_.reserve( actors.size() );
+
+	std::vector< unsigned int > chunkIndices;
+	chunkIndices.reserve( actors.size() );
+	memset( chunkActors_, 0, sizeof( chunkActors_ ) );
+
+	for ( auto actor : actors ) {
+		PLCollisionAABB bounds = actor->GetVisibilityBounds();
+		ActorBounds actorBounds{ actor, bounds.origin + bounds.mins, bounds.origin + bounds.maxs };
+		if ( bounds.mins.x == bounds.maxs.x && bounds.mins.y == bounds.maxs.y && bounds.mins.z == bounds.maxs.z ) {
+			visibleActors_.push_back( actor );
+			continue;
+		}
+
+		int x = static_cast< int >( std::floor( bounds.origin.x / TERRAIN_CHUNK_PIXEL_WIDTH ) );
+		int y = static_cast< int >( std::floor( bounds.origin.z / TERRAIN_CHUNK_PIXEL_WIDTH ) );
+		if ( x < 0 || y < 0 || x >= TERRAIN_CHUNK_ROW || y >= TERRAIN_CHUNK_ROW ) {
+			unsortedActors_.push_back( actorBounds );
+			continue;
+		}
+
+		unsigned int chunk = x + y * TERRAIN_CHUNK_ROW;
+		chunkIndices.push_back( chunk );
+		actorBounds_.push_back( actorBounds );
+		chunkActors_[ chunk + 1 ]++;
+	}
+
+	// Counting sort, so chunkActors_[ i ] is where chunk i's actors start
+	for ( unsigned int i = 0; i < TERRAIN_CHUNKS; ++i ) {
+		chunkActors_[ i + 1 ] += chunkActors_[ i ];
+	}
+
+	std::vector< ActorBounds > sorted( actorBounds_.size() );
+	unsigned int next[ TERRAIN_CHUNKS ];
+	memcpy( next, chunkActors_, sizeof( next ) );
+	for ( unsigned int i = 0; i < actorBounds_.size(); ++i ) {
+		sorted[ next[ chunkIndices[ i ] ]++ ] = actorBounds_[ i ];
+	}
+	actorBounds_.swap( sorted );
+}
+
+/**
+ * Fills in the bounds of every node, from the chunks and actors up. This
+ * is cheap enough to do every frame, which saves us having to keep track
+ * of the terrain being edited or actors moving around.
+ */
+void ohw::Visibility::BuildNodes() {
+	static const unsigned int leafLevel = VISIBILITY_LEVELS - 1;
+	for ( unsigned int y = 0; y < TERRAIN_CHUNK_ROW; ++y ) {
+		for ( unsigned int x = 0; x < TERRAIN_CHUNK_ROW; ++x ) {
+			unsigned int chunk = x + y * TERRAIN_CHUNK_ROW;
+			Node &node = nodes_[ Visibility_GetNode( leafLevel, x, y ) ];
+			node.mins = PLVector3( FLT_MAX, FLT_MAX, FLT_MAX );
+			node.maxs = PLVector3( -FLT_MAX, -FLT_MAX, -FLT_MAX );
+			node.isEmpty = true;
+
+			if ( terrain_ != nullptr ) {
+				const PLCollisionAABB &bounds = terrain_->GetChunkByIndex( chunk ).bounds;
+				Visibility_AddBounds( &node.mins, &node.maxs, bounds.origin + bounds.mins, bounds.origin + bounds.maxs );
+				node.isEmpty = false;
+			}
+
+			for ( unsigned int i = chunkActors_[ chunk ]; i < chunkActors_[ chunk + 1 ]; ++i ) {
+				Visibility_AddBounds( &node.mins, &node.maxs, actorBounds_[ i ].mins, actorBounds_[ i ].maxs );
+				node.isEmpty = false;
+			}
+		}
+	}
+
+	for ( int level = leafLevel - 1; level >= 0; --level ) {
+		unsigned int size = 1U << level;
+		for ( unsigned int y = 0; y < size; ++y ) {
+			for ( unsigned int x = 0; x < size; ++x ) {
+				Node &node = nodes_[ Visibility_GetNode( level, x, y ) ];
+				node.mins = PLVector3( FLT_MAX, FLT_MAX, FLT_MAX );
+				node.maxs = PLVector3( -FLT_MAX, -FLT_MAX, -FLT_MAX );
+				node.isEmpty = true;
+
+				for ( unsigned int i = 0; i < 4; ++i ) {
+					const Node &child = nodes_[ Visibility_GetNode( level + 1, x * 2 + ( i & 1 ), y * 2 + ( i >> 1 ) ) ];
+					if ( child.isEmpty ) {
+						continue;
+					}
+
+					Visibility_AddBounds( &node.mins, &node.maxs, child.mins, child.maxs );
+					node.isEmpty = false;
+				}
+			}
+		}
+	}
+}
+
+void ohw::Visibility::CullNode( unsigned int level, unsigned int x, unsigned int y ) {
+	const Node &node = nodes_[ Visibility_GetNode( level, x, y ) ];
+	if ( node.isEmpty || !IsBoxVisible( node.mins, node.maxs ) ) {
+		return;
+	}
+
+	if ( level < VISIBILITY_LEVELS - 1 ) {
+		for ( unsigned int i = 0; i < 4; ++i ) {
+			CullNode( level + 1, x * 2 + ( i & 1 ), y * 2 + ( i >> 1 ) );
+		}
+		return;
+	}
+
+	// Down to a single chunk, so now we check what's actually in it
+	unsigned int chunk = x + y * TERRAIN_CHUNK_ROW;
+	unsigned int firstActor = chunkActors_[ chunk ], lastActor = chunkActors_[ chunk + 1 ];
+	if ( terrain_ != nullptr ) {
+		// if there's nothing else in here, then the node was just the chunk
+		const PLCollisionAABB &bounds = terrain_->GetChunkByIndex( chunk ).bounds;
+		if ( firstActor == lastActor || IsBoxVisible( bounds.origin + bounds.mins, bounds.origin + bounds.maxs ) ) {
+			visibleChunks_.push_back( chunk );
+		}
+	}
+
+	for ( unsigned int i = firstActor; i < lastActor; ++i ) {
+		if ( IsBoxVisible( actorBounds_[ i ].mins, actorBounds_[ i ].maxs ) ) {
+			visibleActors_.push_back( actorBounds_[ i ].actor );
+		}
+	}
+}
+
+bool ohw::Visibility::IsBoxVisible( const PLVector3 &mins, const PLVector3 &maxs ) {
+	frameStats_.numNodesTested++;
+
+	PLVector3 halfSize = ( maxs - mins ) * 0.5f;
+	PLVector3 centre = mins + halfSize;
+
+	// Nearest the box gets along the view direction, rather than the nearest
+	// point on it, as that's what the fog's based on
+	if ( cullDistance_ > 0.0f ) {
+		PLVector3 delta = centre - cameraPosition_;
+		float depth = delta.x * cameraForward_.x + delta.y * cameraForward_.y + delta.z * cameraForward_.z;
+		depth -= std::fabs( cameraForward_.x ) * halfSize.x +
+		         std::fabs( cameraForward_.y ) * halfSize.y +
+		         std::fabs( cameraForward_.z ) * halfSize.z;
+		if ( depth > cullDistance_ ) {
+			return false;
+		}
+	}
+
+	PLCollisionAABB bounds;
+	bounds.origin = centre;
+	bounds.mins = halfSize * -1.0f;
+	bounds.maxs = halfSize;
+	return camera_->IsBoxVisible( &bounds );
+}
+
+void ohw::Visibility::PrintStatsCommand( unsigned int argc, char **argv ) {
+	Visibility *visibility = GetInstance();
+	const Stats &frame = visibility->frameStats_;
+	Stats &total = visibility->totalStats_;
+
+	Print( "Last frame: %.3fms culling, %u tests, %u chunks and %u actors visible, %u drawn\n",
+	       frame.cullTime * 1000.0, frame.numNodesTested, frame.numChunks, frame.numActors, frame.numDrawn );
+
+	if ( total.numFrames == 0 ) {
+		return;
+	}
+
+	double numFrames = total.numFrames;
+	Print( "Average over %u frames: %.3fms culling, %.1f tests, %.1f chunks and %.1f actors visible, %.1f drawn\n",
+	       total.numFrames, total.cullTime * 1000.0 / numFrames, total.numNodesTested / numFrames,
+	       total.numChunks / numFrames, total.numActors / numFrames, total.numDrawn / numFrames );
+
+	total = Stats();
+}
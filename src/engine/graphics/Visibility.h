@@ -0,0 +1,105 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "Terrain.h"
+
+class Actor;
+
+/* one level per halving of the chunk grid, down to single chunks */
+#define VISIBILITY_LEVELS   5
+#define VISIBILITY_NODES    ( 1 + 4 + 16 + 64 + 256 )
+
+namespace ohw {
+	class Camera;
+
+	/**
+	 * Works out what's on screen once per frame, so every pass after it
+	 * can just walk the lists rather than each doing its own culling.
+	 *
+	 * Chunks are culled through a quadtree over the chunk grid. Actors are
+	 * sorted into whichever chunk they're stood over, and each node's bounds
+	 * cover the actors beneath it, so whole groups of both get thrown out
+	 * at once. Anything that's entirely lost in the fog is culled too.
+	 */
+	class Visibility {
+	public:
+		static Visibility *GetInstance() {
+			static Visibility *instance = nullptr;
+			if ( instance == nullptr ) {
+				instance = new Visibility();
+			}
+			return instance;
+		}
+
+		/* terrain may be null, cullDistance of 0 disables distance culling */
+		void Update( const Camera *camera, const Terrain *terrain, float cullDistance );
+
+		PL_INLINE const std::vector< unsigned int > &GetVisibleChunks() const { return visibleChunks_; }
+		PL_INLINE const std::vector< Actor * > &GetVisibleActors() const { return visibleActors_; }
+
+		/* called by each pass with the number of things it actually drew */
+		PL_INLINE void AddDrawn( unsigned int num ) { frameStats_.numDrawn += num; }
+
+		struct Stats {
+			unsigned int numFrames{ 0 };
+			double cullTime{ 0 };           // in seconds
+			unsigned int numNodesTested{ 0 };
+			unsigned int numChunks{ 0 };
+			unsigned int numActors{ 0 };
+			unsigned int numDrawn{ 0 };
+		};
+
+	private:
+		Visibility();
+
+		struct Node {
+			PLVector3 mins, maxs;
+			bool isEmpty;
+		};
+
+		void BinActors();
+		void BuildNodes();
+		void CullNode( unsigned int level, unsigned int x, unsigned int y );
+		bool IsBoxVisible( const PLVector3 &mins, const PLVector3 &maxs );
+
+		static void PrintStatsCommand( unsigned int argc, char **argv );
+
+		Node nodes_[ VISIBILITY_NODES ];
+
+		const Camera *camera_{ nullptr };
+		const Terrain *terrain_{ nullptr };
+		PLVector3 cameraPosition_;
+		PLVector3 cameraForward_;
+		float cullDistance_{ 0 };
+
+		struct ActorBounds {
+			Actor *actor;
+			PLVector3 mins, maxs;
+		};
+		std::vector< ActorBounds > actorBounds_;        // sorted by chunk
+		unsigned int chunkActors_[ TERRAIN_CHUNKS + 1 ]{};
+		std::vector< ActorBounds > unsortedActors_;     // not over the terrain
+
+		std::vector< unsigned int > visibleChunks_;
+		std::vector< Actor * > visibleActors_;
+
+		Stats frameStats_;
+		Stats totalStats_;
+	};
+}
@@ -15,28 +15,37 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <list>
 #include <map>
 #include <set>
 
 #include <PL/platform_mesh.h>
 #include <PL/pl_math_vector.h>
 
-void Mesh_GenerateFragmentedMeshNormals( const std::list<PLMesh *> &meshes ) {
+#include "MemoryArena.h"
+
+void Mesh_GenerateFragmentedMeshNormals( PLMesh *const *meshes, unsigned int numMeshes ) {
+	// Every vertex ends up in here, so it's all kept off the heap
+	ohw::MemoryArenaScope scope;
+	ohw::ArenaAllocator<PLVertex *> allocator( scope.GetArena() );
+
+	typedef std::set<PLVertex *, std::less<PLVertex *>, ohw::ArenaAllocator<PLVertex *>> VertexSet;
 	struct Position {
 		PLVector3 sum_normals;
-		std::set<PLVertex *> vertices;
+		VertexSet vertices;
 		unsigned int num_faces;
 
-		Position( const PLVector3 &normal, PLVertex *output ) :
-			sum_normals( normal ), num_faces( 1 ) {
+		Position( const PLVector3 &normal, PLVertex *output, const ohw::ArenaAllocator<PLVertex *> &allocator ) :
+			sum_normals( normal ), vertices( allocator ), num_faces( 1 ) {
 			vertices.insert( output );
 		}
 	};
 
-	std::map<PLVector3, Position> positions;
+	typedef std::pair<const PLVector3, Position> PositionPair;
+	std::map<PLVector3, Position, std::less<PLVector3>, ohw::ArenaAllocator<PositionPair>>
+		positions( std::less<PLVector3>(), ohw::ArenaAllocator<PositionPair>( scope.GetArena() ) );
 
-	for ( auto &mesh : meshes ) {
+	for ( unsigned int m = 0; m < numMeshes; ++m ) {
+		PLMesh *mesh = meshes[ m ];
 		for ( unsigned int i = 0, idx = 0; i < mesh->num_triangles; ++i, idx += 3 ) {
 			unsigned int a = mesh->indices[ idx ];
 			unsigned int b = mesh->indices[ idx + 1 ];
@@ -59,7 +68,7 @@ void Mesh_GenerateFragmentedMeshNormals( const std::list<PLMesh *> &meshes ) {
 					ni->second.vertices.insert( vertex );
 					++( ni->second.num_faces );
 				} else {
-					positions.insert( std::make_pair( vertex->position, Position( normal, vertex )));
+					positions.insert( std::make_pair( vertex->position, Position( normal, vertex, allocator )));
 				}
 			}
 		}
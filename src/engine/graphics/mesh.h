@@ -17,7 +17,6 @@
 
 #pragma once
 
-#include <list>
 #include <PL/platform_mesh.h>
 
-void Mesh_GenerateFragmentedMeshNormals(const std::list<PLMesh*>& meshes);
+void Mesh_GenerateFragmentedMeshNormals(PLMesh *const *meshes, unsigned int numMeshes);
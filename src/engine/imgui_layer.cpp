@@ -37,6 +37,7 @@
 #include "editor/ParticleEditor.h"
 #include "editor/TexturePicker.h"
 #include "editor/ConsoleWindow.h"
+#include "editor/MemoryWindow.h"
 
 #include "Language.h"
 
@@ -44,13 +45,6 @@ static bool show_quit = false;
 static bool show_settings = false;
 
 static ohw::ConsoleWindow *mainConsole = nullptr;
-static void ConsoleOutputCallback( int level, const char *msg ) {
-	if ( mainConsole == nullptr ) {
-		return;
-	}
-
-	mainConsole->PushMessage( level, msg );
-}
 
 static std::vector< BaseWindow * > windows;
 
@@ -136,8 +130,6 @@ void ImGuiImpl_Setup() {
 
 	mainConsole = new ohw::ConsoleWindow();
 	mainConsole->SetWindowStatus( false );
-
-	plSetConsoleOutputCallback( ConsoleOutputCallback );
 }
 
 void ImGuiImpl_SetupFrame( void ) {
@@ -470,6 +462,8 @@ private:
 };
 
 void UI_DisplayDebugMenu( void ) {
+	ohw::MemoryTagScope tagScope( ohw::MemoryTag::UI );
+
 	int dW = cv_display_width->i_value;
 	int dH = cv_display_height->i_value;
 
@@ -603,6 +597,7 @@ void UI_DisplayDebugMenu( void ) {
 				if ( ImGui::MenuItem( "Actor Inspector..." ) ) { windows.push_back( new ActorTreeWindow() ); }
 				if ( ImGui::MenuItem( "Map Config Editor..." ) ) { windows.push_back( new MapConfigEditor() ); }
 				if ( ImGui::MenuItem( "Texture Picker..." ) ) { windows.push_back( new TexturePicker() ); }
+				if ( ImGui::MenuItem( "Memory Usage..." ) ) { windows.push_back( new MemoryWindow() ); }
 			}
 			if ( ImGui::MenuItem( "Model Viewer..." ) ) { windows.push_back( new ModelViewer() ); }
 			ImGui::EndMenu();
@@ -0,0 +1,82 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "App.h"
+#include "BinaryReader.h"
+
+/************************************************************/
+/* Packed Binary Reader */
+
+/* all of the original formats are little-endian, as is everything
+ * we currently target, so records are copied out as-is */
+
+void Bin_InitReader( BinReader *reader, const uint8_t *data, size_t size ) {
+	reader->data = data;
+	reader->size = ( data != nullptr ) ? size : 0;
+	reader->pos = 0;
+	reader->overflow = false;
+}
+
+size_t Bin_GetRemaining( const BinReader *reader ) {
+	return reader->overflow ? 0 : reader->size - reader->pos;
+}
+
+const uint8_t *Bin_ReadView( BinReader *reader, size_t recordSize, size_t num ) {
+	if ( reader->overflow ) {
+		return nullptr;
+	}
+
+	// avoid overflowing when the count comes from a corrupt header
+	size_t remaining = reader->size - reader->pos;
+	if ( recordSize != 0 && num > remaining / recordSize ) {
+		reader->overflow = true;
+		return nullptr;
+	}
+
+	const uint8_t *view = reader->data + reader->pos;
+	reader->pos += recordSize * num;
+	return view;
+}
+
+bool Bin_Skip( BinReader *reader, size_t length ) {
+	return ( Bin_ReadView( reader, 1, length ) != nullptr );
+}
+
+bool Bin_ReadArray( BinReader *reader, void *dest, size_t recordSize, size_t num ) {
+	const uint8_t *view = Bin_ReadView( reader, recordSize, num );
+	if ( view == nullptr ) {
+		return false;
+	}
+
+	if ( num > 0 ) {
+		memcpy( dest, view, recordSize * num );
+	}
+
+	return true;
+}
+
+#define BIN_READ_SCALAR( NAME, TYPE ) \
+	bool Bin_Read ## NAME( BinReader *reader, TYPE *out ) { \
+		return Bin_ReadArray( reader, out, sizeof( TYPE ), 1 ); \
+	}
+
+BIN_READ_SCALAR( Int8, int8_t )
+BIN_READ_SCALAR( UInt8, uint8_t )
+BIN_READ_SCALAR( Int16, int16_t )
+BIN_READ_SCALAR( UInt16, uint16_t )
+BIN_READ_SCALAR( Int32, int32_t )
+BIN_READ_SCALAR( UInt32, uint32_t )
@@ -0,0 +1,51 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+PL_EXTERN_C
+
+/* Cursor over a block of packed little-endian data, usually a MappedFile
+ * or a package member. Every read is bounds checked; once a read fails the
+ * reader is flagged as overflowed and all further reads fail too, so
+ * callers can decode a whole header and check once at the end. */
+typedef struct BinReader {
+	const uint8_t *data;
+	size_t size;
+	size_t pos;
+	bool overflow;
+} BinReader;
+
+void Bin_InitReader( BinReader *reader, const uint8_t *data, size_t size );
+
+size_t Bin_GetRemaining( const BinReader *reader );
+bool Bin_Skip( BinReader *reader, size_t length );
+
+bool Bin_ReadInt8( BinReader *reader, int8_t *out );
+bool Bin_ReadUInt8( BinReader *reader, uint8_t *out );
+bool Bin_ReadInt16( BinReader *reader, int16_t *out );
+bool Bin_ReadUInt16( BinReader *reader, uint16_t *out );
+bool Bin_ReadInt32( BinReader *reader, int32_t *out );
+bool Bin_ReadUInt32( BinReader *reader, uint32_t *out );
+
+/* Returns a view of num records of the given size and advances past them,
+ * or null if there isn't enough data left. The view isn't aligned. */
+const uint8_t *Bin_ReadView( BinReader *reader, size_t recordSize, size_t num );
+/* Copies num packed records into dest in one go */
+bool Bin_ReadArray( BinReader *reader, void *dest, size_t recordSize, size_t num );
+
+PL_EXTERN_C_END
@@ -19,162 +19,128 @@
 
 #include "App.h"
 #include "Utilities.h"
+#include "MappedFile.h"
+#include "BinaryReader.h"
 #include "FacLoader.h"
 
 /************************************************************/
 /* Fac Triangle/Quad Faces Format */
 
-typedef struct FacQuad {
+typedef struct __attribute__((packed)) FacPackedQuad {
 	int8_t uv_coords[8];
 	uint16_t vertex_indices[4];
 	uint16_t normal_indices[4];
 	uint32_t texture_index;
 	uint16_t unknown[4];
-} FacQuad;
-
-static FacQuad *Fac_LoadQuads( PLFile *filePtr, unsigned int numQuads ) {
-	bool status = false;
-	FacQuad *quads = ( FacQuad * ) u_alloc( numQuads, sizeof( FacQuad ), true );
-	for ( unsigned int i = 0; i < numQuads; ++i ) {
-		for ( unsigned int j = 0; j < 8; ++j ) {
-			quads[ i ].uv_coords[ j ] = plReadInt8( filePtr, &status );
-		}
-		for ( unsigned int j = 0; j < 4; ++j ) {
-			quads[ i ].vertex_indices[ j ] = plReadInt16( filePtr, false, &status );
-		}
-		for ( unsigned int j = 0; j < 4; ++j ) {
-			quads[ i ].normal_indices[ j ] = plReadInt16( filePtr, false, &status );
-		}
-		quads[ i ].texture_index = plReadInt32( filePtr, false, &status );
-		for ( unsigned int j = 0; j < 4; ++j ) {
-			quads[ i ].unknown[ j ] = plReadInt16( filePtr, false, &status );
-		}
-	}
-
-	if ( !status ) {
-		u_free( quads );
-	}
-
-	return quads;
-}
-
-static FacTriangle *Fac_LoadTriangles( PLFile *filePtr, unsigned int numTriangles ) {
-	bool status = false;
-	FacTriangle *triangles = ( FacTriangle * ) u_alloc( numTriangles, sizeof( FacTriangle ), true );
-	for ( unsigned int i = 0; i < numTriangles; ++i ) {
-		for ( unsigned int j = 0; j < 6; ++j ) {
-			triangles[ i ].uv_coords[ j ] = plReadInt8( filePtr, &status );
-		}
-		for ( unsigned int j = 0; j < 3; ++j ) {
-			triangles[ i ].vertex_indices[ j ] = plReadInt16( filePtr, false, &status );
-		}
-		for ( unsigned int j = 0; j < 3; ++j ) {
-			triangles[ i ].normal_indices[ j ] = plReadInt16( filePtr, false, &status );
-		}
-		triangles[ i ].unknown0 = plReadInt16( filePtr, false, &status );
-		triangles[ i ].texture_index = plReadInt32( filePtr, false, &status );
-		for ( unsigned int j = 0; j < 4; ++j ) {
-			triangles[ i ].unknown1[ j ] = plReadInt16( filePtr, false, &status );
-		}
-	}
-
-	if ( !status ) {
-		u_free( triangles );
-	}
-
-	return triangles;
-}
-
-FacHandle *Fac_LoadFile( const char *path ) {
-	PLFile *filePtr = plOpenFile( path, false );
-	if ( filePtr == NULL ) {
-		Warning( "Failed to load Fac \"%s\", aborting!\nPL: %s\n", path, plGetError() );
-		return NULL;
-	}
+} FacPackedQuad;
+static_assert( sizeof( FacPackedQuad ) == 36, "invalid struct size" );
+
+typedef struct __attribute__((packed)) FacPackedTriangle {
+	int8_t uv_coords[6];
+	uint16_t vertex_indices[3];
+	uint16_t normal_indices[3];
+	uint16_t unknown0;
+	uint32_t texture_index;
+	uint16_t unknown1[4];
+} FacPackedTriangle;
+static_assert( sizeof( FacPackedTriangle ) == 32, "invalid struct size" );
 
-	//LogDebug( "Opened Fac \"%s\"...\n", plGetFilePath( filePtr ) );
+FacHandle *Fac_LoadMemory( const uint8_t *data, size_t size, const char *name ) {
+	BinReader reader;
+	Bin_InitReader( &reader, data, size );
 
 	/* 16 bytes of unknown data, just skip it for now */
-	if ( !plFileSeek( filePtr, 16, PL_SEEK_CUR ) ) {
-		plCloseFile( filePtr );
-
-		Warning( "Failed to find data in Fac \"%s\"!\nPL: %s\n", path, plGetError() );
+	uint32_t numTriangles;
+	if ( !Bin_Skip( &reader, 16 ) || !Bin_ReadUInt32( &reader, &numTriangles ) ) {
+		Warning( "Failed to find data in Fac \"%s\"!\n", name );
 		return NULL;
 	}
 
-	bool status;
-	uint32_t numTriangles = plReadInt32( filePtr, false, &status );
-	FacTriangle *triangles = Fac_LoadTriangles( filePtr, numTriangles );
-	if ( triangles == NULL && numTriangles > 0 ) {
-		Warning( "Failed to read in triangles, \"%s\"!\nPL: %s\n", path, plGetError() );
-		plCloseFile( filePtr );
+	const uint8_t *triangles = Bin_ReadView( &reader, sizeof( FacPackedTriangle ), numTriangles );
+	if ( triangles == NULL ) {
+		Warning( "Failed to read in triangles, \"%s\"!\n", name );
 		return NULL;
 	}
 
-	uint32_t numQuads = plReadInt32( filePtr, false, &status );
-	FacQuad *quads = Fac_LoadQuads( filePtr, numQuads );
+	/* quads are optional */
+	uint32_t numQuads = 0;
+	Bin_ReadUInt32( &reader, &numQuads );
+	const uint8_t *quads = Bin_ReadView( &reader, sizeof( FacPackedQuad ), numQuads );
 	if ( quads == NULL && numQuads > 0 ) {
-		Warning( "Failed to read in quads, \"%s\"!\nPL: %s\n", path, plGetError() );
-		free( triangles );
-		plCloseFile( filePtr );
+		Warning( "Failed to read in quads, \"%s\"!\n", name );
 		return NULL;
 	}
 
 	if ( numQuads == 0 && numTriangles == 0 ) {
-		Warning( "Fac \"%s\" contains no quads or triangles!\n", path );
-	}
-
-	// check for textures table
-	uint8_t num_textures = plReadInt8( filePtr, &status );
-	FacTextureIndex *texture_table = NULL;
-	if ( num_textures > 0 ) {
-		texture_table = ( FacTextureIndex * ) u_alloc( num_textures, sizeof( FacTextureIndex ), true );
-		for ( unsigned int i = 0; i < num_textures; ++i ) {
-			plReadFile( filePtr, texture_table[ i ].name, 1, sizeof( texture_table[ i ].name ) );
-		}
+		Warning( "Fac \"%s\" contains no quads or triangles!\n", name );
 	}
 
-	plCloseFile( filePtr );
-
 	FacHandle *handle = ( FacHandle * ) u_alloc( 1, sizeof( FacHandle ), true );
 	handle->num_triangles = numTriangles + ( numQuads * 2 );
 	handle->triangles = ( FacTriangle * ) u_alloc( handle->num_triangles, sizeof( FacTriangle ), true );
 
 	for ( unsigned int i = 0; i < numTriangles; ++i ) {
-		handle->triangles[ i ].texture_index = triangles[ i ].texture_index;
-		for ( unsigned int j = 0, u = 0; j < 3; j++, u += 2 ) {
-			handle->triangles[ i ].vertex_indices[ j ] = triangles[ i ].vertex_indices[ j ];
-			handle->triangles[ i ].normal_indices[ j ] = triangles[ i ].normal_indices[ j ];
-			handle->triangles[ i ].uv_coords[ u ] = triangles[ i ].uv_coords[ u ];
-			handle->triangles[ i ].uv_coords[ u + 1 ] = triangles[ i ].uv_coords[ u + 1 ];
-		}
+		FacPackedTriangle triangle;
+		memcpy( &triangle, triangles + ( i * sizeof( FacPackedTriangle ) ), sizeof( FacPackedTriangle ) );
+
+		FacTriangle *out = &handle->triangles[ i ];
+		memcpy( out->uv_coords, triangle.uv_coords, sizeof( triangle.uv_coords ) );
+		memcpy( out->vertex_indices, triangle.vertex_indices, sizeof( triangle.vertex_indices ) );
+		memcpy( out->normal_indices, triangle.normal_indices, sizeof( triangle.normal_indices ) );
+		out->unknown0 = triangle.unknown0;
+		out->texture_index = triangle.texture_index;
+		memcpy( out->unknown1, triangle.unknown1, sizeof( triangle.unknown1 ) );
 	}
 
 	for ( unsigned int i = 0, tri = numTriangles; i < numQuads; ++i ) {
-		int quad_to_tri[2][3] = {
+		static const int quad_to_tri[2][3] = {
 				{ 0, 1, 2 },
 				{ 2, 3, 0 },
 		};
 
+		FacPackedQuad quad;
+		memcpy( &quad, quads + ( i * sizeof( FacPackedQuad ) ), sizeof( FacPackedQuad ) );
+
 		for ( int q = 0; q < 2; ++q, ++tri ) {
-			int *q2t = quad_to_tri[ q ];
+			const int *q2t = quad_to_tri[ q ];
 
-			handle->triangles[ tri ].texture_index = quads[ i ].texture_index;
+			handle->triangles[ tri ].texture_index = quad.texture_index;
 			for ( unsigned int j = 0; j < 3; j++ ) {
-				handle->triangles[ tri ].vertex_indices[ j ] = quads[ i ].vertex_indices[ q2t[ j ] ];
-				handle->triangles[ tri ].normal_indices[ j ] = quads[ i ].normal_indices[ q2t[ j ] ];
+				handle->triangles[ tri ].vertex_indices[ j ] = quad.vertex_indices[ q2t[ j ] ];
+				handle->triangles[ tri ].normal_indices[ j ] = quad.normal_indices[ q2t[ j ] ];
 				// todo
-				handle->triangles[ tri ].uv_coords[ j * 2 ] = quads[ i ].uv_coords[ q2t[ j ] * 2 ];
-				handle->triangles[ tri ].uv_coords[ j * 2 + 1 ] = quads[ i ].uv_coords[ q2t[ j ] * 2 + 1 ];
+				handle->triangles[ tri ].uv_coords[ j * 2 ] = quad.uv_coords[ q2t[ j ] * 2 ];
+				handle->triangles[ tri ].uv_coords[ j * 2 + 1 ] = quad.uv_coords[ q2t[ j ] * 2 + 1 ];
+			}
+		}
+	}
+
+	// check for textures table
+	uint8_t numTextures = 0;
+	Bin_ReadUInt8( &reader, &numTextures );
+	if ( numTextures > 0 ) {
+		handle->texture_table = ( FacTextureIndex * ) u_alloc( numTextures, sizeof( FacTextureIndex ), true );
+		handle->texture_table_size = numTextures;
+		for ( unsigned int i = 0; i < numTextures; ++i ) {
+			if ( !Bin_ReadArray( &reader, handle->texture_table[ i ].name, sizeof( handle->texture_table[ i ].name ), 1 ) ) {
+				Warning( "Truncated texture table in Fac \"%s\" (%u/%u)!\n", name, i, numTextures );
+				break;
 			}
 		}
 	}
 
-	if ( texture_table != NULL ) {
-		handle->texture_table = texture_table;
-		handle->texture_table_size = num_textures;
+	return handle;
+}
+
+FacHandle *Fac_LoadFile( const char *path ) {
+	MappedFile *file = Map_OpenFile( path );
+	if ( file == NULL ) {
+		Warning( "Failed to load Fac \"%s\", aborting!\nPL: %s\n", path, plGetError() );
+		return NULL;
 	}
 
+	FacHandle *handle = Fac_LoadMemory( file->data, file->size, path );
+	Map_CloseFile( file );
 	return handle;
 }
 
@@ -192,15 +158,7 @@ void Fac_WriteFile( FacHandle *handle, const char *path ) {
 
 	// write out the triangle data
 	fwrite( &handle->num_triangles, sizeof( uint32_t ), 1, fp );
-	struct __attribute__((packed)) {
-		int8_t uv_coords[6];
-		uint16_t vertex_indices[3];
-		uint16_t normal_indices[3];
-		uint16_t unknown0;
-		uint32_t texture_index;
-		uint16_t unknown1[4];
-	} triangles[handle->num_triangles];
-	memset( triangles, 0, sizeof( *triangles ) * handle->num_triangles );
+	FacPackedTriangle *triangles = ( FacPackedTriangle * ) u_alloc( handle->num_triangles, sizeof( FacPackedTriangle ), true );
 	for ( unsigned int i = 0; i < handle->num_triangles; ++i ) {
 		triangles[ i ].texture_index = handle->triangles[ i ].texture_index;
 		for ( unsigned int j = 0; j < 3; ++j ) {
@@ -211,7 +169,8 @@ void Fac_WriteFile( FacHandle *handle, const char *path ) {
 			triangles[ i ].uv_coords[ j ] = handle->triangles[ i ].uv_coords[ j ];
 		}
 	}
-	fwrite( triangles, sizeof( *triangles ), handle->num_triangles, fp );
+	fwrite( triangles, sizeof( FacPackedTriangle ), handle->num_triangles, fp );
+	u_free( triangles );
 
 	// we won't write any quads, so just mark it as 0
 	uint32_t quads = 0;
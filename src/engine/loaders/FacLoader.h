@@ -41,6 +41,7 @@ typedef struct FacHandle {
 } FacHandle;
 
 FacHandle *Fac_LoadFile( const char *path );
+FacHandle *Fac_LoadMemory( const uint8_t *data, size_t size, const char *name );
 void Fac_WriteFile( FacHandle *handle, const char *path );
 void Fac_DestroyHandle( FacHandle *handle );
 
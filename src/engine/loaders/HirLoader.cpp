@@ -18,40 +18,38 @@
 #include "App.h"
 #include "model.h"
 #include "Loaders.h"
+#include "MappedFile.h"
+#include "BinaryReader.h"
 
 /************************************************************/
 /* Hir Skeleton Format */
 
-HirHandle *Hir_LoadFile( const char *path ) {
-	PLFile *file = plOpenFile( path, false );
-	if ( file == nullptr ) {
-		Warning( "Failed to load \"%s\", aborting!\n", path );
-		return nullptr;
-	}
-
-	size_t hir_size = plGetFileSize( file );
-	if ( hir_size == 0 ) {
-		plCloseFile( file );
-		Warning( "Unexpected Hir size in \"%s\", aborting (%s)!\n", path, plGetError() );
-		return nullptr;
-	}
-
+HirHandle *Hir_LoadMemory( const uint8_t *data, size_t size, const char *name ) {
 	typedef struct __attribute__((packed)) HirBone {
 		int32_t parent;
 		int16_t coords[3];
 		int8_t unknown[10];
 	} HirBone;
+	static_assert( sizeof( HirBone ) == 24, "invalid struct size" );
 
-	auto num_bones = ( unsigned int ) ( hir_size / sizeof( HirBone ) );
-	HirBone bones[num_bones];
-	unsigned int rnum_bones = plReadFile( file, bones, sizeof( HirBone ), num_bones );
-	plCloseFile( file );
+	BinReader reader;
+	Bin_InitReader( &reader, data, size );
 
-	if ( rnum_bones != num_bones ) {
-		Warning( "Failed to read in all bones, %d/%d, aborting!\n", rnum_bones, num_bones );
+	auto num_bones = ( unsigned int ) ( Bin_GetRemaining( &reader ) / sizeof( HirBone ) );
+	if ( num_bones == 0 ) {
+		Warning( "Unexpected Hir size in \"%s\", aborting!\n", name );
 		return nullptr;
 	}
 
+	/* in the long term, we won't have this here, we'll probably extend the format
+	 * to include the names of each bone (.skeleton format?) */
+	if ( static_cast<HirSkeletonBone>(num_bones) >= HirSkeletonBone::MAX_BONES ) {
+		Warning( "Invalid number of bones, %d/%d, aborting!\n", num_bones, HirSkeletonBone::MAX_BONES );
+		return nullptr;
+	}
+
+	const uint8_t *bones = Bin_ReadView( &reader, sizeof( HirBone ), num_bones );
+
 	/* for debugging */
 	static const char *bone_names[static_cast<int>(HirSkeletonBone::MAX_BONES)] = {
 			"Pelvis",
@@ -63,24 +61,31 @@ HirHandle *Hir_LoadFile( const char *path ) {
 			"UpperLeg.R", "LowerLeg.R", "Foot.R",
 	};
 
-	/* in the long term, we won't have this here, we'll probably extend the format
-	 * to include the names of each bone (.skeleton format?) */
-	if ( static_cast<HirSkeletonBone>(num_bones) >= HirSkeletonBone::MAX_BONES ) {
-		Warning( "Invalid number of bones, %d/%d, aborting!\n", num_bones, HirSkeletonBone::MAX_BONES );
-		return nullptr;
-	}
-
 	auto *handle = static_cast<HirHandle *>(u_alloc( 1, sizeof( HirHandle ), true ));
 	handle->bones = static_cast<PLModelBone *>(u_alloc( num_bones, sizeof( PLModelBone ), true ));
+	handle->num_bones = num_bones;
 	for ( unsigned int i = 0; i < num_bones; ++i ) {
-		handle->bones[ i ].position = PLVector3( bones[ i ].coords[ 0 ], bones[ i ].coords[ 1 ],
-		                                         bones[ i ].coords[ 2 ] );
-		handle->bones[ i ].parent = bones[ i ].parent;
+		HirBone bone;
+		memcpy( &bone, bones + ( i * sizeof( HirBone ) ), sizeof( HirBone ) );
+		handle->bones[ i ].position = PLVector3( bone.coords[ 0 ], bone.coords[ 1 ], bone.coords[ 2 ] );
+		handle->bones[ i ].parent = bone.parent;
 		strcpy( handle->bones[ i ].name, bone_names[ i ] );
 	}
 	return handle;
 }
 
+HirHandle *Hir_LoadFile( const char *path ) {
+	MappedFile *file = Map_OpenFile( path );
+	if ( file == nullptr ) {
+		Warning( "Failed to load \"%s\", aborting!\n", path );
+		return nullptr;
+	}
+
+	HirHandle *handle = Hir_LoadMemory( file->data, file->size, path );
+	Map_CloseFile( file );
+	return handle;
+}
+
 void Hir_DestroyHandle( HirHandle *handle ) {
 	if ( handle == nullptr ) {
 		return;
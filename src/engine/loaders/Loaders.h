@@ -74,6 +74,7 @@ typedef struct HirHandle {
 	unsigned int num_bones;
 } HirHandle;
 HirHandle *Hir_LoadFile( const char *path );
+HirHandle *Hir_LoadMemory( const uint8_t *data, size_t size, const char *name );
 void Hir_DestroyHandle( HirHandle *handle );
 
 typedef struct MinHandle {
@@ -0,0 +1,154 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#if defined( _WIN32 )
+#	include <windows.h>
+#else
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <fcntl.h>
+#	include <unistd.h>
+#endif
+
+#include "App.h"
+#include "MappedFile.h"
+#include "Metrics.h"
+
+/************************************************************/
+/* Memory Mapped Files */
+
+static MappedFile *Map_ReadFile( const char *path ) {
+	PLFile *cache = plOpenFile( path, true );
+	if ( cache == nullptr ) {
+		return nullptr;
+	}
+
+	MappedFile *file = static_cast< MappedFile * >( u_alloc( 1, sizeof( MappedFile ), true ) );
+	file->cache = cache;
+	file->data = static_cast< const uint8_t * >( plGetFileData( cache ) );
+	file->size = plGetFileSize( cache );
+	return file;
+}
+
+static MappedFile *Map_MapFile( const char *path ) {
+	MappedFile *file = static_cast< MappedFile * >( u_alloc( 1, sizeof( MappedFile ), true ) );
+
+#if defined( _WIN32 )
+	HANDLE handle = CreateFileA( path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+	if ( handle == INVALID_HANDLE_VALUE ) {
+		u_free( file );
+		return nullptr;
+	}
+
+	LARGE_INTEGER size;
+	if ( !GetFileSizeEx( handle, &size ) || size.QuadPart == 0 ) {
+		CloseHandle( handle );
+		u_free( file );
+		return nullptr;
+	}
+
+	HANDLE mapping = CreateFileMappingA( handle, nullptr, PAGE_READONLY, 0, 0, nullptr );
+	if ( mapping == nullptr ) {
+		CloseHandle( handle );
+		u_free( file );
+		return nullptr;
+	}
+
+	void *data = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+	if ( data == nullptr ) {
+		CloseHandle( mapping );
+		CloseHandle( handle );
+		u_free( file );
+		return nullptr;
+	}
+
+	file->handle = handle;
+	file->mapping = mapping;
+	file->data = static_cast< const uint8_t * >( data );
+	file->size = static_cast< size_t >( size.QuadPart );
+#else
+	int fd = open( path, O_RDONLY );
+	if ( fd == -1 ) {
+		u_free( file );
+		return nullptr;
+	}
+
+	struct stat st;
+	if ( fstat( fd, &st ) != 0 || st.st_size == 0 ) {
+		close( fd );
+		u_free( file );
+		return nullptr;
+	}
+
+	void *data = mmap( nullptr, static_cast< size_t >( st.st_size ), PROT_READ, MAP_PRIVATE, fd, 0 );
+	// Mapping holds its own reference to the file
+	close( fd );
+	if ( data == MAP_FAILED ) {
+		u_free( file );
+		return nullptr;
+	}
+
+	file->data = static_cast< const uint8_t * >( data );
+	file->size = static_cast< size_t >( st.st_size );
+#endif
+
+	return file;
+}
+
+MappedFile *Map_OpenFile( const char *path ) {
+	// Resolve the path against whatever is mounted, so mods can override it
+	char localPath[PL_SYSTEM_MAX_PATH];
+	PLFile *fp = plOpenFile( path, false );
+	if ( fp == nullptr ) {
+		return nullptr;
+	}
+	snprintf( localPath, sizeof( localPath ), "%s", plGetFilePath( fp ) );
+	plCloseFile( fp );
+
+	MappedFile *file = Map_MapFile( localPath );
+	if ( file == nullptr ) {
+		file = Map_ReadFile( path );
+	}
+
+	if ( file != nullptr ) {
+		METRIC_COUNTER( "io.bytes_loaded" )->Add( file->size );
+	}
+
+	return file;
+}
+
+void Map_CloseFile( MappedFile *file ) {
+	if ( file == nullptr ) {
+		return;
+	}
+
+	if ( file->cache != nullptr ) {
+		plCloseFile( file->cache );
+		u_free( file );
+		return;
+	}
+
+#if defined( _WIN32 )
+	UnmapViewOfFile( file->data );
+	CloseHandle( static_cast< HANDLE >( file->mapping ) );
+	CloseHandle( static_cast< HANDLE >( file->handle ) );
+#else
+	munmap( const_cast< uint8_t * >( file->data ), file->size );
+#endif
+
+	u_free( file );
+}
@@ -0,0 +1,38 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+PL_EXTERN_C
+
+/* Read-only view of an entire file, backed by mmap where possible
+ * so nothing is copied until it's decoded. Paths are resolved through
+ * the mounted locations first, and if the file can't be mapped it's
+ * read into memory instead. */
+typedef struct MappedFile {
+	const uint8_t *data;
+	size_t size;
+
+	PLFile *cache;      /* set if we fell back to reading it in */
+	void *handle;       /* platform specific */
+	void *mapping;      /* platform specific */
+} MappedFile;
+
+MappedFile *Map_OpenFile( const char *path );
+void Map_CloseFile( MappedFile *file );
+
+PL_EXTERN_C_END
@@ -19,25 +19,30 @@
 
 #include "App.h"
 #include "loaders/Loaders.h"
+#include "loaders/MappedFile.h"
+#include "loaders/BinaryReader.h"
 
 /************************************************************/
 /* PSX Min Model Format */
 
 MinHandle *Min_LoadFile( const char *path ) {
-	PLFile *fp = plOpenFile( path, false );
+	MappedFile *fp = Map_OpenFile( path );
 	if ( fp == NULL ) {
 		Warning( "Failed to load Min \"%s\", aborting!\n", path );
 		return NULL;
 	}
 
-	plFileSeek( fp, 16, PL_SEEK_CUR );
+	BinReader reader;
+	Bin_InitReader( &reader, fp->data, fp->size );
 
 	uint32_t num_triangles;
-	if ( plReadFile( fp, &num_triangles, sizeof( uint32_t ), 1 ) != 1 ) {
+	if ( !Bin_Skip( &reader, 16 ) || !Bin_ReadUInt32( &reader, &num_triangles ) ) {
+		Map_CloseFile( fp );
 		Warning( "Failed to get number of triangles, \"%s\"!\n", path );
+		return NULL;
 	}
 
-	struct __attribute__((packed)) {
+	struct __attribute__((packed)) MinTriangle {
 #if 0
 		int8_t      uv_coords[6];
 		uint16_t    vertex_indices[3];
@@ -48,10 +53,11 @@ MinHandle *Min_LoadFile( const char *path ) {
 #else
 		char u0[24];
 #endif
-	} triangles[num_triangles];
-	static_assert( sizeof( *triangles ) == 24, "invalid struct size" );
-	if ( plReadFile( fp, triangles, sizeof( *triangles ), num_triangles ) != num_triangles ) {
-		plCloseFile( fp );
+	};
+	static_assert( sizeof( MinTriangle ) == 24, "invalid struct size" );
+	const uint8_t *triangles = Bin_ReadView( &reader, sizeof( MinTriangle ), num_triangles );
+	Map_CloseFile( fp );
+	if ( triangles == NULL ) {
 		Warning( "Failed to get %u triangles, \"%s\", aborting!\n", num_triangles, path );
 		return NULL;
 	}
@@ -20,56 +20,64 @@
 
 #include "App.h"
 #include "Utilities.h"
+#include "MappedFile.h"
+#include "BinaryReader.h"
 #include "No2Loader.h"
 
 /************************************************************/
 /* No2 Normals Format */
 
-/**
- * @brief Loads in vertex normal data
- * @param path Path to the NO2 file
- * @param vertex_data Pointer to an existing VtxHandle which will be filled with normal data
- * @return Returns vertex_data on success, null on fail
- */
-No2Handle *No2_LoadFile( const char *path ) {
-	PLFile *fp = plOpenFile( path, false );
-	if ( fp == NULL ) {
-		Warning( "Failed to load no2 \"%s\"!\n", path );
-		return NULL;
-	}
-
+No2Handle *No2_LoadMemory( const uint8_t *data, size_t size, const char *name ) {
 	typedef struct __attribute__((packed)) No2Coord {
 		float v[3];
 		float bone_index;
 	} No2Coord;
 
-	unsigned int numNormals = ( unsigned int ) ( plGetFileSize( fp ) / sizeof( No2Coord ) );
-	No2Coord *normals = ( No2Coord * ) ohw::GetApp()->CAlloc( numNormals, sizeof( No2Coord ), true );
-	unsigned int numReadNormals = plReadFile( fp, normals, sizeof( No2Coord ), numNormals );
+	static_assert( sizeof( No2Coord ) == 16, "invalid struct size" );
 
-	plCloseFile( fp );
+	BinReader reader;
+	Bin_InitReader( &reader, data, size );
 
-	if ( numReadNormals != numNormals ) {
-		free( normals );
-		Warning( "Failed to read in all normals from \"%s\"!\n", path );
+	unsigned int numNormals = ( unsigned int ) ( Bin_GetRemaining( &reader ) / sizeof( No2Coord ) );
+	if ( numNormals == 0 ) {
+		Warning( "No normals found in \"%s\"!\n", name );
 		return NULL;
 	}
 
-	No2Handle *handle = ( No2Handle * ) ohw::GetApp()->MAlloc( sizeof( No2Handle ), true );
+	const uint8_t *coords = Bin_ReadView( &reader, sizeof( No2Coord ), numNormals );
+
+	No2Handle *handle = ( No2Handle * ) u_alloc( 1, sizeof( No2Handle ), true );
 	handle->numNormals = numNormals;
-	handle->normals = ( PLVector3 * ) ohw::GetApp()->MAlloc( sizeof( PLVector3 ) * handle->numNormals, true );
+	handle->normals = ( PLVector3 * ) u_alloc( handle->numNormals, sizeof( PLVector3 ), true );
 	for ( unsigned int i = 0; i < numNormals; ++i ) {
-		handle->normals[ i ].x = normals->v[ 0 ];
-		handle->normals[ i ].y = normals->v[ 1 ];
-		handle->normals[ i ].z = normals->v[ 2 ];
+		No2Coord normal;
+		memcpy( &normal, coords + ( i * sizeof( No2Coord ) ), sizeof( No2Coord ) );
+		handle->normals[ i ].x = normal.v[ 0 ];
+		handle->normals[ i ].y = normal.v[ 1 ];
+		handle->normals[ i ].z = normal.v[ 2 ];
 	}
 
-	free( normals );
+	return handle;
+}
+
+/**
+ * @brief Loads in vertex normal data
+ * @param path Path to the NO2 file
+ * @return Returns a new No2Handle on success, null on fail
+ */
+No2Handle *No2_LoadFile( const char *path ) {
+	MappedFile *fp = Map_OpenFile( path );
+	if ( fp == NULL ) {
+		Warning( "Failed to load no2 \"%s\"!\n", path );
+		return NULL;
+	}
 
+	No2Handle *handle = No2_LoadMemory( fp->data, fp->size, path );
+	Map_CloseFile( fp );
 	return handle;
 }
 
 void No2_DestroyHandle( No2Handle *handle ) {
-	free( handle->normals );
-	free( handle );
+	u_free( handle->normals );
+	u_free( handle );
 }
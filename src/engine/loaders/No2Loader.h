@@ -25,6 +25,7 @@ typedef struct No2Handle {
 } No2Handle;
 
 No2Handle *No2_LoadFile( const char *path );
+No2Handle *No2_LoadMemory( const uint8_t *data, size_t size, const char *name );
 void No2_DestroyHandle( No2Handle *handle );
 
 PL_EXTERN_C_END
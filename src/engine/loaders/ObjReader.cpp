@@ -0,0 +1,602 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "App.h"
+#include "MappedFile.h"
+#include "ObjReader.h"
+
+/************************************************************/
+/* Streaming Obj/Mtl Parser */
+
+#define OBJ_MAX_POLY 64
+
+static inline bool Obj_IsSpace( char c ) {
+	return ( c == ' ' || c == '\t' || c == '\r' );
+}
+
+static inline bool Obj_IsDigit( char c ) {
+	return ( c >= '0' && c <= '9' );
+}
+
+static inline const char *Obj_SkipSpaces( const char *p, const char *end ) {
+	while ( p < end && Obj_IsSpace( *p ) ) {
+		++p;
+	}
+	return p;
+}
+
+static inline const char *Obj_SkipLine( const char *p, const char *end ) {
+	while ( p < end && *p != '\n' ) {
+		++p;
+	}
+	return ( p < end ) ? p + 1 : p;
+}
+
+static inline bool Obj_IsToken( const char *token, size_t length, const char *str ) {
+	size_t strLength = strlen( str );
+	return ( length == strLength && memcmp( token, str, length ) == 0 );
+}
+
+/* returns the next whitespace separated token on the current line */
+static const char *Obj_ReadToken( const char *&p, const char *end, size_t *length ) {
+	p = Obj_SkipSpaces( p, end );
+	const char *token = p;
+	while ( p < end && *p != '\n' && !Obj_IsSpace( *p ) ) {
+		++p;
+	}
+	*length = p - token;
+	return token;
+}
+
+/* returns the remainder of the current line, minus any comment and trailing whitespace */
+static std::string Obj_ReadRemainder( const char *&p, const char *end ) {
+	p = Obj_SkipSpaces( p, end );
+	const char *start = p;
+	while ( p < end && *p != '\n' && *p != '#' ) {
+		++p;
+	}
+
+	const char *last = p;
+	while ( last > start && Obj_IsSpace( *( last - 1 ) ) ) {
+		--last;
+	}
+
+	return std::string( start, last - start );
+}
+
+static bool Obj_ParseInt( const char *&p, const char *end, int64_t *out ) {
+	bool negative = false;
+	if ( p < end && ( *p == '-' || *p == '+' ) ) {
+		negative = ( *p == '-' );
+		++p;
+	}
+
+	if ( p >= end || !Obj_IsDigit( *p ) ) {
+		return false;
+	}
+
+	int64_t value = 0;
+	for ( ; p < end && Obj_IsDigit( *p ); ++p ) {
+		if ( value < INT32_MAX ) {
+			value = value * 10 + ( *p - '0' );
+		}
+	}
+
+	*out = negative ? -value : value;
+	return true;
+}
+
+static bool Obj_ParseFloat( const char *&p, const char *end, float *out ) {
+	static const double powersOfTen[] = {
+			1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+			1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+	};
+
+	p = Obj_SkipSpaces( p, end );
+
+	bool negative = false;
+	if ( p < end && ( *p == '-' || *p == '+' ) ) {
+		negative = ( *p == '-' );
+		++p;
+	}
+
+	// gather all the significant digits into one integer, and track where the point was
+	static const uint64_t maxMantissa = 100000000000000000ULL;
+	uint64_t mantissa = 0;
+	int exponent = 0;
+	bool hasDigits = false;
+	for ( ; p < end && Obj_IsDigit( *p ); ++p ) {
+		if ( mantissa < maxMantissa ) {
+			mantissa = mantissa * 10 + ( *p - '0' );
+		} else {
+			exponent++;
+		}
+		hasDigits = true;
+	}
+
+	if ( p < end && *p == '.' ) {
+		for ( ++p; p < end && Obj_IsDigit( *p ); ++p ) {
+			if ( mantissa < maxMantissa ) {
+				mantissa = mantissa * 10 + ( *p - '0' );
+				exponent--;
+			}
+			hasDigits = true;
+		}
+	}
+
+	if ( !hasDigits ) {
+		return false;
+	}
+
+	if ( p < end && ( *p == 'e' || *p == 'E' ) ) {
+		const char *e = p + 1;
+		int64_t value;
+		if ( Obj_ParseInt( e, end, &value ) ) {
+			exponent += ( int ) std::max< int64_t >( -1000, std::min< int64_t >( 1000, value ) );
+			p = e;
+		}
+	}
+
+	double value = ( double ) mantissa;
+	if ( exponent < 0 ) {
+		value = ( -exponent <= 22 ) ? value / powersOfTen[ -exponent ] : value * pow( 10.0, exponent );
+	} else if ( exponent > 0 ) {
+		value = ( exponent <= 22 ) ? value * powersOfTen[ exponent ] : value * pow( 10.0, exponent );
+	}
+
+	*out = static_cast< float >( negative ? -value : value );
+	return true;
+}
+
+static bool Obj_ParseVector3( const char *&p, const char *end, PLVector3 *out ) {
+	return Obj_ParseFloat( p, end, &out->x ) && Obj_ParseFloat( p, end, &out->y ) && Obj_ParseFloat( p, end, &out->z );
+}
+
+/* returns the directory of the given path, including the trailing separator */
+static std::string Obj_GetDirectory( const std::string &path ) {
+	size_t pos = path.find_last_of( "\\/" );
+	return ( pos != std::string::npos ) ? path.substr( 0, pos + 1 ) : std::string();
+}
+
+/* Obj indices are 1-based, or relative to the end if negative */
+static bool Obj_ResolveIndex( int64_t index, size_t count, int32_t *out ) {
+	if ( index == 0 ) {
+		return false;
+	}
+
+	int64_t resolved = ( index < 0 ) ? ( int64_t ) count + index : index - 1;
+	if ( resolved < 0 || resolved >= ( int64_t ) count ) {
+		return false;
+	}
+
+	*out = static_cast< int32_t >( resolved );
+	return true;
+}
+
+/**
+ * Open-addressed table mapping each unique position/texcoord/normal triple
+ * to the vertex that was generated for it.
+ */
+class ObjReader::VertexCache {
+public:
+	uint32_t Insert( int32_t position, int32_t texCoord, int32_t normal, uint32_t newIndex ) {
+		if ( ( numEntries + 1 ) * 2 > table.size() ) {
+			Grow();
+		}
+
+		size_t mask = table.size() - 1;
+		for ( size_t i = Hash( position, texCoord, normal ) & mask;; i = ( i + 1 ) & mask ) {
+			Entry &entry = table[ i ];
+			if ( entry.index == UINT32_MAX ) {
+				entry = { position, texCoord, normal, newIndex };
+				numEntries++;
+				return newIndex;
+			}
+
+			if ( entry.position == position && entry.texCoord == texCoord && entry.normal == normal ) {
+				return entry.index;
+			}
+		}
+	}
+
+private:
+	struct Entry {
+		int32_t position;
+		int32_t texCoord;
+		int32_t normal;
+		uint32_t index;
+	};
+
+	static size_t Hash( int32_t position, int32_t texCoord, int32_t normal ) {
+		uint64_t hash = ( uint32_t ) position * 73856093U ^ ( uint32_t ) texCoord * 19349663U ^ ( uint32_t ) normal * 83492791U;
+		return ( size_t ) ( ( hash * 0x9E3779B97F4A7C15ULL ) >> 29U );
+	}
+
+	void Grow() {
+		std::vector< Entry > oldTable;
+		oldTable.swap( table );
+		table.resize( oldTable.empty() ? 1024 : oldTable.size() * 2, { 0, 0, 0, UINT32_MAX } );
+		numEntries = 0;
+
+		for ( const auto &entry : oldTable ) {
+			if ( entry.index != UINT32_MAX ) {
+				Insert( entry.position, entry.texCoord, entry.normal, entry.index );
+			}
+		}
+	}
+
+	std::vector< Entry > table;
+	size_t numEntries{ 0 };
+};
+
+bool ObjReader::Load( const std::string &path, bool ccw ) {
+	MappedFile *file = Map_OpenFile( path.c_str() );
+	if ( file == nullptr ) {
+		Warning( "Failed to open \"%s\"!\n", path.c_str() );
+		return false;
+	}
+
+	bool status = LoadMemory( reinterpret_cast< const char * >( file->data ), file->size, path, ccw );
+	Map_CloseFile( file );
+	return status;
+}
+
+bool ObjReader::LoadMemory( const char *data, size_t size, const std::string &path, bool ccw ) {
+	Clear();
+
+	name = path;
+
+	size_t cpos = name.find_last_of( "\\/" );
+	if ( std::string::npos != cpos ) {
+		name.erase( 0, cpos + 1 );
+	}
+
+	cpos = name.find_last_of( '.' );
+	if ( std::string::npos != cpos ) {
+		name.erase( cpos );
+	}
+
+	std::vector< PLVector3 > positions;
+	std::vector< PLVector3 > normals;
+	std::vector< PLVector2 > texCoords;
+
+	// each subset has its own vertex cache, and each material maps to a subset
+	std::vector< VertexCache > vertexCaches;
+	std::vector< int > materialSubsets;
+
+	Material defaultMaterial;
+	defaultMaterial.strName = "default";
+	materials.push_back( defaultMaterial );
+
+	uint32_t curMaterial = 0;
+	bool warnedNormals = false;
+
+	std::string materialFilename;
+
+	const char *p = data;
+	const char *end = data + size;
+	while ( p < end ) {
+		size_t length;
+		const char *command = Obj_ReadToken( p, end, &length );
+		if ( length == 0 || command[ 0 ] == '#' ) {
+			// Blank line or comment
+		} else if ( Obj_IsToken( command, length, "v" ) ) {
+			// Vertex Position
+			PLVector3 position;
+			if ( !Obj_ParseVector3( p, end, &position ) ) {
+				Warning( "Invalid vertex position in Obj \"%s\"!\n", path.c_str() );
+				return false;
+			}
+			positions.push_back( position );
+		} else if ( Obj_IsToken( command, length, "vt" ) ) {
+			// Vertex TexCoord
+			float u, v;
+			if ( !Obj_ParseFloat( p, end, &u ) || !Obj_ParseFloat( p, end, &v ) ) {
+				Warning( "Invalid texture coordinate in Obj \"%s\"!\n", path.c_str() );
+				return false;
+			}
+			texCoords.push_back( PLVector2( u, 1.0f - v ) );
+
+			hasTexcoords = true;
+		} else if ( Obj_IsToken( command, length, "vn" ) ) {
+			// Vertex Normal
+			PLVector3 normal;
+			if ( !Obj_ParseVector3( p, end, &normal ) ) {
+				Warning( "Invalid vertex normal in Obj \"%s\"!\n", path.c_str() );
+				return false;
+			}
+			normals.push_back( normal );
+
+			hasNormals = true;
+		} else if ( Obj_IsToken( command, length, "f" ) ) {
+			// Face
+			if ( curMaterial >= materialSubsets.size() ) {
+				materialSubsets.resize( materials.size(), -1 );
+			}
+			if ( materialSubsets[ curMaterial ] == -1 ) {
+				materialSubsets[ curMaterial ] = static_cast< int >( subsets.size() );
+				subsets.emplace_back();
+				subsets.back().material = curMaterial;
+				vertexCaches.emplace_back();
+			}
+
+			Subset &subset = subsets[ materialSubsets[ curMaterial ] ];
+			VertexCache &vertexCache = vertexCaches[ materialSubsets[ curMaterial ] ];
+
+			index_t faceIndex[OBJ_MAX_POLY];
+			unsigned int iFace = 0;
+			for ( ;; ) {
+				p = Obj_SkipSpaces( p, end );
+				if ( p >= end || *p == '\n' || *p == '#' ) {
+					break;
+				}
+
+				if ( iFace >= OBJ_MAX_POLY ) {
+					// Too many polygon verts for the reader
+					Warning( "Too many polygon vertices for the reader (%dvs%d)!\n", iFace, OBJ_MAX_POLY );
+					return false;
+				}
+
+				int64_t iPosition, iTexCoord, iNormal;
+				int32_t position, texCoord = -1, normal = -1;
+				if ( !Obj_ParseInt( p, end, &iPosition ) || !Obj_ResolveIndex( iPosition, positions.size(), &position ) ) {
+					Warning( "Invalid face position index in Obj \"%s\"!\n", path.c_str() );
+					return false;
+				}
+
+				if ( p < end && *p == '/' ) {
+					++p;
+
+					// Optional texture coordinate
+					if ( p < end && *p != '/' ) {
+						if ( !Obj_ParseInt( p, end, &iTexCoord ) || !Obj_ResolveIndex( iTexCoord, texCoords.size(), &texCoord ) ) {
+							Warning( "Invalid face texture coordinate index in Obj \"%s\"!\n", path.c_str() );
+							return false;
+						}
+					}
+
+					// Optional vertex normal
+					if ( p < end && *p == '/' ) {
+						++p;
+
+						if ( !Obj_ParseInt( p, end, &iNormal ) ) {
+							Warning( "Invalid face normal index in Obj \"%s\"!\n", path.c_str() );
+							return false;
+						}
+
+						// Some Objs provide normal indices, but no normals
+						if ( !Obj_ResolveIndex( iNormal, normals.size(), &normal ) && !warnedNormals ) {
+							Warning( "Out of range normal in Obj \"%s\", ignoring!\n", path.c_str() );
+							warnedNormals = true;
+						}
+					}
+				}
+
+				auto newIndex = static_cast< index_t >( subset.vertices.size() );
+				index_t index = vertexCache.Insert( position, texCoord, normal, newIndex );
+				if ( index == newIndex ) {
+					PLVertex vertex;
+					vertex.position = positions[ position ];
+					vertex.normal = ( normal != -1 ) ? normals[ normal ] : PLVector3( 0, 0, 0 );
+					vertex.st[ 0 ] = ( texCoord != -1 ) ? texCoords[ texCoord ] : PLVector2( 0, 0 );
+					vertex.colour = PL_COLOUR_WHITE;
+					subset.vertices.push_back( vertex );
+				}
+
+				faceIndex[ iFace++ ] = index;
+
+				// Skip anything trailing the index (e.g. a "p/t/n/")
+				while ( p < end && !Obj_IsSpace( *p ) && *p != '\n' ) {
+					++p;
+				}
+			}
+
+			if ( iFace < 3 ) {
+				// Need at least 3 points to form a triangle
+				Warning( "Invalid number of points to form a triangle (%dvs3)\n", iFace );
+				return false;
+			}
+
+			// Convert polygons to triangles
+			index_t i0 = faceIndex[ 0 ];
+			index_t i1 = faceIndex[ 1 ];
+			for ( unsigned int j = 2; j < iFace; ++j ) {
+				index_t index = faceIndex[ j ];
+				subset.indices.push_back( i0 );
+				if ( ccw ) {
+					subset.indices.push_back( i1 );
+					subset.indices.push_back( index );
+				} else {
+					subset.indices.push_back( index );
+					subset.indices.push_back( i1 );
+				}
+
+				i1 = index;
+			}
+		} else if ( Obj_IsToken( command, length, "mtllib" ) ) {
+			// Material library
+			materialFilename = Obj_ReadRemainder( p, end );
+		} else if ( Obj_IsToken( command, length, "usemtl" ) ) {
+			// Material
+			const char *materialName = Obj_ReadToken( p, end, &length );
+			curMaterial = FindMaterial( materialName, length );
+		} else if ( Obj_IsToken( command, length, "o" ) || Obj_IsToken( command, length, "g" ) || Obj_IsToken( command, length, "s" ) ) {
+			// Object, group and smoothing group ignored
+		} else {
+			Warning( "Unrecognised command in Obj \"%s\"!\n", path.c_str() );
+		}
+
+		p = Obj_SkipLine( p, end );
+	}
+
+	if ( positions.empty() ) {
+		return false;
+	}
+
+	// If an associated material file was found, read that in as well.
+	if ( !materialFilename.empty() ) {
+		if ( !LoadMTL( Obj_GetDirectory( path ) + materialFilename ) ) {
+			Warning( "Failed to load material, \"%s\"!\n", materialFilename.c_str() );
+		}
+	}
+
+	return true;
+}
+
+bool ObjReader::LoadMTL( const std::string &path ) {
+	MappedFile *file = Map_OpenFile( path.c_str() );
+	if ( file == nullptr ) {
+		Warning( "Failed to open material, \"%s\"!\n", path.c_str() );
+		return false;
+	}
+
+	std::string directory = Obj_GetDirectory( path );
+
+	auto curMaterial = materials.end();
+
+	const char *p = reinterpret_cast< const char * >( file->data );
+	const char *end = p + file->size;
+	for ( ; p < end; p = Obj_SkipLine( p, end ) ) {
+		size_t length;
+		const char *command = Obj_ReadToken( p, end, &length );
+		if ( length == 0 || command[ 0 ] == '#' ) {
+			continue;
+		}
+
+		if ( Obj_IsToken( command, length, "newmtl" ) ) {
+			// Switching active materials, we only care about those the Obj uses
+			std::string materialName = Obj_ReadRemainder( p, end );
+			curMaterial = materials.end();
+			for ( auto it = materials.begin(); it != materials.end(); ++it ) {
+				if ( it->strName == materialName ) {
+					curMaterial = it;
+					break;
+				}
+			}
+			continue;
+		}
+
+		// The rest of the commands rely on an active material
+		if ( curMaterial == materials.end() ) {
+			continue;
+		}
+
+		float value;
+		if ( Obj_IsToken( command, length, "Ka" ) ) {
+			// Ambient color
+			Obj_ParseVector3( p, end, &curMaterial->vAmbient );
+		} else if ( Obj_IsToken( command, length, "Kd" ) ) {
+			// Diffuse color
+			Obj_ParseVector3( p, end, &curMaterial->vDiffuse );
+		} else if ( Obj_IsToken( command, length, "Ks" ) ) {
+			// Specular color
+			Obj_ParseVector3( p, end, &curMaterial->vSpecular );
+		} else if ( Obj_IsToken( command, length, "Ke" ) ) {
+			// Emissive color
+			PLVector3 &emissive = curMaterial->vEmissive;
+			if ( Obj_ParseVector3( p, end, &emissive ) && ( emissive.x > 0.f || emissive.y > 0.f || emissive.z > 0.f ) ) {
+				curMaterial->bEmissive = true;
+			}
+		} else if ( Obj_IsToken( command, length, "d" ) ) {
+			// Alpha
+			if ( Obj_ParseFloat( p, end, &value ) ) {
+				curMaterial->fAlpha = std::min( 1.f, std::max( 0.f, value ) );
+			}
+		} else if ( Obj_IsToken( command, length, "Tr" ) ) {
+			// Transparency (inverse of alpha)
+			if ( Obj_ParseFloat( p, end, &value ) ) {
+				curMaterial->fAlpha = std::min( 1.f, std::max( 0.f, 1.f - value ) );
+			}
+		} else if ( Obj_IsToken( command, length, "Ns" ) ) {
+			// Shininess
+			if ( Obj_ParseFloat( p, end, &value ) ) {
+				curMaterial->nShininess = static_cast< uint32_t >( value );
+			}
+		} else if ( Obj_IsToken( command, length, "illum" ) ) {
+			// Specular on/off
+			if ( Obj_ParseFloat( p, end, &value ) ) {
+				curMaterial->bSpecular = ( value == 2.0f );
+			}
+		} else if ( command[ 0 ] == 'm' || command[ 0 ] == 'n' ) {
+			// Texture path should be the last element in line
+			std::string texturePath = Obj_ReadRemainder( p, end );
+			size_t pos = texturePath.find_last_of( ' ' );
+			if ( pos != std::string::npos ) {
+				texturePath = texturePath.substr( pos + 1 );
+			}
+
+			if ( Obj_IsToken( command, length, "map_Kd" ) || Obj_IsToken( command, length, "map_Ka" ) ) {
+				// Diffuse texture
+				curMaterial->strTexture = directory + texturePath;
+			} else if ( Obj_IsToken( command, length, "map_Ks" ) ) {
+				// Specular texture
+				curMaterial->strSpecularTexture = texturePath;
+			} else if ( Obj_IsToken( command, length, "map_Kn" ) || Obj_IsToken( command, length, "norm" ) ) {
+				// Normal texture
+				curMaterial->strNormalTexture = texturePath;
+			} else if ( Obj_IsToken( command, length, "map_Ke" ) || Obj_IsToken( command, length, "map_emissive" ) ) {
+				// Emissive texture
+				curMaterial->strEmissiveTexture = texturePath;
+				curMaterial->bEmissive = true;
+			} else if ( Obj_IsToken( command, length, "map_RMA" ) || Obj_IsToken( command, length, "map_ORM" ) ) {
+				// RMA texture
+				curMaterial->strRMATexture = texturePath;
+			}
+		}
+	}
+
+	Map_CloseFile( file );
+
+	return true;
+}
+
+void ObjReader::Clear() {
+	materials.clear();
+	subsets.clear();
+	name.clear();
+	hasNormals = false;
+	hasTexcoords = false;
+}
+
+size_t ObjReader::GetNumTriangles() const {
+	size_t numTriangles = 0;
+	for ( const auto &subset : subsets ) {
+		numTriangles += subset.indices.size() / 3;
+	}
+	return numTriangles;
+}
+
+size_t ObjReader::GetNumVertices() const {
+	size_t numVertices = 0;
+	for ( const auto &subset : subsets ) {
+		numVertices += subset.vertices.size();
+	}
+	return numVertices;
+}
+
+uint32_t ObjReader::FindMaterial( const char *materialName, size_t length ) {
+	for ( size_t i = 0; i < materials.size(); ++i ) {
+		if ( Obj_IsToken( materialName, length, materials[ i ].strName.c_str() ) ) {
+			return static_cast< uint32_t >( i );
+		}
+	}
+
+	Material material;
+	material.strName.assign( materialName, length );
+	materials.push_back( material );
+	return static_cast< uint32_t >( materials.size() - 1 );
+}
@@ -0,0 +1,73 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+/* Streaming Obj/Mtl parser. Works straight off the mapped file rather than
+ * copying it into a stream first, and splits faces into a subset per material
+ * with its own de-duplicated vertex list, so each subset can be copied
+ * straight into a mesh. */
+class ObjReader {
+public:
+	typedef unsigned int index_t;
+
+	struct Material {
+		PLVector3 vAmbient{ 0.2f, 0.2f, 0.2f };
+		PLVector3 vDiffuse{ 0.8f, 0.8f, 0.8f };
+		PLVector3 vSpecular{ 1.0f, 1.0f, 1.0f };
+		PLVector3 vEmissive{ 0.0f, 0.0f, 0.0f };
+		uint32_t nShininess{ 0 };
+		float fAlpha{ 1.0f };
+
+		bool bSpecular{ false };
+		bool bEmissive{ false };
+
+		std::string strName;
+		std::string strTexture;
+		std::string strNormalTexture;
+		std::string strSpecularTexture;
+		std::string strEmissiveTexture;
+		std::string strRMATexture;
+	};
+
+	struct Subset {
+		uint32_t material{ 0 };
+		std::vector< PLVertex > vertices;
+		std::vector< index_t > indices;
+	};
+
+	bool Load( const std::string &path, bool ccw = true );
+	bool LoadMemory( const char *data, size_t size, const std::string &path, bool ccw = true );
+	bool LoadMTL( const std::string &path );
+
+	void Clear();
+
+	size_t GetNumTriangles() const;
+	size_t GetNumVertices() const;
+
+	std::vector< Material > materials;
+	std::vector< Subset > subsets;
+
+	std::string name;
+	bool hasNormals{ false };
+	bool hasTexcoords{ false };
+
+private:
+	class VertexCache;
+
+	uint32_t FindMaterial( const char *materialName, size_t length );
+};
@@ -0,0 +1,143 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "App.h"
+#include "BinaryReader.h"
+#include "OhmLoader.h"
+
+/************************************************************/
+/* Compiled Model Format */
+
+OhmHandle *Ohm_LoadFile( const char *path ) {
+	MappedFile *file = Map_OpenFile( path );
+	if ( file == nullptr ) {
+		return nullptr;
+	}
+
+	BinReader reader;
+	Bin_InitReader( &reader, file->data, file->size );
+
+	OhmHeader header;
+	if ( !Bin_ReadArray( &reader, &header, sizeof( OhmHeader ), 1 ) ||
+	     memcmp( header.identifier, OHM_IDENTIFIER, sizeof( header.identifier ) ) != 0 ) {
+		Warning( "Invalid compiled model, \"%s\"!\n", path );
+		Map_CloseFile( file );
+		return nullptr;
+	}
+
+	// Out of date, not an error, it'll just get rebuilt
+	if ( header.version != OHM_VERSION || header.vertex_size != sizeof( PLVertex ) ) {
+		DebugMsg( "Outdated compiled model, \"%s\" (version %u, vertex size %u)\n", path, header.version, header.vertex_size );
+		Map_CloseFile( file );
+		return nullptr;
+	}
+
+	auto *handle = static_cast< OhmHandle * >( u_alloc( 1, sizeof( OhmHandle ), true ) );
+	handle->file = file;
+	handle->header = header;
+	handle->submeshes = static_cast< OhmSubMesh * >( u_alloc( header.num_submeshes, sizeof( OhmSubMesh ), true ) );
+	handle->atlas_images = static_cast< OhmAtlasImage * >( u_alloc( header.num_atlas_images, sizeof( OhmAtlasImage ), true ) );
+
+	bool status = Bin_ReadArray( &reader, handle->submeshes, sizeof( OhmSubMesh ), header.num_submeshes ) &&
+	              Bin_ReadArray( &reader, handle->atlas_images, sizeof( OhmAtlasImage ), header.num_atlas_images );
+	handle->vertices = Bin_ReadView( &reader, header.vertex_size, header.num_vertices );
+	handle->indices = Bin_ReadView( &reader, sizeof( uint32_t ), header.num_indices );
+	if ( !status || reader.overflow ) {
+		Warning( "Truncated compiled model, \"%s\"!\n", path );
+		Ohm_DestroyHandle( handle );
+		return nullptr;
+	}
+
+	// Make sure none of the submeshes are going to take us out of bounds
+	for ( unsigned int i = 0; i < header.num_submeshes; ++i ) {
+		const OhmSubMesh *submesh = &handle->submeshes[ i ];
+		if ( submesh->first_vertex > header.num_vertices || submesh->num_vertices > header.num_vertices - submesh->first_vertex ||
+		     submesh->first_index > header.num_indices || submesh->num_indices > header.num_indices - submesh->first_index ) {
+			Warning( "Invalid submesh in compiled model, \"%s\" (%u)!\n", path, i );
+			Ohm_DestroyHandle( handle );
+			return nullptr;
+		}
+	}
+
+	for ( unsigned int i = 0; i < header.num_atlas_images; ++i ) {
+		handle->atlas_images[ i ].path[ OHM_MAX_PATH - 1 ] = '\0';
+	}
+
+	return handle;
+}
+
+void Ohm_DestroyHandle( OhmHandle *handle ) {
+	if ( handle == nullptr ) {
+		return;
+	}
+
+	Map_CloseFile( handle->file );
+	u_free( handle->submeshes );
+	u_free( handle->atlas_images );
+	u_free( handle );
+}
+
+/**
+ * Writes out to a temporary file first and then moves it into place,
+ * so we never leave a half written model behind.
+ */
+bool Ohm_WriteFile( const char *path, const OhmHeader *header, OhmSubMesh *submeshes,
+                    const void **vertices, const uint32_t **indices, const OhmAtlasImage *atlasImages ) {
+	char tmpPath[PL_SYSTEM_MAX_PATH];
+	snprintf( tmpPath, sizeof( tmpPath ), "%s.tmp", path );
+
+	FILE *fp = fopen( tmpPath, "wb" );
+	if ( fp == nullptr ) {
+		Warning( "Failed to open \"%s\" for writing!\n", tmpPath );
+		return false;
+	}
+
+	for ( unsigned int i = 0, firstVertex = 0, firstIndex = 0; i < header->num_submeshes; ++i ) {
+		submeshes[ i ].first_vertex = firstVertex;
+		submeshes[ i ].first_index = firstIndex;
+		firstVertex += submeshes[ i ].num_vertices;
+		firstIndex += submeshes[ i ].num_indices;
+	}
+
+	bool status = ( fwrite( header, sizeof( OhmHeader ), 1, fp ) == 1 );
+	status &= ( fwrite( submeshes, sizeof( OhmSubMesh ), header->num_submeshes, fp ) == header->num_submeshes );
+	status &= ( fwrite( atlasImages, sizeof( OhmAtlasImage ), header->num_atlas_images, fp ) == header->num_atlas_images );
+	for ( unsigned int i = 0; i < header->num_submeshes; ++i ) {
+		status &= ( fwrite( vertices[ i ], header->vertex_size, submeshes[ i ].num_vertices, fp ) == submeshes[ i ].num_vertices );
+	}
+	for ( unsigned int i = 0; i < header->num_submeshes; ++i ) {
+		status &= ( fwrite( indices[ i ], sizeof( uint32_t ), submeshes[ i ].num_indices, fp ) == submeshes[ i ].num_indices );
+	}
+
+	u_fclose( fp );
+
+	if ( !status ) {
+		Warning( "Failed to write compiled model, \"%s\"!\n", tmpPath );
+		remove( tmpPath );
+		return false;
+	}
+
+	// rename won't replace an existing file on Windows
+	remove( path );
+	if ( rename( tmpPath, path ) != 0 ) {
+		Warning( "Failed to move compiled model into place, \"%s\"!\n", path );
+		remove( tmpPath );
+		return false;
+	}
+
+	return true;
+}
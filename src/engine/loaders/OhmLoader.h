@@ -0,0 +1,89 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "MappedFile.h"
+
+PL_EXTERN_C
+
+/* Compiled model (.ohm), written out the first time a model is converted so
+ * that later loads can be copied straight into meshes. Vertices are stored as
+ * they are in memory, so the cache is discarded if PLVertex changes size.
+ *
+ * header, submeshes, atlas images, vertices, indices */
+
+#define OHM_IDENTIFIER  "OHWM"
+#define OHM_VERSION     3
+#define OHM_MAX_PATH    128
+
+typedef struct __attribute__((packed)) OhmHeader {
+	char identifier[4];
+	uint32_t version;
+	uint32_t vertex_size;           /* sizeof( PLVertex ) at the time it was written */
+	uint64_t source_hash;           /* hash of the files it was compiled from */
+
+	float origin[3];
+	float mins[3];
+	float maxs[3];
+
+	uint32_t num_submeshes;
+	uint32_t num_vertices;
+	uint32_t num_indices;
+
+	/* images making up the atlas, and what they should produce */
+	uint32_t num_atlas_images;
+	uint32_t atlas_width;
+	uint32_t atlas_height;
+	uint32_t atlas_filtered;
+	uint64_t atlas_key;             /* cached atlas it was baked against, 0 if it wasn't cached */
+} OhmHeader;
+
+#define OHM_SUBMESH_ATLAS   1   /* uses the atlas, otherwise the fallback */
+
+typedef struct __attribute__((packed)) OhmSubMesh {
+	uint32_t first_vertex;
+	uint32_t num_vertices;
+	uint32_t first_index;
+	uint32_t num_indices;
+	uint32_t flags;
+} OhmSubMesh;
+
+typedef struct __attribute__((packed)) OhmAtlasImage {
+	char path[OHM_MAX_PATH];
+} OhmAtlasImage;
+
+typedef struct OhmHandle {
+	MappedFile *file;
+
+	OhmHeader header;
+	OhmSubMesh *submeshes;
+	OhmAtlasImage *atlas_images;
+
+	/* views into the mapped file */
+	const uint8_t *vertices;
+	const uint8_t *indices;
+} OhmHandle;
+
+OhmHandle *Ohm_LoadFile( const char *path );
+void Ohm_DestroyHandle( OhmHandle *handle );
+
+/* vertices and indices are given per submesh, the first_* offsets are filled in on write */
+bool Ohm_WriteFile( const char *path, const OhmHeader *header, OhmSubMesh *submeshes,
+                    const void **vertices, const uint32_t **indices, const OhmAtlasImage *atlasImages );
+
+PL_EXTERN_C_END
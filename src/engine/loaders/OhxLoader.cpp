@@ -0,0 +1,132 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "App.h"
+#include "BinaryReader.h"
+#include "OhxLoader.h"
+
+/************************************************************/
+/* Cooked Texture Format */
+
+OhxHandle *Ohx_LoadFile( const char *path ) {
+	MappedFile *file = Map_OpenFile( path );
+	if ( file == nullptr ) {
+		return nullptr;
+	}
+
+	BinReader reader;
+	Bin_InitReader( &reader, file->data, file->size );
+
+	OhxHeader header;
+	if ( !Bin_ReadArray( &reader, &header, sizeof( OhxHeader ), 1 ) ||
+	     memcmp( header.identifier, OHX_IDENTIFIER, sizeof( header.identifier ) ) != 0 ) {
+		Warning( "Invalid cooked texture, \"%s\"!\n", path );
+		Map_CloseFile( file );
+		return nullptr;
+	}
+
+	// Out of date, not an error, it'll just get cooked again
+	if ( header.version != OHX_VERSION ) {
+		DebugMsg( "Outdated cooked texture, \"%s\" (version %u)\n", path, header.version );
+		Map_CloseFile( file );
+		return nullptr;
+	}
+
+	if ( header.num_levels == 0 || header.num_levels > OHX_MAX_LEVELS || header.format > OHX_FORMAT_BC3 ) {
+		Warning( "Invalid cooked texture, \"%s\"!\n", path );
+		Map_CloseFile( file );
+		return nullptr;
+	}
+
+	auto *handle = static_cast< OhxHandle * >( u_alloc( 1, sizeof( OhxHandle ), true ) );
+	handle->file = file;
+	handle->header = header;
+
+	bool status = Bin_ReadArray( &reader, handle->levels, sizeof( OhxLevel ), header.num_levels );
+	size_t pixelsSize = Bin_GetRemaining( &reader );
+	handle->pixels = Bin_ReadView( &reader, 1, pixelsSize );
+	if ( !status || reader.overflow ) {
+		Warning( "Truncated cooked texture, \"%s\"!\n", path );
+		Ohx_DestroyHandle( handle );
+		return nullptr;
+	}
+
+	// Make sure none of the levels are going to take us out of bounds
+	for ( unsigned int i = 0; i < header.num_levels; ++i ) {
+		const OhxLevel *level = &handle->levels[ i ];
+		if ( level->offset > pixelsSize || level->size > pixelsSize - level->offset ) {
+			Warning( "Invalid level in cooked texture, \"%s\" (%u)!\n", path, i );
+			Ohx_DestroyHandle( handle );
+			return nullptr;
+		}
+	}
+
+	return handle;
+}
+
+void Ohx_DestroyHandle( OhxHandle *handle ) {
+	if ( handle == nullptr ) {
+		return;
+	}
+
+	Map_CloseFile( handle->file );
+	u_free( handle );
+}
+
+/**
+ * Writes out to a temporary file first and then moves it into place,
+ * so we never leave a half written texture behind.
+ */
+bool Ohx_WriteFile( const char *path, const OhxHeader *header, OhxLevel *levels, const uint8_t **pixels ) {
+	char tmpPath[PL_SYSTEM_MAX_PATH];
+	snprintf( tmpPath, sizeof( tmpPath ), "%s.tmp", path );
+
+	FILE *fp = fopen( tmpPath, "wb" );
+	if ( fp == nullptr ) {
+		Warning( "Failed to open \"%s\" for writing!\n", tmpPath );
+		return false;
+	}
+
+	for ( unsigned int i = 0, offset = 0; i < header->num_levels; ++i ) {
+		levels[ i ].offset = offset;
+		offset += levels[ i ].size;
+	}
+
+	bool status = ( fwrite( header, sizeof( OhxHeader ), 1, fp ) == 1 );
+	status &= ( fwrite( levels, sizeof( OhxLevel ), header->num_levels, fp ) == header->num_levels );
+	for ( unsigned int i = 0; i < header->num_levels; ++i ) {
+		status &= ( fwrite( pixels[ i ], 1, levels[ i ].size, fp ) == levels[ i ].size );
+	}
+
+	u_fclose( fp );
+
+	if ( !status ) {
+		Warning( "Failed to write cooked texture, \"%s\"!\n", tmpPath );
+		remove( tmpPath );
+		return false;
+	}
+
+	// rename won't replace an existing file on Windows
+	remove( path );
+	if ( rename( tmpPath, path ) != 0 ) {
+		Warning( "Failed to move cooked texture into place, \"%s\"!\n", path );
+		remove( tmpPath );
+		return false;
+	}
+
+	return true;
+}
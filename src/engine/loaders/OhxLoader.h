@@ -0,0 +1,74 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "MappedFile.h"
+
+PL_EXTERN_C
+
+/* Cooked texture (.ohx), written out the first time a texture is loaded so
+ * that later loads can be uploaded straight from the file. Every mip level
+ * is stored, already converted to the format it'll be uploaded in.
+ *
+ * header, levels, pixel data */
+
+#define OHX_IDENTIFIER  "OHWX"
+#define OHX_VERSION     1
+#define OHX_MAX_LEVELS  16
+
+enum {
+	OHX_FORMAT_RGBA8,
+	OHX_FORMAT_BC1,     /* 4x4 blocks, 8 bytes each, no alpha */
+	OHX_FORMAT_BC3,     /* 4x4 blocks, 16 bytes each */
+};
+
+typedef struct __attribute__((packed)) OhxHeader {
+	char identifier[4];
+	uint32_t version;
+	uint64_t source_hash;           /* hash of the file it was cooked from */
+
+	uint32_t width;
+	uint32_t height;
+	uint32_t format;
+	uint32_t num_levels;
+} OhxHeader;
+
+typedef struct __attribute__((packed)) OhxLevel {
+	uint32_t width;
+	uint32_t height;
+	uint32_t offset;                /* from the start of the pixel data */
+	uint32_t size;
+} OhxLevel;
+
+typedef struct OhxHandle {
+	MappedFile *file;
+
+	OhxHeader header;
+	OhxLevel levels[OHX_MAX_LEVELS];
+
+	/* view into the mapped file */
+	const uint8_t *pixels;
+} OhxHandle;
+
+OhxHandle *Ohx_LoadFile( const char *path );
+void Ohx_DestroyHandle( OhxHandle *handle );
+
+/* the level offsets are filled in on write */
+bool Ohx_WriteFile( const char *path, const OhxHeader *header, OhxLevel *levels, const uint8_t **pixels );
+
+PL_EXTERN_C_END
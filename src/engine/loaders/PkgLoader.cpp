@@ -0,0 +1,184 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <PL/platform_filesystem.h>
+
+#include "App.h"
+#include "Utilities.h"
+#include "PkgLoader.h"
+
+/************************************************************/
+/* Mad/Mtd/Ptg Package Formats */
+
+static bool Pkg_IsPackageExtension( const char *extension, size_t length ) {
+	static const char *extensions[] = { "mad", "mtd", "ptg" };
+	if ( length != 3 ) {
+		return false;
+	}
+
+	for ( unsigned int i = 0; i < plArrayElements( extensions ); ++i ) {
+		if ( pl_strncasecmp( extension, extensions[ i ], 3 ) == 0 ) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool Pkg_SplitPath( const char *path, char *packagePath, size_t length, const char **memberName ) {
+	for ( const char *p = path; *p != '\0'; ++p ) {
+		if ( *p != '.' ) {
+			continue;
+		}
+
+		const char *end = strchr( p, '/' );
+		if ( end == nullptr ) {
+			return false;
+		}
+
+		if ( !Pkg_IsPackageExtension( p + 1, end - ( p + 1 ) ) ) {
+			continue;
+		}
+
+		size_t packageLength = end - path;
+		if ( packageLength >= length ) {
+			return false;
+		}
+
+		strncpy( packagePath, path, packageLength );
+		packagePath[ packageLength ] = '\0';
+		*memberName = end + 1;
+		return ( **memberName != '\0' );
+	}
+
+	return false;
+}
+
+static bool Pkg_ParsePtg( PkgHandle *handle ) {
+	const MappedFile *file = handle->file;
+	if ( file->size < sizeof( uint32_t ) ) {
+		return false;
+	}
+
+	uint32_t numTextures;
+	memcpy( &numTextures, file->data, sizeof( uint32_t ) );
+	if ( numTextures == 0 ) {
+		return false;
+	}
+
+	// All of the textures are expected to be the same size
+	size_t timSize = ( file->size - sizeof( uint32_t ) ) / numTextures;
+	if ( timSize == 0 ) {
+		return false;
+	}
+
+	handle->num_members = numTextures;
+	handle->members = static_cast< PkgMember * >( u_alloc( numTextures, sizeof( PkgMember ), true ) );
+	for ( unsigned int i = 0; i < numTextures; ++i ) {
+		snprintf( handle->members[ i ].name, sizeof( handle->members[ i ].name ), "%u.tim", i );
+		handle->members[ i ].data = file->data + sizeof( uint32_t ) + ( timSize * i );
+		handle->members[ i ].size = timSize;
+	}
+
+	return true;
+}
+
+static bool Pkg_ParseNamed( PkgHandle *handle ) {
+	typedef struct __attribute__((packed)) MadIndex {
+		char name[16];
+		uint32_t offset;
+		uint32_t length;
+	} MadIndex;
+	static_assert( sizeof( MadIndex ) == 24, "invalid struct size" );
+
+	const MappedFile *file = handle->file;
+	if ( file->size < sizeof( MadIndex ) ) {
+		return false;
+	}
+
+	// The table runs up until the data of the first entry
+	MadIndex index;
+	memcpy( &index, file->data, sizeof( MadIndex ) );
+	if ( index.offset == 0 || index.offset % sizeof( MadIndex ) != 0 || index.offset > file->size ) {
+		return false;
+	}
+
+	unsigned int numMembers = index.offset / sizeof( MadIndex );
+	handle->members = static_cast< PkgMember * >( u_alloc( numMembers, sizeof( PkgMember ), true ) );
+	for ( unsigned int i = 0; i < numMembers; ++i ) {
+		memcpy( &index, file->data + ( i * sizeof( MadIndex ) ), sizeof( MadIndex ) );
+		if ( index.offset > file->size || index.length > file->size - index.offset ) {
+			Warning( "Member %u in package is out of bounds, ignoring the rest!\n", i );
+			break;
+		}
+
+		PkgMember *member = &handle->members[ handle->num_members++ ];
+		memcpy( member->name, index.name, sizeof( index.name ) );
+		member->name[ sizeof( index.name ) ] = '\0';
+		member->data = file->data + index.offset;
+		member->size = index.length;
+	}
+
+	return ( handle->num_members > 0 );
+}
+
+PkgHandle *Pkg_LoadFile( const char *path ) {
+	MappedFile *file = Map_OpenFile( path );
+	if ( file == nullptr ) {
+		Warning( "Failed to load package \"%s\"!\n", path );
+		return nullptr;
+	}
+
+	PkgHandle *handle = static_cast< PkgHandle * >( u_alloc( 1, sizeof( PkgHandle ), true ) );
+	handle->file = file;
+
+	const char *extension = plGetFileExtension( path );
+	bool status;
+	if ( pl_strcasecmp( extension, "ptg" ) == 0 ) {
+		status = Pkg_ParsePtg( handle );
+	} else {
+		status = Pkg_ParseNamed( handle );
+	}
+
+	if ( !status ) {
+		Warning( "Failed to parse package \"%s\"!\n", path );
+		Pkg_DestroyHandle( handle );
+		return nullptr;
+	}
+
+	return handle;
+}
+
+const PkgMember *Pkg_GetMember( const PkgHandle *handle, const char *name ) {
+	for ( unsigned int i = 0; i < handle->num_members; ++i ) {
+		if ( pl_strcasecmp( handle->members[ i ].name, name ) == 0 ) {
+			return &handle->members[ i ];
+		}
+	}
+
+	return nullptr;
+}
+
+void Pkg_DestroyHandle( PkgHandle *handle ) {
+	if ( handle == nullptr ) {
+		return;
+	}
+
+	Map_CloseFile( handle->file );
+	u_free( handle->members );
+	u_free( handle );
+}
@@ -0,0 +1,48 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "MappedFile.h"
+
+PL_EXTERN_C
+
+/* MAD/MTD/PTG packages, read in place from a mapped file.
+ * Each member is just a view into the mapping, so it's only
+ * valid for as long as the handle is. */
+
+typedef struct PkgMember {
+	char name[32];
+	const uint8_t *data;
+	size_t size;
+} PkgMember;
+
+typedef struct PkgHandle {
+	MappedFile *file;
+
+	PkgMember *members;
+	unsigned int num_members;
+} PkgHandle;
+
+PkgHandle *Pkg_LoadFile( const char *path );
+const PkgMember *Pkg_GetMember( const PkgHandle *handle, const char *name );
+void Pkg_DestroyHandle( PkgHandle *handle );
+
+/* splits "Chars/WEAPONS.MAD/bazooka.vtx" into the package path and member */
+bool Pkg_SplitPath( const char *path, char *packagePath, size_t length, const char **memberName );
+
+PL_EXTERN_C_END
@@ -20,56 +20,61 @@
 
 #include "App.h"
 #include "Utilities.h"
+#include "MappedFile.h"
+#include "BinaryReader.h"
 #include "VtxLoader.h"
 
 /************************************************************/
 /* Vtx Vertex Format */
 
-VtxHandle *Vtx_LoadFile( const char *path ) {
-	PLFile *vtx_file = plOpenFile( path, false );
-	if ( vtx_file == NULL ) {
-		Warning( "Failed to load Vtx \"%s\", aborting!\n", path );
-		return NULL;
-	}
-
-	/* load in the vertices */
-
+VtxHandle *Vtx_LoadMemory( const uint8_t *data, size_t size, const char *name ) {
 	typedef struct __attribute__((packed)) VtxCoord {
 		int16_t v[3];
 		uint16_t bone_index;
 	} VtxCoord;
-	unsigned int num_vertices = ( unsigned int ) ( plGetFileSize( vtx_file ) / sizeof( VtxCoord ) );
+	static_assert( sizeof( VtxCoord ) == 8, "invalid struct size" );
+
+	BinReader reader;
+	Bin_InitReader( &reader, data, size );
+
+	unsigned int num_vertices = ( unsigned int ) ( Bin_GetRemaining( &reader ) / sizeof( VtxCoord ) );
 	if ( num_vertices >= VTX_MAX_VERTICES ) {
-		plCloseFile( vtx_file );
-		Warning( "Invalid number of vertices in \"%s\" (%d/%d)!\n", path, num_vertices, VTX_MAX_VERTICES );
+		Warning( "Invalid number of vertices in \"%s\" (%d/%d)!\n", name, num_vertices, VTX_MAX_VERTICES );
 		return NULL;
 	}
 
-	VtxCoord vertices[num_vertices];
-	unsigned int rnum_vertices = plReadFile( vtx_file, vertices, sizeof( VtxCoord ), num_vertices );
-	plCloseFile( vtx_file );
-
 	if ( num_vertices == 0 ) {
-		Warning( "No vertices found in Vtx \"%s\"!\n", path );
+		Warning( "No vertices found in Vtx \"%s\"!\n", name );
 		return NULL;
 	}
 
-	if ( rnum_vertices != num_vertices ) {
-		Warning( "Failed to read in all vertices from \"%s\", aborting!\n", path );
-		return NULL;
-	}
+	const uint8_t *coords = Bin_ReadView( &reader, sizeof( VtxCoord ), num_vertices );
 
-	VtxHandle *handle = ( VtxHandle * ) ohw::GetApp()->CAlloc( 1, sizeof( VtxHandle ), true );
-	handle->vertices = ( PLVertex * ) ohw::GetApp()->CAlloc( num_vertices, sizeof( PLVertex ), true );
+	VtxHandle *handle = ( VtxHandle * ) u_alloc( 1, sizeof( VtxHandle ), true );
+	handle->vertices = ( PLVertex * ) u_alloc( num_vertices, sizeof( PLVertex ), true );
 	handle->num_vertices = num_vertices;
 	for ( unsigned int i = 0; i < num_vertices; ++i ) {
-		handle->vertices[ i ].position = PLVector3( vertices[ i ].v[ 0 ], vertices[ i ].v[ 1 ], vertices[ i ].v[ 2 ] );
-		handle->vertices[ i ].bone_index = vertices[ i ].bone_index;
+		VtxCoord vertex;
+		memcpy( &vertex, coords + ( i * sizeof( VtxCoord ) ), sizeof( VtxCoord ) );
+		handle->vertices[ i ].position = PLVector3( vertex.v[ 0 ], vertex.v[ 1 ], vertex.v[ 2 ] );
+		handle->vertices[ i ].bone_index = vertex.bone_index;
 		handle->vertices[ i ].colour = PL_COLOUR_WHITE;
 	}
 	return handle;
 }
 
+VtxHandle *Vtx_LoadFile( const char *path ) {
+	MappedFile *vtx_file = Map_OpenFile( path );
+	if ( vtx_file == NULL ) {
+		Warning( "Failed to load Vtx \"%s\", aborting!\n", path );
+		return NULL;
+	}
+
+	VtxHandle *handle = Vtx_LoadMemory( vtx_file->data, vtx_file->size, path );
+	Map_CloseFile( vtx_file );
+	return handle;
+}
+
 void Vtx_DestroyHandle( VtxHandle *handle ) {
 	if ( handle == NULL ) {
 		return;
@@ -27,6 +27,7 @@ typedef struct VtxHandle {
 } VtxHandle;
 
 VtxHandle *Vtx_LoadFile(const char *path);
+VtxHandle *Vtx_LoadMemory(const uint8_t *data, size_t size, const char *name);
 void Vtx_DestroyHandle(VtxHandle *handle);
 
 PL_EXTERN_C_END
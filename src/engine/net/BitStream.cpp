@@ -0,0 +1,155 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "App.h"
+#include "BitStream.h"
+
+/************************************************************/
+/* Bit Packing */
+
+/* bits are written least significant first, so the stream
+ * reads the same regardless of the host's byte order */
+
+static uint32_t Bit_Quantize( float value, float min, float max, unsigned int numBits ) {
+	uint32_t maxValue = ( numBits >= 32 ) ? UINT32_MAX : ( ( 1U << numBits ) - 1 );
+	if ( value <= min ) {
+		return 0;
+	} else if ( value >= max ) {
+		return maxValue;
+	}
+
+	double normalised = ( double ) ( value - min ) / ( double ) ( max - min );
+	return ( uint32_t ) ( normalised * maxValue + 0.5 );
+}
+
+static float Bit_Dequantize( uint32_t value, float min, float max, unsigned int numBits ) {
+	uint32_t maxValue = ( numBits >= 32 ) ? UINT32_MAX : ( ( 1U << numBits ) - 1 );
+	return ( float ) ( min + ( ( double ) value / maxValue ) * ( max - min ) );
+}
+
+ohw::BitWriter::BitWriter( uint8_t *buffer, size_t size ) : buffer( buffer ), numBits( size * 8 ) {}
+
+void ohw::BitWriter::WriteBits( uint32_t value, unsigned int count ) {
+	u_assert( count <= 32 );
+	if ( overflow || count > numBits - bitPosition ) {
+		overflow = true;
+		return;
+	}
+
+	WriteBitsAt( bitPosition, value, count );
+	bitPosition += count;
+}
+
+/**
+ * Overwrites bits that have already been written, e.g. to fill in a count
+ * once it's known.
+ */
+void ohw::BitWriter::WriteBitsAt( size_t position, uint32_t value, unsigned int count ) {
+	u_assert( position + count <= numBits );
+	while ( count > 0 ) {
+		size_t byte = position / 8;
+		unsigned int offset = position % 8;
+		unsigned int chunk = 8 - offset;
+		if ( chunk > count ) {
+			chunk = count;
+		}
+
+		uint8_t mask = ( uint8_t ) ( ( ( 1U << chunk ) - 1 ) << offset );
+		buffer[ byte ] = ( uint8_t ) ( ( buffer[ byte ] & ~mask ) | ( ( value << offset ) & mask ) );
+
+		value >>= chunk;
+		position += chunk;
+		count -= chunk;
+	}
+}
+
+void ohw::BitWriter::WriteFloat( float value ) {
+	uint32_t bits;
+	memcpy( &bits, &value, sizeof( bits ) );
+	WriteBits( bits, 32 );
+}
+
+void ohw::BitWriter::WriteQuantizedFloat( float value, float min, float max, unsigned int count ) {
+	WriteBits( Bit_Quantize( value, min, max, count ), count );
+}
+
+void ohw::BitWriter::WriteBytes( const void *data, size_t size ) {
+	const uint8_t *bytes = static_cast< const uint8_t * >( data );
+	for ( size_t i = 0; i < size; ++i ) {
+		WriteBits( bytes[ i ], 8 );
+	}
+}
+
+/**
+ * Moves back to an earlier position, discarding anything written after
+ * it, and clears the overflow flag.
+ */
+void ohw::BitWriter::Rewind( size_t position ) {
+	u_assert( position <= bitPosition || overflow );
+	bitPosition = position;
+	overflow = false;
+}
+
+ohw::BitReader::BitReader( const uint8_t *buffer, size_t size ) : buffer( buffer ), numBits( size * 8 ) {}
+
+uint32_t ohw::BitReader::ReadBits( unsigned int count ) {
+	u_assert( count <= 32 );
+	if ( overflow || count > numBits - bitPosition ) {
+		overflow = true;
+		return 0;
+	}
+
+	uint32_t value = 0;
+	unsigned int shift = 0;
+	while ( count > 0 ) {
+		size_t byte = bitPosition / 8;
+		unsigned int offset = bitPosition % 8;
+		unsigned int chunk = 8 - offset;
+		if ( chunk > count ) {
+			chunk = count;
+		}
+
+		uint32_t bits = ( buffer[ byte ] >> offset ) & ( ( 1U << chunk ) - 1 );
+		value |= bits << shift;
+
+		shift += chunk;
+		bitPosition += chunk;
+		count -= chunk;
+	}
+
+	return value;
+}
+
+float ohw::BitReader::ReadFloat() {
+	uint32_t bits = ReadBits( 32 );
+	float value;
+	memcpy( &value, &bits, sizeof( value ) );
+	return value;
+}
+
+float ohw::BitReader::ReadQuantizedFloat( float min, float max, unsigned int count ) {
+	return Bit_Dequantize( ReadBits( count ), min, max, count );
+}
+
+bool ohw::BitReader::ReadBytes( void *data, size_t size ) {
+	uint8_t *bytes = static_cast< uint8_t * >( data );
+	for ( size_t i = 0; i < size; ++i ) {
+		bytes[ i ] = ( uint8_t ) ReadBits( 8 );
+	}
+
+	return !overflow;
+}
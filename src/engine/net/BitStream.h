@@ -0,0 +1,72 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ohw {
+	/**
+	 * Packs values into a fixed buffer, bit by bit. Never allocates; if the
+	 * buffer fills up the writer is flagged as overflowed and further writes
+	 * are dropped, so callers can rewind and try again elsewhere.
+	 */
+	class BitWriter {
+	public:
+		BitWriter( uint8_t *buffer, size_t size );
+
+		void WriteBits( uint32_t value, unsigned int numBits );
+		void WriteBitsAt( size_t bitPosition, uint32_t value, unsigned int numBits );
+		void WriteBool( bool value ) { WriteBits( value ? 1 : 0, 1 ); }
+		void WriteFloat( float value );
+		void WriteQuantizedFloat( float value, float min, float max, unsigned int numBits );
+		void WriteBytes( const void *data, size_t size );
+
+		void Rewind( size_t bitPosition );
+
+		inline size_t GetBitPosition() const { return bitPosition; }
+		inline size_t GetBytesWritten() const { return ( bitPosition + 7 ) / 8; }
+		inline bool HasOverflowed() const { return overflow; }
+
+	private:
+		uint8_t *buffer;
+		size_t numBits;
+		size_t bitPosition{ 0 };
+		bool overflow{ false };
+	};
+
+	class BitReader {
+	public:
+		BitReader( const uint8_t *buffer, size_t size );
+
+		uint32_t ReadBits( unsigned int numBits );
+		bool ReadBool() { return ReadBits( 1 ) != 0; }
+		float ReadFloat();
+		float ReadQuantizedFloat( float min, float max, unsigned int numBits );
+		bool ReadBytes( void *data, size_t size );
+
+		inline size_t GetBitPosition() const { return bitPosition; }
+		inline bool HasOverflowed() const { return overflow; }
+
+	private:
+		const uint8_t *buffer;
+		size_t numBits;
+		size_t bitPosition{ 0 };
+		bool overflow{ false };
+	};
+}
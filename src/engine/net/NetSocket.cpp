@@ -0,0 +1,194 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "App.h"
+#include "NetSocket.h"
+
+#if defined( _WIN32 )
+#   include <winsock2.h>
+#   include <ws2tcpip.h>
+typedef int socklen_t;
+#   define NET_INVALID_SOCKET INVALID_SOCKET
+#   define Net_CloseSocket closesocket
+#   define Net_IsResetError() ( WSAGetLastError() == WSAECONNRESET )
+#else
+#   include <sys/socket.h>
+#   include <netinet/in.h>
+#   include <arpa/inet.h>
+#   include <netdb.h>
+#   include <fcntl.h>
+#   include <unistd.h>
+#   include <errno.h>
+#   define NET_INVALID_SOCKET -1
+#   define Net_CloseSocket close
+#   define Net_IsResetError() ( errno == ECONNREFUSED )
+#endif
+
+/************************************************************/
+/* UDP Socket */
+
+static bool Net_Initialize() {
+#if defined( _WIN32 )
+	static bool isInitialized = false;
+	if ( !isInitialized ) {
+		WSADATA data;
+		if ( WSAStartup( MAKEWORD( 2, 2 ), &data ) != 0 ) {
+			Warning( "Failed to initialize Winsock!\n" );
+			return false;
+		}
+		isInitialized = true;
+	}
+#endif
+	return true;
+}
+
+/**
+ * Accepts either "host" or "host:port", falling back to the default port.
+ */
+bool ohw::NetAddress::Parse( const char *string, NetAddress *out ) {
+	if ( !Net_Initialize() ) {
+		return false;
+	}
+
+	char host[ 256 ];
+	snprintf( host, sizeof( host ), "%s", string );
+
+	uint16_t port = NET_DEFAULT_PORT;
+	char *separator = strrchr( host, ':' );
+	if ( separator != nullptr ) {
+		*separator = '\0';
+		port = ( uint16_t ) strtoul( separator + 1, nullptr, 10 );
+	}
+
+	struct addrinfo hints;
+	memset( &hints, 0, sizeof( hints ) );
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_DGRAM;
+
+	struct addrinfo *result;
+	if ( getaddrinfo( host, nullptr, &hints, &result ) != 0 || result == nullptr ) {
+		Warning( "Failed to resolve \"%s\"!\n", host );
+		return false;
+	}
+
+	out->ip = ntohl( ( ( struct sockaddr_in * ) result->ai_addr )->sin_addr.s_addr );
+	out->port = port;
+	freeaddrinfo( result );
+
+	return true;
+}
+
+void ohw::NetAddress::ToString( char *out, size_t size ) const {
+	snprintf( out, size, "%u.%u.%u.%u:%u",
+	          ( ip >> 24 ) & 0xff, ( ip >> 16 ) & 0xff, ( ip >> 8 ) & 0xff, ip & 0xff, port );
+}
+
+ohw::NetSocket::~NetSocket() {
+	Close();
+}
+
+bool ohw::NetSocket::Open( uint16_t port ) {
+	Close();
+
+	if ( !Net_Initialize() ) {
+		return false;
+	}
+
+	auto sock = socket( AF_INET, SOCK_DGRAM, IPPROTO_UDP );
+	if ( sock == NET_INVALID_SOCKET ) {
+		Warning( "Failed to create socket!\n" );
+		return false;
+	}
+
+	struct sockaddr_in address;
+	memset( &address, 0, sizeof( address ) );
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl( INADDR_ANY );
+	address.sin_port = htons( port );
+	if ( bind( sock, ( struct sockaddr * ) &address, sizeof( address ) ) != 0 ) {
+		Warning( "Failed to bind socket to port %u!\n", port );
+		Net_CloseSocket( sock );
+		return false;
+	}
+
+#if defined( _WIN32 )
+	u_long nonBlocking = 1;
+	int status = ioctlsocket( sock, FIONBIO, &nonBlocking );
+#else
+	int status = fcntl( sock, F_SETFL, fcntl( sock, F_GETFL, 0 ) | O_NONBLOCK );
+#endif
+	if ( status != 0 ) {
+		Warning( "Failed to set socket as non-blocking!\n" );
+		Net_CloseSocket( sock );
+		return false;
+	}
+
+	handle = ( intptr_t ) sock;
+
+	return true;
+}
+
+void ohw::NetSocket::Close() {
+	if ( handle == INVALID_HANDLE ) {
+		return;
+	}
+
+	Net_CloseSocket( handle );
+	handle = INVALID_HANDLE;
+}
+
+uint16_t ohw::NetSocket::GetPort() const {
+	struct sockaddr_in address;
+	socklen_t length = sizeof( address );
+	if ( handle == INVALID_HANDLE || getsockname( handle, ( struct sockaddr * ) &address, &length ) != 0 ) {
+		return 0;
+	}
+
+	return ntohs( address.sin_port );
+}
+
+bool ohw::NetSocket::Send( const NetAddress &address, const void *data, size_t size ) {
+	struct sockaddr_in destination;
+	memset( &destination, 0, sizeof( destination ) );
+	destination.sin_family = AF_INET;
+	destination.sin_addr.s_addr = htonl( address.ip );
+	destination.sin_port = htons( address.port );
+
+	auto sent = sendto( handle, ( const char * ) data, size, 0, ( struct sockaddr * ) &destination, sizeof( destination ) );
+	return ( sent == ( decltype( sent ) ) size );
+}
+
+size_t ohw::NetSocket::Receive( NetAddress *address, void *buffer, size_t size ) {
+	struct sockaddr_in source;
+	socklen_t length = sizeof( source );
+
+	// keep going past any errors from earlier sends (e.g. the other end isn't up yet)
+	while ( true ) {
+		auto received = recvfrom( handle, ( char * ) buffer, size, 0, ( struct sockaddr * ) &source, &length );
+		if ( received < 0 ) {
+			if ( Net_IsResetError() ) {
+				continue;
+			}
+
+			return 0;
+		}
+
+		address->ip = ntohl( source.sin_addr.s_addr );
+		address->port = ntohs( source.sin_port );
+		return ( size_t ) received;
+	}
+}
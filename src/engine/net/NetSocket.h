@@ -0,0 +1,65 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#define NET_DEFAULT_PORT    9525
+
+namespace ohw {
+	/**
+	 * IPv4 address and port, both in host byte order.
+	 */
+	struct NetAddress {
+		uint32_t ip{ 0 };
+		uint16_t port{ 0 };
+
+		bool operator==( const NetAddress &other ) const { return ip == other.ip && port == other.port; }
+		bool operator!=( const NetAddress &other ) const { return !( *this == other ); }
+
+		static bool Parse( const char *string, NetAddress *out );
+		void ToString( char *out, size_t size ) const;
+	};
+
+	/**
+	 * Non-blocking UDP socket.
+	 */
+	class NetSocket {
+	public:
+		NetSocket() = default;
+		~NetSocket();
+
+		NetSocket( const NetSocket & ) = delete;
+		NetSocket &operator=( const NetSocket & ) = delete;
+
+		bool Open( uint16_t port );
+		void Close();
+
+		PL_INLINE bool IsOpen() const { return handle != INVALID_HANDLE; }
+		uint16_t GetPort() const;
+
+		bool Send( const NetAddress &address, const void *data, size_t size );
+		/* returns the number of bytes received, or 0 if there's nothing waiting */
+		size_t Receive( NetAddress *address, void *buffer, size_t size );
+
+	private:
+		static constexpr intptr_t INVALID_HANDLE = -1;
+		intptr_t handle{ INVALID_HANDLE };
+	};
+}
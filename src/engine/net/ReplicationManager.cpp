@@ -0,0 +1,592 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "App.h"
+#include "ReplicationManager.h"
+#include "Property.h"
+
+#include "game/Actor.h"
+
+/************************************************************/
+/* Property Replication */
+
+/* packet layout
+ *  protocol        16
+ *  sequence        16
+ *  has ack         1   set once we've heard anything from the other end
+ *  ack             16  most recent sequence we've had from the other end
+ *  ack bits        32  the 32 sequences before that
+ *  num objects     9
+ *  objects         id (REPLICATION_OBJECT_BITS) followed by PropertyOwner::SendUpdate
+ */
+
+#define PACKET_OBJECT_COUNT_BITS    9
+static_assert( REPLICATION_PACKET_OBJECTS < ( 1U << PACKET_OBJECT_COUNT_BITS ), "object count won't fit" );
+
+/* server sends everything that isn't local or pushed by clients,
+ * and clients only send what they're allowed to push */
+#define SERVER_REQUIRED_FLAGS   0
+#define SERVER_EXCLUDED_FLAGS   ( PROP_LOCAL | PROP_PUSH )
+#define CLIENT_REQUIRED_FLAGS   PROP_PUSH
+#define CLIENT_EXCLUDED_FLAGS   PROP_LOCAL
+
+/**
+ * Returns true if sequence a is more recent than b, allowing for wrap-around.
+ */
+static bool Replication_IsNewer( uint16_t a, uint16_t b ) {
+	return ( ( a > b ) && ( a - b <= 32768 ) ) || ( ( a < b ) && ( b - a > 32768 ) );
+}
+
+ohw::ReplicationManager::ReplicationManager() {
+	static bool isRegistered = false;
+	if ( !isRegistered ) {
+		plRegisterConsoleCommand( "NetHost", HostCommand, "Hosts a game on the given port." );
+		plRegisterConsoleCommand( "NetConnect", ConnectCommand, "Connects to the given host[:port]." );
+		plRegisterConsoleCommand( "NetDisconnect", DisconnectCommand, "Disconnects from any peers." );
+		plRegisterConsoleCommand( "NetStatus", StatusCommand, "Prints out replication statistics." );
+		plRegisterConsoleCommand( "BenchmarkReplication", BenchmarkReplicationCommand,
+		                          "Replicates the given number of actors over loopback. [actors] [ticks]" );
+		isRegistered = true;
+	}
+
+	objects = static_cast< PropertyOwner ** >( u_alloc( REPLICATION_MAX_OBJECTS, sizeof( PropertyOwner * ), true ) );
+}
+
+ohw::ReplicationManager::~ReplicationManager() {
+	Disconnect();
+
+	u_free( objects );
+}
+
+bool ohw::ReplicationManager::Host( uint16_t port ) {
+	Disconnect();
+
+	if ( !socket.Open( port ) ) {
+		return false;
+	}
+
+	isServer = true;
+
+	Print( "Hosting on port %u\n", socket.GetPort() );
+
+	return true;
+}
+
+bool ohw::ReplicationManager::Connect( const NetAddress &address, uint16_t localPort ) {
+	Disconnect();
+
+	if ( !socket.Open( localPort ) ) {
+		return false;
+	}
+
+	isServer = false;
+
+	// We don't wait on any handshake, the server picks us up from our first packet
+	AddPeer( address );
+
+	char addressString[ 32 ];
+	address.ToString( addressString, sizeof( addressString ) );
+	Print( "Connecting to %s\n", addressString );
+
+	return true;
+}
+
+void ohw::ReplicationManager::Disconnect() {
+	for ( auto &peer : peers ) {
+		if ( peer.isConnected ) {
+			RemovePeer( &peer );
+		}
+	}
+
+	socket.Close();
+}
+
+uint16_t ohw::ReplicationManager::RegisterObject( PropertyOwner *owner ) {
+	// Always take the lowest free id, so both ends hand out the same ones
+	for ( unsigned int i = 0; i < REPLICATION_MAX_OBJECTS; ++i ) {
+		if ( objects[ i ] != nullptr ) {
+			continue;
+		}
+
+		objects[ i ] = owner;
+		if ( i >= numObjects ) {
+			numObjects = i + 1;
+		}
+
+		for ( auto &peer : peers ) {
+			if ( peer.isConnected ) {
+				peer.ackedRevisions[ i ] = 0;
+			}
+		}
+
+		return ( uint16_t ) i;
+	}
+
+	Warning( "Ran out of replicated object slots!\n" );
+	return REPLICATION_INVALID_ID;
+}
+
+void ohw::ReplicationManager::UnregisterObject( uint16_t id ) {
+	if ( id >= numObjects ) {
+		return;
+	}
+
+	objects[ id ] = nullptr;
+	while ( numObjects > 0 && objects[ numObjects - 1 ] == nullptr ) {
+		numObjects--;
+	}
+}
+
+ohw::ReplicationManager::Peer *ohw::ReplicationManager::AddPeer( const NetAddress &address ) {
+	for ( auto &peer : peers ) {
+		if ( peer.isConnected ) {
+			continue;
+		}
+
+		peer = Peer();
+		peer.isConnected = true;
+		peer.address = address;
+		peer.lastReceiveTime = SDL_GetTicks();
+		peer.ackedRevisions = static_cast< uint64_t * >( u_alloc( REPLICATION_MAX_OBJECTS, sizeof( uint64_t ), true ) );
+		peer.history = new SentPacket[ REPLICATION_PACKET_HISTORY ];
+		numPeers++;
+
+		return &peer;
+	}
+
+	return nullptr;
+}
+
+void ohw::ReplicationManager::RemovePeer( Peer *peer ) {
+	u_free( peer->ackedRevisions );
+	delete[] peer->history;
+
+	*peer = Peer();
+	numPeers--;
+}
+
+ohw::ReplicationManager::Peer *ohw::ReplicationManager::FindPeer( const NetAddress &address ) {
+	for ( auto &peer : peers ) {
+		if ( peer.isConnected && peer.address == address ) {
+			return &peer;
+		}
+	}
+
+	return nullptr;
+}
+
+void ohw::ReplicationManager::Tick() {
+	if ( !socket.IsOpen() ) {
+		return;
+	}
+
+	ReceivePackets();
+
+	unsigned int now = SDL_GetTicks();
+	for ( auto &peer : peers ) {
+		if ( !peer.isConnected ) {
+			continue;
+		}
+
+		if ( now - peer.lastReceiveTime > REPLICATION_TIMEOUT ) {
+			char addressString[ 32 ];
+			peer.address.ToString( addressString, sizeof( addressString ) );
+			Warning( "Lost connection to %s!\n", addressString );
+			RemovePeer( &peer );
+			continue;
+		}
+
+		SendPackets( &peer );
+	}
+
+	if ( !isServer && numPeers == 0 ) {
+		Disconnect();
+	}
+}
+
+void ohw::ReplicationManager::ReceivePackets() {
+	NetAddress address;
+	size_t size;
+	while ( ( size = socket.Receive( &address, packetBuffer, sizeof( packetBuffer ) ) ) > 0 ) {
+		Peer *peer = FindPeer( address );
+		if ( peer == nullptr ) {
+			// Clients only ever talk to the server
+			if ( !isServer ) {
+				continue;
+			}
+
+			// Make sure it's one of ours before we give it a slot
+			BitReader reader( packetBuffer, size );
+			if ( reader.ReadBits( 16 ) != REPLICATION_PROTOCOL ) {
+				continue;
+			}
+
+			peer = AddPeer( address );
+			if ( peer == nullptr ) {
+				continue;
+			}
+
+			char addressString[ 32 ];
+			address.ToString( addressString, sizeof( addressString ) );
+			Print( "%s connected\n", addressString );
+		}
+
+		stats.packetsReceived++;
+		stats.bytesReceived += size;
+
+		ReadPacket( peer, packetBuffer, size );
+	}
+}
+
+void ohw::ReplicationManager::ReadPacket( Peer *peer, const uint8_t *data, size_t size ) {
+	BitReader reader( data, size );
+	if ( reader.ReadBits( 16 ) != REPLICATION_PROTOCOL ) {
+		stats.packetsDropped++;
+		return;
+	}
+
+	uint16_t sequence = reader.ReadBits( 16 );
+	bool hasAck = reader.ReadBool();
+	uint16_t ack = reader.ReadBits( 16 );
+	uint32_t ackBits = reader.ReadBits( 32 );
+	unsigned int numPacketObjects = reader.ReadBits( PACKET_OBJECT_COUNT_BITS );
+	if ( reader.HasOverflowed() ) {
+		stats.packetsDropped++;
+		return;
+	}
+
+	peer->lastReceiveTime = SDL_GetTicks();
+
+	// Acks are fine to take from anything, however old
+	if ( hasAck ) {
+		AcknowledgePacket( peer, ack );
+		for ( unsigned int i = 0; i < 32; ++i ) {
+			if ( ackBits & ( 1U << i ) ) {
+				AcknowledgePacket( peer, ack - 1 - i );
+			}
+		}
+	}
+
+	// Keep track of what we've seen, so we can ack it in turn
+	bool isStale = false;
+	if ( !peer->hasReceived ) {
+		peer->remoteSequence = sequence;
+		peer->hasReceived = true;
+	} else if ( Replication_IsNewer( sequence, peer->remoteSequence ) ) {
+		unsigned int shift = ( uint16_t ) ( sequence - peer->remoteSequence );
+		peer->remoteAckBits = ( shift < 32 ) ? ( peer->remoteAckBits << shift ) : 0;
+		if ( shift <= 32 ) {
+			peer->remoteAckBits |= 1U << ( shift - 1 );
+		}
+		peer->remoteSequence = sequence;
+	} else {
+		unsigned int age = ( uint16_t ) ( peer->remoteSequence - sequence );
+		if ( age > 0 && age <= 32 ) {
+			peer->remoteAckBits |= 1U << ( age - 1 );
+		}
+		isStale = true;
+	}
+
+	// Anything older than what we've already applied would undo newer changes,
+	// and everything in it will be sent again anyway as it's not been acked
+	if ( isStale ) {
+		stats.packetsDropped++;
+		return;
+	}
+
+	unsigned int requiredFlags = isServer ? CLIENT_REQUIRED_FLAGS : SERVER_REQUIRED_FLAGS;
+	unsigned int excludedFlags = isServer ? CLIENT_EXCLUDED_FLAGS : SERVER_EXCLUDED_FLAGS;
+	for ( unsigned int i = 0; i < numPacketObjects; ++i ) {
+		unsigned int id = reader.ReadBits( REPLICATION_OBJECT_BITS );
+		if ( reader.HasOverflowed() || id >= numObjects || objects[ id ] == nullptr ) {
+			// Can't skip past it without knowing what it is
+			DebugMsg( "Update for unknown object (%u), dropping the rest of the packet\n", id );
+			stats.packetsDropped++;
+			return;
+		}
+
+		if ( !objects[ id ]->ReceiveUpdate( reader, requiredFlags, excludedFlags ) ) {
+			DebugMsg( "Invalid update for object (%u), dropping the rest of the packet\n", id );
+			stats.packetsDropped++;
+			return;
+		}
+	}
+}
+
+void ohw::ReplicationManager::AcknowledgePacket( Peer *peer, uint16_t sequence ) {
+	SentPacket *packet = &peer->history[ sequence % REPLICATION_PACKET_HISTORY ];
+	if ( !packet->isPending || packet->sequence != sequence ) {
+		return;
+	}
+
+	for ( unsigned int i = 0; i < packet->numObjects; ++i ) {
+		uint64_t *acked = &peer->ackedRevisions[ packet->objects[ i ] ];
+		if ( packet->revisions[ i ] > *acked ) {
+			*acked = packet->revisions[ i ];
+		}
+	}
+
+	float roundTripTime = ( float ) ( SDL_GetTicks() - packet->sendTime );
+	stats.roundTripTime = ( stats.roundTripTime == 0.0f ) ? roundTripTime : ( stats.roundTripTime * 0.9f + roundTripTime * 0.1f );
+
+	packet->isPending = false;
+}
+
+/**
+ * Sends the peer everything that's changed since the revisions it's acked,
+ * starting with wherever we had to stop last time if it didn't all fit.
+ */
+void ohw::ReplicationManager::SendPackets( Peer *peer ) {
+	unsigned int requiredFlags = isServer ? SERVER_REQUIRED_FLAGS : CLIENT_REQUIRED_FLAGS;
+	unsigned int excludedFlags = isServer ? SERVER_EXCLUDED_FLAGS : CLIENT_EXCLUDED_FLAGS;
+
+	unsigned int firstObject = ( peer->nextObject < numObjects ) ? peer->nextObject : 0;
+	unsigned int numVisited = 0;
+	for ( unsigned int i = 0; i < REPLICATION_MAX_PACKETS; ++i ) {
+		uint16_t sequence = peer->localSequence++;
+
+		// Always goes out, even if empty, so the other end gets our acks
+		BitWriter writer( packetBuffer, sizeof( packetBuffer ) );
+		writer.WriteBits( REPLICATION_PROTOCOL, 16 );
+		writer.WriteBits( sequence, 16 );
+		writer.WriteBool( peer->hasReceived );
+		writer.WriteBits( peer->remoteSequence, 16 );
+		writer.WriteBits( peer->remoteAckBits, 32 );
+		size_t countPosition = writer.GetBitPosition();
+		writer.WriteBits( 0, PACKET_OBJECT_COUNT_BITS );
+
+		SentPacket *packet = &peer->history[ sequence % REPLICATION_PACKET_HISTORY ];
+		if ( packet->isPending ) {
+			stats.packetsLost++;
+		}
+		packet->isPending = true;
+		packet->sequence = sequence;
+		packet->sendTime = SDL_GetTicks();
+		packet->numObjects = 0;
+
+		bool isFull = false;
+		for ( ; numVisited < numObjects; ++numVisited ) {
+			unsigned int id = ( firstObject + numVisited ) % numObjects;
+			PropertyOwner *owner = objects[ id ];
+			if ( owner == nullptr ) {
+				continue;
+			}
+
+			uint64_t revision = owner->GetRevision();
+			uint64_t *acked = &peer->ackedRevisions[ id ];
+			if ( revision <= *acked ) {
+				continue;
+			}
+
+			if ( packet->numObjects == REPLICATION_PACKET_OBJECTS ) {
+				isFull = true;
+				break;
+			}
+
+			size_t objectPosition = writer.GetBitPosition();
+			writer.WriteBits( id, REPLICATION_OBJECT_BITS );
+			unsigned int numProperties = owner->SendUpdate( writer, *acked, requiredFlags, excludedFlags );
+			if ( writer.HasOverflowed() ) {
+				writer.Rewind( objectPosition );
+				if ( packet->numObjects == 0 ) {
+					Warning( "Object (%u) is too large to replicate, skipping!\n", id );
+					*acked = revision;
+					continue;
+				}
+
+				isFull = true;
+				break;
+			}
+
+			// Nothing that this peer is interested in, so consider it up to date
+			if ( numProperties == 0 ) {
+				writer.Rewind( objectPosition );
+				*acked = revision;
+				continue;
+			}
+
+			packet->objects[ packet->numObjects ] = id;
+			packet->revisions[ packet->numObjects ] = revision;
+			packet->numObjects++;
+
+			stats.objectsSent++;
+			stats.propertiesSent += numProperties;
+		}
+
+		writer.WriteBitsAt( countPosition, packet->numObjects, PACKET_OBJECT_COUNT_BITS );
+
+		size_t size = writer.GetBytesWritten();
+		if ( socket.Send( peer->address, packetBuffer, size ) ) {
+			stats.packetsSent++;
+			stats.bytesSent += size;
+		}
+
+		if ( !isFull ) {
+			return;
+		}
+	}
+
+	// Didn't get through everything, so pick up from here next time
+	peer->nextObject = ( firstObject + numVisited ) % numObjects;
+}
+
+void ohw::ReplicationManager::PrintStatus() const {
+	if ( !socket.IsOpen() ) {
+		Print( "Not connected\n" );
+		return;
+	}
+
+	Print( "%s on port %u, %u peers, %u objects\n", isServer ? "Hosting" : "Client", socket.GetPort(), numPeers, numObjects );
+	for ( const auto &peer : peers ) {
+		if ( !peer.isConnected ) {
+			continue;
+		}
+
+		char addressString[ 32 ];
+		peer.address.ToString( addressString, sizeof( addressString ) );
+		Print( " %s (last heard from %ums ago)\n", addressString, SDL_GetTicks() - peer.lastReceiveTime );
+	}
+
+	Print( " sent %llu packets (%llu bytes, %llu objects, %llu properties)\n",
+	       ( unsigned long long ) stats.packetsSent, ( unsigned long long ) stats.bytesSent,
+	       ( unsigned long long ) stats.objectsSent, ( unsigned long long ) stats.propertiesSent );
+	Print( " received %llu packets (%llu bytes), %llu lost, %llu dropped\n",
+	       ( unsigned long long ) stats.packetsReceived, ( unsigned long long ) stats.bytesReceived,
+	       ( unsigned long long ) stats.packetsLost, ( unsigned long long ) stats.packetsDropped );
+	Print( " round trip %.1fms\n", stats.roundTripTime );
+}
+
+/************************************************************/
+/* Console Commands */
+
+void ohw::ReplicationManager::HostCommand( unsigned int argc, char **argv ) {
+	uint16_t port = ( argc > 1 ) ? ( uint16_t ) strtoul( argv[ 1 ], nullptr, 10 ) : NET_DEFAULT_PORT;
+	GetInstance()->Host( port );
+}
+
+void ohw::ReplicationManager::ConnectCommand( unsigned int argc, char **argv ) {
+	if ( argc < 2 ) {
+		Print( "Usage: NetConnect <host[:port]>\n" );
+		return;
+	}
+
+	NetAddress address;
+	if ( !NetAddress::Parse( argv[ 1 ], &address ) ) {
+		return;
+	}
+
+	GetInstance()->Connect( address );
+}
+
+void ohw::ReplicationManager::DisconnectCommand( unsigned int argc, char **argv ) {
+	GetInstance()->Disconnect();
+}
+
+void ohw::ReplicationManager::StatusCommand( unsigned int argc, char **argv ) {
+	GetInstance()->PrintStatus();
+}
+
+/**
+ * Replicates a set of constantly moving actors between a server and a
+ * client in the same process, over loopback, and reports how long each
+ * tick took and how much bandwidth it would need at 30Hz.
+ */
+void ohw::ReplicationManager::BenchmarkReplicationCommand( unsigned int argc, char **argv ) {
+	static const unsigned int tickRate = 30;
+
+	unsigned int numActors = ( argc > 1 ) ? strtoul( argv[ 1 ], nullptr, 10 ) : 500;
+	unsigned int numTicks = ( argc > 2 ) ? strtoul( argv[ 2 ], nullptr, 10 ) : tickRate * 10;
+	if ( numActors == 0 || numActors > REPLICATION_MAX_OBJECTS ) {
+		Warning( "Number of actors must be between 1 and %u!\n", REPLICATION_MAX_OBJECTS );
+		return;
+	}
+	if ( numTicks == 0 ) {
+		numTicks = 1;
+	}
+
+	ReplicationManager server, client;
+	if ( !server.Host( 0 ) ) {
+		return;
+	}
+
+	NetAddress address;
+	address.ip = 0x7f000001;
+	address.port = server.GetPort();
+	if ( !client.Connect( address ) ) {
+		return;
+	}
+
+	// Registered in the same order on both ends, so the ids line up
+	std::vector< Actor * > serverActors( numActors ), clientActors( numActors );
+	for ( unsigned int i = 0; i < numActors; ++i ) {
+		serverActors[ i ] = new Actor();
+		server.RegisterObject( serverActors[ i ] );
+		clientActors[ i ] = new Actor();
+		client.RegisterObject( clientActors[ i ] );
+	}
+
+	double serverTime = 0.0, clientTime = 0.0;
+	for ( unsigned int tick = 0; tick < numTicks; ++tick ) {
+		float time = ( float ) tick / tickRate;
+		for ( unsigned int i = 0; i < numActors; ++i ) {
+			float angle = time + ( float ) i;
+			serverActors[ i ]->SetPosition( PLVector3( 16384.0f + cosf( angle ) * ( 1000.0f + i ), 512.0f, 16384.0f + sinf( angle ) * ( 1000.0f + i ) ) );
+			serverActors[ i ]->SetAngles( PLVector3( 0.0f, fmodf( angle * 57.29578f, 360.0f ), 0.0f ) );
+		}
+
+		Timer serverTimer;
+		server.Tick();
+		serverTimer.End();
+		serverTime += serverTimer.GetTimeTaken();
+
+		Timer clientTimer;
+		client.Tick();
+		clientTimer.End();
+		clientTime += clientTimer.GetTimeTaken();
+	}
+
+	// Give the last of it a chance to arrive, then see how far off the client is
+	SDL_Delay( 10 );
+	client.Tick();
+
+	float maxError = 0.0f;
+	for ( unsigned int i = 0; i < numActors; ++i ) {
+		PLVector3 difference = serverActors[ i ]->GetPosition() - clientActors[ i ]->GetPosition();
+		float error = std::max( std::fabs( difference.x ), std::max( std::fabs( difference.y ), std::fabs( difference.z ) ) );
+		maxError = std::max( maxError, error );
+	}
+
+	const Stats &stats = server.GetStats();
+	double bytesPerTick = ( double ) stats.bytesSent / numTicks;
+	Print( "Replication benchmark, %u actors over %u ticks\n", numActors, numTicks );
+	Print( " server: %.3fms per tick, %.1f packets per tick, %.0f bytes per tick (%.1fKB/s at %uHz)\n",
+	       ( serverTime * 1000.0 ) / numTicks, ( double ) stats.packetsSent / numTicks, bytesPerTick,
+	       ( bytesPerTick * tickRate ) / 1024.0, tickRate );
+	Print( " client: %.3fms per tick, %llu bytes acked back\n",
+	       ( clientTime * 1000.0 ) / numTicks, ( unsigned long long ) client.GetStats().bytesSent );
+	Print( " %.2f properties per actor per tick, %llu packets lost, max position error %.3f\n",
+	       ( double ) stats.propertiesSent / ( ( double ) numActors * numTicks ),
+	       ( unsigned long long ) stats.packetsLost, maxError );
+
+	server.Disconnect();
+	client.Disconnect();
+
+	for ( unsigned int i = 0; i < numActors; ++i ) {
+		delete serverActors[ i ];
+		delete clientActors[ i ];
+	}
+}
@@ -0,0 +1,146 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "NetSocket.h"
+#include "BitStream.h"
+
+#define REPLICATION_PROTOCOL            0x4f48
+#define REPLICATION_MAX_PEERS           8
+#define REPLICATION_OBJECT_BITS         12
+#define REPLICATION_MAX_OBJECTS         ( 1U << REPLICATION_OBJECT_BITS )
+#define REPLICATION_INVALID_ID          UINT16_MAX
+#define REPLICATION_PACKET_SIZE         1200    // stay under the typical MTU
+#define REPLICATION_MAX_PACKETS         8       // per peer, per tick
+#define REPLICATION_PACKET_OBJECTS      256     // most objects a single packet can carry
+#define REPLICATION_PACKET_HISTORY      64      // sent packets remembered while waiting on an ack, power of two
+#define REPLICATION_TIMEOUT             5000    // ms
+
+class PropertyOwner;
+
+namespace ohw {
+	/**
+	 * Replicates properties between a server and its clients over UDP.
+	 *
+	 * Every tick, each peer is sent the properties that have changed since the
+	 * last revision it acknowledged, so lost packets are simply covered by the
+	 * next one. The server sends everything that isn't PROP_LOCAL or PROP_PUSH,
+	 * and clients send back their PROP_PUSH properties. Objects need to be
+	 * registered in the same order on both ends, so their ids match up.
+	 *
+	 * Everything is allocated up front, so ticking doesn't allocate.
+	 */
+	class ReplicationManager {
+	public:
+		ReplicationManager();
+		~ReplicationManager();
+
+		static ReplicationManager *GetInstance() {
+			static ReplicationManager *instance = nullptr;
+			if ( instance == nullptr ) {
+				instance = new ReplicationManager();
+			}
+			return instance;
+		}
+
+		bool Host( uint16_t port );
+		bool Connect( const NetAddress &address, uint16_t localPort = 0 );
+		void Disconnect();
+
+		PL_INLINE bool IsActive() const { return socket.IsOpen(); }
+		PL_INLINE bool IsServer() const { return isServer; }
+		PL_INLINE uint16_t GetPort() const { return socket.GetPort(); }
+
+		uint16_t RegisterObject( PropertyOwner *owner );
+		void UnregisterObject( uint16_t id );
+
+		void Tick();
+
+		struct Stats {
+			uint64_t packetsSent{ 0 };
+			uint64_t packetsReceived{ 0 };
+			uint64_t packetsLost{ 0 };          // never acknowledged
+			uint64_t packetsDropped{ 0 };       // stale or malformed
+			uint64_t bytesSent{ 0 };
+			uint64_t bytesReceived{ 0 };
+			uint64_t objectsSent{ 0 };
+			uint64_t propertiesSent{ 0 };
+			float roundTripTime{ 0.0f };        // ms, smoothed
+		};
+		PL_INLINE const Stats &GetStats() const { return stats; }
+		PL_INLINE unsigned int GetNumPeers() const { return numPeers; }
+
+		void PrintStatus() const;
+
+	private:
+		struct SentPacket {
+			bool isPending{ false };
+			uint16_t sequence{ 0 };
+			unsigned int sendTime{ 0 };
+			unsigned int numObjects{ 0 };
+			uint16_t objects[ REPLICATION_PACKET_OBJECTS ];
+			uint64_t revisions[ REPLICATION_PACKET_OBJECTS ];
+		};
+
+		struct Peer {
+			bool isConnected{ false };
+			NetAddress address;
+			unsigned int lastReceiveTime{ 0 };
+
+			uint16_t localSequence{ 0 };
+			uint16_t remoteSequence{ 0 };
+			uint32_t remoteAckBits{ 0 };        // which of the 32 packets before remoteSequence we've seen
+			bool hasReceived{ false };
+
+			unsigned int nextObject{ 0 };       // where to carry on from if we ran out of room last tick
+
+			uint64_t *ackedRevisions{ nullptr };
+			SentPacket *history{ nullptr };
+		};
+
+		Peer *AddPeer( const NetAddress &address );
+		void RemovePeer( Peer *peer );
+		Peer *FindPeer( const NetAddress &address );
+
+		void ReceivePackets();
+		void ReadPacket( Peer *peer, const uint8_t *data, size_t size );
+		void AcknowledgePacket( Peer *peer, uint16_t sequence );
+
+		void SendPackets( Peer *peer );
+
+		bool isServer{ false };
+
+		NetSocket socket;
+
+		Peer peers[ REPLICATION_MAX_PEERS ];
+		unsigned int numPeers{ 0 };
+
+		PropertyOwner **objects{ nullptr };
+		unsigned int numObjects{ 0 };           // highest id in use, plus one
+
+		uint8_t packetBuffer[ REPLICATION_PACKET_SIZE ];
+
+		Stats stats;
+
+		static void HostCommand( unsigned int argc, char **argv );
+		static void ConnectCommand( unsigned int argc, char **argv );
+		static void DisconnectCommand( unsigned int argc, char **argv );
+		static void StatusCommand( unsigned int argc, char **argv );
+		static void BenchmarkReplicationCommand( unsigned int argc, char **argv );
+	};
+}
@@ -17,10 +17,10 @@
 
 #include <PL/platform_filesystem.h>
 #include <duktape.h>
-#include <sstream>
 
 #include "App.h"
 #include "JsonReader.h"
+#include "MemoryTracker.h"
 
 #define LogMissingProperty( P )   Warning("Failed to get JSON property \"%s\"!\n", (P))
 #define LogInvalidArray( P )      Warning("Invalid JSON array for property \"%s\"!\n", (P))
@@ -132,17 +132,6 @@ float JsonReader::GetFloatProperty( const std::string &property, float def, bool
 	return var;
 }
 
-// https://stackoverflow.com/a/23305012
-template< char C >
-std::istream &expect( std::istream &in ) {
-	if ( in.peek() == C ) {
-		in.ignore();
-	} else {
-		in.setstate( std::ios_base::failbit );
-	}
-	return in;
-}
-
 PLColour JsonReader::GetColourProperty( const std::string &property, PLColour def, bool silent ) {
 	auto *context = static_cast<duk_context *>(ctx_);
 
@@ -155,19 +144,15 @@ PLColour JsonReader::GetColourProperty( const std::string &property, PLColour de
 		return def;
 	}
 
-	std::string str = duk_safe_to_string( context, -1 );
+	// Parsed straight out of the context, rather than copying it anywhere first
+	int r, g, b, a;
+	int numParsed = sscanf( duk_safe_to_string( context, -1 ), "%d %d %d %d", &r, &g, &b, &a );
 	duk_pop( context );
 
-	std::stringstream stream( str );
-	int r, g, b, a;
-	stream >> r >> expect<' '> >> g >> expect<' '> >> b;
-	if ( !( stream.rdstate() & std::stringstream::failbit ) ) {
-		stream >> expect<' '> >> a;
-		if ( stream.rdstate() & std::stringstream::failbit ) {
-			// can still ignore alpha channel
-			a = 255;
-		}
-	} else {
+	if ( numParsed == 3 ) {
+		// can still ignore alpha channel
+		a = 255;
+	} else if ( numParsed < 3 ) {
 		throw std::runtime_error( "Failed to parse entirety of colour from JSON property, \"" + property + "\"!\n" );
 	}
 
@@ -186,13 +171,11 @@ PLVector4 JsonReader::GetVector4Property( const std::string &property, PLVector4
 		return def;
 	}
 
-	std::string str = duk_safe_to_string( context, -1 );
+	PLVector4 out;
+	int numParsed = sscanf( duk_safe_to_string( context, -1 ), "%f %f %f %f", &out.x, &out.y, &out.z, &out.w );
 	duk_pop( context );
 
-	PLVector4 out;
-	std::stringstream stream( str );
-	stream >> out.x >> expect<' '> >> out.y >> expect<' '> >> out.z >> expect< ' ' > >> out.w;
-	if ( stream.rdstate() & std::stringstream::failbit ) {
+	if ( numParsed != 4 ) {
 		throw std::runtime_error( "Failed to parse entirety of vector from JSON property, \"" + property + "\"!\n" );
 	}
 
@@ -211,13 +194,11 @@ PLVector3 JsonReader::GetVector3Property( const std::string &property, PLVector3
 		return def;
 	}
 
-	std::string str = duk_safe_to_string( context, -1 );
+	PLVector3 out;
+	int numParsed = sscanf( duk_safe_to_string( context, -1 ), "%f %f %f", &out.x, &out.y, &out.z );
 	duk_pop( context );
 
-	PLVector3 out;
-	std::stringstream stream( str );
-	stream >> out.x >> expect<' '> >> out.y >> expect<' '> >> out.z;
-	if ( stream.rdstate() & std::stringstream::failbit ) {
+	if ( numParsed != 3 ) {
 		throw std::runtime_error( "Failed to parse entirety of vector from JSON property, \"" + property + "\"!\n" );
 	}
 
@@ -326,6 +307,8 @@ std::vector<std::string> JsonReader::GetArrayStrings( const std::string &propert
 }
 
 void JsonReader::ParseBuffer( const char *buf ) {
+	ohw::MemoryTagScope tagScope( ohw::MemoryTag::SCRIPT );
+
 	if ( buf == nullptr ) {
 		Error( "Invalid buffer length!\n" );
 	}
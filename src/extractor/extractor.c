@@ -18,12 +18,83 @@
 
 #include <PL/platform_package.h>
 
+#include <stdatomic.h>
+#include <time.h>
+
 #include "extractor.h"
 #include "fac.h"
+#include "manifest.h"
+#include "package.h"
+#include "tim.h"
+#include "ImageKernels.h"
 
 static char g_input_path[PL_SYSTEM_MAX_PATH] = { '\0' };
 static char g_output_path[PL_SYSTEM_MAX_PATH];
 
+/************************************************************/
+/* Stage Timing */
+
+typedef struct ExtractorStage {
+	const char *description;
+	double timeTaken;
+	atomic_uint numProcessed;
+	atomic_uint numSkipped;
+} ExtractorStage;
+
+enum {
+	STAGE_PACKAGES,
+	STAGE_COPY,
+	STAGE_MUSIC,
+	STAGE_MERGE,
+	STAGE_MODELS,
+
+	MAX_STAGES
+};
+
+static ExtractorStage g_stages[MAX_STAGES] = {
+	[STAGE_PACKAGES] = { .description = "Package extraction" },
+	[STAGE_COPY] = { .description = "File copy" },
+	[STAGE_MUSIC] = { .description = "Music copy" },
+	[STAGE_MERGE] = { .description = "Texture merge" },
+	[STAGE_MODELS] = { .description = "Model conversion" },
+};
+
+static double GetTimeSeconds( void ) {
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ( double ) ts.tv_sec + ( ( double ) ts.tv_nsec / 1000000000.0 );
+}
+
+typedef void ( *StageFunction )( void );
+
+/* runs the given stage and waits for all of its jobs to finish,
+ * manifest is then flushed so progress isn't lost on failure */
+static void RunStage( unsigned int stageIndex, StageFunction function ) {
+	ExtractorStage *stage = &g_stages[ stageIndex ];
+	Print( "%s...\n", stage->description );
+
+	double start = GetTimeSeconds();
+	function();
+	Jobs_Wait();
+	stage->timeTaken = GetTimeSeconds() - start;
+
+	Manifest_Save();
+}
+
+static void PrintStageSummary( void ) {
+	double total = 0.0;
+	Print( "\n%-20s %10s %10s %10s\n", "stage", "time (s)", "processed", "skipped" );
+	for ( unsigned int i = 0; i < MAX_STAGES; ++i ) {
+		Print( "%-20s %10.2f %10u %10u\n",
+		       g_stages[ i ].description,
+		       g_stages[ i ].timeTaken,
+		       atomic_load( &g_stages[ i ].numProcessed ),
+		       atomic_load( &g_stages[ i ].numSkipped ) );
+		total += g_stages[ i ].timeTaken;
+	}
+	Print( "%-20s %10.2f\n\n", "total", total );
+}
+
 //#define PARANOID_DATA
 //#define EXPORT_NORMALS
 #define CONVERT_TIMS
@@ -31,47 +102,116 @@ static char g_output_path[PL_SYSTEM_MAX_PATH];
 /************************************************************/
 /* Data Conversion */
 
-static void ConvertImageToPng( const char *path ) {
+/* rename won't replace an existing file on Windows */
+static bool ReplaceFile( const char *from, const char *to ) {
+#if defined( _WIN32 )
+	remove( to );
+#endif
+	return ( rename( from, to ) == 0 );
+}
+
+/* decodes the Tim straight out of the package and writes it out as a png,
+ * path is where the Tim itself would've been written. Whether it needs doing
+ * at all is down to the manifest, so any existing png is always replaced. */
+static void ConvertImageToPng( const uint8_t *data, size_t size, const char *path ) {
 #if defined( CONVERT_TIMS )
-	// figure out if the file already exists before
-	// we even start trying to convert this thing
 	char out_path[PL_SYSTEM_MAX_PATH];
-	plStripExtension( out_path, sizeof( out_path ), path );
+	plStripExtension( out_path, sizeof( out_path ) - 4, path );
 	strcat( out_path, ".png" );
-	if ( plFileExists( out_path ) ) {
-		plDeleteFile( path );
-		return;
-	}
 
-	PLImage *image = plLoadImage( path );
+	/* written somewhere unique first and then moved over, so nothing reading
+	 * the output ever sees half a png */
+	static atomic_uint num_temporaries = 0;
+	char tmp_path[PL_SYSTEM_MAX_PATH];
+	snprintf( tmp_path, sizeof( tmp_path ), "%s.%u.tmp.png", out_path, atomic_fetch_add( &num_temporaries, 1 ) );
+
+	PLImage *image = Tim_LoadMemory( data, size, path );
 	if ( image == NULL ) {
-		Warning( "Failed to load image, \"%s\" (%s)!\n", path, plGetError() );
+		Warning( "Failed to load image, \"%s\"!\n", path );
 		return;
 	}
 
-	const char *ext = plGetFileExtension( path );
-	if ( ext != NULL && ext[ 0 ] != '\0' && strcmp( ext, "tim" ) == 0 ) {
-		// ensure that it's a format we're able to convert from
-		if ( image->format == PL_IMAGEFORMAT_RGB5A1 ) {
-			if ( plConvertPixelFormat( image, PL_IMAGEFORMAT_RGBA8 ) ) {
-				plReplaceImageColour( image, PLColour( 255, 0, 255, 255 ), PLColour( 0, 0, 0, 0 ) );
-				if ( !plWriteImage( image, out_path ) ) {
-					Warning( "Failed to write PNG, \"%s\" (%s)!\n", out_path, plGetError() );
-				}
-			} else {
-				Warning( "Failed to convert \"%s\", %s, aborting!\n", path, plGetError() );
-			}
-		} else {
-			Warning( "Unexpected pixel format in \"%s\", aborting!\n", path );
-		}
+	static const uint8_t key[ 4 ] = { 255, 0, 255, 255 }, transparent[ 4 ] = { 0, 0, 0, 0 };
+	Img_ReplaceColour( image->data[ 0 ], image->width * image->height, key, transparent );
+	if ( !plWriteImage( image, tmp_path ) ) {
+		Warning( "Failed to write PNG, \"%s\" (%s)!\n", tmp_path, plGetError() );
+		remove( tmp_path );
+	} else if ( !ReplaceFile( tmp_path, out_path ) ) {
+		Warning( "Failed to replace PNG, \"%s\"!\n", out_path );
+		remove( tmp_path );
 	}
 
-	if ( plFileExists( out_path ) ) {
-		plDeleteFile( path );
+	plDestroyImage( image );
+#else
+	if ( !plWriteFile( path, data, size ) ) {
+		Warning( "Failed to write file, \"%s\" (%s)!\n", path, plGetError() );
 	}
+#endif
+}
 
-	plDestroyImage( image );
+typedef struct ImageConversionJob {
+	Package *package;
+	const PackageMember *member;
+	char path[PL_SYSTEM_MAX_PATH];
+} ImageConversionJob;
+
+static void ConvertImageToPngJob( void *userData ) {
+	ImageConversionJob *job = ( ImageConversionJob * ) userData;
+	ConvertImageToPng( job->member->data, job->member->size, job->path );
+	Pkg_Release( job->package );
+	free( job );
+}
+
+/* the package is kept mapped until the conversion is done */
+static void QueueImageConversion( Package *package, const PackageMember *member, const char *path ) {
+	ImageConversionJob *job = malloc( sizeof( ImageConversionJob ) );
+	if ( job == NULL ) {
+		Error( "Failed to allocate job for conversion, \"%s\"!\n", path );
+	}
+
+	Pkg_Retain( package );
+	job->package = package;
+	job->member = member;
+	snprintf( job->path, sizeof( job->path ), "%s", path );
+
+	Jobs_Submit( ConvertImageToPngJob, job );
+}
+
+static bool IsTimMember( const PackageMember *member ) {
+	const char *ext = plGetFileExtension( member->name );
+	return ( ext != NULL && pl_strcasecmp( ext, "tim" ) == 0 );
+}
+
+/* checks everything the package would be written out as is still there,
+ * so a stage isn't skipped just because its inputs haven't changed */
+static bool PackageOutputsExist( const char *input_path, const char *output_path ) {
+	Package *package = Pkg_LoadFile( input_path );
+	if ( package == NULL ) {
+		return false;
+	}
+
+	bool exists = true;
+	for ( unsigned int i = 0; i < package->num_members && exists; ++i ) {
+		const PackageMember *member = &package->members[ i ];
+
+		char out[PL_SYSTEM_MAX_PATH];
+		snprintf( out, sizeof( out ), "%s%s", output_path, member->name );
+		pl_strtolower( out + strlen( output_path ) );
+#if defined( CONVERT_TIMS )
+		if ( IsTimMember( member ) ) {
+			char tim_path[PL_SYSTEM_MAX_PATH];
+			snprintf( tim_path, sizeof( tim_path ), "%s", out );
+			plStripExtension( out, sizeof( out ) - 4, tim_path );
+			strcat( out, ".png" );
+		}
 #endif
+
+		exists = plFileExists( out );
+	}
+
+	Pkg_Release( package );
+
+	return exists;
 }
 
 typedef struct ModelConversionData {
@@ -96,7 +236,6 @@ static ModelConversionData pc_conversion_data[] = {
 	{ "/Maps/HELL3.MAD", "/Maps/hell3.mtd", "mods/how/chars/scenery/" },
 	{ "/Maps/HILLBASE.MAD", "/Maps/hillbase.mtd", "mods/how/chars/scenery/" },
 	{ "/Maps/ICEFLOW.MAD", "/Maps/iceflow.mtd", "mods/how/chars/scenery/" },
-	{ "/Maps/ICE.MAD", "/Maps/ice.mtd", "mods/how/chars/scenery/" },
 	{ "/Maps/ZULUS.MAD", "/Maps/zulus.mtd", "mods/how/chars/scenery/" },
 
 	{ "/Chars/WEAPONS.MAD", "/Chars/WEAPONS.MTD", "mods/how/chars/weapons/" },
@@ -109,240 +248,312 @@ static ModelConversionData pc_conversion_data[] = {
 	{ "/Chars/SKYDOME.MAD", "/Chars/SKYDOME.MTD", "mods/how/skys/" },
 };
 
-static void ConvertModelData( void ) {
-	for ( unsigned long i = 0; i < plArrayElements( pc_conversion_data ); ++i ) {
-		char path[PL_SYSTEM_MAX_PATH];
-		snprintf( path, sizeof( path ), "%s%s", g_input_path, pc_conversion_data[ i ].mad );
-		PLPackage *package = plLoadPackage( path );
-		if ( package == NULL ) {
-			Error( "Failed to load MAD package, \"%s\" (%s)!\n", path, plGetError() );
+/* pngs already written by earlier conversions into the same place */
+typedef struct WrittenImages {
+	uint64_t *hashes;
+	unsigned int num, max;
+} WrittenImages;
+
+/* returns false if the path was already written, otherwise remembers it */
+static bool MarkImageWritten( WrittenImages *written, const char *path ) {
+	uint64_t hash = Manifest_HashString( path, MANIFEST_HASH_SEED );
+	for ( unsigned int i = 0; i < written->num; ++i ) {
+		if ( written->hashes[ i ] == hash ) {
+			return false;
+		}
+	}
+
+	if ( written->num == written->max ) {
+		written->max = ( written->max == 0 ) ? 64 : written->max * 2;
+		written->hashes = realloc( written->hashes, sizeof( uint64_t ) * written->max );
+		if ( written->hashes == NULL ) {
+			Error( "Failed to allocate written image list!\n" );
+		}
+	}
+
+	written->hashes[ written->num++ ] = hash;
+	return true;
+}
+
+/* Tims are queued, unless other conversions write into the same place, in which
+ * case they're converted straight away and whichever conversion wrote one first
+ * keeps it (written is NULL when this is the only conversion) */
+static void ConvertModel( const ModelConversionData *conversion, WrittenImages *written ) {
+	char path[PL_SYSTEM_MAX_PATH];
+	snprintf( path, sizeof( path ), "%s%s", g_input_path, conversion->mad );
+	Package *package = Pkg_LoadFile( path );
+	if ( package == NULL ) {
+		Error( "Failed to load MAD package, \"%s\"!\n", path );
+	}
+
+	/* Write the files out to the destination. I'm lazy and we'll delete it once we're done anyway. */
+	char model_paths[package->num_members][PL_SYSTEM_MAX_PATH];
+	unsigned int num_models = 0;
+	for ( unsigned int j = 0; j < package->num_members; ++j ) {
+		const PackageMember *member = &package->members[ j ];
+
+		char out[PL_SYSTEM_MAX_PATH];
+		snprintf( out, sizeof( out ), "%s/%s%s", g_output_path, conversion->out, member->name );
+		pl_strtolower( out + strlen( out ) - strlen( member->name ) );
+
+		char dir[PL_SYSTEM_MAX_PATH];
+		const char *filename = plGetFileName( out );
+		strncpy( dir, out, strlen( out ) - strlen( filename ) );
+		dir[ strlen( out ) - strlen( filename ) ] = '\0';
+		if ( plCreatePath( dir ) ) {
+			if ( !plWriteFile( out, member->data, member->size ) ) {
+				Error( "Failed to write model, \"%s\" (%s)!\n", out, plGetError() );
+			}
+		} else {
+			Error( "Failed to create output directory, \"%s\" (%s)!\n", dir, plGetError() );
+		}
+
+		// skydome is a special case
+		if ( pl_strcasecmp( filename, "skydomeu.fac" ) == 0 || pl_strcasecmp( filename, "skydome.fac" ) == 0 ) {
+			continue;
 		}
 
-		/* Write the files out to the destination. I'm lazy and we'll delete it once we're done anyway. */
-		char model_paths[package->table_size][PL_SYSTEM_MAX_PATH];
-		unsigned int num_models = 0;
-		for ( unsigned int j = 0; j < package->table_size; ++j ) {
+		const char *ext = plGetFileExtension( member->name );
+		if ( pl_strcasecmp( ext, "fac" ) == 0 ) {
+			plStripExtension( model_paths[ num_models++ ], PL_SYSTEM_MAX_PATH - 1, out );
+		}
+	}
+
+	Pkg_Release( package );
+
+	/* Now we need to load each fac, fetch each index for each texture and figure out
+	 * the true name for that texture by comparing against the mtd. */
+
+	snprintf( path, sizeof( path ), "%s%s", g_input_path, conversion->mtd );
+	package = Pkg_LoadFile( path );
+	if ( package == NULL ) {
+		Error( "Failed to load MTD package, \"%s\"!\n", conversion->mtd );
+	}
+
+	/* pigs are a special case... */
+	if ( strcmp( conversion->mad, "/Chars/british.mad" ) != 0 ) {
+		// write all the textures out
+		for ( unsigned int j = 0; j < package->num_members; ++j ) {
+			const PackageMember *member = &package->members[ j ];
+
 			char out[PL_SYSTEM_MAX_PATH];
-			snprintf( out, sizeof( out ), "%s/%s%s", g_output_path, pc_conversion_data[ i ].out, pl_strtolower( package->table[ j ].fileName ) );
+			snprintf( out, sizeof( out ), "%s/%s%s", g_output_path, conversion->out, member->name );
+			pl_strtolower( out + strlen( out ) - strlen( member->name ) );
 
 			char dir[PL_SYSTEM_MAX_PATH];
 			const char *filename = plGetFileName( out );
 			strncpy( dir, out, strlen( out ) - strlen( filename ) );
 			dir[ strlen( out ) - strlen( filename ) ] = '\0';
-			if ( plCreatePath( dir ) ) {
-				PLFile *fp = plLoadPackageFile( package, package->table[ j ].fileName );
-				if ( !plWriteFile( out, plGetFileData( fp ), package->table[ j ].fileSize ) ) {
-					Error( "Failed to write model, \"%s\" (%s)!\n", out, plGetError() );
-				}
-				plCloseFile( fp );
-			} else {
+			if ( !plCreatePath( dir ) ) {
 				Error( "Failed to create output directory, \"%s\" (%s)!\n", dir, plGetError() );
 			}
 
-			// skydome is a special case
-			if ( pl_strcasecmp( filename, "skydomeu.fac" ) == 0 || pl_strcasecmp( filename, "skydome.fac" ) == 0 ) {
-				continue;
+			if ( IsTimMember( member ) ) {
+				if ( written == NULL ) {
+					QueueImageConversion( package, member, out );
+				} else if ( MarkImageWritten( written, out ) ) {
+					ConvertImageToPng( member->data, member->size, out );
+				}
+			} else if ( !plWriteFile( out, member->data, member->size ) ) {
+				Error( "Failed to write texture, \"%s\" (%s)!\n", out, plGetError() );
 			}
+		}
+	}
 
-			const char *ext = plGetFileExtension( package->table[ j ].fileName );
-			if ( pl_strcasecmp( ext, "fac" ) == 0 ) {
-				plStripExtension( model_paths[ num_models++ ], PL_SYSTEM_MAX_PATH - 1, out );
-			}
+	/* and now we go through again, converting everything as we do so */
+	for ( unsigned int j = 0; j < num_models; ++j ) {
+		char fac_path[PL_SYSTEM_MAX_PATH];
+		snprintf( fac_path, PL_SYSTEM_MAX_PATH, "%s.fac", model_paths[ j ] );
+		if ( !plFileExists( fac_path ) ) {
+			Error( "Failed to find FAC file, \"%s\"!\n", fac_path );
 		}
 
-		plDestroyPackage( package );
+		// we'll resize this later...
+		FacTextureIndex *table = calloc( package->num_members, sizeof( FacTextureIndex ) );
+		if ( table == NULL ) {
+			Warning( "Failed to allocate texture table!\n" );
+			continue;
+		}
 
-		/* Now we need to load each fac, fetch each index for each texture and figure out
-		 * the true name for that texture by comparing against the mtd. */
+		unsigned int table_size = 0;
 
-		snprintf( path, sizeof( path ), "%s%s", g_input_path, pc_conversion_data[ i ].mtd );
-		package = plLoadPackage( path );
-		if ( package == NULL ) {
-			Error( "Failed to load MTD package, \"%s\" (%s)!\n", pc_conversion_data[ i ].mtd, plGetError() );
+		FacHandle *fac = Fac_LoadFile( fac_path );
+		if ( fac == NULL ) {
+			Warning( "Failed to load FAC \"%s\"!\n", fac_path );
+			continue;
 		}
 
-		/* pigs are a special case... */
-		if ( strcmp( pc_conversion_data[ i ].mad, "/Chars/british.mad" ) != 0 ) {
-			// write all the textures out
-			for ( unsigned int j = 0; j < package->table_size; ++j ) {
-				char out[PL_SYSTEM_MAX_PATH];
-				snprintf( out, sizeof( out ), "%s/%s%s", g_output_path, pc_conversion_data[ i ].out, pl_strtolower( package->table[ j ].fileName ) );
-
-				char dir[PL_SYSTEM_MAX_PATH];
-				const char *filename = plGetFileName( out );
-				strncpy( dir, out, strlen( out ) - strlen( filename ) );
-				dir[ strlen( out ) - strlen( filename ) ] = '\0';
-
-#if defined( PARANOID_DATA ) // paranoid check, doesn't happen...
-				if(plFileExists(out)) {
-				  LogInfo("The file \"%s\" already exists, comparing...\n", out);
-
-				  size_t size = plGetLocalFileSize(out);
-				  FILE *fp = fopen(out, "rb");
-				  char *data = u_alloc(size, 1, true);
-				  fread(data, 1, size, fp);
-				  fclose(fp);
-
-				  uint32_t crc_a;
-				  pl_crc32(package->table[j].file.data, package->table[j].fileSize, &crc_a);
-				  uint32_t crc_b;
-				  pl_crc32(data, size, &crc_b);
-				  if(crc_a != crc_b) {
-					LogWarn("Files are different, renaming second file!\n");
-					while(plFileExists(out)) {
-					  strcat(out, "_");
-					}
-				  }
-				}
-#endif
+		for ( unsigned int k = 0; k < fac->num_triangles; ++k ) {
+			uint32_t texture_index = fac->triangles[ k ].texture_index;
+			if ( texture_index >= package->num_members ) {
+				Error( "Out of bounds texture index, \"%s\"!\n", fac_path );
+			}
 
-				if ( plCreatePath( dir ) ) {
-					PLFile *fp = plLoadPackageFile( package, package->table[ j ].fileName );
-					if ( !plWriteFile( out, plGetFileData( fp ), package->table[ j ].fileSize ) ) {
-						Error( "Failed to write model, \"%s\" (%s)!\n", out, plGetError() );
-					}
-					plCloseFile( fp );
-				} else {
-					Error( "Failed to create output directory, \"%s\" (%s)!\n", dir, plGetError() );
+			// attempt to add it to the table
+			char texture_name[16];
+			plStripExtension( texture_name, sizeof( texture_name ), package->members[ texture_index ].name );
+			pl_strtolower( texture_name );
+			unsigned int l;
+			for ( l = 0; l < package->num_members; ++l ) {
+				if ( table[ l ].name[ 0 ] == '\0' ) {
+					strncpy( table[ l ].name, texture_name, sizeof( table[ l ].name ) );
+					table_size++;
+					break;
+				} else if ( strncmp( table[ l ].name, texture_name, sizeof( table[ l ].name ) ) == 0 ) {
+					break;
 				}
-
-				ConvertImageToPng( out );
 			}
-		}
 
-		/* and now we go through again, converting everything as we do so */
-		for ( unsigned int j = 0; j < num_models; ++j ) {
-			char fac_path[PL_SYSTEM_MAX_PATH];
-			snprintf( fac_path, PL_SYSTEM_MAX_PATH, "%s.fac", model_paths[ j ] );
-			if ( !plFileExists( fac_path ) ) {
-				Error( "Failed to find FAC file, \"%s\"!\n", fac_path );
+			if ( table_size > package->num_members ) {
+				Error( "Invalid table size, %d > %d!\n", table_size, package->num_members );
 			}
 
-			// we'll resize this later...
-			FacTextureIndex *table = calloc( package->table_size, sizeof( FacTextureIndex ) );
-			if ( table == NULL ) {
-				Warning( "Failed to allocate texture table!\n" );
-				continue;
-			}
+			// replace the original id so it matches with the index in our table
+			fac->triangles[ k ].texture_index = l;
+		}
 
-			unsigned int table_size = 0;
+		fac->texture_table = calloc( table_size, sizeof( FacTextureIndex ) );
+		if ( fac->texture_table == NULL ) {
+			Error( "Failed to allocate texture table for output!\n" );
+		}
 
-			FacHandle *fac = Fac_LoadFile( fac_path );
-			if ( fac == NULL ) {
-				Warning( "Failed to load FAC \"%s\"!\n", fac_path );
-				continue;
-			}
+		fac->texture_table_size = table_size;
+		memcpy( fac->texture_table, table, sizeof( FacTextureIndex ) * table_size );
+		free( table );
 
-			for ( unsigned int k = 0; k < fac->num_triangles; ++k ) {
-				uint32_t texture_index = fac->triangles[ k ].texture_index;
-				if ( texture_index >= package->table_size ) {
-					Error( "Out of bounds texture index, \"%s\"!\n", fac_path );
-				}
+		// write out the fac and replace it (we'll append the table to the end)
+		snprintf( fac_path, PL_SYSTEM_MAX_PATH, "%s.fac", model_paths[ j ] );
+		Fac_WriteFile( fac, fac_path );
+		Fac_DestroyHandle( fac );
+	}
 
-				// attempt to add it to the table
-				char texture_name[16];
-				strncpy( texture_name, package->table[ texture_index ].fileName, strlen( package->table[ texture_index ].fileName ) - 4 );
-				texture_name[ strlen( package->table[ texture_index ].fileName ) - 4 ] = '\0';
-				pl_strtolower( texture_name );
-				unsigned int l;
-				for ( l = 0; l < package->table_size; ++l ) {
-					if ( table[ l ].name[ 0 ] == '\0' ) {
-						strncpy( table[ l ].name, texture_name, sizeof( table[ l ].name ) );
-						table_size++;
-						break;
-					} else if ( strncmp( table[ l ].name, texture_name, sizeof( table[ l ].name ) ) == 0 ) {
-						break;
-					}
-				}
+	Pkg_Release( package );
+}
 
-				if ( table_size > package->table_size ) {
-					Error( "Invalid table size, %d > %d!\n", table_size, package->table_size );
-				}
+static bool ModelOutputsExist( const ModelConversionData *conversion ) {
+	char input_path[PL_SYSTEM_MAX_PATH], output_path[PL_SYSTEM_MAX_PATH];
+	snprintf( output_path, sizeof( output_path ), "%s/%s", g_output_path, conversion->out );
 
-				// replace the original id so it matches with the index in our table
-				fac->triangles[ k ].texture_index = l;
-			}
+	snprintf( input_path, sizeof( input_path ), "%s%s", g_input_path, conversion->mad );
+	if ( !PackageOutputsExist( input_path, output_path ) ) {
+		return false;
+	}
 
-			fac->texture_table = calloc( table_size, sizeof( FacTextureIndex ) );
-			if ( fac->texture_table == NULL ) {
-				Error( "Failed to allocate texture table for output!\n" );
-			}
+	/* pigs don't have their textures written out here */
+	if ( strcmp( conversion->mad, "/Chars/british.mad" ) == 0 ) {
+		return true;
+	}
 
-			fac->texture_table_size = table_size;
-			memcpy( fac->texture_table, table, sizeof( FacTextureIndex ) * table_size );
-			free( table );
+	snprintf( input_path, sizeof( input_path ), "%s%s", g_input_path, conversion->mtd );
+	return PackageOutputsExist( input_path, output_path );
+}
 
-			// write out the fac and replace it (we'll append the table to the end)
-			snprintf( fac_path, PL_SYSTEM_MAX_PATH, "%s.fac", model_paths[ j ] );
-			Fac_WriteFile( fac, fac_path );
+/* Several of the conversions write into the same directory, with members of
+ * the same name, so each job takes every conversion for one directory and runs
+ * them one after another, in the order of the table, so that the same files win
+ * as when they were all done in turn. */
+static void ConvertModelGroupJob( void *userData ) {
+	const ModelConversionData *first = ( const ModelConversionData * ) userData;
+	const ModelConversionData *last = pc_conversion_data + plArrayElements( pc_conversion_data );
+
+	char key[PL_SYSTEM_MAX_PATH];
+	snprintf( key, sizeof( key ), "model:%s", first->out );
+
+	uint64_t hash = Manifest_HashString( first->out, MANIFEST_HASH_SEED );
+	unsigned int num_conversions = 0;
+	bool outputs_exist = true;
+	for ( const ModelConversionData *conversion = first; conversion < last; ++conversion ) {
+		if ( strcmp( conversion->out, first->out ) != 0 ) {
+			continue;
 		}
-	}
-}
 
-/////////////////////////////////////////////////////////////
-/* Extraction process for initial setup */
+		char path[PL_SYSTEM_MAX_PATH];
+		snprintf( path, sizeof( path ), "%s%s", g_input_path, conversion->mad );
+		if ( !Manifest_HashFile( path, &hash ) ) {
+			Error( "Failed to load MAD package, \"%s\"!\n", path );
+		}
+		snprintf( path, sizeof( path ), "%s%s", g_input_path, conversion->mtd );
+		if ( !Manifest_HashFile( path, &hash ) ) {
+			Error( "Failed to load MTD package, \"%s\"!\n", path );
+		}
 
-static void ExtractPtgPackage( const char *input_path, const char *output_path ) {
-	if ( !plCreatePath( output_path ) ) {
-		Error( "Failed to create path, \"%s\" (%s)!\n", output_path, plGetError() );
+		num_conversions++;
+		outputs_exist = outputs_exist && ModelOutputsExist( conversion );
 	}
 
-	FILE *file = fopen( input_path, "rb" );
-	if ( file == NULL ) {
-		Error( "Failed to load PTG package, \"%s\"!\n", input_path );
+	if ( Manifest_IsUpToDate( key, hash ) && outputs_exist ) {
+		atomic_fetch_add( &g_stages[ STAGE_MODELS ].numSkipped, num_conversions );
+		return;
 	}
 
-	uint32_t num_textures = 0;
-	if ( fread( &num_textures, sizeof( uint32_t ), 1, file ) != 1 ) {
-		Error( "Invalid PTG file, failed to get number of textures!\n" );
+	WrittenImages written = { NULL, 0, 0 };
+	for ( const ModelConversionData *conversion = first; conversion < last; ++conversion ) {
+		if ( strcmp( conversion->out, first->out ) == 0 ) {
+			ConvertModel( conversion, ( num_conversions == 1 ) ? NULL : &written );
+		}
 	}
+	free( written.hashes );
 
-	size_t tim_size = ( plGetLocalFileSize( input_path ) - sizeof( num_textures ) ) / num_textures;
-	for ( unsigned int i = 0; i < num_textures; ++i ) {
-		uint8_t tim[tim_size];
-		if ( fread( tim, tim_size, 1, file ) != 1 ) {
-			Print( "Failed to read Tim, \"%d\"!\n", i );
+	Manifest_Update( key, hash );
+	atomic_fetch_add( &g_stages[ STAGE_MODELS ].numProcessed, num_conversions );
+}
+
+static void ConvertModelData( void ) {
+	for ( unsigned long i = 0; i < plArrayElements( pc_conversion_data ); ++i ) {
+		/* only the first for each destination, it'll take care of the rest */
+		unsigned long j;
+		for ( j = 0; j < i; ++j ) {
+			if ( strcmp( pc_conversion_data[ j ].out, pc_conversion_data[ i ].out ) == 0 ) {
+				break;
+			}
+		}
+		if ( j < i ) {
 			continue;
 		}
 
-		char out_path[PL_SYSTEM_MAX_PATH] = { '\0' };
-		sprintf( out_path, "%s%d.tim", output_path, i );
-		if ( !plWriteFile( out_path, tim, tim_size ) ) {
-			Warning( "Failed to write file, \"%s\" (%s)!\n", out_path, plGetError() );
+		char dir[PL_SYSTEM_MAX_PATH];
+		snprintf( dir, sizeof( dir ), "%s/%s", g_output_path, pc_conversion_data[ i ].out );
+		if ( !plCreatePath( dir ) ) {
+			Error( "Failed to create output directory, \"%s\" (%s)!\n", dir, plGetError() );
 		}
 
-		ConvertImageToPng( out_path );
+		Jobs_Submit( ConvertModelGroupJob, &pc_conversion_data[ i ] );
 	}
-
-	fclose( file );
 }
 
-static void ExtractMadPackage( const char *input_path, const char *output_path ) {
+/////////////////////////////////////////////////////////////
+/* Extraction process for initial setup */
+
+/* writes out each member of the package, Tims are converted straight
+ * from the mapped package rather than being written out first */
+static void ExtractPackageMembers( const char *input_path, const char *output_path ) {
 	if ( !plCreatePath( output_path ) ) {
 		Error( "Failed to create output directory,  \"%s\"!\nPL: %s\n", output_path, plGetError() );
 	}
 
-	PLPackage *package = plLoadPackage( input_path );
+	Package *package = Pkg_LoadFile( input_path );
 	if ( package == NULL ) {
-		Error( "Failed to load %s, aborting!\nPL: %s\n", input_path, plGetError() );
+		Error( "Failed to load %s, aborting!\n", input_path );
 	}
 
-	for ( unsigned int i = 0; i < package->table_size; i++ ) {
+	for ( unsigned int i = 0; i < package->num_members; i++ ) {
+		const PackageMember *member = &package->members[ i ];
+
 		char out[PL_SYSTEM_MAX_PATH];
-		snprintf( out, sizeof( out ) - 1, "%s%s", output_path, pl_strtolower( package->table[ i ].fileName ) );
-		PLFile *fp = plLoadPackageFile( package, package->table[ i ].fileName );
-		if ( !plWriteFile( out, plGetFileData( fp ), package->table[ i ].fileSize ) ) {
-			Error( "Failed to write file, \"%s\" (%s)!\n", out, plGetError() );
+		snprintf( out, sizeof( out ) - 1, "%s%s", output_path, member->name );
+		pl_strtolower( out + strlen( output_path ) );
+
+		if ( IsTimMember( member ) ) {
+			QueueImageConversion( package, member, out );
+			continue;
 		}
-		plCloseFile( fp );
 
-		const char *ext = plGetFileExtension( out );
-		if ( strcmp( ext, "tim" ) == 0 ) {
-			ConvertImageToPng( out );
+		if ( !plWriteFile( out, member->data, member->size ) ) {
+			Error( "Failed to write file, \"%s\" (%s)!\n", out, plGetError() );
 		}
 	}
 
-	plDestroyPackage( package );
+	Pkg_Release( package );
 }
 
 /************************************************************/
@@ -429,45 +640,67 @@ static TextureMerge texture_targets[] = {
 	}
 };
 
-static void MergeTextureTargets( void ) {
-	unsigned int num_texture_targets = plArrayElements( texture_targets );
-	Print( "Merging %d texture targets...\n", num_texture_targets );
-	for ( unsigned int i = 0; i < num_texture_targets; ++i ) {
-		TextureMerge *merge = &texture_targets[ i ];
-		Print( "Generating %s\n", merge->output );
-		PLImage
-			*output = plCreateImage( NULL, merge->width, merge->height, PL_COLOURFORMAT_RGBA, PL_IMAGEFORMAT_RGBA8 );
-		if ( output == NULL ) {
-			Warning( "Failed to generate texture target (%s)!\n", plGetError() );
-			continue;
+static void MergeTextureTargetJob( void *userData ) {
+	TextureMerge *merge = ( TextureMerge * ) userData;
+
+	/* the pieces are deleted once they've been merged, so if none
+	 * of them are around then there's nothing new to merge */
+	unsigned int num_pieces = 0;
+	for ( unsigned int j = 0; j < merge->num_textures; ++j ) {
+		if ( plFileExists( merge->targets[ j ].path ) ) {
+			num_pieces++;
 		}
+	}
 
-		for ( unsigned int j = 0; j < merge->num_textures; ++j ) {
-			const char *path = merge->targets[ j ].path;
-			PLImage *image = plLoadImage( path );
-			if ( image == NULL ) {
-				Warning( "Failed to find image, \"%s\", for merge!\n", merge->targets[ j ].path );
-				continue;
-			}
+	if ( num_pieces == 0 && plFileExists( merge->output ) ) {
+		atomic_fetch_add( &g_stages[ STAGE_MERGE ].numSkipped, 1 );
+		return;
+	}
 
-			Print( "Writing %s into %s\n", merge->targets[ j ].path, merge->output );
+	Print( "Generating %s\n", merge->output );
+	PLImage
+		*output = plCreateImage( NULL, merge->width, merge->height, PL_COLOURFORMAT_RGBA, PL_IMAGEFORMAT_RGBA8 );
+	if ( output == NULL ) {
+		Warning( "Failed to generate texture target (%s)!\n", plGetError() );
+		return;
+	}
 
-			uint8_t
-				*pos = output->data[ 0 ] + ( ( merge->targets[ j ].y * output->width ) + merge->targets[ j ].x ) * 4;
-			uint8_t *src = image->data[ 0 ];
-			for ( unsigned int y = 0; y < image->height; ++y ) {
-				memcpy( pos, src, ( image->width * 4 ) );
-				src += image->width * 4;
-				pos += output->width * 4;
-			}
+	for ( unsigned int j = 0; j < merge->num_textures; ++j ) {
+		const char *path = merge->targets[ j ].path;
+		PLImage *image = plLoadImage( path );
+		if ( image == NULL ) {
+			Warning( "Failed to find image, \"%s\", for merge!\n", merge->targets[ j ].path );
+			continue;
+		}
 
+		if ( !Img_ConvertImageToRGBA8( image ) ) {
+			Warning( "Failed to convert image, \"%s\", for merge (%s)!\n", path, plGetError() );
 			plDestroyImage( image );
-			plDeleteFile( path );
+			continue;
 		}
 
-		Print( "Writing %s\n", merge->output );
-		plWriteImage( output, merge->output );
-		plDestroyImage( output );
+		Print( "Writing %s into %s\n", merge->targets[ j ].path, merge->output );
+
+		uint8_t
+			*pos = output->data[ 0 ] + ( ( merge->targets[ j ].y * output->width ) + merge->targets[ j ].x ) * 4;
+		Img_Blit( pos, output->width * 4, image->data[ 0 ], image->width * 4, image->width * 4, image->height );
+
+		plDestroyImage( image );
+		plDeleteFile( path );
+	}
+
+	Print( "Writing %s\n", merge->output );
+	plWriteImage( output, merge->output );
+	plDestroyImage( output );
+
+	atomic_fetch_add( &g_stages[ STAGE_MERGE ].numProcessed, 1 );
+}
+
+static void MergeTextureTargets( void ) {
+	unsigned int num_texture_targets = plArrayElements( texture_targets );
+	Print( "Merging %d texture targets...\n", num_texture_targets );
+	for ( unsigned int i = 0; i < num_texture_targets; ++i ) {
+		Jobs_Submit( MergeTextureTargetJob, &texture_targets[ i ] );
 	}
 }
 
@@ -489,6 +722,68 @@ static IOPath pc_package_paths[] = {
 #include "pc_package_paths.h"
 };
 
+typedef struct PathJob {
+	char input[PL_SYSTEM_MAX_PATH];
+	char output[PL_SYSTEM_MAX_PATH];
+	unsigned int stage;
+} PathJob;
+
+static PathJob *CreatePathJob( const char *input, const char *output, unsigned int stage ) {
+	PathJob *job = malloc( sizeof( PathJob ) );
+	if ( job == NULL ) {
+		Error( "Failed to allocate job for \"%s\"!\n", input );
+	}
+
+	snprintf( job->input, sizeof( job->input ), "%s", input );
+	snprintf( job->output, sizeof( job->output ), "%s", output );
+	job->stage = stage;
+	return job;
+}
+
+static void ExtractPackageJob( void *userData ) {
+	PathJob *job = ( PathJob * ) userData;
+
+	char key[PL_SYSTEM_MAX_PATH + 16];
+	snprintf( key, sizeof( key ), "package:%s", job->input );
+
+	uint64_t hash = Manifest_HashString( job->output, MANIFEST_HASH_SEED );
+	if ( Manifest_HashFile( job->input, &hash ) && Manifest_IsUpToDate( key, hash ) &&
+	     PackageOutputsExist( job->input, job->output ) ) {
+		atomic_fetch_add( &g_stages[ job->stage ].numSkipped, 1 );
+		free( job );
+		return;
+	}
+
+	Print( "Copying %s to %s\n", job->input, job->output );
+	ExtractPackageMembers( job->input, job->output );
+
+	Manifest_Update( key, hash );
+	atomic_fetch_add( &g_stages[ job->stage ].numProcessed, 1 );
+	free( job );
+}
+
+static void CopyFileJob( void *userData ) {
+	PathJob *job = ( PathJob * ) userData;
+
+	char key[PL_SYSTEM_MAX_PATH + 16];
+	snprintf( key, sizeof( key ), "copy:%s", job->output );
+
+	uint64_t hash = MANIFEST_HASH_SEED;
+	if ( Manifest_HashFile( job->input, &hash ) && Manifest_IsUpToDate( key, hash ) && plFileExists( job->output ) ) {
+		atomic_fetch_add( &g_stages[ job->stage ].numSkipped, 1 );
+		free( job );
+		return;
+	}
+
+	Print( "Copying %s to %s\n", job->input, job->output );
+	if ( plCopyFile( job->input, job->output ) ) {
+		Manifest_Update( key, hash );
+	}
+
+	atomic_fetch_add( &g_stages[ job->stage ].numProcessed, 1 );
+	free( job );
+}
+
 static void ProcessPackagePaths( const char *in, const char *out, const IOPath *paths, unsigned int length ) {
 	for ( unsigned int i = 0; i < length; ++i ) {
 		char output_path[PL_SYSTEM_MAX_PATH];
@@ -500,17 +795,11 @@ static void ProcessPackagePaths( const char *in, const char *out, const IOPath *
 
 		char input_path[PL_SYSTEM_MAX_PATH];
 		snprintf( input_path, sizeof( input_path ), "%s%s", in, paths[ i ].input );
-		Print( "Copying %s to %s\n", input_path, output_path );
-		const char *ext = plGetFileExtension( input_path );
-		if ( pl_strncasecmp( ext, "PTG", 3 ) == 0 ) {
-			ExtractPtgPackage( input_path, output_path );
-		} else {
-			ExtractMadPackage( input_path, output_path );
-		}
+		Jobs_Submit( ExtractPackageJob, CreatePathJob( input_path, output_path, STAGE_PACKAGES ) );
 	}
 }
 
-static void ProcessCopyPaths( const char *in, const char *out, const IOPath *paths, unsigned int length ) {
+static void ProcessCopyPaths( const char *in, const char *out, const IOPath *paths, unsigned int length, unsigned int stage ) {
 	for ( unsigned int i = 0; i < length; ++i ) {
 		char output_path[PL_SYSTEM_MAX_PATH];
 		snprintf( output_path, sizeof( output_path ), "%s%s", out, paths[ i ].output );
@@ -531,19 +820,33 @@ static void ProcessCopyPaths( const char *in, const char *out, const IOPath *pat
 
 		char input_path[PL_SYSTEM_MAX_PATH];
 		snprintf( input_path, sizeof( input_path ), "%s%s", in, paths[ i ].input );
-		Print( "Copying %s to %s\n", input_path, output_path );
-		plCopyFile( input_path, output_path );
+		Jobs_Submit( CopyFileJob, CreatePathJob( input_path, output_path, stage ) );
 	}
 }
 
+static void ExtractPackages( void ) {
+	ProcessPackagePaths( g_input_path, g_output_path, pc_package_paths, plArrayElements( pc_package_paths ) );
+}
+
+static void CopyFiles( void ) {
+	ProcessCopyPaths( g_input_path, g_output_path, pc_copy_paths, plArrayElements( pc_copy_paths ), STAGE_COPY );
+}
+
+static void CopyMusic( void ) {
+	ProcessCopyPaths( g_input_path, g_output_path, pc_music_paths, plArrayElements( pc_music_paths ), STAGE_MUSIC );
+}
+
 int main( int argc, char **argv ) {
 	if ( argc == 1 ) {
 		printf( "Invalid number of arguments ...\n"
-				"  extractor <game_path> -<out_path>\n" );
+				"  extractor <game_path> -<out_path> [--force] [--jobs=<n>]\n"
+				"    --force     ignore the manifest and extract everything again\n"
+				"    --jobs=<n>  number of threads to use, defaults to the number of cores\n" );
 		return EXIT_SUCCESS;
 	}
 
 	plInitialize( argc, argv );
+	Img_InitKernels();
 
 	plRegisterStandardPackageLoaders();
 	plRegisterStandardImageLoaders( PL_IMAGE_FILEFORMAT_TIM | PL_IMAGE_FILEFORMAT_BMP | PL_IMAGE_FILEFORMAT_PNG );
@@ -572,8 +875,14 @@ int main( int argc, char **argv ) {
 	strcpy( g_output_path, "./" );
 #endif
 
+	bool force = false;
+	unsigned int num_threads = 0;
 	for ( int i = 1; i < argc; ++i ) {
-		if ( argv[ i ][ 0 ] == '-' ) {
+		if ( strcmp( argv[ i ], "--force" ) == 0 ) {
+			force = true;
+		} else if ( strncmp( argv[ i ], "--jobs=", 7 ) == 0 ) {
+			num_threads = strtoul( argv[ i ] + 7, NULL, 10 );
+		} else if ( argv[ i ][ 0 ] == '-' ) {
 			strncpy( g_output_path, argv[ i ] + 1, sizeof( g_output_path ) );
 		} else {
 			strncpy( g_input_path, argv[ i ], sizeof( g_input_path ) );
@@ -601,21 +910,33 @@ int main( int argc, char **argv ) {
 		Error( "Unsupported platform!\n" );
 	}
 
+	char manifest_path[PL_SYSTEM_MAX_PATH];
+	snprintf( manifest_path, sizeof( manifest_path ), "%s/extractor.manifest", g_output_path );
+	if ( force && plFileExists( manifest_path ) ) {
+		plDeleteFile( manifest_path );
+	}
+	Manifest_Load( manifest_path );
+
+	Jobs_Initialize( num_threads );
+
 	if ( version_info.platform == PLATFORM_PC || version_info.platform == PLATFORM_PC_DIGITAL ) {
-		ProcessPackagePaths( g_input_path, g_output_path, pc_package_paths, plArrayElements( pc_package_paths ) );
-		ProcessCopyPaths( g_input_path, g_output_path, pc_copy_paths, plArrayElements( pc_copy_paths ) );
+		RunStage( STAGE_PACKAGES, ExtractPackages );
+		RunStage( STAGE_COPY, CopyFiles );
 
 		if ( version_info.platform == PLATFORM_PC_DIGITAL ) {
 			// They've done us the honors for the digital version
-			ProcessCopyPaths( g_input_path, g_output_path, pc_music_paths, plArrayElements( pc_music_paths ) );
+			RunStage( STAGE_MUSIC, CopyMusic );
 		} else {
 			// todo: rip the disc...
 		}
 	}
 
-	MergeTextureTargets();
+	RunStage( STAGE_MERGE, MergeTextureTargets );
+	RunStage( STAGE_MODELS, ConvertModelData );
+
+	Jobs_Shutdown();
 
-	ConvertModelData();
+	PrintStageSummary();
 
 	Print( "Complete!\n" );
 	return EXIT_SUCCESS;
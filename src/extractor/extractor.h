@@ -22,9 +22,12 @@
 #include <PL/platform_image.h>
 #include <PL/platform_console.h>
 
-#define Print( ... )    plLogMessage( 0, __VA_ARGS__ )
-#define Warning( ... )  plLogMessage( 1, __VA_ARGS__ )
-#define Error( ... )    plLogMessage( 2, __VA_ARGS__ ); exit( EXIT_FAILURE )
+#include "jobs.h"
+
+/* output is locked, as these can be called from any of the workers */
+#define Print( ... )    do { Jobs_LockOutput(); plLogMessage( 0, __VA_ARGS__ ); Jobs_UnlockOutput(); } while ( 0 )
+#define Warning( ... )  do { Jobs_LockOutput(); plLogMessage( 1, __VA_ARGS__ ); Jobs_UnlockOutput(); } while ( 0 )
+#define Error( ... )    do { Jobs_LockOutput(); plLogMessage( 2, __VA_ARGS__ ); exit( EXIT_FAILURE ); } while ( 0 )
 
 typedef enum ERegion {
 	REGION_UNKNOWN = -1,
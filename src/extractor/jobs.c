@@ -0,0 +1,208 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <pthread.h>
+
+#if defined( _WIN32 )
+#	include <windows.h>
+#else
+#	include <unistd.h>
+#endif
+
+#include "extractor.h"
+
+#define MAX_WORKER_THREADS  32
+
+typedef struct Job {
+	JobFunction function;
+	void *userData;
+	struct Job *next;
+} Job;
+
+static struct {
+	pthread_t threads[MAX_WORKER_THREADS];
+	unsigned int numThreads;
+
+	pthread_mutex_t mutex;
+	pthread_cond_t jobAvailable;
+	pthread_cond_t jobsComplete;
+
+	Job *head, *tail;
+	/* queued and currently running */
+	unsigned int numPending;
+
+	bool shutdown;
+} pool;
+
+/* initialised statically, as output can happen before the pool is up */
+static pthread_mutex_t outputMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static unsigned int GetNumProcessors( void ) {
+#if defined( _WIN32 )
+	SYSTEM_INFO info;
+	GetSystemInfo( &info );
+	return ( unsigned int ) info.dwNumberOfProcessors;
+#else
+	long num = sysconf( _SC_NPROCESSORS_ONLN );
+	return ( num > 0 ) ? ( unsigned int ) num : 1;
+#endif
+}
+
+/* expects the pool mutex to be held */
+static Job *PopJob( void ) {
+	Job *job = pool.head;
+	if ( job == NULL ) {
+		return NULL;
+	}
+
+	pool.head = job->next;
+	if ( pool.head == NULL ) {
+		pool.tail = NULL;
+	}
+
+	return job;
+}
+
+static void RunJob( Job *job ) {
+	job->function( job->userData );
+	free( job );
+
+	pthread_mutex_lock( &pool.mutex );
+	if ( --pool.numPending == 0 ) {
+		pthread_cond_broadcast( &pool.jobsComplete );
+	}
+	pthread_mutex_unlock( &pool.mutex );
+}
+
+static void *WorkerThread( void *userData ) {
+	( void ) userData;
+
+	for ( ;; ) {
+		pthread_mutex_lock( &pool.mutex );
+		while ( pool.head == NULL && !pool.shutdown ) {
+			pthread_cond_wait( &pool.jobAvailable, &pool.mutex );
+		}
+
+		if ( pool.shutdown ) {
+			pthread_mutex_unlock( &pool.mutex );
+			break;
+		}
+
+		Job *job = PopJob();
+		pthread_mutex_unlock( &pool.mutex );
+
+		RunJob( job );
+	}
+
+	return NULL;
+}
+
+void Jobs_Initialize( unsigned int numThreads ) {
+	if ( numThreads == 0 ) {
+		numThreads = GetNumProcessors();
+	}
+
+	if ( numThreads > MAX_WORKER_THREADS ) {
+		numThreads = MAX_WORKER_THREADS;
+	}
+
+	pthread_mutex_init( &pool.mutex, NULL );
+	pthread_cond_init( &pool.jobAvailable, NULL );
+	pthread_cond_init( &pool.jobsComplete, NULL );
+
+	/* the main thread also works through the queue while it
+	 * waits, so we spawn one less */
+	for ( unsigned int i = 0; i < numThreads - 1; ++i ) {
+		if ( pthread_create( &pool.threads[ pool.numThreads ], NULL, WorkerThread, NULL ) != 0 ) {
+			Warning( "Failed to create worker thread, only %u will be used!\n", pool.numThreads + 1 );
+			break;
+		}
+
+		pool.numThreads++;
+	}
+
+	Print( "Using %u threads for extraction\n", pool.numThreads + 1 );
+}
+
+void Jobs_Shutdown( void ) {
+	Jobs_Wait();
+
+	pthread_mutex_lock( &pool.mutex );
+	pool.shutdown = true;
+	pthread_cond_broadcast( &pool.jobAvailable );
+	pthread_mutex_unlock( &pool.mutex );
+
+	for ( unsigned int i = 0; i < pool.numThreads; ++i ) {
+		pthread_join( pool.threads[ i ], NULL );
+	}
+	pool.numThreads = 0;
+
+	pthread_cond_destroy( &pool.jobsComplete );
+	pthread_cond_destroy( &pool.jobAvailable );
+	pthread_mutex_destroy( &pool.mutex );
+}
+
+unsigned int Jobs_GetNumThreads( void ) {
+	return pool.numThreads + 1;
+}
+
+void Jobs_Submit( JobFunction function, void *userData ) {
+	Job *job = malloc( sizeof( Job ) );
+	if ( job == NULL ) {
+		Error( "Failed to allocate job!\n" );
+	}
+
+	job->function = function;
+	job->userData = userData;
+	job->next = NULL;
+
+	pthread_mutex_lock( &pool.mutex );
+	if ( pool.tail != NULL ) {
+		pool.tail->next = job;
+	} else {
+		pool.head = job;
+	}
+	pool.tail = job;
+	pool.numPending++;
+	pthread_cond_signal( &pool.jobAvailable );
+	pthread_mutex_unlock( &pool.mutex );
+}
+
+void Jobs_Wait( void ) {
+	pthread_mutex_lock( &pool.mutex );
+	while ( pool.numPending > 0 ) {
+		Job *job = PopJob();
+		if ( job == NULL ) {
+			/* everything left is already running elsewhere */
+			pthread_cond_wait( &pool.jobsComplete, &pool.mutex );
+			continue;
+		}
+
+		pthread_mutex_unlock( &pool.mutex );
+		RunJob( job );
+		pthread_mutex_lock( &pool.mutex );
+	}
+	pthread_mutex_unlock( &pool.mutex );
+}
+
+void Jobs_LockOutput( void ) {
+	pthread_mutex_lock( &outputMutex );
+}
+
+void Jobs_UnlockOutput( void ) {
+	pthread_mutex_unlock( &outputMutex );
+}
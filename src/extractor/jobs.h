@@ -0,0 +1,45 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+PL_EXTERN_C
+
+/************************************************************/
+/* Worker Pool */
+
+/* userData is owned by the job, so it's expected to free it
+ * itself once it's done with it */
+typedef void ( *JobFunction )( void *userData );
+
+void Jobs_Initialize( unsigned int numThreads );
+void Jobs_Shutdown( void );
+
+unsigned int Jobs_GetNumThreads( void );
+
+/* jobs can be submitted from any thread, including from
+ * within another job */
+void Jobs_Submit( JobFunction function, void *userData );
+/* blocks until every submitted job has completed, the calling
+ * thread will pick up jobs itself while it waits */
+void Jobs_Wait( void );
+
+/* serialises output from the workers */
+void Jobs_LockOutput( void );
+void Jobs_UnlockOutput( void );
+
+PL_EXTERN_C_END
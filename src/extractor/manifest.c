@@ -0,0 +1,181 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <pthread.h>
+#include <inttypes.h>
+
+#include "extractor.h"
+#include "manifest.h"
+
+/* bump this whenever the output of the extractor changes,
+ * so that existing manifests get thrown out */
+#define MANIFEST_VERSION    1
+
+#define FNV_PRIME   1099511628211ULL
+
+typedef struct ManifestEntry {
+	uint64_t keyHash;
+	uint64_t hash;
+	char key[PL_SYSTEM_MAX_PATH * 2];
+} ManifestEntry;
+
+static struct {
+	char path[PL_SYSTEM_MAX_PATH];
+	ManifestEntry *entries;
+	unsigned int numEntries;
+	unsigned int maxEntries;
+	pthread_mutex_t mutex;
+} manifest = {
+	.mutex = PTHREAD_MUTEX_INITIALIZER
+};
+
+uint64_t Manifest_HashData( const void *data, size_t size, uint64_t hash ) {
+	const uint8_t *p = ( const uint8_t * ) data;
+	for ( size_t i = 0; i < size; ++i ) {
+		hash ^= p[ i ];
+		hash *= FNV_PRIME;
+	}
+
+	return hash;
+}
+
+uint64_t Manifest_HashString( const char *string, uint64_t hash ) {
+	return Manifest_HashData( string, strlen( string ), hash );
+}
+
+bool Manifest_HashFile( const char *path, uint64_t *hash ) {
+	FILE *fp = fopen( path, "rb" );
+	if ( fp == NULL ) {
+		return false;
+	}
+
+	uint8_t buf[65536];
+	size_t n;
+	while ( ( n = fread( buf, 1, sizeof( buf ), fp ) ) > 0 ) {
+		*hash = Manifest_HashData( buf, n, *hash );
+	}
+
+	fclose( fp );
+	return true;
+}
+
+/* expects the manifest mutex to be held */
+static ManifestEntry *FindEntry( const char *key, uint64_t keyHash ) {
+	for ( unsigned int i = 0; i < manifest.numEntries; ++i ) {
+		if ( manifest.entries[ i ].keyHash == keyHash && strcmp( manifest.entries[ i ].key, key ) == 0 ) {
+			return &manifest.entries[ i ];
+		}
+	}
+
+	return NULL;
+}
+
+/* expects the manifest mutex to be held */
+static void SetEntry( const char *key, uint64_t hash ) {
+	uint64_t keyHash = Manifest_HashString( key, MANIFEST_HASH_SEED );
+	ManifestEntry *entry = FindEntry( key, keyHash );
+	if ( entry == NULL ) {
+		if ( manifest.numEntries >= manifest.maxEntries ) {
+			manifest.maxEntries = ( manifest.maxEntries == 0 ) ? 1024 : manifest.maxEntries * 2;
+			manifest.entries = realloc( manifest.entries, sizeof( ManifestEntry ) * manifest.maxEntries );
+			if ( manifest.entries == NULL ) {
+				Error( "Failed to allocate manifest entries!\n" );
+			}
+		}
+
+		entry = &manifest.entries[ manifest.numEntries++ ];
+		entry->keyHash = keyHash;
+		snprintf( entry->key, sizeof( entry->key ), "%s", key );
+	}
+
+	entry->hash = hash;
+}
+
+void Manifest_Load( const char *path ) {
+	snprintf( manifest.path, sizeof( manifest.path ), "%s", path );
+
+	FILE *fp = fopen( path, "r" );
+	if ( fp == NULL ) {
+		/* first run, nothing to do */
+		return;
+	}
+
+	unsigned int version = 0;
+	if ( fscanf( fp, "version %u\n", &version ) != 1 || version != MANIFEST_VERSION ) {
+		Print( "Manifest \"%s\" is out of date, everything will be extracted\n", path );
+		fclose( fp );
+		return;
+	}
+
+	pthread_mutex_lock( &manifest.mutex );
+
+	char line[PL_SYSTEM_MAX_PATH * 2 + 32];
+	while ( fgets( line, sizeof( line ), fp ) != NULL ) {
+		line[ strcspn( line, "\r\n" ) ] = '\0';
+
+		uint64_t hash;
+		int keyOffset;
+		if ( sscanf( line, "%" SCNx64 " %n", &hash, &keyOffset ) != 1 ) {
+			continue;
+		}
+
+		SetEntry( line + keyOffset, hash );
+	}
+
+	pthread_mutex_unlock( &manifest.mutex );
+
+	fclose( fp );
+
+	Print( "Loaded %u entries from manifest \"%s\"\n", manifest.numEntries, path );
+}
+
+void Manifest_Save( void ) {
+	if ( manifest.path[ 0 ] == '\0' ) {
+		return;
+	}
+
+	FILE *fp = fopen( manifest.path, "w" );
+	if ( fp == NULL ) {
+		Warning( "Failed to write manifest, \"%s\"!\n", manifest.path );
+		return;
+	}
+
+	pthread_mutex_lock( &manifest.mutex );
+
+	fprintf( fp, "version %u\n", MANIFEST_VERSION );
+	for ( unsigned int i = 0; i < manifest.numEntries; ++i ) {
+		fprintf( fp, "%016" PRIx64 " %s\n", manifest.entries[ i ].hash, manifest.entries[ i ].key );
+	}
+
+	pthread_mutex_unlock( &manifest.mutex );
+
+	fclose( fp );
+}
+
+bool Manifest_IsUpToDate( const char *key, uint64_t hash ) {
+	pthread_mutex_lock( &manifest.mutex );
+	ManifestEntry *entry = FindEntry( key, Manifest_HashString( key, MANIFEST_HASH_SEED ) );
+	bool status = ( entry != NULL && entry->hash == hash );
+	pthread_mutex_unlock( &manifest.mutex );
+	return status;
+}
+
+void Manifest_Update( const char *key, uint64_t hash ) {
+	pthread_mutex_lock( &manifest.mutex );
+	SetEntry( key, hash );
+	pthread_mutex_unlock( &manifest.mutex );
+}
@@ -0,0 +1,39 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+PL_EXTERN_C
+
+/************************************************************/
+/* Extraction Manifest
+ * Records a content hash for each unit of work, so that a
+ * later run can skip anything whose input hasn't changed. */
+
+#define MANIFEST_HASH_SEED  14695981039346656037ULL
+
+uint64_t Manifest_HashData( const void *data, size_t size, uint64_t hash );
+uint64_t Manifest_HashString( const char *string, uint64_t hash );
+bool Manifest_HashFile( const char *path, uint64_t *hash );
+
+void Manifest_Load( const char *path );
+void Manifest_Save( void );
+
+bool Manifest_IsUpToDate( const char *key, uint64_t hash );
+void Manifest_Update( const char *key, uint64_t hash );
+
+PL_EXTERN_C_END
@@ -0,0 +1,220 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#if defined( _WIN32 )
+#	include <windows.h>
+#else
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <fcntl.h>
+#	include <unistd.h>
+#endif
+
+#include <stdatomic.h>
+
+#include "extractor.h"
+#include "package.h"
+
+static bool MapFile( Package *package, const char *path ) {
+#if defined( _WIN32 )
+	HANDLE handle = CreateFileA( path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+	if ( handle == INVALID_HANDLE_VALUE ) {
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	if ( !GetFileSizeEx( handle, &size ) || size.QuadPart == 0 ) {
+		CloseHandle( handle );
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA( handle, NULL, PAGE_READONLY, 0, 0, NULL );
+	if ( mapping == NULL ) {
+		CloseHandle( handle );
+		return false;
+	}
+
+	void *data = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+	if ( data == NULL ) {
+		CloseHandle( mapping );
+		CloseHandle( handle );
+		return false;
+	}
+
+	package->handle = handle;
+	package->mapping = mapping;
+	package->data = data;
+	package->size = ( size_t ) size.QuadPart;
+#else
+	int fd = open( path, O_RDONLY );
+	if ( fd == -1 ) {
+		return false;
+	}
+
+	struct stat st;
+	if ( fstat( fd, &st ) != 0 || st.st_size == 0 ) {
+		close( fd );
+		return false;
+	}
+
+	void *data = mmap( NULL, ( size_t ) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+	close( fd );
+	if ( data == MAP_FAILED ) {
+		return false;
+	}
+
+	package->data = data;
+	package->size = ( size_t ) st.st_size;
+#endif
+
+	return true;
+}
+
+static void UnmapFile( Package *package ) {
+	if ( package->data == NULL ) {
+		return;
+	}
+
+#if defined( _WIN32 )
+	UnmapViewOfFile( package->data );
+	CloseHandle( package->mapping );
+	CloseHandle( package->handle );
+#else
+	munmap( ( void * ) package->data, package->size );
+#endif
+}
+
+static bool ParsePtg( Package *package ) {
+	uint32_t num_textures;
+	if ( package->size < sizeof( num_textures ) ) {
+		return false;
+	}
+
+	memcpy( &num_textures, package->data, sizeof( num_textures ) );
+	if ( num_textures == 0 ) {
+		return false;
+	}
+
+	/* all of the textures are the same size */
+	size_t tim_size = ( package->size - sizeof( num_textures ) ) / num_textures;
+	if ( tim_size == 0 ) {
+		return false;
+	}
+
+	package->members = calloc( num_textures, sizeof( PackageMember ) );
+	if ( package->members == NULL ) {
+		Error( "Failed to allocate package members!\n" );
+	}
+
+	package->num_members = num_textures;
+	for ( unsigned int i = 0; i < num_textures; ++i ) {
+		snprintf( package->members[ i ].name, sizeof( package->members[ i ].name ), "%u.tim", i );
+		package->members[ i ].data = package->data + sizeof( num_textures ) + ( tim_size * i );
+		package->members[ i ].size = tim_size;
+	}
+
+	return true;
+}
+
+static bool ParseNamed( Package *package ) {
+	typedef struct __attribute__((packed)) MadIndex {
+		char name[16];
+		uint32_t offset;
+		uint32_t length;
+	} MadIndex;
+	_Static_assert( sizeof( MadIndex ) == 24, "invalid struct size" );
+
+	MadIndex index;
+	if ( package->size < sizeof( index ) ) {
+		return false;
+	}
+
+	/* the table runs up until the data of the first entry */
+	memcpy( &index, package->data, sizeof( index ) );
+	if ( index.offset == 0 || index.offset % sizeof( index ) != 0 || index.offset > package->size ) {
+		return false;
+	}
+
+	unsigned int num_members = index.offset / sizeof( index );
+	package->members = calloc( num_members, sizeof( PackageMember ) );
+	if ( package->members == NULL ) {
+		Error( "Failed to allocate package members!\n" );
+	}
+
+	for ( unsigned int i = 0; i < num_members; ++i ) {
+		memcpy( &index, package->data + ( i * sizeof( index ) ), sizeof( index ) );
+		if ( index.offset > package->size || index.length > package->size - index.offset ) {
+			Warning( "Member %u in package is out of bounds, ignoring the rest!\n", i );
+			break;
+		}
+
+		PackageMember *member = &package->members[ package->num_members++ ];
+		memcpy( member->name, index.name, sizeof( index.name ) );
+		member->name[ sizeof( index.name ) ] = '\0';
+		member->data = package->data + index.offset;
+		member->size = index.length;
+	}
+
+	return ( package->num_members > 0 );
+}
+
+Package *Pkg_LoadFile( const char *path ) {
+	Package *package = calloc( 1, sizeof( Package ) );
+	if ( package == NULL ) {
+		Error( "Failed to allocate package!\n" );
+	}
+
+	atomic_init( &package->references, 1 );
+
+	if ( !MapFile( package, path ) ) {
+		free( package );
+		return NULL;
+	}
+
+	const char *ext = plGetFileExtension( path );
+	bool status = ( pl_strcasecmp( ext, "ptg" ) == 0 ) ? ParsePtg( package ) : ParseNamed( package );
+	if ( !status ) {
+		Pkg_Release( package );
+		return NULL;
+	}
+
+	return package;
+}
+
+const PackageMember *Pkg_GetMember( const Package *package, const char *name ) {
+	for ( unsigned int i = 0; i < package->num_members; ++i ) {
+		if ( pl_strcasecmp( package->members[ i ].name, name ) == 0 ) {
+			return &package->members[ i ];
+		}
+	}
+
+	return NULL;
+}
+
+void Pkg_Retain( Package *package ) {
+	atomic_fetch_add( &package->references, 1 );
+}
+
+void Pkg_Release( Package *package ) {
+	if ( package == NULL || atomic_fetch_sub( &package->references, 1 ) != 1 ) {
+		return;
+	}
+
+	UnmapFile( package );
+	free( package->members );
+	free( package );
+}
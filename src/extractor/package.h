@@ -0,0 +1,54 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdatomic.h>
+
+PL_EXTERN_C
+
+/************************************************************/
+/* Mapped MAD/MTD/PTG Packages
+ * Members are views straight into the mapped file, so they're
+ * only valid while a reference to the package is held. */
+
+typedef struct PackageMember {
+	char name[32];
+	const uint8_t *data;
+	size_t size;
+} PackageMember;
+
+typedef struct Package {
+	const uint8_t *data;
+	size_t size;
+
+	PackageMember *members;
+	unsigned int num_members;
+
+	atomic_uint references;
+
+	void *handle;       /* platform specific */
+	void *mapping;      /* platform specific */
+} Package;
+
+Package *Pkg_LoadFile( const char *path );
+const PackageMember *Pkg_GetMember( const Package *package, const char *name );
+
+void Pkg_Retain( Package *package );
+void Pkg_Release( Package *package );
+
+PL_EXTERN_C_END
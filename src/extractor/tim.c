@@ -0,0 +1,153 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 TalonBrave.info and Others (see CONTRIBUTORS)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stddef.h>
+
+#include "extractor.h"
+#include "tim.h"
+#include "ImageKernels.h"
+
+/************************************************************/
+/* PSX Tim Image Format */
+
+#define TIM_IDENT       0x10
+
+#define TIM_MODE_4BPP   0
+#define TIM_MODE_8BPP   1
+#define TIM_MODE_16BPP  2
+#define TIM_MODE_24BPP  3
+#define TIM_FLAG_CLUT   8
+
+typedef struct __attribute__((packed)) TimBlock {
+	uint32_t length;    // includes this header
+	uint16_t x, y;
+	uint16_t w, h;      // width is in 16-bit units
+} TimBlock;
+
+PLImage *Tim_LoadMemory( const uint8_t *data, size_t size, const char *name ) {
+	uint32_t header[2];
+	if ( size < sizeof( header ) ) {
+		Warning( "Unexpected end of Tim, \"%s\"!\n", name );
+		return NULL;
+	}
+
+	memcpy( header, data, sizeof( header ) );
+	if ( header[ 0 ] != TIM_IDENT ) {
+		Warning( "Invalid identifier for Tim, \"%s\"!\n", name );
+		return NULL;
+	}
+
+	const uint8_t *pos = data + sizeof( header );
+	const uint8_t *end = data + size;
+
+	unsigned int mode = header[ 1 ] & 3;
+
+	// Only the first palette is used
+	const uint8_t *clut = NULL;
+	unsigned int clutSize = 0;
+	if ( header[ 1 ] & TIM_FLAG_CLUT ) {
+		TimBlock block;
+		if ( end - pos < ( ptrdiff_t ) sizeof( TimBlock ) ) {
+			Warning( "Unexpected end of Tim, \"%s\"!\n", name );
+			return NULL;
+		}
+
+		memcpy( &block, pos, sizeof( TimBlock ) );
+		clut = pos + sizeof( TimBlock );
+		clutSize = block.w;
+		if ( block.length < sizeof( TimBlock ) || end - pos < ( ptrdiff_t ) block.length ||
+		     clutSize * 2 > block.length - sizeof( TimBlock ) ) {
+			Warning( "Invalid palette in Tim, \"%s\"!\n", name );
+			return NULL;
+		}
+
+		pos += block.length;
+	} else if ( mode == TIM_MODE_4BPP || mode == TIM_MODE_8BPP ) {
+		Warning( "Missing palette in Tim, \"%s\"!\n", name );
+		return NULL;
+	}
+
+	TimBlock block;
+	if ( end - pos < ( ptrdiff_t ) sizeof( TimBlock ) ) {
+		Warning( "Unexpected end of Tim, \"%s\"!\n", name );
+		return NULL;
+	}
+
+	memcpy( &block, pos, sizeof( TimBlock ) );
+	pos += sizeof( TimBlock );
+
+	unsigned int width;
+	switch ( mode ) {
+		case TIM_MODE_4BPP: width = block.w * 4; break;
+		case TIM_MODE_8BPP: width = block.w * 2; break;
+		case TIM_MODE_16BPP: width = block.w; break;
+		default: width = ( block.w * 2 ) / 3; break;
+	}
+
+	unsigned int height = block.h;
+	size_t stride = block.w * 2;
+	if ( width == 0 || height == 0 || ( size_t ) ( end - pos ) < stride * height ) {
+		Warning( "Invalid image data in Tim, \"%s\"!\n", name );
+		return NULL;
+	}
+
+	PLImage *image = plCreateImage( NULL, width, height, PL_COLOURFORMAT_RGBA, PL_IMAGEFORMAT_RGBA8 );
+	if ( image == NULL ) {
+		Warning( "Failed to create image for Tim, \"%s\" (%s)!\n", name, plGetError() );
+		return NULL;
+	}
+
+	snprintf( image->path, sizeof( image->path ), "%s", name );
+
+	// Decode the palette up front, so indexed pixels are just a lookup
+	uint8_t palette[ 256 * 4 ] = { 0 };
+	if ( clut != NULL ) {
+		clutSize = ( clutSize < 256 ) ? clutSize : 256;
+		Img_ConvertRGB5A1ToRGBA8( clut, palette, clutSize );
+	}
+
+	uint8_t *dst = image->data[ 0 ];
+	for ( unsigned int y = 0; y < height; ++y, pos += stride, dst += width * 4 ) {
+		switch ( mode ) {
+			case TIM_MODE_16BPP:
+				Img_ConvertRGB5A1ToRGBA8( pos, dst, width );
+				continue;
+			case TIM_MODE_24BPP:
+				Img_ConvertRGB8ToRGBA8( pos, dst, width );
+				continue;
+			default:
+				break;
+		}
+
+		for ( unsigned int x = 0; x < width; ++x ) {
+			unsigned int index;
+			if ( mode == TIM_MODE_4BPP ) {
+				index = ( pos[ x / 2 ] >> ( ( x & 1 ) * 4 ) ) & 15;
+			} else {
+				index = pos[ x ];
+			}
+
+			if ( index >= clutSize ) {
+				index = 0;
+			}
+
+			memcpy( dst + x * 4, palette + index * 4, 4 );
+		}
+	}
+
+	return image;
+}
@@ -19,6 +19,8 @@
 #include <PL/platform_image.h>
 #include <PL/platform_console.h>
 
+#include "ImageKernels.h"
+
 /**
  * Img2Pmg
  * This tool will convert any four channel image into a PMG file
@@ -76,27 +78,19 @@ static void LoadHeightmap( const char *path, int multiplier ) {
 
 	unsigned int channelLength = image->width * image->height;
 
+	if ( !Img_ConvertImageToRGBA8( image ) ) {
+		Error( "Failed to convert heightmap to RGBA8, \"%s\"!\nPL: %s\n", path, plGetError() );
+	}
+
 	/* height */
 	float *redChannel = malloc( sizeof( float ) * channelLength );
-	uint8_t *pixel = image->data[ 0 ];
-	for ( unsigned int i = 0; i < channelLength; ++i ) {
-		redChannel[ i ] = (float) ( *pixel * multiplier );
-		pixel += 4;
-	}
+	Img_ExtractChannelF( image->data[ 0 ], channelLength, 0, (float) multiplier, redChannel );
 
 	uint8_t *greenChannel = malloc( sizeof( uint8_t ) * channelLength );
-	pixel = image->data[ 0 ] + 1;
-	for ( unsigned int i = 0; i < channelLength; ++i ) {
-		greenChannel[ i ] = *pixel;
-		pixel += 4;
-	}
+	Img_ExtractChannel( image->data[ 0 ], channelLength, 1, greenChannel );
 
 	uint8_t *alphaChannel = malloc( sizeof( uint8_t ) * channelLength );
-	pixel = image->data[ 0 ] + 3;
-	for ( unsigned int i = 0; i < channelLength; ++i ) {
-		alphaChannel[ i ] = *pixel;
-		pixel += 4;
-	}
+	Img_ExtractChannel( image->data[ 0 ], channelLength, 3, alphaChannel );
 
 	plDestroyImage( image );
 
@@ -213,6 +207,7 @@ static void WritePmg( const char *path ) {
 
 int main(int argc, char **argv) {
 	plInitialize(argc, argv);
+	Img_InitKernels();
 
 	plSetupLogOutput( "Img2Pmg.txt" );
 